@@ -13,12 +13,17 @@ namespace algorithms {
 
 using namespace structures;
 
-void extract_containing_graph(const HandleGraph* source,
-                              MutableHandleGraph* into,
-                              const vector<pos_t>& positions,
-                              const vector<size_t>& forward_search_lengths,
-                              const vector<size_t>& backward_search_lengths,
-                              size_t reversing_walk_length) {
+/// Does the Dijkstra search for extract_containing_graph. Calls add_node with the forward handle of
+/// each node the first time it is reached, and add_edge with every edge crossed. Edges can be reported
+/// before the node on their far side is.
+template<typename AddNode, typename AddEdge>
+void extract_containing_graph_internal(const HandleGraph* source,
+                                       const vector<pos_t>& positions,
+                                       const vector<size_t>& forward_search_lengths,
+                                       const vector<size_t>& backward_search_lengths,
+                                       size_t reversing_walk_length,
+                                       const AddNode& add_node,
+                                       const AddEdge& add_edge) {
     
     if (forward_search_lengths.size() != backward_search_lengths.size()
         || forward_search_lengths.size() != positions.size()) {
@@ -26,11 +31,6 @@ void extract_containing_graph(const HandleGraph* source,
         assert(false);
     }
     
-    if (into->node_size()) {
-        cerr << "error:[extract_containing_graph] must extract into an empty graph" << endl;
-        assert(false);
-    }
-    
 #ifdef debug_vg_algorithms
     cerr << "[extract_containing_graph] extracting containing graph from the following points:" << endl;
     for (size_t i = 0; i < positions.size(); i ++) {
@@ -45,9 +45,6 @@ void extract_containing_graph(const HandleGraph* source,
     int64_t max_search_length = max(*std::max_element(forward_search_lengths.begin(), forward_search_lengths.end()),
                                     *std::max_element(backward_search_lengths.begin(), backward_search_lengths.end()));
     
-    // for keeping track of all the edges we cross to add later
-    unordered_set<edge_t> observed_edges;
-    
     // initialize the queue, opposite order so priority queue selects minimum
     // priority represent distance from starting pos to the left side of this node
     RankPairingHeap<handle_t, int64_t, greater<int64_t>> queue;
@@ -58,9 +55,7 @@ void extract_containing_graph(const HandleGraph* source,
         handle_t source_handle = source->get_handle(id(pos), false);
         
         // add all of the initial nodes to the graph
-        if (!into->has_node(id(pos))) {
-            into->create_handle(source->get_sequence(source_handle), id(pos));
-        }
+        add_node(source_handle);
         
         // compute the modified search lengths
         int64_t dist_forward = -offset(pos) + max_search_length - forward_search_lengths[i];
@@ -77,9 +72,7 @@ void extract_containing_graph(const HandleGraph* source,
         queue.pop();
         
         // make sure the node is in the graph
-        if (!into->has_node(source->get_id(trav.first))) {
-            into->create_handle(source->get_sequence(source->forward(trav.first)), source->get_id(trav.first));
-        }
+        add_node(source->forward(trav.first));
         
         int64_t dist_thru = trav.second + source->get_length(trav.first);
         
@@ -89,7 +82,7 @@ void extract_containing_graph(const HandleGraph* source,
             // look locally right from this position
             source->follow_edges(trav.first, false, [&](const handle_t& next) {
                 // record the edge
-                observed_edges.insert(source->edge_handle(trav.first, next));
+                add_edge(source->edge_handle(trav.first, next));
                 
                 // add it to the queue
                 queue.push_or_reprioritize(next, dist_thru);
@@ -107,13 +100,41 @@ void extract_containing_graph(const HandleGraph* source,
             // look locally right from this position
             source->follow_edges(flipped, false, [&](const handle_t& next) {
                 // record the edge
-                observed_edges.insert(source->edge_handle(flipped, next));
+                add_edge(source->edge_handle(flipped, next));
                 
                 // add it to the queue
                 queue.push_or_reprioritize(next, max_search_length - reversing_walk_length);
             });
         }
     }
+}
+
+void extract_containing_graph(const HandleGraph* source,
+                              MutableHandleGraph* into,
+                              const vector<pos_t>& positions,
+                              const vector<size_t>& forward_search_lengths,
+                              const vector<size_t>& backward_search_lengths,
+                              size_t reversing_walk_length) {
+    
+    if (into->node_size()) {
+        cerr << "error:[extract_containing_graph] must extract into an empty graph" << endl;
+        assert(false);
+    }
+    
+    // for keeping track of all the edges we cross to add later
+    unordered_set<edge_t> observed_edges;
+    
+    extract_containing_graph_internal(source, positions, forward_search_lengths, backward_search_lengths,
+                                      reversing_walk_length,
+                                      [&](const handle_t& handle) {
+        id_t node_id = source->get_id(handle);
+        if (!into->has_node(node_id)) {
+            into->create_handle(source->get_sequence(handle), node_id);
+        }
+    },
+                                      [&](const edge_t& edge) {
+        observed_edges.insert(edge);
+    });
     
     // add the edges to the graph
     for (const edge_t& edge : observed_edges) {
@@ -122,6 +143,27 @@ void extract_containing_graph(const HandleGraph* source,
     }
 }
 
+void extract_containing_graph(const HandleGraph* source,
+                              SubHandleGraph* into,
+                              const vector<pos_t>& positions,
+                              const vector<size_t>& forward_search_lengths,
+                              const vector<size_t>& backward_search_lengths,
+                              size_t reversing_walk_length) {
+    
+    if (into->node_size()) {
+        cerr << "error:[extract_containing_graph] must extract into an empty graph" << endl;
+        assert(false);
+    }
+    
+    // the subgraph induces its edges from the source, so we only need the nodes
+    extract_containing_graph_internal(source, positions, forward_search_lengths, backward_search_lengths,
+                                      reversing_walk_length,
+                                      [&](const handle_t& handle) {
+        into->add_handle(handle);
+    },
+                                      [](const edge_t& edge) {});
+}
+
 void extract_containing_graph(const HandleGraph* source, MutableHandleGraph* into, const vector<pos_t>& positions,
                               size_t max_dist, size_t reversing_walk_length) {
     
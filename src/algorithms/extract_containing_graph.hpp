@@ -11,6 +11,7 @@
 
 #include "../position.hpp"
 #include "../handle.hpp"
+#include "../subgraph.hpp"
 
 #include <structures/rank_pairing_heap.hpp>
 
@@ -52,6 +53,16 @@ namespace algorithms {
                                   const vector<size_t>& position_forward_max_dist,
                                   const vector<size_t>& position_backward_max_dist,
                                   size_t reversing_walk_length = 0);
+    
+    /// Same semantics as previous except that the subgraph is a view over the source graph, which
+    /// is filled with the nodes that are found. The view contains all edges between these nodes,
+    /// including any that the search did not cross. Nothing is copied out of the source graph, so
+    /// this is the cheaper choice when the subgraph will only be read.
+    void extract_containing_graph(const HandleGraph* source, SubHandleGraph* into,
+                                  const vector<pos_t>& positions,
+                                  const vector<size_t>& position_forward_max_dist,
+                                  const vector<size_t>& position_backward_max_dist,
+                                  size_t reversing_walk_length = 0);
 
 }
 }
@@ -2,6 +2,8 @@
 
 #include <sstream>
 #include <regex>
+#include <cerrno>
+#include <cstdlib>
 
 namespace vg {
 
@@ -486,6 +488,426 @@ size_t fastq_paired_two_files_for_each(const string& file1, const string& file2,
 
 }
 
+string alignment_to_gaf(const HandleGraph& graph, const Alignment& aln) {
+    const Path& path = aln.path();
+    
+    string line = aln.name().empty() ? "*" : aln.name();
+    line += '\t';
+    line += to_string(aln.sequence().size());
+    
+    if (path.mapping_size() == 0) {
+        // Unaligned reads have no path to describe
+        line += "\t*\t*\t*\t*\t*\t*\t*\t0\t0\t255";
+        return line;
+    }
+    
+    // Softclips are left out of the query range and the difference string
+    size_t query_start = softclip_start(aln);
+    size_t query_end = max<size_t>(query_start, aln.sequence().size() - softclip_end(aln));
+    
+    string path_string;
+    size_t path_length = 0;
+    size_t path_start = path.mapping(0).position().offset();
+    size_t path_end = path_start;
+    size_t matches = 0;
+    size_t block_length = 0;
+    
+    // Build the cs difference string, merging matches across nodes
+    string difference;
+    size_t pending_match = 0;
+    auto flush_match = [&]() {
+        if (pending_match > 0) {
+            difference += ':';
+            difference += to_string(pending_match);
+            pending_match = 0;
+        }
+    };
+    auto append_lower = [&](const string& bases, size_t start, size_t length) {
+        for (size_t k = start; k < start + length; k++) {
+            difference += (char) tolower(bases[k]);
+        }
+    };
+    
+    for (size_t i = 0; i < path.mapping_size(); i++) {
+        const Mapping& mapping = path.mapping(i);
+        handle_t handle = graph.get_handle(mapping.position().node_id(), mapping.position().is_reverse());
+        path_string += mapping.position().is_reverse() ? '<' : '>';
+        path_string += to_string(mapping.position().node_id());
+        path_length += graph.get_length(handle);
+        
+        // We only need the node sequence for substitutions and deletions
+        string node_sequence;
+        size_t node_offset = mapping.position().offset();
+        
+        for (size_t j = 0; j < mapping.edit_size(); j++) {
+            const Edit& edit = mapping.edit(j);
+            if (edit.from_length() == 0 && edit.to_length() > 0 &&
+                ((i == 0 && j == 0) || (i + 1 == path.mapping_size() && j + 1 == mapping.edit_size()))) {
+                // Softclips are already described by the query range
+                continue;
+            }
+            
+            if (edit_is_match(edit)) {
+                pending_match += edit.from_length();
+                matches += edit.from_length();
+            } else {
+                flush_match();
+                if (edit.from_length() > 0 && node_sequence.empty()) {
+                    node_sequence = graph.get_sequence(handle);
+                }
+                if (edit_is_sub(edit)) {
+                    for (size_t k = 0; k < edit.from_length(); k++) {
+                        difference += '*';
+                        difference += (char) tolower(node_sequence[node_offset + k]);
+                        difference += (char) tolower(edit.sequence()[k]);
+                    }
+                } else {
+                    // Anything else is a deletion of the graph bases, an
+                    // insertion of the read bases, or both.
+                    if (edit.from_length() > 0) {
+                        difference += '-';
+                        append_lower(node_sequence, node_offset, edit.from_length());
+                    }
+                    if (edit.to_length() > 0) {
+                        difference += '+';
+                        append_lower(edit.sequence(), 0, edit.to_length());
+                    }
+                }
+            }
+            
+            block_length += max(edit.from_length(), edit.to_length());
+            node_offset += edit.from_length();
+            path_end += edit.from_length();
+        }
+    }
+    flush_match();
+    
+    line += '\t';
+    line += to_string(query_start);
+    line += '\t';
+    line += to_string(query_end);
+    // Orientation is carried by the path, so the read is always forward
+    line += "\t+\t";
+    line += path_string;
+    line += '\t';
+    line += to_string(path_length);
+    line += '\t';
+    line += to_string(path_start);
+    line += '\t';
+    line += to_string(path_end);
+    line += '\t';
+    line += to_string(matches);
+    line += '\t';
+    line += to_string(block_length);
+    line += '\t';
+    line += to_string(aln.mapping_quality());
+    line += "\tAS:i:";
+    line += to_string(aln.score());
+    line += "\ttp:A:";
+    line += aln.is_secondary() ? 'S' : 'P';
+    line += "\tcs:Z:";
+    line += difference;
+    
+    return line;
+}
+
+/// Parse all of a GAF field as an unsigned number. Returns false instead of
+/// throwing if it is not one, since GAF is parsed in parallel regions.
+static bool parse_gaf_unsigned(const string& text, size_t& value) {
+    if (text.empty() || !isdigit(text[0])) {
+        return false;
+    }
+    errno = 0;
+    char* end;
+    unsigned long long parsed = strtoull(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || parsed > numeric_limits<size_t>::max()) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+/// Parse all of a GAF field as a signed number that fits in an int.
+static bool parse_gaf_int(const string& text, int& value) {
+    if (text.empty()) {
+        return false;
+    }
+    errno = 0;
+    char* end;
+    long long parsed = strtoll(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || parsed < numeric_limits<int>::min() || parsed > numeric_limits<int>::max()) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool gaf_to_alignment(const HandleGraph& graph, const string& line, Alignment& aln) {
+    aln.Clear();
+    
+    vector<string> fields = split_delims(line, "\t");
+    if (fields.size() < 12) {
+        return false;
+    }
+    
+    if (fields[0] != "*") {
+        aln.set_name(fields[0]);
+    }
+    size_t query_length;
+    if (!parse_gaf_unsigned(fields[1], query_length) || query_length > aln.sequence().max_size()) {
+        return false;
+    }
+    
+    if (fields[5] == "*") {
+        // Unaligned read; we never had its bases.
+        aln.set_sequence(string(query_length, 'N'));
+        return true;
+    }
+    
+    size_t query_start;
+    size_t query_end;
+    size_t path_start;
+    int mapping_quality;
+    if (!parse_gaf_unsigned(fields[2], query_start) || !parse_gaf_unsigned(fields[3], query_end) ||
+        !parse_gaf_unsigned(fields[7], path_start) || !parse_gaf_int(fields[11], mapping_quality)) {
+        return false;
+    }
+    if (query_start > query_end || query_end > query_length) {
+        return false;
+    }
+    aln.set_mapping_quality(mapping_quality);
+    
+    // Parse the oriented node IDs
+    vector<handle_t> handles;
+    const string& path_string = fields[5];
+    for (size_t i = 0; i < path_string.size();) {
+        if (path_string[i] != '<' && path_string[i] != '>') {
+            return false;
+        }
+        size_t next = path_string.find_first_of("<>", i + 1);
+        if (next == string::npos) {
+            next = path_string.size();
+        }
+        size_t node_id;
+        if (!parse_gaf_unsigned(path_string.substr(i + 1, next - i - 1), node_id) ||
+            node_id > (size_t) numeric_limits<id_t>::max() || !graph.has_node(node_id)) {
+            return false;
+        }
+        handles.push_back(graph.get_handle(node_id, path_string[i] == '<'));
+        i = next;
+    }
+    if (handles.empty()) {
+        return false;
+    }
+    
+    string difference;
+    for (size_t i = 12; i < fields.size(); i++) {
+        if (fields[i].compare(0, 5, "AS:i:") == 0) {
+            int score;
+            if (!parse_gaf_int(fields[i].substr(5), score)) {
+                return false;
+            }
+            aln.set_score(score);
+        } else if (fields[i] == "tp:A:S") {
+            aln.set_is_secondary(true);
+        } else if (fields[i].compare(0, 5, "cs:Z:") == 0) {
+            difference = fields[i].substr(5);
+        }
+    }
+    
+    // Walk the path, splitting graph-consuming operations at node boundaries
+    Path& path = *aln.mutable_path();
+    string& sequence = *aln.mutable_sequence();
+    size_t node_index = 0;
+    size_t node_offset = path_start;
+    string node_sequence = graph.get_sequence(handles[0]);
+    if (path_start > node_sequence.size()) {
+        return false;
+    }
+    Mapping* mapping = nullptr;
+    auto add_mapping = [&]() {
+        mapping = path.add_mapping();
+        mapping->mutable_position()->set_node_id(graph.get_id(handles[node_index]));
+        mapping->mutable_position()->set_is_reverse(graph.get_is_reverse(handles[node_index]));
+        mapping->mutable_position()->set_offset(node_offset);
+        mapping->set_rank(path.mapping_size());
+    };
+    add_mapping();
+    
+    auto add_insertion = [&](const string& bases) {
+        Edit* edit = mapping->add_edit();
+        edit->set_to_length(bases.size());
+        edit->set_sequence(bases);
+        sequence += bases;
+    };
+    
+    // Consume length graph bases as matches, substitutions by the given read
+    // bases, or deletions.
+    auto consume = [&](size_t length, char op, const string& read_bases) -> bool {
+        size_t used = 0;
+        while (used < length) {
+            if (node_offset == node_sequence.size()) {
+                if (node_index + 1 == handles.size()) {
+                    // Ran off the end of the path
+                    return false;
+                }
+                node_index++;
+                node_offset = 0;
+                node_sequence = graph.get_sequence(handles[node_index]);
+                add_mapping();
+            }
+            size_t take = min(length - used, node_sequence.size() - node_offset);
+            
+            // Extend the last edit if it is of the same kind
+            Edit* edit = nullptr;
+            if (mapping->edit_size() > 0) {
+                Edit* last = mapping->mutable_edit(mapping->edit_size() - 1);
+                if ((op == ':' && edit_is_match(*last)) || (op == '*' && edit_is_sub(*last)) ||
+                    (op == '-' && edit_is_deletion(*last))) {
+                    edit = last;
+                }
+            }
+            if (edit == nullptr) {
+                edit = mapping->add_edit();
+            }
+            
+            edit->set_from_length(edit->from_length() + take);
+            if (op == ':') {
+                edit->set_to_length(edit->to_length() + take);
+                sequence += node_sequence.substr(node_offset, take);
+            } else if (op == '*') {
+                string bases = read_bases.substr(used, take);
+                edit->set_to_length(edit->to_length() + take);
+                *edit->mutable_sequence() += bases;
+                sequence += bases;
+            }
+            used += take;
+            node_offset += take;
+        }
+        return true;
+    };
+    
+    if (query_start > 0) {
+        add_insertion(string(query_start, 'N'));
+    }
+    
+    for (size_t i = 0; i < difference.size();) {
+        char op = difference[i++];
+        size_t end = i;
+        if (op == ':') {
+            while (end < difference.size() && isdigit(difference[end])) {
+                end++;
+            }
+            size_t length;
+            if (!parse_gaf_unsigned(difference.substr(i, end - i), length) || !consume(length, op, "")) {
+                return false;
+            }
+        } else if (op == '*') {
+            if (i + 2 > difference.size()) {
+                return false;
+            }
+            end = i + 2;
+            if (!consume(1, op, string(1, toupper(difference[i + 1])))) {
+                return false;
+            }
+        } else if (op == '+' || op == '-') {
+            while (end < difference.size() && isalpha(difference[end])) {
+                end++;
+            }
+            string bases = difference.substr(i, end - i);
+            for (auto& base : bases) {
+                base = toupper(base);
+            }
+            if (bases.empty()) {
+                return false;
+            }
+            if (op == '+') {
+                add_insertion(bases);
+            } else if (!consume(bases.size(), op, "")) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+        i = end;
+    }
+    
+    if (query_end < query_length) {
+        add_insertion(string(query_length - query_end, 'N'));
+    }
+    
+    aln.set_identity(identity(path));
+    return true;
+}
+
+size_t gaf_unpaired_for_each(const HandleGraph& graph, const string& filename, function<void(Alignment&)> lambda) {
+    ifstream in_file;
+    if (filename != "-") {
+        in_file.open(filename);
+        if (!in_file) {
+            cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
+        }
+    }
+    istream& in = (filename != "-") ? in_file : cin;
+    
+    size_t nLines = 0;
+    string line;
+    Alignment aln;
+    while (getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (!gaf_to_alignment(graph, line, aln)) {
+            cerr << "[vg::alignment.cpp] couldn't parse GAF line: " << line << endl; exit(1);
+        }
+        lambda(aln);
+        nLines++;
+    }
+    return nLines;
+}
+
+size_t gaf_unpaired_for_each_parallel(const HandleGraph& graph, const string& filename, function<void(Alignment&)> lambda) {
+    ifstream in_file;
+    if (filename != "-") {
+        in_file.open(filename);
+        if (!in_file) {
+            cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
+        }
+    }
+    istream& in = (filename != "-") ? in_file : cin;
+    
+    // Lines are independent, so we only need to read them in order.
+    const size_t batch_size = 1 << 16;
+    vector<string> batch;
+    batch.reserve(batch_size);
+    
+    size_t nLines = 0;
+    bool more_data = true;
+    while (more_data) {
+        batch.clear();
+        string line;
+        while (batch.size() < batch_size && (more_data = (bool) getline(in, line))) {
+            if (!line.empty()) {
+                batch.emplace_back(std::move(line));
+            }
+        }
+        
+#pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < batch.size(); i++) {
+            Alignment aln;
+            if (!gaf_to_alignment(graph, batch[i], aln)) {
+#pragma omp critical (cerr)
+                {
+                    cerr << "[vg::alignment.cpp] couldn't parse GAF line: " << batch[i] << endl; exit(1);
+                }
+            }
+            lambda(aln);
+        }
+        nLines += batch.size();
+    }
+    return nLines;
+}
+
 void parse_rg_sample_map(char* hts_header, map<string, string>& rg_sample) {
     string header(hts_header);
     vector<string> header_lines = split_delims(header, "\n");
@@ -49,6 +49,23 @@ size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1,
                                                            function<void(Alignment&, Alignment&)> lambda,
                                                            function<bool(void)> single_threaded_until_true);
 
+/// Convert an Alignment to a line of GAF (Graph Alignment Format), without
+/// the trailing newline. The path is written as oriented node IDs ("<" or ">"
+/// followed by the ID), and the edits as a "cs:Z:" difference string, so node
+/// lengths and sequences are taken from the graph. Softclips become the query
+/// start and end, and unaligned reads get "*" for all path fields.
+string alignment_to_gaf(const HandleGraph& graph, const Alignment& aln);
+/// Parse a line of GAF, as produced by alignment_to_gaf(), into an Alignment
+/// against the given graph. GAF does not store the read bases outside the
+/// alignment, so softclipped and unaligned bases come back as N. Returns false
+/// if the line could not be parsed.
+bool gaf_to_alignment(const HandleGraph& graph, const string& line, Alignment& aln);
+/// Call the lambda on each Alignment in a GAF file (or "-"), in order.
+size_t gaf_unpaired_for_each(const HandleGraph& graph, const string& filename, function<void(Alignment&)> lambda);
+/// Call the lambda on each Alignment in a GAF file (or "-"). Batches of lines
+/// are read in the calling thread, and parsed and processed in parallel.
+size_t gaf_unpaired_for_each_parallel(const HandleGraph& graph, const string& filename, function<void(Alignment&)> lambda);
+
 bam_hdr_t* hts_file_header(string& filename, string& header);
 bam_hdr_t* hts_string_header(string& header,
                              map<string, int64_t>& path_length,
@@ -13,7 +13,8 @@
 namespace vg {
 using namespace std;
 
-unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, const map<string, int64_t>& path_length) {
+unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, const map<string, int64_t>& path_length,
+    const HandleGraph* graph) {
 
     // Make the backing, non-buffered emitter
     AlignmentEmitter* backing = nullptr;
@@ -25,6 +26,14 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
         backing = new HTSAlignmentEmitter(filename, format, path_length);
     } else if (format == "TSV") {
         backing = new TSVAlignmentEmitter(filename);
+    } else if (format == "GAF") {
+        if (graph == nullptr) {
+            cerr << "error [vg::get_alignment_emitter]: GAF output requires a graph" << endl;
+            exit(1);
+        }
+        // GAF buffers formatted lines per thread on its own, so it needs no
+        // Alignment buffering on top.
+        return make_unique<GAFAlignmentEmitter>(filename, *graph);
     } else {
         cerr << "error [vg::get_alignment_emitter]: Unimplemented output format " << format << endl;
         exit(1);
@@ -169,6 +178,97 @@ void TSVAlignmentEmitter::emit_pair_internal(Alignment&& aln1, Alignment&& aln2,
     emit_single_internal(std::move(aln2), lock);
 }
 
+GAFAlignmentEmitter::GAFAlignmentEmitter(const string& filename, const HandleGraph& graph, size_t buffer_limit) : graph(graph),
+    out_file(filename == "-" ? nullptr : new ofstream(filename)), buffer_limit(buffer_limit) {
+    
+    if (out_file.get() != nullptr && !*out_file) {
+        // Make sure we opened a file if we aren't writing to standard output
+        cerr << "[vg::GAFAlignmentEmitter] failed to open " << filename << " for writing" << endl;
+        exit(1);
+    }
+    
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            line_buffer.resize(omp_get_num_threads());
+        }
+    }
+}
+
+GAFAlignmentEmitter::~GAFAlignmentEmitter() {
+    for (size_t i = 0; i < line_buffer.size(); i++) {
+        flush(i);
+    }
+    
+    if (out_file.get() != nullptr) {
+        out_file->flush();
+    } else {
+        cout.flush();
+    }
+}
+
+void GAFAlignmentEmitter::buffer_line(size_t thread, const Alignment& aln) {
+    string& buffer = line_buffer[thread];
+    buffer += alignment_to_gaf(graph, aln);
+    buffer += '\n';
+}
+
+void GAFAlignmentEmitter::flush_if_full(size_t thread) {
+    if (line_buffer[thread].size() >= buffer_limit) {
+        flush(thread);
+    }
+}
+
+void GAFAlignmentEmitter::flush(size_t thread) {
+    string& buffer = line_buffer[thread];
+    if (buffer.empty()) {
+        return;
+    }
+    
+    ostream& out = (out_file.get() != nullptr) ? *out_file : cout;
+    {
+        lock_guard<mutex> lock(sync);
+        out.write(buffer.data(), buffer.size());
+    }
+    buffer.clear();
+}
+
+void GAFAlignmentEmitter::emit_single(Alignment&& aln) {
+    size_t thread = omp_get_thread_num();
+    buffer_line(thread, aln);
+    flush_if_full(thread);
+}
+
+void GAFAlignmentEmitter::emit_mapped_single(vector<Alignment>&& alns) {
+    size_t thread = omp_get_thread_num();
+    for (auto& aln : alns) {
+        buffer_line(thread, aln);
+    }
+    flush_if_full(thread);
+}
+
+void GAFAlignmentEmitter::emit_pair(Alignment&& aln1, Alignment&& aln2, int64_t tlen_limit) {
+    // GAF has no pairing fields, so mates just go out one after the other.
+    // Only flush after both are buffered, so no other thread's lines can end
+    // up between them.
+    size_t thread = omp_get_thread_num();
+    buffer_line(thread, aln1);
+    buffer_line(thread, aln2);
+    flush_if_full(thread);
+}
+
+void GAFAlignmentEmitter::emit_mapped_pair(vector<Alignment>&& alns1, vector<Alignment>&& alns2, int64_t tlen_limit) {
+    // Make sure we have the same number of mappings on each side.
+    assert(alns1.size() == alns2.size());
+    size_t thread = omp_get_thread_num();
+    for (size_t i = 0; i < alns1.size(); i++) {
+        buffer_line(thread, alns1[i]);
+        buffer_line(thread, alns2[i]);
+    }
+    flush_if_full(thread);
+}
+
 HTSAlignmentEmitter::HTSAlignmentEmitter(const string& filename, const string& format, const map<string, int64_t>& path_length) : 
     format(format), path_length(path_length) {
     
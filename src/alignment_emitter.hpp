@@ -17,6 +17,8 @@
 #include <vg/vg.pb.h>
 #include <vg/io/protobuf_emitter.hpp>
 
+#include "handle.hpp"
+
 namespace vg {
 using namespace std;
 
@@ -49,9 +51,10 @@ public:
 };
 
 /// Get an AlignmentEmitter that can emit to the given file (or "-") in the
-/// given format. A table of contig lengths is required for HTSlib formats.
-/// Automatically applies buffering.
-unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, const map<string, int64_t>& path_length);
+/// given format. A table of contig lengths is required for HTSlib formats, and
+/// a graph is required for GAF. Automatically applies buffering.
+unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, const map<string, int64_t>& path_length,
+    const HandleGraph* graph = nullptr);
 
 /**
  * Throws per-OMP-thread buffers over the top of a backing AlignmentEmitter, which it owns.
@@ -127,6 +130,65 @@ private:
     void emit_pair_internal(Alignment&& aln1, Alignment&& aln2, const lock_guard<mutex>& lock);
 };
 
+/**
+ * Emit Alignments as lines of GAF (graph alignment format). Each thread
+ * formats its lines into its own buffer, and only takes the lock to write out
+ * a full buffer. Pairs are written as consecutive lines.
+ * Thread safe.
+ */
+class GAFAlignmentEmitter : public AlignmentEmitter {
+public:
+    
+    /// Write out a thread's buffer when it reaches this many bytes, by default
+    const static size_t DEFAULT_BUFFER_LIMIT = 1 << 20;
+
+    /// Create a GAFAlignmentEmitter writing to the given file (or "-"). Node
+    /// lengths and sequences come from the given graph. Each thread's buffer
+    /// is written out once it holds at least buffer_limit bytes.
+    GAFAlignmentEmitter(const string& filename, const HandleGraph& graph, size_t buffer_limit = DEFAULT_BUFFER_LIMIT);
+
+    /// Flush all the buffers and clean up the open file, if any.
+    ~GAFAlignmentEmitter();
+    
+    /// Emit a single Alignment
+    virtual void emit_single(Alignment&& aln);
+    /// Emit a single Alignment with secondaries. All secondaries must have is_secondary set already.
+    virtual void emit_mapped_single(vector<Alignment>&& alns);
+    /// Emit a pair of Alignments.
+    virtual void emit_pair(Alignment&& aln1, Alignment&& aln2, int64_t tlen_limit = 0);
+    /// Emit the mappings of a pair of Alignments. All secondaries must have is_secondary set already.
+    virtual void emit_mapped_pair(vector<Alignment>&& alns1, vector<Alignment>&& alns2, int64_t tlen_limit = 0);
+    
+private:
+
+    /// Format an alignment into the given thread's buffer. Never writes the
+    /// buffer out, so that all the lines for a read or pair can be added
+    /// before anything is written.
+    void buffer_line(size_t thread, const Alignment& aln);
+
+    /// Write out the given thread's buffer if it is full. Call only between
+    /// complete records, so that mates stay on adjacent lines.
+    void flush_if_full(size_t thread);
+
+    /// Write out the given thread's buffer.
+    void flush(size_t thread);
+
+    /// The graph the alignments are against
+    const HandleGraph& graph;
+
+    /// If we are doing output to a file, this will hold the open file. Otherwise (for stdout) it will be empty.
+    unique_ptr<ofstream> out_file;
+
+    /// Access to the output stream is protected by this mutex
+    mutex sync;
+    
+    /// Each thread has a buffer of complete lines
+    vector<string> line_buffer;
+    
+    /// Write out a thread's buffer when it reaches this many bytes
+    size_t buffer_limit;
+};
+
 /**
  * Emit Alignments to a stream in SAM/BAM/CRAM format.
  * Thread safe.
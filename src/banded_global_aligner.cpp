@@ -8,6 +8,13 @@
 #include "banded_global_aligner.hpp"
 #include "json2pb.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
 //#define debug_banded_aligner_objects
 //#define debug_banded_aligner_graph_processing
 //#define debug_banded_aligner_fill_matrix
@@ -16,6 +23,61 @@
 
 namespace vg {
 
+BandedAlignmentArena& BandedAlignmentArena::get_thread_arena() {
+    static thread_local BandedAlignmentArena arena;
+    return arena;
+}
+
+void* BandedAlignmentArena::allocate_bytes(size_t bytes) {
+    size_t offset = (curr_offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (curr_block < blocks.size() && offset + bytes <= blocks[curr_block].second) {
+        curr_offset = offset + bytes;
+        return blocks[curr_block].first.get() + offset;
+    }
+    
+    // move on to the next block, which is not in use
+    size_t next_block = curr_block < blocks.size() ? curr_block + 1 : curr_block;
+    if (next_block == blocks.size() || blocks[next_block].second < bytes) {
+        // grow the block sizes geometrically so that large alignments don't need many blocks
+        size_t capacity = max(bytes, MIN_BLOCK_SIZE << min<size_t>(next_block, 10));
+        if (next_block == blocks.size()) {
+            blocks.emplace_back(unique_ptr<char[]>(new char[capacity]), capacity);
+        }
+        else {
+            blocks[next_block] = make_pair(unique_ptr<char[]>(new char[capacity]), capacity);
+        }
+    }
+    curr_block = next_block;
+    curr_offset = bytes;
+    return blocks[curr_block].first.get();
+}
+
+auto BandedAlignmentArena::mark() -> Mark {
+    return Mark{curr_block, curr_offset, live_marks++};
+}
+
+bool BandedAlignmentArena::is_newest(const Mark& mark) const {
+    return mark.depth + 1 == live_marks;
+}
+
+void BandedAlignmentArena::release(const Mark& mark) {
+    // anything allocated after a newer live mark would be freed out from under its owner
+    assert(is_newest(mark));
+    live_marks = mark.depth;
+    curr_block = mark.block;
+    curr_offset = mark.offset;
+    
+    // don't hold onto the memory from an unusually large alignment forever
+    size_t retained_bytes = 0;
+    for (const auto& block : blocks) {
+        retained_bytes += block.second;
+    }
+    while (retained_bytes > MAX_RETAINED_BYTES && blocks.size() > curr_block + 1) {
+        retained_bytes -= blocks.back().second;
+        blocks.pop_back();
+    }
+}
+
 template<class IntType>
 BandedGlobalAligner<IntType>::BABuilder::BABuilder(Alignment& alignment) :
                                                    alignment(alignment),
@@ -231,13 +293,99 @@ BandedGlobalAligner<IntType>::BAMatrix::~BAMatrix() {
         cerr << "[BAMatrix::~BAMatrix] destructing null matrix" << endl;
     }
 #endif
-    free(match);
-    free(insert_row);
-    free(insert_col);
+    // the matrices belong to the arena
+}
+
+/// Computes the match and insert column scores for n consecutive rows in the interior of a
+/// column of a band, given the scores of the same rows in the previous column (plus one
+/// more row, for the insert column of the last cell) and the match scores of the cells.
+/// Each score only depends on the previous column, so all rows can be done at once.
+template <class IntType>
+inline void fill_band_column_scalar(const IntType* prev_match, const IntType* prev_insert_row,
+                                    const IntType* prev_insert_col, const IntType* match_scores,
+                                    IntType* match, IntType* insert_col, int64_t n,
+                                    int8_t gap_open, int8_t gap_extend) {
+    for (int64_t k = 0; k < n; k++) {
+        match[k] = match_scores[k] + max(max(prev_match[k], prev_insert_row[k]), prev_insert_col[k]);
+        insert_col[k] = max(max(prev_match[k + 1] - gap_open, prev_insert_row[k + 1] - gap_open),
+                            prev_insert_col[k + 1] - gap_extend);
+    }
 }
 
+/// Chooses a SIMD implementation of fill_band_column_scalar() for the integer width when
+/// one is available. The SIMD versions saturate instead of wrapping, which only makes a
+/// difference in cells that have overflowed the integer type anyway.
+template <class IntType>
+struct BandColumnFiller {
+    static inline void fill(const IntType* prev_match, const IntType* prev_insert_row,
+                            const IntType* prev_insert_col, const IntType* match_scores,
+                            IntType* match, IntType* insert_col, int64_t n,
+                            int8_t gap_open, int8_t gap_extend) {
+        fill_band_column_scalar(prev_match, prev_insert_row, prev_insert_col, match_scores,
+                                match, insert_col, n, gap_open, gap_extend);
+    }
+};
+
+#ifdef __SSE4_1__
+// signed 8-bit max needs SSE4.1
+template <>
+struct BandColumnFiller<int8_t> {
+    static inline void fill(const int8_t* prev_match, const int8_t* prev_insert_row,
+                            const int8_t* prev_insert_col, const int8_t* match_scores,
+                            int8_t* match, int8_t* insert_col, int64_t n,
+                            int8_t gap_open, int8_t gap_extend) {
+        __m128i open = _mm_set1_epi8(gap_open);
+        __m128i extend = _mm_set1_epi8(gap_extend);
+        int64_t k = 0;
+        for (; k + 16 <= n; k += 16) {
+            __m128i diag = _mm_max_epi8(_mm_max_epi8(_mm_loadu_si128((const __m128i*) (prev_match + k)),
+                                                     _mm_loadu_si128((const __m128i*) (prev_insert_row + k))),
+                                        _mm_loadu_si128((const __m128i*) (prev_insert_col + k)));
+            _mm_storeu_si128((__m128i*) (match + k),
+                             _mm_adds_epi8(_mm_loadu_si128((const __m128i*) (match_scores + k)), diag));
+            
+            __m128i left = _mm_max_epi8(_mm_max_epi8(_mm_subs_epi8(_mm_loadu_si128((const __m128i*) (prev_match + k + 1)), open),
+                                                     _mm_subs_epi8(_mm_loadu_si128((const __m128i*) (prev_insert_row + k + 1)), open)),
+                                        _mm_subs_epi8(_mm_loadu_si128((const __m128i*) (prev_insert_col + k + 1)), extend));
+            _mm_storeu_si128((__m128i*) (insert_col + k), left);
+        }
+        fill_band_column_scalar(prev_match + k, prev_insert_row + k, prev_insert_col + k, match_scores + k,
+                                match + k, insert_col + k, n - k, gap_open, gap_extend);
+    }
+};
+#endif
+
+#ifdef __SSE2__
+template <>
+struct BandColumnFiller<int16_t> {
+    static inline void fill(const int16_t* prev_match, const int16_t* prev_insert_row,
+                            const int16_t* prev_insert_col, const int16_t* match_scores,
+                            int16_t* match, int16_t* insert_col, int64_t n,
+                            int8_t gap_open, int8_t gap_extend) {
+        __m128i open = _mm_set1_epi16(gap_open);
+        __m128i extend = _mm_set1_epi16(gap_extend);
+        int64_t k = 0;
+        for (; k + 8 <= n; k += 8) {
+            __m128i diag = _mm_max_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*) (prev_match + k)),
+                                                       _mm_loadu_si128((const __m128i*) (prev_insert_row + k))),
+                                         _mm_loadu_si128((const __m128i*) (prev_insert_col + k)));
+            _mm_storeu_si128((__m128i*) (match + k),
+                             _mm_adds_epi16(_mm_loadu_si128((const __m128i*) (match_scores + k)), diag));
+            
+            __m128i left = _mm_max_epi16(_mm_max_epi16(_mm_subs_epi16(_mm_loadu_si128((const __m128i*) (prev_match + k + 1)), open),
+                                                       _mm_subs_epi16(_mm_loadu_si128((const __m128i*) (prev_insert_row + k + 1)), open)),
+                                         _mm_subs_epi16(_mm_loadu_si128((const __m128i*) (prev_insert_col + k + 1)), extend));
+            _mm_storeu_si128((__m128i*) (insert_col + k), left);
+        }
+        fill_band_column_scalar(prev_match + k, prev_insert_row + k, prev_insert_col + k, match_scores + k,
+                                match + k, insert_col + k, n - k, gap_open, gap_extend);
+    }
+};
+#endif
+
 template <class IntType>
-void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& graph, int8_t* score_mat, int8_t* nt_table,
+void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& graph, BandedAlignmentArena& arena,
+                                                         int8_t* score_mat, int8_t* nt_table,
                                                          int8_t gap_open, int8_t gap_extend, bool qual_adjusted, IntType min_inf) {
     
 #ifdef debug_banded_aligner_fill_matrix
@@ -257,9 +405,9 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
     const string& read = alignment.sequence();
     const string& base_quality = alignment.quality();
     
-    match = (IntType*) malloc(sizeof(IntType) * band_size);
-    insert_col = (IntType*) malloc(sizeof(IntType) * band_size);
-    insert_row = (IntType*) malloc(sizeof(IntType) * band_size);
+    match = arena.allocate<IntType>(band_size);
+    insert_col = arena.allocate<IntType>(band_size);
+    insert_row = arena.allocate<IntType>(band_size);
     /* these represent a band in a matrix, but we store it as a rectangle with chopped
      * corners
      *
@@ -563,6 +711,14 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
     cerr << "[BAMatrix::fill_matrix]: seeding finished, moving to subsequent columns" << endl;
 #endif
     
+    // contiguous copies of one column of the band for the column interiors
+    IntType* prev_match = ncols > 1 ? arena.allocate<IntType>(6 * band_height) : nullptr;
+    IntType* prev_insert_row = prev_match + band_height;
+    IntType* prev_insert_col = prev_insert_row + band_height;
+    IntType* col_match_scores = prev_insert_col + band_height;
+    IntType* col_match = col_match_scores + band_height;
+    IntType* col_insert_col = col_match + band_height;
+    
     // iterate through the rest of the columns
     for (int64_t j = 1; j < ncols; j++) {
         
@@ -617,31 +773,48 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
         }
         
         
-        for (int64_t i = iter_start + 1; i < iter_stop - 1; i++) {
-            // indices of the current and previous cells in the rectangularized band
-            idx = i * ncols + j;
-            up_idx = (i - 1) * ncols + j;
-            diag_idx = i * ncols + (j - 1);
-            left_idx = (i + 1) * ncols + (j - 1);
-            
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[i + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
+        // the match and insert column scores in the interior of the column only depend on the previous
+        // column, so we copy it into contiguous buffers and compute them for all rows at once
+        int64_t interior_start = iter_start + 1;
+        int64_t interior_size = iter_stop - 1 - interior_start;
+        if (interior_size > 0) {
+            // the previous column, including the row below the interior for the last insert column score
+            for (int64_t i = interior_start; i < iter_stop; i++) {
+                diag_idx = i * ncols + (j - 1);
+                prev_match[i - interior_start] = match[diag_idx];
+                prev_insert_row[i - interior_start] = insert_row[diag_idx];
+                prev_insert_col[i - interior_start] = insert_col[diag_idx];
             }
             
-            match[idx] = match_score + max(max(match[diag_idx], insert_row[diag_idx]), insert_col[diag_idx]);
-            
-            insert_row[idx] = max(max(match[up_idx] - gap_open, insert_row[up_idx] - gap_extend),
-                                  insert_col[up_idx] - gap_open);
+            for (int64_t i = interior_start; i < iter_stop - 1; i++) {
+                if (qual_adjusted) {
+                    col_match_scores[i - interior_start] = score_mat[25 * base_quality[i + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
+                }
+                else {
+                    col_match_scores[i - interior_start] = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
+                }
+            }
             
-            insert_col[idx] = max(max(match[left_idx] - gap_open, insert_row[left_idx] - gap_open),
-                                  insert_col[left_idx] - gap_extend);
+            BandColumnFiller<IntType>::fill(prev_match, prev_insert_row, prev_insert_col, col_match_scores,
+                                            col_match, col_insert_col, interior_size, gap_open, gap_extend);
             
+            // the insert row scores depend on the cell above, so they go down the column one at a time
+            for (int64_t i = interior_start; i < iter_stop - 1; i++) {
+                // indices of the current and previous cells in the rectangularized band
+                idx = i * ncols + j;
+                up_idx = (i - 1) * ncols + j;
+                
+                match[idx] = col_match[i - interior_start];
+                
+                insert_row[idx] = max(max(match[up_idx] - gap_open, insert_row[up_idx] - gap_extend),
+                                      insert_col[up_idx] - gap_open);
+                
+                insert_col[idx] = col_insert_col[i - interior_start];
+                
 #ifdef debug_banded_aligner_fill_matrix
-            cerr << "[BAMatrix::fill_matrix]: in interior of matrix at rectangle coords (" << i << ", " << j << "), match score of node char " << j << " (" << node_seq[j] << ") and read char " << i + top_diag + j << " (" << read[i + top_diag + j] << ") is " << (int) match_score << ", leading gap length is " << cumulative_seq_len + j << " for total match matrix score of " << (int) match[idx] << endl;
+                cerr << "[BAMatrix::fill_matrix]: in interior of matrix at rectangle coords (" << i << ", " << j << "), match score of node char " << j << " (" << node_seq[j] << ") and read char " << i + top_diag + j << " (" << read[i + top_diag + j] << ") is " << (int) col_match_scores[i - interior_start] << ", leading gap length is " << cumulative_seq_len + j << " for total match matrix score of " << (int) match[idx] << endl;
 #endif
+            }
         }
         
         // stop iteration one cell early to handle logic on bottom edge of band
@@ -1790,6 +1963,8 @@ BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const Ha
                                                   alt_alignments(alt_alignments),
                                                   max_multi_alns(max_multi_alns),
                                                   adjust_for_base_quality(adjust_for_base_quality),
+                                                  arena(BandedAlignmentArena::get_thread_arena()),
+                                                  arena_mark(arena.mark()),
                                                   // compute some graph features we will be frequently reusing
                                                   topological_order(algorithms::lazier_topological_order(&g)),
                                                   source_nodes(algorithms::head_nodes(&g)),
@@ -1816,6 +1991,7 @@ BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const Ha
     }
     
     // map node ids to indices
+    node_id_to_idx.reserve(topological_order.size());
     for (int64_t i = 0; i < topological_order.size(); i++) {
         node_id_to_idx[graph.get_id(topological_order[i])] = i;
     }
@@ -1868,12 +2044,12 @@ BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const Ha
                 seeds.push_back(banded_matrices[node_id_to_idx[graph.get_id(prev)]]);
             });
             
-            banded_matrices[i] = new BAMatrix(alignment,
-                                              node,
-                                              band_ends[i].first,
-                                              band_ends[i].second,
-                                              std::move(seeds),
-                                              shortest_seqs[i]);
+            banded_matrices[i] = new (arena.allocate<BAMatrix>(1)) BAMatrix(alignment,
+                                                                            node,
+                                                                            band_ends[i].first,
+                                                                            band_ends[i].second,
+                                                                            std::move(seeds),
+                                                                            shortest_seqs[i]);
             
         }
     }
@@ -1892,6 +2068,8 @@ BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const Ha
         if (sinks_masked) {
             // We couldn't find an alignment in this band. That's bad, but we
             // don't necessarily want to kill the whole program.
+            // The destructor won't run, so give back the scratch memory first.
+            destroy_matrices();
             throw NoAlignmentInBandException();
         }
     }
@@ -1899,12 +2077,19 @@ BandedGlobalAligner<IntType>::BandedGlobalAligner(Alignment& alignment, const Ha
 
 template <class IntType>
 BandedGlobalAligner<IntType>::~BandedGlobalAligner() {
-    
-    for (BAMatrix* banded_matrix : banded_matrices) {
+    destroy_matrices();
+}
+
+template <class IntType>
+void BandedGlobalAligner<IntType>::destroy_matrices() {
+    for (BAMatrix*& banded_matrix : banded_matrices) {
         if (banded_matrix != nullptr) {
-            delete banded_matrix;
+            // constructed in the arena
+            banded_matrix->~BAMatrix();
+            banded_matrix = nullptr;
         }
     }
+    arena.release(arena_mark);
 }
 
 template <class IntType>
@@ -2084,6 +2269,9 @@ void BandedGlobalAligner<IntType>::shortest_seq_paths(vector<int64_t>& seq_lens_
 template <class IntType>
 void BandedGlobalAligner<IntType>::align(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend) {
     
+    // the matrices are filled with arena memory past any newer aligner's mark otherwise
+    assert(arena.is_newest(arena_mark));
+    
     // small enough number to never be accepted in alignment but also not trigger underflow
     IntType max_mismatch = numeric_limits<IntType>::max();
     for (int i = 0; i < 25; i++) {
@@ -2108,7 +2296,7 @@ void BandedGlobalAligner<IntType>::align(int8_t* score_mat, int8_t* nt_table, in
         cerr << "[BandedGlobalAligner::align] at node " << graph.get_id(band_matrix->node) << " at index " << i << " with sequence " << graph.get_id(band_matrix->node) << endl;
         cerr << "[BandedGlobalAligner::align] node is not masked, filling matrix" << endl;
 #endif
-        band_matrix->fill_matrix(graph, score_mat, nt_table, gap_open, gap_extend, adjust_for_base_quality, min_inf);
+        band_matrix->fill_matrix(graph, arena, score_mat, nt_table, gap_open, gap_extend, adjust_for_base_quality, min_inf);
     }
     
     traceback(score_mat, nt_table, gap_open, gap_extend, min_inf);
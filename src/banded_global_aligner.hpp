@@ -15,6 +15,7 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <list>
+#include <memory>
 #include <exception>
 
 #include "handle.hpp"
@@ -35,6 +36,65 @@ namespace vg {
         int get_count();
     };
     
+    /**
+     * Scratch memory for the dynamic programming matrices of BandedGlobalAligner. Each thread has
+     * one, which keeps its memory between alignments so that aligning to many small graphs does
+     * not allocate and free matrices for every node. Memory is released in stack order: everything
+     * allocated after a mark is released at once. Marks must be released in the reverse of the
+     * order they were taken, and memory must only be allocated for the owner of the newest live
+     * mark, since releasing a mark also frees anything allocated after it for someone else. Debug
+     * builds check both rules.
+     */
+    class BandedAlignmentArena {
+    public:
+        
+        /// A position in the arena to release back to
+        struct Mark {
+            size_t block;
+            size_t offset;
+            /// How many marks were live when this one was taken
+            size_t depth;
+        };
+        
+        /// Get the arena for the current thread
+        static BandedAlignmentArena& get_thread_arena();
+        
+        /// Allocate uninitialized memory for n objects of type T, aligned for vector loads
+        template<typename T>
+        T* allocate(size_t n) {
+            return reinterpret_cast<T*>(allocate_bytes(sizeof(T) * n));
+        }
+        
+        /// Get the current position in the arena. The mark is live until it is released.
+        Mark mark();
+        
+        /// Release everything that was allocated since the mark was taken. The mark must be
+        /// the newest live one.
+        void release(const Mark& mark);
+        
+        /// Is this the newest live mark, so that memory allocated now belongs to its owner?
+        bool is_newest(const Mark& mark) const;
+        
+    private:
+        
+        /// Alignment of all allocations
+        static const size_t ALIGNMENT = 16;
+        /// Size of the first block
+        static const size_t MIN_BLOCK_SIZE = 64 * 1024;
+        /// Free unused blocks beyond this many bytes when releasing
+        static const size_t MAX_RETAINED_BYTES = 64 * 1024 * 1024;
+        
+        void* allocate_bytes(size_t bytes);
+        
+        /// Blocks of memory and their sizes
+        vector<pair<unique_ptr<char[]>, size_t>> blocks;
+        /// The block we are currently allocating from, and the first free byte in it
+        size_t curr_block = 0;
+        size_t curr_offset = 0;
+        /// The number of marks that have been taken and not released
+        size_t live_marks = 0;
+    };
+    
     /**
      * The outward-facing interface for banded global graph alignment. It computes optimal alignment
      * of a DNA sequence to a DAG with POA. The alignment will start at any source node in the graph and
@@ -46,6 +106,13 @@ namespace vg {
      *
      * Use Aligner::align_global_banded() instead.
      *
+     * The matrices are allocated from the BandedAlignmentArena of the thread that constructs the
+     * aligner, so it should be used and destroyed on that thread. Aligners on the same thread must
+     * be destroyed in the reverse of the order they were constructed, and only the most recently
+     * constructed live aligner may align. Most of the matrix memory is only taken in align(), so
+     * if an older aligner aligns while a newer one exists, destroying the newer one frees memory
+     * the older one is still using.
+     *
      */
     template <class IntType>
     class BandedGlobalAligner {
@@ -121,6 +188,11 @@ namespace vg {
         /// Dynamic programming matrices for each node
         vector<BAMatrix*> banded_matrices;
         
+        /// Scratch memory that the matrices are allocated from
+        BandedAlignmentArena& arena;
+        /// Where the arena was when we started using it
+        BandedAlignmentArena::Mark arena_mark;
+        
         /// Map from node IDs to the index used in internal vectors
         unordered_map<int64_t, int64_t> node_id_to_idx;
         /// A topological ordering of the nodes
@@ -136,6 +208,9 @@ namespace vg {
                             int64_t band_padding, bool permissive_banding = false,
                             bool adjust_for_base_quality = false);
         
+        /// Destroy the matrices and give their memory back to the arena
+        void destroy_matrices();
+        
         /// Traceback through dynamic programming matrices to compute alignment
         void traceback(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend, IntType min_inf);
         
@@ -160,8 +235,8 @@ namespace vg {
                  const vector<BAMatrix*>& seeds, int64_t cumulative_seq_len);
         ~BAMatrix();
         
-        /// Use DP to fill the band with alignment scores
-        void fill_matrix(const HandleGraph& graph, int8_t* score_mat, int8_t* nt_table, int8_t gap_open,
+        /// Use DP to fill the band with alignment scores, taking the memory for it from the arena
+        void fill_matrix(const HandleGraph& graph, BandedAlignmentArena& arena, int8_t* score_mat, int8_t* nt_table, int8_t gap_open,
                          int8_t gap_extend, bool qual_adjusted, IntType min_inf);
         
         /// Traceback through the band after using DP to fill it
@@ -190,11 +265,11 @@ namespace vg {
         /// Matrices for nodes with edges into this node
         vector<BAMatrix*> seeds;
         
-        /// DP matrix
+        /// DP matrix (owned by the arena)
         IntType* match;
-        /// DP matrix
+        /// DP matrix (owned by the arena)
         IntType* insert_col;
-        /// DP matrix
+        /// DP matrix (owned by the arena)
         IntType* insert_row;
         
         void traceback_internal(const HandleGraph& graph, BABuilder& builder, AltTracebackStack& traceback_stack,
@@ -3,6 +3,7 @@
 
 #include <vg/vg.pb.h>
 #include "types.hpp"
+#include "handle.hpp"
 #include "xg.hpp"
 #include "lru_cache.h"
 #include "utility.hpp"
@@ -10,33 +11,37 @@
 #include <gcsa/gcsa.h>
 #include <iostream>
 
-/** \file 
- * Functions for working with cached Positions and `pos_t`s.
+/** \file
+ * Functions for walking `pos_t`s through a HandleGraph.
+ *
+ * These go through handles, follow_edges(), and the graph's own sequence
+ * access, so they are cheap enough to call in tight loops without keeping
+ * per-thread caches of deserialized Nodes and Edges.
  */
 
 namespace vg {
 
 using namespace std;
 
-// xg/position traversal helpers with caching
-// used by the Sampler and by the Mapper
-string xg_cached_node_sequence(id_t id, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache);
-/// Get the length of a Node from an xg::XG index, with cacheing of deserialized nodes.
-size_t xg_cached_node_length(id_t id, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache);
-/// Get the node start position in the sequence vector
-int64_t xg_cached_node_start(id_t id, xg::XG* xgidx, LRUCache<id_t, int64_t>& node_start_cache);
-/// Get the character at a position in an xg::XG index, with cacheing of deserialized nodes.
-char xg_cached_pos_char(pos_t pos, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache);
-/// Get the characters at positions after the given position from an xg::XG index, with cacheing of deserialized nodes.
-map<pos_t, char> xg_cached_next_pos_chars(pos_t pos, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache, LRUCache<id_t, vector<Edge> >& edge_cache);
-set<pos_t> xg_cached_next_pos(pos_t pos, bool whole_node, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache, LRUCache<id_t, vector<Edge> >& edge_cache);
-int64_t xg_cached_distance(pos_t pos1, pos_t pos2, int64_t maximum, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache, LRUCache<id_t, vector<Edge> >& edge_cache);
-set<pos_t> xg_cached_positions_bp_from(pos_t pos, int64_t distance, bool rev, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache, LRUCache<id_t, vector<Edge> >& edge_cache);
-//void xg_cached_graph_context(VG& graph, const pos_t& pos, int length, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache, LRUCache<id_t, vector<Edge> >& edge_cache);
-Node xg_cached_node(id_t id, xg::XG* xgidx, LRUCache<id_t, Node>& node_cache);
-vector<Edge> xg_cached_edges_of(id_t id, xg::XG* xgidx, LRUCache<id_t, vector<Edge> >& edge_cache);
-vector<Edge> xg_cached_edges_on_start(id_t id, xg::XG* xgidx, LRUCache<id_t, vector<Edge> >& edge_cache);
-vector<Edge> xg_cached_edges_on_end(id_t id, xg::XG* xgidx, LRUCache<id_t, vector<Edge> >& edge_cache);
+// handle graph position traversal helpers
+// used by the xg position helpers and anything else that walks a graph
+/// Get the forward sequence of a node.
+string graph_node_sequence(id_t id, const HandleGraph* graph);
+/// Get the length of a node.
+size_t graph_node_length(id_t id, const HandleGraph* graph);
+/// Get the character at a position, on the strand of the position.
+char graph_pos_char(pos_t pos, const HandleGraph* graph);
+/// Get the characters at positions after the given position.
+map<pos_t, char> graph_next_pos_chars(pos_t pos, const HandleGraph* graph);
+/// Get the positions after the given position. If whole_node is set, skip to the
+/// starts of the following nodes.
+set<pos_t> graph_next_pos(pos_t pos, bool whole_node, const HandleGraph* graph);
+/// Get the distance from one position to another, or numeric_limits<int64_t>::max()
+/// if the second position is not found within the maximum distance.
+int64_t graph_distance(pos_t pos1, pos_t pos2, int64_t maximum, const HandleGraph* graph);
+/// Get the positions at the given distance from the position, looking backward if
+/// rev is set.
+set<pos_t> graph_positions_bp_from(pos_t pos, int64_t distance, bool rev, const HandleGraph* graph);
 
 }
 
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <unordered_map>
 #include <unordered_set>
 #include <vg/io/stream.hpp>
 #include "chunker.hpp"
@@ -34,7 +35,132 @@ void PathChunker::extract_subgraph(const Region& region, int context, int length
     if (length) {
         xg->expand_context(g, context, true, false, true, !forward_only);
     }
-        
+
+    finish_subgraph(region, g, subgraph, out_region);
+}
+
+void PathChunker::extract_subgraph_batch(const vector<Region>& regions, int context,
+                                         const function<void(size_t, VG&, const Region&)>& callback) {
+
+    // extract the path ranges of all the regions into one graph
+    Graph batch;
+    unordered_set<int64_t> seeds;
+    for (auto& region : regions) {
+        xg->for_path_range(region.seq, region.start, region.end, [&](int64_t id, bool) {
+                if (seeds.insert(id).second) {
+                    *batch.add_node() = xg->node(id);
+                }
+            });
+    }
+
+    // expand the context of the batch in the xg just once. the neighborhood of any
+    // one region is contained in the neighborhood of all of them
+    xg->expand_context(batch, context, true, true, true, true);
+
+    // index the batch graph so we can walk it and pull out the paths of each node
+    unordered_map<int64_t, size_t> node_index;
+    for (size_t i = 0; i < batch.node_size(); ++i) {
+        node_index[batch.node(i).id()] = i;
+    }
+    vector<vector<size_t>> node_edges(batch.node_size());
+    for (size_t i = 0; i < batch.edge_size(); ++i) {
+        const Edge& edge = batch.edge(i);
+        node_edges[node_index.at(edge.from())].push_back(i);
+        if (edge.to() != edge.from()) {
+            node_edges[node_index.at(edge.to())].push_back(i);
+        }
+    }
+    vector<vector<pair<size_t, size_t>>> node_mappings(batch.node_size());
+    for (size_t i = 0; i < batch.path_size(); ++i) {
+        const Path& path = batch.path(i);
+        for (size_t j = 0; j < path.mapping_size(); ++j) {
+            auto found = node_index.find(path.mapping(j).position().node_id());
+            if (found != node_index.end()) {
+                node_mappings[found->second].emplace_back(i, j);
+            }
+        }
+    }
+
+    for (size_t r = 0; r < regions.size(); ++r) {
+        const Region& region = regions[r];
+
+        // find the nodes within the context steps of the path range, in the same way as
+        // the xg does: breadth first, out to the last step
+        Graph g;
+        vector<size_t> reached;
+        unordered_set<size_t> visited;
+        xg->for_path_range(region.seq, region.start, region.end, [&](int64_t id, bool) {
+                size_t i = node_index.at(id);
+                if (visited.insert(i).second) {
+                    reached.push_back(i);
+                }
+            });
+        size_t frontier_begin = 0;
+        for (int step = 0; step < context; ++step) {
+            size_t frontier_end = reached.size();
+            for (size_t k = frontier_begin; k < frontier_end; ++k) {
+                for (size_t e : node_edges[reached[k]]) {
+                    const Edge& edge = batch.edge(e);
+                    size_t other = node_index.at(edge.from() == batch.node(reached[k]).id() ? edge.to() : edge.from());
+                    if (visited.insert(other).second) {
+                        reached.push_back(other);
+                    }
+                }
+            }
+            frontier_begin = frontier_end;
+        }
+
+        // the xg takes all the edges between the nodes it reaches, unless it didn't expand at all
+        unordered_set<size_t> edges_added;
+        for (size_t i : reached) {
+            *g.add_node() = batch.node(i);
+            if (context > 0) {
+                for (size_t e : node_edges[i]) {
+                    const Edge& edge = batch.edge(e);
+                    if (visited.count(node_index.at(edge.from())) && visited.count(node_index.at(edge.to())) &&
+                        edges_added.insert(e).second) {
+                        *g.add_edge() = edge;
+                    }
+                }
+            }
+        }
+
+        // collect the path mappings on the nodes by rank, as the xg does when it adds paths
+        map<string, map<size_t, const Mapping*>> paths;
+        map<string, vector<const Mapping*>> unplaced;
+        for (size_t i : reached) {
+            for (auto& path_mapping : node_mappings[i]) {
+                const Path& path = batch.path(path_mapping.first);
+                const Mapping& mapping = path.mapping(path_mapping.second);
+                if (mapping.rank()) {
+                    paths[path.name()][mapping.rank()] = &mapping;
+                } else {
+                    unplaced[path.name()].push_back(&mapping);
+                }
+            }
+        }
+        for (auto& p : paths) {
+            Path* path = g.add_path();
+            path->set_name(p.first);
+            for (auto& m : p.second) {
+                *path->add_mapping() = *m.second;
+            }
+            if (unplaced.count(p.first)) {
+                for (auto m : unplaced[p.first]) {
+                    *path->add_mapping() = *m;
+                }
+            }
+        }
+
+        VG subgraph;
+        Region out_region;
+        finish_subgraph(region, g, subgraph, out_region);
+        callback(r, subgraph, out_region);
+    }
+}
+
+void PathChunker::finish_subgraph(const Region& region, Graph& g, VG& subgraph, Region& out_region) {
+
     // build the vg of the subgraph
     subgraph.extend(g);
     subgraph.remove_orphan_edges();
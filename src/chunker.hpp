@@ -48,6 +48,25 @@ public:
     void extract_id_range(vg::id_t start, vg::id_t end, int context, int length, bool forward_only,
                          VG& subgraph, Region& out_region);
 
+    /**
+     * Extract the subgraphs for a batch of regions on the same path, as if
+     * extract_subgraph were called on each of them with the given number of
+     * context steps (expanding in both directions and with no length
+     * expansion). Context is only expanded in the xg once, around all the
+     * regions at once, and each region's neighborhood is then found in that
+     * shared graph, which pays off when the regions are adjacent or
+     * overlapping. The callback is called with the index of each region in
+     * the batch, its subgraph, and its output region, in order.
+     */
+    void extract_subgraph_batch(const vector<Region>& regions, int context,
+                                const function<void(size_t, VG&, const Region&)>& callback);
+
+private:
+
+    /** Build the subgraph for a path region out of its context graph, as
+     * extracted from the xg, and cut it at the region endpoints.
+     */
+    void finish_subgraph(const Region& region, Graph& g, VG& subgraph, Region& out_region);
 };
 
 
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <utility>
 #include <cstring>
+#include <unordered_map>
 
 #include "cluster.hpp"
 
@@ -21,48 +22,80 @@ namespace vg {
 //size_t OrientedDistanceClusterer::PRE_SPLIT_CLUSTER_COUNTER = 0;
 //size_t OrientedDistanceClusterer::POST_SPLIT_CLUSTER_COUNTER = 0;
     
+// the fragments are on the vertexes, not the MEMs they refer to
+static bool vertexes_overlap(const MEMChainModelVertex& v1, const MEMChainModelVertex& v2) {
+    return v1.fragment == v2.fragment
+        && !(v1.mem->end <= v2.mem->begin
+             || v2.mem->end <= v1.mem->begin);
+}
+
 MEMChainModel::MEMChainModel(
     const vector<size_t>& aln_lengths,
     const vector<vector<MaximalExactMatch> >& matches,
     const function<int64_t(pos_t)>& approx_position,
     const function<map<string, vector<pair<size_t, bool> > >(pos_t)>& path_position,
-    const function<double(const MaximalExactMatch&, const MaximalExactMatch&)>& transition_weight,
+    const function<double(const MEMChainModelVertex&, const MEMChainModelVertex&)>& transition_weight,
     int band_width,
     int position_depth,
     int max_connections) {
-    // store the MEMs in the model
+    // there is one vertex per hit, so we can avoid reallocating the model
+    size_t total_hits = 0;
+    for (auto& fragment : matches) {
+        for (auto& mem : fragment) {
+            total_hits += mem.nodes.size();
+        }
+    }
+    model.reserve(total_hits);
+    // where each vertex's positions start in hit_positions, plus the end
+    vector<size_t> position_starts;
+    position_starts.reserve(total_hits + 1);
+    unordered_map<string, size_t> path_ranks;
+    auto path_rank = [&](const string& name) {
+        auto found = path_ranks.find(name);
+        if (found != path_ranks.end()) {
+            return found->second;
+        }
+        path_ranks.emplace(name, path_names.size());
+        path_names.push_back(name);
+        return path_names.size() - 1;
+    };
+    // make a vertex for each hit of each MEM, referring back to the MEM
     int frag_n = 0;
     for (auto& fragment : matches) {
         ++frag_n;
         for (auto& mem : fragment) {
-            // copy the MEM for each specific hit in the base graph
-            // and add it in as a vertex
             for (auto& node : mem.nodes) {
-                //model.emplace_back();
-                //auto m = model.back();
                 auto pos = make_pos_t(node);
-                MEMChainModelVertex m;
-                m.mem = mem;
+                model.emplace_back();
+                MEMChainModelVertex& m = model.back();
+                m.mem = &mem;
+                m.node = node;
+                m.fragment = frag_n;
                 m.weight = mem.length();
                 m.prev = nullptr;
                 m.score = 0;
-                m.mem.positions = path_position(pos);
-                m.mem.positions[""].push_back(make_pair(approx_position(pos), is_rev(pos)));
-                m.mem.nodes.clear();
-                m.mem.nodes.push_back(node);
-                m.mem.fragment = frag_n;
-                m.mem.match_count = mem.match_count;
-                model.push_back(m);
+                // the hit's positions go on the end of the flat array
+                position_starts.push_back(hit_positions.size());
+                for (auto& path : path_position(pos)) {
+                    size_t rank = path_rank(path.first);
+                    for (auto& offset : path.second) {
+                        hit_positions.push_back({rank, offset.first, offset.second});
+                    }
+                }
+                hit_positions.push_back({path_rank(""), (size_t) approx_position(pos), is_rev(pos)});
             }
         }
     }
+    position_starts.push_back(hit_positions.size());
+    // now that the flat array won't move, point the vertexes at their slices
+    for (size_t i = 0; i < model.size(); i++) {
+        model[i].positions_begin = hit_positions.data() + position_starts[i];
+        model[i].positions_end = hit_positions.data() + position_starts[i + 1];
+    }
     // index the model with the positions
     for (vector<MEMChainModelVertex>::iterator v = model.begin(); v != model.end(); ++v) {
-        for (auto& chr : v->mem.positions) {
-            auto& chr_positions = positions[chr.first];
-            for (auto& pos : chr.second) {
-                chr_positions[pos.first].push_back(v);
-            }
+        for (auto p = v->positions_begin; p != v->positions_end; ++p) {
+            positions[path_names[p->path]][p->offset].push_back(v);
         }
     }
     // sort the vertexes at each approx position by their matches and trim
@@ -71,7 +104,7 @@ MEMChainModel::MEMChainModel(
             auto& pos = p.second;
             std::sort(pos.begin(), pos.end(), [](const vector<MEMChainModelVertex>::iterator& v1,
                                                  const vector<MEMChainModelVertex>::iterator& v2) {
-                          return v1->mem.length() > v2->mem.length();
+                          return v1->mem->length() > v2->mem->length();
                       });
             pos.resize(min(pos.size(), (size_t)position_depth));
         }
@@ -86,12 +119,12 @@ MEMChainModel::MEMChainModel(
                 while (++q != c->second.end() && abs(p->first - q->first) < band_width) {
                     for (auto& v2 : q->second) {
                         if (redundant_vertexes.count(v2)) continue;
-                        if (mems_overlap(v1->mem, v2->mem)
-                            && abs(v2->mem.begin - v1->mem.begin) == abs(q->first - p->first)) {
-                            if (v2->mem.length() < v1->mem.length()) {
+                        if (vertexes_overlap(*v1, *v2)
+                            && abs(v2->mem->begin - v1->mem->begin) == abs(q->first - p->first)) {
+                            if (v2->mem->length() < v1->mem->length()) {
                                 redundant_vertexes.insert(v2);
-                                if (v2->mem.end > v1->mem.end) {
-                                    v1->weight += v2->mem.end - v1->mem.end;
+                                if (v2->mem->end > v1->mem->end) {
+                                    v1->weight += v2->mem->end - v1->mem->end;
                                 }
                             }
                         }
@@ -109,12 +142,12 @@ MEMChainModel::MEMChainModel(
                 while (++q != c->second.rend() && abs(p->first - q->first) < band_width) {
                     for (auto& v2 : q->second) {
                         if (redundant_vertexes.count(v2)) continue;
-                        if (mems_overlap(v1->mem, v2->mem)
-                            && abs(v2->mem.begin - v1->mem.begin) == abs(p->first - q->first)) {
-                            if (v2->mem.length() < v1->mem.length()) {
+                        if (vertexes_overlap(*v1, *v2)
+                            && abs(v2->mem->begin - v1->mem->begin) == abs(p->first - q->first)) {
+                            if (v2->mem->length() < v1->mem->length()) {
                                 redundant_vertexes.insert(v2);
-                                if (v2->mem.end > v1->mem.end) {
-                                    v1->weight += v2->mem.end - v1->mem.end;
+                                if (v2->mem->end > v1->mem->end) {
+                                    v1->weight += v2->mem->end - v1->mem->end;
                                 }
                             }
                         }
@@ -145,20 +178,20 @@ MEMChainModel::MEMChainModel(
                             && v2->prev_cost.size() < max_connections) {
                             // There are not too many connections yet
                             seen.insert(make_pair(v1, v2));
-                            if (v1->mem.fragment < v2->mem.fragment
-                                || (v1->mem.fragment == v2->mem.fragment && v1->mem.begin < v2->mem.begin)) {
+                            if (v1->fragment < v2->fragment
+                                || (v1->fragment == v2->fragment && v1->mem->begin < v2->mem->begin)) {
                                 // Transition is allowable because the first comes before the second
                             
-                                double weight = transition_weight(v1->mem, v2->mem);
+                                double weight = transition_weight(*v1, *v2);
                                 if (weight > -std::numeric_limits<double>::max()) {
                                     v1->next_cost.push_back(make_pair(&*v2, weight));
                                     v2->prev_cost.push_back(make_pair(&*v1, weight));
                                 }
-                            } else if (v1->mem.fragment > v2->mem.fragment
-                                       || (v1->mem.fragment == v2->mem.fragment && v1->mem.begin > v2->mem.begin)) {
+                            } else if (v1->fragment > v2->fragment
+                                       || (v1->fragment == v2->fragment && v1->mem->begin > v2->mem->begin)) {
                                 // Really we want to think about the transition going the other way
                             
-                                double weight = transition_weight(v2->mem, v1->mem);
+                                double weight = transition_weight(*v2, *v1);
                                 if (weight > -std::numeric_limits<double>::max()) {
                                     v2->next_cost.push_back(make_pair(&*v1, weight));
                                     v1->prev_cost.push_back(make_pair(&*v2, weight));
@@ -233,7 +266,7 @@ vector<vector<MaximalExactMatch> > MEMChainModel::traceback(int alt_alns, bool p
 #ifdef debug_mapper
 #pragma omp critical
             {
-                if (debug) cerr << "maximum score " << vertex->mem.sequence() << " " << vertex << ":" << vertex->score << endl;
+                if (debug) cerr << "maximum score " << vertex->mem->sequence() << " " << vertex << ":" << vertex->score << endl;
             }
 #endif
             // make trace
@@ -266,52 +299,72 @@ vector<vector<MaximalExactMatch> > MEMChainModel::traceback(int alt_alns, bool p
                     if (p.first == prev) {
                         p.first = nullptr;
                     } else if (paired && p.first != nullptr
-                               && p.first->mem.fragment != vertex.mem.fragment
+                               && p.first->fragment != vertex.fragment
                                && chain_members.count(p.first)) {
                         p.first = nullptr;
                     }
                 }
             }
-            mem_trace.push_back(vertex.mem);
+            // only the hits in traces get made back into MEMs
+            mem_trace.push_back(vertex_mem(vertex));
         }
     }
     return traces;
 }
 
+MaximalExactMatch MEMChainModel::vertex_mem(const MEMChainModelVertex& vertex) const {
+    MaximalExactMatch mem(vertex.mem->begin, vertex.mem->end, vertex.mem->range, vertex.mem->match_count);
+    mem.queried_count = vertex.mem->queried_count;
+    mem.primary = vertex.mem->primary;
+    mem.fragment = vertex.fragment;
+    mem.nodes.push_back(vertex.node);
+    for (auto p = vertex.positions_begin; p != vertex.positions_end; ++p) {
+        mem.positions[path_names[p->path]].push_back(make_pair(p->offset, p->is_rev));
+    }
+    return mem;
+}
+
+pair<int64_t, int64_t> MEMChainModelVertex::min_oriented_distances(const MEMChainModelVertex& other) const {
+    int64_t distance_same = std::numeric_limits<int64_t>::max();
+    int64_t distance_diff = std::numeric_limits<int64_t>::max();
+    for (auto p1 = positions_begin; p1 != positions_end; ++p1) {
+        for (auto p2 = other.positions_begin; p2 != other.positions_end; ++p2) {
+            if (p1->path == p2->path) {
+                int64_t proposal = abs((int64_t)p1->offset - (int64_t)p2->offset);
+                if (p1->is_rev == p2->is_rev) {
+                    distance_same = min(distance_same, proposal);
+                } else {
+                    distance_diff = min(distance_diff, proposal);
+                }
+            }
+        }
+    }
+    return make_pair(distance_same, distance_diff);
+}
+
 // show model
 void MEMChainModel::display(ostream& out) {
+    auto show_hit = [&](const MEMChainModelVertex& vertex) {
+        id_t id = gcsa::Node::id(vertex.node);
+        size_t offset = gcsa::Node::offset(vertex.node);
+        bool is_rev = gcsa::Node::rc(vertex.node);
+        out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
+    };
     for (auto& vertex : model) {
-        out << vertex.mem.sequence() << ":" << vertex.mem.fragment << " " << &vertex << ":" << vertex.score << "@";
-        for (auto& node : vertex.mem.nodes) {
-            id_t id = gcsa::Node::id(node);
-            size_t offset = gcsa::Node::offset(node);
-            bool is_rev = gcsa::Node::rc(node);
-            out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
-        }
+        out << vertex.mem->sequence() << ":" << vertex.fragment << " " << &vertex << ":" << vertex.score << "@";
+        show_hit(vertex);
         out << "prev: ";
         for (auto& p : vertex.prev_cost) {
-            auto& next = p.first;
             if (p.first == nullptr) continue;
             out << p.first << ":" << p.second << "@";
-            for (auto& node : next->mem.nodes) {
-                id_t id = gcsa::Node::id(node);
-                size_t offset = gcsa::Node::offset(node);
-                bool is_rev = gcsa::Node::rc(node);
-                out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
-            }
+            show_hit(*p.first);
             out << " ; ";
         }
         out << " next: ";
         for (auto& p : vertex.next_cost) {
-            auto& next = p.first;
             if (p.first == nullptr) continue;
             out << p.first << ":" << p.second << "@";
-            for (auto& node : next->mem.nodes) {
-                id_t id = gcsa::Node::id(node);
-                size_t offset = gcsa::Node::offset(node);
-                bool is_rev = gcsa::Node::rc(node);
-                out << id << (is_rev ? "-" : "+") << ":" << offset << " ";
-            }
+            show_hit(*p.first);
             out << " ; ";
         }
         out << endl;
@@ -471,8 +524,14 @@ void MEMClusterer::deduplicate_cluster_pairs(vector<pair<pair<size_t, size_t>, i
     
 MEMClusterer::HitGraph::HitGraph(const vector<MaximalExactMatch>& mems, const Alignment& alignment, const GSSWAligner* aligner,
                                  size_t min_mem_length) {
-    // there generally will be at least as many nodes as MEMs, so we can speed up the reallocation
-    nodes.reserve(mems.size());
+    // there is one node per hit of a long enough MEM, so we can avoid reallocating
+    size_t total_hits = 0;
+    for (const MaximalExactMatch& mem : mems) {
+        if (mem.length() >= min_mem_length) {
+            total_hits += mem.nodes.size();
+        }
+    }
+    nodes.reserve(total_hits);
     
     for (const MaximalExactMatch& mem : mems) {
         
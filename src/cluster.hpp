@@ -113,9 +113,25 @@ private:
     size_t primitive_root;
 };
 
+/// A position of a MEM hit along a path, stored flat in a MEMChainModel
+struct MEMChainModelPosition {
+    /// The path's index in the model's path_names
+    size_t path;
+    size_t offset;
+    bool is_rev;
+};
+
 class MEMChainModelVertex {
 public:
-    MaximalExactMatch mem;
+    /// The MEM this is a hit of, which must outlive the model
+    const MaximalExactMatch* mem;
+    /// The hit in the graph that this vertex stands for
+    gcsa::node_type node;
+    /// The fragment (read of a pair) the MEM came from, counting from 1
+    int fragment;
+    /// The hit's path positions, as a slice of the model's hit_positions
+    const MEMChainModelPosition* positions_begin;
+    const MEMChainModelPosition* positions_end;
     vector<pair<MEMChainModelVertex*, double> > next_cost; // for forward
     vector<pair<MEMChainModelVertex*, double> > prev_cost; // for backward
     double weight;
@@ -127,27 +143,47 @@ public:
     MEMChainModelVertex& operator=(const MEMChainModelVertex&) & = default;  // MEMChainModelVertexopy assignment operator
     MEMChainModelVertex& operator=(MEMChainModelVertex&&) & = default;       // Move assignment operator
     virtual ~MEMChainModelVertex() { }                     // Destructor
+    
+    /// Get the minimum distances to the other hit along the paths they share,
+    /// with the same and with opposite orientations on the path
+    pair<int64_t, int64_t> min_oriented_distances(const MEMChainModelVertex& other) const;
 };
 
+/*
+ * A Markov chain model over the hits of MEMs. Each hit is a vertex that
+ * refers back to its MEM instead of copying it, and the path positions of
+ * all the hits are stored in one flat array. MEMs with their positions are
+ * only made for the hits that come out of traceback().
+ */
 class MEMChainModel {
 public:
     vector<MEMChainModelVertex> model;
+    /// The path positions of every hit, with each vertex's positions together
+    vector<MEMChainModelPosition> hit_positions;
+    /// The names of the paths in hit_positions, with "" for approximate positions
+    vector<string> path_names;
     map<string, map<int64_t, vector<vector<MEMChainModelVertex>::iterator> > > positions;
     set<vector<MEMChainModelVertex>::iterator> redundant_vertexes;
+    /// Build the model over the hits of the matches, which must outlive it
     MEMChainModel(
         const vector<size_t>& aln_lengths,
         const vector<vector<MaximalExactMatch> >& matches,
         const function<int64_t(pos_t)>& approx_position,
         const function<map<string, vector<pair<size_t, bool> > >(pos_t)>& path_position,
-        const function<double(const MaximalExactMatch&, const MaximalExactMatch&)>& transition_weight,
+        const function<double(const MEMChainModelVertex&, const MEMChainModelVertex&)>& transition_weight,
         int band_width = 10,
         int position_depth = 1,
         int max_connections = 20);
+    // the vertexes point into the model's own storage
+    MEMChainModel(const MEMChainModel&) = delete;
+    MEMChainModel& operator=(const MEMChainModel&) = delete;
     void score(const unordered_set<MEMChainModelVertex*>& exclude);
     MEMChainModelVertex* max_vertex(void);
     vector<vector<MaximalExactMatch> > traceback(int alt_alns, bool paired, bool debug);
     void display(ostream& out);
     void clear_scores(void);
+    /// Make a MEM with just the hit of the given vertex, and its path positions
+    MaximalExactMatch vertex_mem(const MEMChainModelVertex& vertex) const;
 };
 
 /*
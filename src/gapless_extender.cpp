@@ -4,6 +4,10 @@
 #include <set>
 #include <stack>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace vg {
 
 //------------------------------------------------------------------------------
@@ -14,6 +18,79 @@ constexpr size_t GaplessExtender::MAX_MISMATCHES;
 
 //------------------------------------------------------------------------------
 
+size_t GaplessExtension::tail_offset(const HandleGraph& graph) const {
+    size_t result = this->offset + this->core_length();
+    for (size_t i = 0; i + 1 < this->path.size(); i++) {
+        result -= graph.get_length(this->path[i]);
+    }
+    return result;
+}
+
+Position GaplessExtension::starting_position(const HandleGraph& graph) const {
+    Position result;
+    result.set_node_id(graph.get_id(this->path.front()));
+    result.set_is_reverse(graph.get_is_reverse(this->path.front()));
+    result.set_offset(this->offset);
+    return result;
+}
+
+Position GaplessExtension::tail_position(const HandleGraph& graph) const {
+    Position result;
+    result.set_node_id(graph.get_id(this->path.back()));
+    result.set_is_reverse(graph.get_is_reverse(this->path.back()));
+    result.set_offset(this->tail_offset(graph));
+    return result;
+}
+
+Path GaplessExtension::to_path(const HandleGraph& graph, const std::string& sequence) const {
+
+    Path result;
+    if (this->empty()) {
+        return result;
+    }
+
+    // Skip the mismatches in the left flank.
+    size_t mismatch_offset = 0; // In mismatch_positions.
+    while (mismatch_offset < this->mismatch_positions.size() && this->mismatch_positions[mismatch_offset] < this->core_interval.first) {
+        mismatch_offset++;
+    }
+
+    size_t sequence_offset = this->core_interval.first; // Start of the unmapped part in the sequence.
+    size_t node_offset = this->offset; // Start of the alignment in the current node.
+    for (size_t i = 0; i < this->path.size(); i++) {
+        size_t limit = std::min(sequence_offset + graph.get_length(this->path[i]) - node_offset, this->core_interval.second);
+        Mapping& mapping = *(result.add_mapping());
+        mapping.mutable_position()->set_node_id(graph.get_id(this->path[i]));
+        mapping.mutable_position()->set_offset(node_offset);
+        mapping.mutable_position()->set_is_reverse(graph.get_is_reverse(this->path[i]));
+        while (mismatch_offset < this->mismatch_positions.size() && this->mismatch_positions[mismatch_offset] < limit) {
+            if (sequence_offset < this->mismatch_positions[mismatch_offset]) {
+                Edit& exact_match = *(mapping.add_edit());
+                exact_match.set_from_length(this->mismatch_positions[mismatch_offset] - sequence_offset);
+                exact_match.set_to_length(this->mismatch_positions[mismatch_offset] - sequence_offset);
+            }
+            Edit& mismatch = *(mapping.add_edit());
+            mismatch.set_from_length(1);
+            mismatch.set_to_length(1);
+            mismatch.set_sequence(std::string(1, sequence[this->mismatch_positions[mismatch_offset]]));
+            sequence_offset = this->mismatch_positions[mismatch_offset] + 1;
+            mismatch_offset++;
+        }
+        if (sequence_offset < limit) {
+            Edit& exact_match = *(mapping.add_edit());
+            exact_match.set_from_length(limit - sequence_offset);
+            exact_match.set_to_length(limit - sequence_offset);
+            sequence_offset = limit;
+        }
+        mapping.set_rank(i + 1);
+        node_offset = 0;
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
 GaplessExtender::GaplessExtender() :
     graph(nullptr)
 {
@@ -47,6 +124,79 @@ std::vector<GaplessExtension> GaplessExtender::extend(cluster_type& cluster, con
 
 //------------------------------------------------------------------------------
 
+// Length of the longest common prefix of the n-character arrays. Compares 16 characters
+// at a time when SSE2 is available.
+size_t common_prefix_length(const char* a, const char* b, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        unsigned mismatches = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) & 0xFFFF;
+        if (mismatches != 0) {
+            return i + __builtin_ctz(mismatches);
+        }
+    }
+#endif
+    while (i < n && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+// Length of the longest common suffix of the n-character arrays ending before a_end and
+// b_end. Compares 16 characters at a time when SSE2 is available.
+size_t common_suffix_length(const char* a_end, const char* b_end, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_end - i - 16));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b_end - i - 16));
+        unsigned mismatches = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) & 0xFFFF;
+        if (mismatches != 0) {
+            // The last mismatch is the highest set bit.
+            return i + (__builtin_clz(mismatches) - 16);
+        }
+    }
+#endif
+    while (i < n && *(a_end - i - 1) == *(b_end - i - 1)) {
+        i++;
+    }
+    return i;
+}
+
+// Length of the longest common prefix of the n characters starting at seq and the n
+// characters of the view starting at the given offset. A reverse view is compared one
+// character at a time, complementing the stored forward sequence on the fly.
+size_t common_prefix_length(const char* seq, GBWTGraph::strand_view view, size_t offset, size_t n) {
+    if (!view.reverse) {
+        return common_prefix_length(seq, view.data + offset, n);
+    }
+    const char* target_end = view.data + view.length - offset;
+    size_t i = 0;
+    while (i < n && seq[i] == reverse_complement(*(target_end - i - 1))) {
+        i++;
+    }
+    return i;
+}
+
+// Length of the longest common suffix of the n characters ending before seq_end and the
+// n characters of the view ending before the given offset. A reverse view is compared one
+// character at a time, complementing the stored forward sequence on the fly.
+size_t common_suffix_length(const char* seq_end, GBWTGraph::strand_view view, size_t end, size_t n) {
+    if (!view.reverse) {
+        return common_suffix_length(seq_end, view.data + end, n);
+    }
+    const char* target = view.data + view.length - end;
+    size_t i = 0;
+    while (i < n && *(seq_end - i - 1) == reverse_complement(target[i])) {
+        i++;
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+
 struct GaplessMatch {
     size_t score;
     size_t start, limit; // In the sequence.
@@ -73,16 +223,21 @@ std::ostream& operator<<(std::ostream& out, const GaplessMatch& match) {
 }
 
 // Match forward, starting from the given target offset.
-void match_forward(const std::string& seq, std::pair<const char*, size_t> target, size_t target_offset,
+void match_forward(const std::string& seq, GBWTGraph::strand_view target, size_t target_offset,
                    GaplessMatch& match, size_t error_bound) {
-    while (match.limit < seq.length() && target_offset < target.second) {
-        if (seq[match.limit] != target.first[target_offset]) {
-            match.score++;
-            if (match.score < error_bound) {
-                match.mismatches.push_back(match.limit);
-            } else {
-                return;
-            }
+    while (match.limit < seq.length() && target_offset < target.size()) {
+        size_t length = std::min(seq.length() - match.limit, target.size() - target_offset);
+        size_t matched = common_prefix_length(seq.data() + match.limit, target, target_offset, length);
+        match.limit += matched;
+        target_offset += matched;
+        if (matched >= length) {
+            return;
+        }
+        match.score++;
+        if (match.score < error_bound) {
+            match.mismatches.push_back(match.limit);
+        } else {
+            return;
         }
         match.limit++;
         target_offset++;
@@ -90,28 +245,34 @@ void match_forward(const std::string& seq, std::pair<const char*, size_t> target
 }
 
 // Match backward, starting from the end of the target and updating match offset.
-void match_backward(const std::string& seq, std::pair<const char*, size_t> target,
+void match_backward(const std::string& seq, GBWTGraph::strand_view target,
                     GaplessMatch& match, size_t error_bound) {
-    match.offset = target.second;
+    match.offset = target.size();
     while (match.start > 0 && match.offset > 0) {
+        size_t length = std::min(match.start, match.offset);
+        size_t matched = common_suffix_length(seq.data() + match.start, target, match.offset, length);
+        match.start -= matched;
+        match.offset -= matched;
+        if (matched >= length) {
+            return;
+        }
         match.start--;
         match.offset--;
-        if (seq[match.start] != target.first[match.offset]) {
-            match.score++;
-            if (match.score < error_bound) {
-                match.mismatches.push_back(match.start);
-            } else {
-                return;
-            }
+        match.score++;
+        if (match.score < error_bound) {
+            match.mismatches.push_back(match.start);
+        } else {
+            return;
         }
     }
 }
 
 // Convert the GaplessMatch to GaplessExtension.
-GaplessExtension match_to_extension(GaplessMatch& match, const GBWTGraph& graph, const std::string& sequence) {
+GaplessExtension match_to_extension(GaplessMatch& match, const std::string& sequence) {
 
     GaplessExtension result {
-        Path(),
+        { },
+        match.offset,
         match.state,
         { match.start, match.limit },
         (match.start == 0 && match.limit == sequence.length()),
@@ -122,40 +283,8 @@ GaplessExtension match_to_extension(GaplessMatch& match, const GBWTGraph& graph,
         return result;
     }
 
-    // Build the path.
+    result.path.swap(match.path);
     std::sort(match.mismatches.begin(), match.mismatches.end());
-    size_t sequence_offset = 0; // Start of the unmapped part in the sequence.
-    size_t mismatch_offset = 0; // In match.mismatches.
-    size_t node_offset = match.offset; // Start of the alignment in the current node.
-    for (size_t i = 0; i < match.path.size(); i++) {
-        size_t limit = std::min(sequence_offset + graph.get_length(match.path[i]) - node_offset, match.limit);
-        Mapping& mapping = *(result.path.add_mapping());
-        mapping.mutable_position()->set_node_id(graph.get_id(match.path[i]));
-        mapping.mutable_position()->set_offset(node_offset);
-        mapping.mutable_position()->set_is_reverse(graph.get_is_reverse(match.path[i]));
-        while (mismatch_offset < match.mismatches.size() && match.mismatches[mismatch_offset] < limit) {
-            if (sequence_offset < match.mismatches[mismatch_offset]) {
-                Edit& exact_match = *(mapping.add_edit());
-                exact_match.set_from_length(match.mismatches[mismatch_offset] - sequence_offset);
-                exact_match.set_to_length(match.mismatches[mismatch_offset] - sequence_offset);
-            }
-            Edit& mismatch = *(mapping.add_edit());
-            mismatch.set_from_length(1);
-            mismatch.set_to_length(1);
-            mismatch.set_sequence(std::string(1, sequence[match.mismatches[mismatch_offset]]));
-            sequence_offset = match.mismatches[mismatch_offset] + 1;
-            mismatch_offset++;
-        }
-        if (sequence_offset < limit) {
-            Edit& exact_match = *(mapping.add_edit());
-            exact_match.set_from_length(limit - sequence_offset);
-            exact_match.set_to_length(limit - sequence_offset);
-            sequence_offset = limit;
-        }
-        mapping.set_rank(i + 1);
-        node_offset = 0;
-    }
-
     result.mismatch_positions.swap(match.mismatches);
     return result;
 }
@@ -170,7 +299,7 @@ GaplessExtension GaplessExtender::extend_seeds(cluster_type& cluster, const std:
         { }
     };
     if (this->graph == nullptr) {
-        return match_to_extension(best_match, *(this->graph), sequence);
+        return match_to_extension(best_match, sequence);
     }
 
     // Process the seeds in sorted order.
@@ -202,7 +331,7 @@ GaplessExtension GaplessExtender::extend_seeds(cluster_type& cluster, const std:
                 { },
                 { }            
             };
-            match_forward(sequence, this->graph->get_sequence_view(handle), match.offset, match, best_match.score);
+            match_forward(sequence, this->graph->get_strand_view(handle), match.offset, match, best_match.score);
             if (match.score >= best_match.score) { 
                 continue;
             } else {
@@ -218,7 +347,7 @@ GaplessExtension GaplessExtender::extend_seeds(cluster_type& cluster, const std:
                 forward.push(match);
             }
             if (best_match.score == 0) {
-                return match_to_extension(best_match, *(this->graph), sequence);
+                return match_to_extension(best_match, sequence);
             }
         }
 
@@ -239,7 +368,7 @@ GaplessExtension GaplessExtender::extend_seeds(cluster_type& cluster, const std:
                     { },
                     { }
                 };
-                match_forward(sequence, this->graph->get_sequence_view(handle), 0, next, best_match.score);
+                match_forward(sequence, this->graph->get_strand_view(handle), 0, next, best_match.score);
                 if (next.score >= best_match.score) {
                     return true;
                 } else {
@@ -260,7 +389,7 @@ GaplessExtension GaplessExtender::extend_seeds(cluster_type& cluster, const std:
                 return true;
             });
             if (best_match.score == 0) {
-                return match_to_extension(best_match, *(this->graph), sequence);
+                return match_to_extension(best_match, sequence);
             }
         }
 
@@ -281,7 +410,7 @@ GaplessExtension GaplessExtender::extend_seeds(cluster_type& cluster, const std:
                     { },
                     { }
                 };
-                match_backward(sequence, this->graph->get_sequence_view(handle), next, best_match.score);
+                match_backward(sequence, this->graph->get_strand_view(handle), next, best_match.score);
                 if (next.score >= best_match.score) {
                     return true;
                 } else {
@@ -298,12 +427,12 @@ GaplessExtension GaplessExtender::extend_seeds(cluster_type& cluster, const std:
                 return true;
             });
             if (best_match.score == 0) {
-                return match_to_extension(best_match, *(this->graph), sequence);
+                return match_to_extension(best_match, sequence);
             }
         }
     }
 
-    return match_to_extension(best_match, *(this->graph), sequence);
+    return match_to_extension(best_match, sequence);
 }
 
 //------------------------------------------------------------------------------
@@ -343,32 +472,30 @@ struct UnambiguousMatch {
 };
 
 // Match forward as long as the characters match,
-void match_forward(const std::string& seq, std::pair<const char*, size_t> target, UnambiguousMatch& match) {
-    while (match.seq_limit < seq.length() && match.node_limit < target.second) {
-        if (seq[match.seq_limit] != target.first[match.node_limit]) {
-            break;
-        }
-        match.seq_limit++;
-        match.node_limit++;
+void match_forward(const std::string& seq, GBWTGraph::strand_view target, UnambiguousMatch& match) {
+    if (match.seq_limit >= seq.length() || match.node_limit >= target.size()) {
+        return;
     }
+    size_t length = std::min(seq.length() - match.seq_limit, target.size() - match.node_limit);
+    size_t matched = common_prefix_length(seq.data() + match.seq_limit, target, match.node_limit, length);
+    match.seq_limit += matched;
+    match.node_limit += matched;
 }
 
 // Match backward as long as the characters match.
-void match_backward(const std::string& seq, std::pair<const char*, size_t> target, UnambiguousMatch& match) {
-    while (match.seq_start > 0 && match.node_start > 0) {
-        if (seq[match.seq_start - 1] != target.first[match.node_start - 1]) {
-            break;
-        }
-        match.seq_start--;
-        match.node_start--;
-    }
+void match_backward(const std::string& seq, GBWTGraph::strand_view target, UnambiguousMatch& match) {
+    size_t length = std::min(match.seq_start, match.node_start);
+    size_t matched = common_suffix_length(seq.data() + match.seq_start, target, match.node_start, length);
+    match.seq_start -= matched;
+    match.node_start -= matched;
 }
 
 // Convert UnambiguousMatch to GaplessExtension.
-GaplessExtension unambiguous_match_to_extension(const UnambiguousMatch& match, const GBWTGraph& graph, const std::string& sequence) {
+GaplessExtension unambiguous_match_to_extension(const UnambiguousMatch& match, const std::string& sequence) {
 
     GaplessExtension result {
-        Path(),
+        { },
+        match.node_start,
         match.state,
         { match.seq_start, match.seq_limit },
         (match.seq_start == 0 && match.seq_limit == sequence.length()),
@@ -379,22 +506,7 @@ GaplessExtension unambiguous_match_to_extension(const UnambiguousMatch& match, c
         return result;
     }
 
-    for (size_t i = 0; i < match.path.size(); i++) {
-        size_t start = (i == 0 ? match.node_start : 0);
-        size_t limit = (i + 1 == match.path.size() ? match.node_limit : graph.get_length(match.path[i]));
-
-        Mapping& mapping = *(result.path.add_mapping());
-        mapping.mutable_position()->set_node_id(graph.get_id(match.path[i]));
-        mapping.mutable_position()->set_offset(start);
-        mapping.mutable_position()->set_is_reverse(graph.get_is_reverse(match.path[i]));
-
-        Edit& exact_match = *(mapping.add_edit());
-        exact_match.set_from_length(limit - start);
-        exact_match.set_to_length(limit - start);
-
-        mapping.set_rank(i + 1);
-    }
-
+    result.path = match.path;
     return result;
 }
 
@@ -428,13 +540,13 @@ std::vector<GaplessExtension> GaplessExtender::maximal_extensions(cluster_type&
             this->graph->get_bd_state(handle),
             { handle }            
         };
-        std::pair<const char*, size_t> node_view = this->graph->get_sequence_view(handle);
+        GBWTGraph::strand_view node_view = this->graph->get_strand_view(handle);
         match_forward(sequence, node_view, match);
         prev_limit = match.node_limit;
         match_backward(sequence, node_view, match);
 
         // Match forward.
-        while (match.node_limit >= node_view.second && match.seq_limit < sequence.length()) {
+        while (match.node_limit >= node_view.size() && match.seq_limit < sequence.length()) {
             bool extension = false, ambiguous = false;
             gbwt::BidirectionalState successor;
             this->graph->follow_paths(match.state, false, [&](const gbwt::BidirectionalState& next_state) -> bool {
@@ -459,7 +571,7 @@ std::vector<GaplessExtension> GaplessExtender::maximal_extensions(cluster_type&
                 return true;
             });
             if (extension && !ambiguous) {
-                node_view = this->graph->get_sequence_view(handle);
+                node_view = this->graph->get_strand_view(handle);
                 match.seq_limit++;
                 match.node_limit = 1;
                 match.state = successor;
@@ -496,9 +608,9 @@ std::vector<GaplessExtension> GaplessExtender::maximal_extensions(cluster_type&
                 return true;
             });
             if (extension && !ambiguous) {
-                node_view = this->graph->get_sequence_view(handle);
+                node_view = this->graph->get_strand_view(handle);
                 match.seq_start--;
-                match.node_start = node_view.second - 1;
+                match.node_start = node_view.size() - 1;
                 match.state = successor;
                 match.path.insert(match.path.begin(), handle);
                 match_backward(sequence, node_view, match);
@@ -516,7 +628,7 @@ std::vector<GaplessExtension> GaplessExtender::maximal_extensions(cluster_type&
     std::vector<GaplessExtension> result;
     result.reserve(matches.size());
     for(const UnambiguousMatch& match : matches) {
-        result.emplace_back(unambiguous_match_to_extension(match, *(this->graph), sequence));
+        result.emplace_back(unambiguous_match_to_extension(match, sequence));
     }
     return result;
 }
@@ -576,35 +688,45 @@ struct FlankState {
 };
 
 // Match forward.
-void match_forward(const std::string& seq, std::pair<const char*, size_t> target, FlankState& match, size_t error_bound) {
-    while (match.seq_limit < seq.length() && match.node_limit < target.second) {
-        if (seq[match.seq_limit] == target.first[match.node_limit]) {
-            match.seq_limit++;
+void match_forward(const std::string& seq, GBWTGraph::strand_view target, FlankState& match, size_t error_bound) {
+    while (match.seq_limit < seq.length() && match.node_limit < target.size()) {
+        size_t length = std::min(seq.length() - match.seq_limit, target.size() - match.node_limit);
+        size_t matched = common_prefix_length(seq.data() + match.seq_limit, target, match.node_limit, length);
+        if (matched > 0) {
+            match.seq_limit += matched;
             match.match_limit = match.seq_limit;
-            match.node_limit++;
-        } else {
-            match.tail_mismatches.push_back(match.seq_limit);
-            match.seq_limit++;
-            match.node_limit++;
-            if (match.tail_mismatches.size() > error_bound) {
-                return;
-            }
+            match.node_limit += matched;
+        }
+        if (matched >= length) {
+            return;
+        }
+        match.tail_mismatches.push_back(match.seq_limit);
+        match.seq_limit++;
+        match.node_limit++;
+        if (match.tail_mismatches.size() > error_bound) {
+            return;
         }
     }
 }
 
 // Match backward.
-void match_backward(const std::string& seq, std::pair<const char*, size_t> target, FlankState& match, size_t error_bound) {
+void match_backward(const std::string& seq, GBWTGraph::strand_view target, FlankState& match, size_t error_bound) {
     while (match.seq_start > 0 && match.node_start > 0) {
+        size_t length = std::min(match.seq_start, match.node_start);
+        size_t matched = common_suffix_length(seq.data() + match.seq_start, target, match.node_start, length);
+        if (matched > 0) {
+            match.seq_start -= matched;
+            match.match_start = match.seq_start;
+            match.node_start -= matched;
+        }
+        if (matched >= length) {
+            return;
+        }
         match.seq_start--;
         match.node_start--;
-        if (seq[match.seq_start] == target.first[match.node_start]) {
-            match.match_start = match.seq_start;
-        } else {
-            match.head_mismatches.push_back(match.seq_start);
-            if (match.head_mismatches.size() > error_bound) {
-                return;
-            }
+        match.head_mismatches.push_back(match.seq_start);
+        if (match.head_mismatches.size() > error_bound) {
+            return;
         }
     }
 }
@@ -623,7 +745,7 @@ void GaplessExtender::extend_flanks(std::vector<GaplessExtension>& extensions, c
             extension.state,
             extension.core_interval.first, extension.core_interval.second,
             extension.core_interval.first, extension.core_interval.second,
-            head_offset(extension.path), tail_offset(extension.path),
+            extension.offset, extension.tail_offset(*(this->graph)),
             { }, { }
         };
 
@@ -631,11 +753,11 @@ void GaplessExtender::extend_flanks(std::vector<GaplessExtension>& extensions, c
         std::stack<FlankState> forward, backward;
         {
             handle_t backward_handle = GBWTGraph::node_to_handle(gbwt::Node::reverse(best_match.state.backward.node));
-            std::pair<const char*, size_t> backward_view = this->graph->get_sequence_view(backward_handle);
+            GBWTGraph::strand_view backward_view = this->graph->get_strand_view(backward_handle);
             match_backward(sequence, backward_view, best_match, max_mismatches);
 
             handle_t forward_handle = GBWTGraph::node_to_handle(best_match.state.forward.node);
-            std::pair<const char*, size_t> forward_view = this->graph->get_sequence_view(forward_handle);
+            GBWTGraph::strand_view forward_view = this->graph->get_strand_view(forward_handle);
             match_forward(sequence, forward_view, best_match, max_mismatches);
 
             if (best_match.right_maximal(max_mismatches, sequence.length())) {
@@ -645,7 +767,7 @@ void GaplessExtender::extend_flanks(std::vector<GaplessExtension>& extensions, c
                 } else if (best_match.at_start()) {
                     backward.push(best_match);
                 }
-            } else if (best_match.at_end(forward_view.second)) {
+            } else if (best_match.at_end(forward_view.size())) {
                 forward.push(best_match);
             }
         }
@@ -661,7 +783,7 @@ void GaplessExtender::extend_flanks(std::vector<GaplessExtension>& extensions, c
                 }
                 extension = true;
                 handle_t handle = GBWTGraph::node_to_handle(next_state.forward.node);
-                std::pair<const char*, size_t> seq_view = this->graph->get_sequence_view(handle);
+                GBWTGraph::strand_view seq_view = this->graph->get_strand_view(handle);
                 FlankState next = curr;
                 next.state = next_state;
                 next.node_limit = 0;
@@ -676,7 +798,7 @@ void GaplessExtender::extend_flanks(std::vector<GaplessExtension>& extensions, c
                     } else if (next.at_start()) {
                         backward.push(next);
                     }
-                } else if (next.at_end(seq_view.second)){
+                } else if (next.at_end(seq_view.size())){
                     forward.push(next);
                 }
                 return true;
@@ -705,10 +827,10 @@ void GaplessExtender::extend_flanks(std::vector<GaplessExtension>& extensions, c
                 }
                 extension = true;
                 handle_t handle = GBWTGraph::node_to_handle(gbwt::Node::reverse(next_state.backward.node));
-                std::pair<const char*, size_t> seq_view = this->graph->get_sequence_view(handle);
+                GBWTGraph::strand_view seq_view = this->graph->get_strand_view(handle);
                 FlankState next = curr;
                 next.state = next_state;
-                next.node_start = seq_view.second;
+                next.node_start = seq_view.size();
                 match_backward(sequence, seq_view, next, max_mismatches);
                 if (next.left_maximal(max_mismatches)) {
                     next.trim_head();
@@ -743,16 +865,4 @@ void GaplessExtender::extend_flanks(std::vector<GaplessExtension>& extensions, c
 
 //------------------------------------------------------------------------------
 
-size_t GaplessExtender::head_offset(const Path& path) {
-    return path.mapping(0).position().offset();
-}
-
-
-size_t GaplessExtender::tail_offset(const Path& path) {
-    const Mapping& mapping = path.mapping(path.mapping_size() - 1);
-    return mapping.position().offset() + mapping.edit(0).to_length();
-}
-
-//------------------------------------------------------------------------------
-
 } // namespace vg
@@ -15,7 +15,8 @@ namespace vg {
 
 /**
  * A result of the gapless extension of a seed.
- * - 'path' covers 'core_interval' of the read.
+ * - 'path' is the sequence of oriented nodes covering 'core_interval' of the read,
+ *   starting at 'offset' in the first node. Use to_path() to get a Path.
  * - The intervals are semi-open [first, second) intervals.
  * - 'state' is the search state corresponding to 'path'.
  * - If 'is_full_alignment' is set, the path is a full-length alignment and may contain
@@ -27,7 +28,8 @@ namespace vg {
  */
 struct GaplessExtension
 {
-  Path                      path;
+  std::vector<handle_t>     path;
+  size_t                    offset;
   gbwt::BidirectionalState  state;
   std::pair<size_t, size_t> core_interval;
   bool                      is_full_alignment;
@@ -41,6 +43,19 @@ struct GaplessExtension
   bool full() const { return this->is_full_alignment; }
   bool exact() const { return this->mismatch_positions.empty(); }
   size_t mismatches() const { return this->mismatch_positions.size(); }
+
+  /// Offset in the last node of the path just past the end of the core interval.
+  size_t tail_offset(const HandleGraph& graph) const;
+
+  /// Position of the first base of the core interval.
+  Position starting_position(const HandleGraph& graph) const;
+
+  /// Position just past the end of the core interval, on the last node of the path.
+  Position tail_position(const HandleGraph& graph) const;
+
+  /// Convert the core interval to a Path aligning the given read sequence, with the
+  /// mismatches inside the core interval as substitutions.
+  Path to_path(const HandleGraph& graph, const std::string& sequence) const;
 };
 
 //------------------------------------------------------------------------------
@@ -97,10 +112,6 @@ public:
     void extend_flanks(std::vector<GaplessExtension>& extensions, const std::string& sequence, size_t max_mismatches = MAX_MISMATCHES / 2) const;
 
     const GBWTGraph* graph;
-
-private:
-    static size_t head_offset(const Path& path);
-    static size_t tail_offset(const Path& path);
 };
 
 //------------------------------------------------------------------------------
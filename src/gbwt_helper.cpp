@@ -11,6 +11,8 @@ namespace vg {
 // Numerical class constants.
 
 constexpr size_t GBWTGraph::CHUNK_SIZE;
+constexpr std::uint32_t GBWTGraph::Header::TAG;
+constexpr std::uint32_t GBWTGraph::Header::VERSION;
 
 //------------------------------------------------------------------------------
 
@@ -39,19 +41,19 @@ std::string thread_name(const gbwt::GBWT& gbwt_index, size_t i) {
 
 //------------------------------------------------------------------------------
 
-GBWTGraph::GBWTGraph(const gbwt::GBWT& gbwt_index, const HandleGraph& sequence_source) :
-    index(gbwt_index), total_nodes(0) {
+GBWTGraph::GBWTGraph(const gbwt::GBWT& gbwt_index, const HandleGraph& sequence_source, bool single_strand) :
+    index(&gbwt_index), total_nodes(0), single_strand(single_strand), first_node(gbwt_index.firstNode()), sigma(gbwt_index.sigma()) {
 
     // Sanity checks for the GBWT index.
-    assert(this->index.bidirectional());
+    assert(this->index->bidirectional());
 
     // Determine the number of real nodes and the total length of the sequences.
     // Node n is real, if real_nodes[node_offset(n) / 2] is true.
-    size_t total_length = 0, potential_nodes = this->index.sigma() - this->index.firstNode();
+    size_t total_length = 0, potential_nodes = this->index->sigma() - this->index->firstNode();
     this->real_nodes = std::vector<bool>(potential_nodes / 2, false);
     std::vector<handle_t> handle_cache(potential_nodes); // Getting handles from XG is slow.
-    for (gbwt::node_type node = this->index.firstNode(); node < this->index.sigma(); node += 2) {
-        if (this->index.empty(node)) {
+    for (gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2) {
+        if (this->index->empty(node)) {
             continue;
         }
         size_t offset = this->node_offset(node);
@@ -61,12 +63,13 @@ GBWTGraph::GBWTGraph(const gbwt::GBWT& gbwt_index, const HandleGraph& sequence_s
         total_length += sequence_source.get_length(source_handle);
         handle_cache[offset] = source_handle;
     }
-    this->sequences.reserve(2 * total_length);
+    this->sequences.reserve(this->single_strand ? total_length : 2 * total_length);
     this->offsets = sdsl::int_vector<0>(potential_nodes + 1, 0, gbwt::bit_length(this->sequences.capacity()));
 
     // Store the concatenated sequences and their offset ranges for both orientations of all nodes.
     // Given GBWT node n, the sequence is sequences[node_offset(n)] to sequences[node_offset(n + 1) - 1].
-    for (gbwt::node_type node = this->index.firstNode(); node < this->index.sigma(); node += 2) {
+    // In single-strand mode, the range for the reverse orientation is empty.
+    for (gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2) {
         std::string seq;
         size_t offset = this->node_offset(node);
         if (this->real_nodes[offset / 2]) {
@@ -74,18 +77,27 @@ GBWTGraph::GBWTGraph(const gbwt::GBWT& gbwt_index, const HandleGraph& sequence_s
         }
         this->sequences.insert(this->sequences.end(), seq.begin(), seq.end());
         this->offsets[offset + 1] = this->sequences.size();
-        seq = reverse_complement(seq);
-        this->sequences.insert(this->sequences.end(), seq.begin(), seq.end());
+        if (!this->single_strand) {
+            seq = reverse_complement(seq);
+            this->sequences.insert(this->sequences.end(), seq.begin(), seq.end());
+        }
         this->offsets[offset + 2] = this->sequences.size();
     }
 }
 
+GBWTGraph::GBWTGraph() :
+    index(nullptr), total_nodes(0), single_strand(false), first_node(0), sigma(0) {
+}
+
 GBWTGraph::GBWTGraph(const GBWTGraph& source) :
     index(source.index) {
     this->sequences = source.sequences;
     this->offsets = source.offsets;
     this->real_nodes = source.real_nodes;
     this->total_nodes = source.total_nodes;
+    this->single_strand = source.single_strand;
+    this->first_node = source.first_node;
+    this->sigma = source.sigma;
 }
 
 GBWTGraph::GBWTGraph(GBWTGraph&& source) :
@@ -93,7 +105,255 @@ GBWTGraph::GBWTGraph(GBWTGraph&& source) :
     this->sequences = std::move(source.sequences);
     this->offsets = std::move(source.offsets);
     this->real_nodes = std::move(source.real_nodes);
-    this->total_nodes = std::move(total_nodes);
+    this->total_nodes = source.total_nodes;
+    this->single_strand = source.single_strand;
+    this->first_node = source.first_node;
+    this->sigma = source.sigma;
+}
+
+//------------------------------------------------------------------------------
+
+GBWTGraph::Header::Header() :
+    tag(TAG), version(VERSION), first_node(0), sigma(0), nodes(0) {
+}
+
+bool GBWTGraph::Header::check() const {
+    return (this->tag == TAG && this->version == VERSION);
+}
+
+// Serialization helpers for the packed sequences.
+namespace gg {
+
+// 2-bit codes of the bases. Other characters are stored as exceptions.
+inline std::uint64_t pack_base(char c) {
+    switch (c) {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+    default:  return 4;
+    }
+}
+
+constexpr char UNPACK_BASE[4] = { 'A', 'C', 'G', 'T' };
+
+template<class Element>
+size_t serialize(std::ostream& out, const Element& element, bool& ok) {
+    out.write(reinterpret_cast<const char*>(&element), sizeof(element));
+    ok &= out.good();
+    return sizeof(element);
+}
+
+template<class Element>
+bool load(std::istream& in, Element& element) {
+    in.read(reinterpret_cast<char*>(&element), sizeof(element));
+    return in.good();
+}
+
+template<class Vector>
+size_t serialize_sdsl(std::ostream& out, const Vector& vector, bool& ok) {
+    size_t bytes = vector.serialize(out);
+    ok &= out.good();
+    return bytes;
+}
+
+template<class Vector>
+bool load_sdsl(std::istream& in, Vector& vector) {
+    vector.load(in);
+    return in.good();
+}
+
+} // namespace gg
+
+std::pair<size_t, bool> GBWTGraph::serialize(std::ostream& out) const {
+    size_t bytes = 0;
+    bool ok = true;
+
+    Header header;
+    header.first_node = this->first_node;
+    header.sigma = this->sigma;
+    header.nodes = this->total_nodes;
+    bytes += gg::serialize(out, header, ok);
+
+    // Real nodes.
+    sdsl::bit_vector real(this->real_nodes.size(), 0);
+    for (size_t i = 0; i < this->real_nodes.size(); i++) {
+        real[i] = this->real_nodes[i];
+    }
+    bytes += gg::serialize_sdsl(out, real, ok);
+
+    // Forward sequences. Given node offset i / 2, the sequence starts at forward_offsets[i / 2].
+    size_t forward_length = 0;
+    for (size_t i = 0; i + 1 < this->offsets.size(); i += 2) {
+        forward_length += this->offsets[i + 1] - this->offsets[i];
+    }
+    sdsl::int_vector<0> forward_offsets(this->real_nodes.size() + 1, 0, gbwt::bit_length(forward_length));
+    sdsl::int_vector<2> packed(forward_length, 0);
+    std::vector<std::pair<size_t, char>> exceptions;
+    size_t tail = 0;
+    for (size_t i = 0; i + 1 < this->offsets.size(); i += 2) {
+        for (size_t j = this->offsets[i]; j < this->offsets[i + 1]; j++) {
+            std::uint64_t code = gg::pack_base(this->sequences[j]);
+            if (code > 3) {
+                exceptions.emplace_back(tail, this->sequences[j]);
+                code = 0;
+            }
+            packed[tail++] = code;
+        }
+        forward_offsets[i / 2 + 1] = tail;
+    }
+    bytes += gg::serialize_sdsl(out, forward_offsets, ok);
+    bytes += gg::serialize_sdsl(out, packed, ok);
+
+    // Exceptions to the packing.
+    sdsl::int_vector<0> exception_positions(exceptions.size(), 0, gbwt::bit_length(forward_length));
+    sdsl::int_vector<8> exception_values(exceptions.size(), 0);
+    for (size_t i = 0; i < exceptions.size(); i++) {
+        exception_positions[i] = exceptions[i].first;
+        exception_values[i] = static_cast<unsigned char>(exceptions[i].second);
+    }
+    bytes += gg::serialize_sdsl(out, exception_positions, ok);
+    bytes += gg::serialize_sdsl(out, exception_values, ok);
+
+    if (!ok) {
+        std::cerr << "error: [GBWTGraph] serialization failed" << std::endl;
+    }
+
+    return std::make_pair(bytes, ok);
+}
+
+bool GBWTGraph::load(std::istream& in) {
+    bool ok = true;
+
+    // Load and check the header.
+    Header header;
+    ok &= gg::load(in, header);
+    if (!ok || !(header.check())) {
+        std::cerr << "error: [GBWTGraph] invalid or old graph file" << std::endl;
+        std::cerr << "error: [GBWTGraph] graph version is " << header.version << "; required " << Header::VERSION << std::endl;
+        return false;
+    }
+
+    sdsl::bit_vector real;
+    sdsl::int_vector<0> forward_offsets;
+    sdsl::int_vector<2> packed;
+    sdsl::int_vector<0> exception_positions;
+    sdsl::int_vector<8> exception_values;
+    if (ok) {
+        ok &= gg::load_sdsl(in, real);
+    }
+    if (ok) {
+        ok &= gg::load_sdsl(in, forward_offsets);
+    }
+    if (ok) {
+        ok &= gg::load_sdsl(in, packed);
+    }
+    if (ok) {
+        ok &= gg::load_sdsl(in, exception_positions);
+    }
+    if (ok) {
+        ok &= gg::load_sdsl(in, exception_values);
+    }
+    if (ok && (forward_offsets.size() != real.size() + 1 || exception_positions.size() != exception_values.size())) {
+        ok = false;
+    }
+    if (!ok) {
+        std::cerr << "error: [GBWTGraph] graph loading failed" << std::endl;
+        return false;
+    }
+
+    this->index = nullptr;
+    this->first_node = header.first_node;
+    this->sigma = header.sigma;
+    this->total_nodes = header.nodes;
+    this->real_nodes = std::vector<bool>(real.size(), false);
+    for (size_t i = 0; i < real.size(); i++) {
+        this->real_nodes[i] = real[i];
+    }
+
+    // Unpack the sequences and rebuild the reverse complements unless in single-strand mode.
+    this->sequences.clear();
+    this->sequences.shrink_to_fit();
+    this->sequences.reserve(this->single_strand ? packed.size() : 2 * packed.size());
+    this->offsets = sdsl::int_vector<0>(2 * real.size() + 1, 0, gbwt::bit_length(2 * packed.size()));
+    size_t next_exception = 0;
+    for (size_t i = 0; i < real.size(); i++) {
+        size_t start = this->sequences.size();
+        for (size_t j = forward_offsets[i]; j < forward_offsets[i + 1]; j++) {
+            if (next_exception < exception_positions.size() && exception_positions[next_exception] == j) {
+                this->sequences.push_back(static_cast<char>(exception_values[next_exception]));
+                next_exception++;
+            } else {
+                this->sequences.push_back(gg::UNPACK_BASE[packed[j]]);
+            }
+        }
+        this->offsets[2 * i + 1] = this->sequences.size();
+        if (!this->single_strand) {
+            for (size_t j = this->sequences.size(); j > start; j--) {
+                this->sequences.push_back(reverse_complement(this->sequences[j - 1]));
+            }
+        }
+        this->offsets[2 * i + 2] = this->sequences.size();
+    }
+
+    return true;
+}
+
+bool GBWTGraph::set_gbwt(const gbwt::GBWT& gbwt_index) {
+    if (gbwt_index.firstNode() != this->first_node || gbwt_index.sigma() != this->sigma) {
+        std::cerr << "error: [GBWTGraph] the GBWT index does not match the graph" << std::endl;
+        return false;
+    }
+    if (!gbwt_index.bidirectional()) {
+        std::cerr << "error: [GBWTGraph] the GBWT index is not bidirectional" << std::endl;
+        return false;
+    }
+
+    // The node range alone does not identify the index. The nodes visited by
+    // the paths must be exactly the nodes we have sequences for.
+    for (gbwt::node_type node = this->first_node; node < this->sigma; node += 2) {
+        if (gbwt_index.empty(node) == this->real_nodes[this->node_offset(node) / 2]) {
+            std::cerr << "error: [GBWTGraph] the GBWT index does not match the graph at node " << gbwt::Node::id(node) << std::endl;
+            return false;
+        }
+    }
+
+    this->index = &gbwt_index;
+    return true;
+}
+
+void GBWTGraph::set_single_strand(bool single_strand) {
+    if (single_strand == this->single_strand) {
+        return;
+    }
+
+    // The forward sequence of node offset i / 2 is at the same place in both modes.
+    size_t forward_length = 0;
+    for (size_t i = 0; i + 1 < this->offsets.size(); i += 2) {
+        forward_length += this->offsets[i + 1] - this->offsets[i];
+    }
+    std::vector<char> new_sequences;
+    new_sequences.reserve(single_strand ? forward_length : 2 * forward_length);
+    sdsl::int_vector<0> new_offsets(this->offsets.size(), 0, gbwt::bit_length(new_sequences.capacity()));
+    for (size_t i = 0; i + 1 < this->offsets.size(); i += 2) {
+        size_t start = new_sequences.size();
+        new_sequences.insert(new_sequences.end(), this->sequences.begin() + this->offsets[i], this->sequences.begin() + this->offsets[i + 1]);
+        new_offsets[i + 1] = new_sequences.size();
+        if (!single_strand) {
+            for (size_t j = new_sequences.size(); j > start; j--) {
+                new_sequences.push_back(reverse_complement(new_sequences[j - 1]));
+            }
+        }
+        new_offsets[i + 2] = new_sequences.size();
+    }
+
+    this->sequences.swap(new_sequences);
+    this->offsets = std::move(new_offsets);
+    this->single_strand = single_strand;
+}
+
+size_t GBWTGraph::sequence_bytes() const {
+    return this->sequences.capacity() * sizeof(char) + sdsl::size_in_bytes(this->offsets);
 }
 
 //------------------------------------------------------------------------------
@@ -120,13 +380,17 @@ handle_t GBWTGraph::flip(const handle_t& handle) const {
 }
 
 size_t GBWTGraph::get_length(const handle_t& handle) const {
-    size_t offset = this->node_offset(handle);
+    size_t offset = this->stored_offset(handle);
     return this->offsets[offset + 1] - this->offsets[offset];
 }
 
 std::string GBWTGraph::get_sequence(const handle_t& handle) const {
-    size_t offset = this->node_offset(handle);
-    return std::string(this->sequences.begin() + this->offsets[offset], this->sequences.begin() + this->offsets[offset + 1]);
+    size_t offset = this->stored_offset(handle);
+    std::string result(this->sequences.begin() + this->offsets[offset], this->sequences.begin() + this->offsets[offset + 1]);
+    if (this->single_strand && this->get_is_reverse(handle)) {
+        reverse_complement_in_place(result);
+    }
+    return result;
 }
 
 size_t GBWTGraph::node_size() const {
@@ -134,11 +398,11 @@ size_t GBWTGraph::node_size() const {
 }
 
 id_t GBWTGraph::min_node_id() const {
-    return gbwt::Node::id(this->index.firstNode());
+    return gbwt::Node::id(this->first_node);
 }
 
 id_t GBWTGraph::max_node_id() const {
-    id_t next_id = gbwt::Node::id(this->index.sigma());
+    id_t next_id = gbwt::Node::id(this->sigma);
     return next_id - 1;
 }
 
@@ -151,7 +415,7 @@ bool GBWTGraph::follow_edges_impl(const handle_t& handle, bool go_left, const st
         curr = gbwt::Node::reverse(curr);
     }
 
-    gbwt::CompressedRecord record = this->index.record(curr);
+    gbwt::CompressedRecord record = this->index->record(curr);
     for (gbwt::rank_type outrank = 0; outrank < record.outdegree(); outrank++) {
         gbwt::node_type next = record.successor(outrank);
         if (next == gbwt::ENDMARKER) {
@@ -173,7 +437,7 @@ bool GBWTGraph::follow_edges_impl(const handle_t& handle, bool go_left, const st
 bool GBWTGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const {
     if (parallel) {
         #pragma omp parallel for schedule(dynamic, CHUNK_SIZE)
-        for (gbwt::node_type node = this->index.firstNode(); node < this->index.sigma(); node += 2) {
+        for (gbwt::node_type node = this->first_node; node < this->sigma; node += 2) {
             if (!(this->real_nodes[this->node_offset(node) / 2])) {
                 continue;
             }
@@ -182,7 +446,7 @@ bool GBWTGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>&
             }
         }
     } else {
-        for (gbwt::node_type node = this->index.firstNode(); node < this->index.sigma(); node += 2) {
+        for (gbwt::node_type node = this->first_node; node < this->sigma; node += 2) {
             if (!(this->real_nodes[this->node_offset(node) / 2])) {
                 continue;
             }
@@ -198,29 +462,45 @@ bool GBWTGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>&
 //------------------------------------------------------------------------------
 
 std::pair<const char*, size_t> GBWTGraph::get_sequence_view(const handle_t& handle) const {
+    assert(!(this->single_strand && this->get_is_reverse(handle)));
     size_t offset = this->node_offset(handle);
     return std::make_pair(this->sequences.data() + this->offsets[offset], this->offsets[offset + 1] - this->offsets[offset]);
 }
 
+GBWTGraph::strand_view GBWTGraph::get_strand_view(const handle_t& handle) const {
+    size_t offset = this->stored_offset(handle);
+    return {
+        this->sequences.data() + this->offsets[offset],
+        this->offsets[offset + 1] - this->offsets[offset],
+        (this->single_strand && this->get_is_reverse(handle))
+    };
+}
+
 bool GBWTGraph::starts_with(const handle_t& handle, char c) const {
-    size_t offset = this->node_offset(handle);
+    size_t offset = this->stored_offset(handle);
     if (this->offsets[offset + 1] <= this->offsets[offset]) {
         return false;
     }
+    if (this->single_strand && this->get_is_reverse(handle)) {
+        return (reverse_complement(this->sequences[this->offsets[offset + 1] - 1]) == c);
+    }
     return (this->sequences[this->offsets[offset]] == c);
 }
 
 bool GBWTGraph::ends_with(const handle_t& handle, char c) const {
-    size_t offset = this->node_offset(handle);
+    size_t offset = this->stored_offset(handle);
     if (this->offsets[offset + 1] <= this->offsets[offset]) {
         return false;
     }
+    if (this->single_strand && this->get_is_reverse(handle)) {
+        return (reverse_complement(this->sequences[this->offsets[offset]]) == c);
+    }
     return (this->sequences[this->offsets[offset + 1] - 1] == c);
 }
 
 // Using undocumented parts of the GBWT interface. --Jouni
 bool GBWTGraph::follow_paths(gbwt::SearchState state, const std::function<bool(const gbwt::SearchState&)>& iteratee) const {
-    gbwt::CompressedRecord record = this->index.record(state.node);
+    gbwt::CompressedRecord record = this->index->record(state.node);
     for (gbwt::rank_type outrank = 0; outrank < record.outdegree(); outrank++) {
         gbwt::node_type next_node = record.successor(outrank);
         if (next_node == gbwt::ENDMARKER) {
@@ -241,7 +521,7 @@ bool GBWTGraph::follow_paths(gbwt::BidirectionalState state, bool backward, cons
         state.flip();
     }
 
-    gbwt::CompressedRecord record = this->index.record(state.forward.node);
+    gbwt::CompressedRecord record = this->index->record(state.forward.node);
     for (gbwt::rank_type outrank = 0; outrank < record.outdegree(); outrank++) {
         gbwt::node_type next_node = record.successor(outrank);
         if (next_node == gbwt::ENDMARKER) {
@@ -287,8 +567,15 @@ struct GBWTTraversal {
         std::string result;
         result.reserve(this->length);
         for (handle_t handle : this->traversal) {
-            auto view = graph.get_sequence_view(handle);
-            result.append(view.first, std::min(view.second, this->length - result.length()));
+            GBWTGraph::strand_view view = graph.get_strand_view(handle);
+            size_t length = std::min(view.size(), this->length - result.length());
+            if (view.reverse) {
+                for (size_t i = 0; i < length; i++) {
+                    result.push_back(view[i]);
+                }
+            } else {
+                result.append(view.data, length);
+            }
         }
         return result;
     }
@@ -326,7 +613,7 @@ void for_each_haplotype_window(const GBWTGraph& graph, size_t window_size,
             // Try to extend the window to all successor nodes.
             // We are using undocumented parts of the GBWT interface. --Jouni
             bool extend_success = false;
-            gbwt::CompressedRecord record = graph.index.record(window.state.node);
+            gbwt::CompressedRecord record = graph.index->record(window.state.node);
             for (gbwt::rank_type outrank = 0; outrank < record.outdegree(); outrank++) {
                 gbwt::node_type next_node = record.successor(outrank);
                 if (next_node == gbwt::ENDMARKER) {
@@ -5,6 +5,7 @@
  * Utility classes and functions for working with GBWT.
  */
 
+#include <iostream>
 #include <vector>
 
 #include "handle.hpp"
@@ -59,16 +60,29 @@ std::string thread_name(const gbwt::GBWT& gbwt_index, size_t i);
 //------------------------------------------------------------------------------
 
 /**
- * A runtime-only HandleGraph implementation that uses GBWT for graph topology and
- * extracts sequences from another HandleGraph. Faster sequence access but slower
- * graph navigation than in XG. Also supports a version of follow_edges() that
- * takes only paths supported by the indexed haplotypes.
+ * A HandleGraph implementation that uses GBWT for graph topology and extracts
+ * sequences from another HandleGraph. Faster sequence access but slower graph
+ * navigation than in XG. Also supports a version of follow_edges() that takes
+ * only paths supported by the indexed haplotypes.
+ *
+ * The sequences can be serialized with 2-bit packing and loaded without the
+ * original HandleGraph. A loaded graph must be connected to its GBWT index with
+ * set_gbwt() before use.
+ *
+ * By default, the sequences are stored in both orientations, so that
+ * get_sequence_view() can return a pointer for either. In single-strand mode,
+ * only the forward sequences are stored, halving the memory usage, and
+ * get_strand_view() reads the reverse orientation from the forward sequence
+ * with the bases complemented on the fly.
  */
 class GBWTGraph : public HandleGraph {
 public:
     /// Create a graph backed by the GBWT index and extract the sequences from the
-    /// given HandleGraph.
-    GBWTGraph(const gbwt::GBWT& gbwt_index, const HandleGraph& sequence_source);
+    /// given HandleGraph. Stores only the forward sequences if single_strand is set.
+    GBWTGraph(const gbwt::GBWT& gbwt_index, const HandleGraph& sequence_source, bool single_strand = false);
+
+    /// Create an empty graph. Call load() and set_gbwt() before use.
+    GBWTGraph();
 
     /// Copy constructor.
     GBWTGraph(const GBWTGraph& source);
@@ -76,16 +90,66 @@ public:
     /// Move constructor.
     GBWTGraph(GBWTGraph&& source);
 
-    const gbwt::GBWT&   index;
+    /// Serialization header.
+    struct Header {
+        std::uint32_t tag, version;
+        std::uint64_t first_node, sigma, nodes;
+
+        constexpr static std::uint32_t TAG = 0x6B3764AF;
+        constexpr static std::uint32_t VERSION = 1;
+
+        Header();
+        bool check() const;
+    };
+
+    const gbwt::GBWT*   index;
     std::vector<char>   sequences;
     sdsl::int_vector<0> offsets;
     std::vector<bool>   real_nodes;
     size_t              total_nodes;
 
+    // Are the reverse complements left out of sequences? The offsets then give
+    // an empty range for the reverse orientation of each node.
+    bool                single_strand;
+
+    // Node ids of the GBWT the sequences were extracted for, for checking set_gbwt().
+    gbwt::node_type     first_node;
+    gbwt::node_type     sigma;
+
     constexpr static size_t CHUNK_SIZE = 1024; // For parallel for_each_handle().
 
 //------------------------------------------------------------------------------
 
+public:
+    // Serialization.
+
+    /// Serialize the sequences to the ostream. The GBWT index is not included.
+    /// Forward sequences are stored with 2-bit packing, with the bases other than
+    /// ACGT stored separately, and the reverse complements are rebuilt when loading.
+    /// Returns the number of bytes written and true if the serialization was successful.
+    std::pair<size_t, bool> serialize(std::ostream& out) const;
+
+    /// Load the sequences from the istream and return true if successful.
+    /// The graph keeps its current storage mode. The serialization format
+    /// does not depend on it.
+    bool load(std::istream& in);
+
+    /// Use the given GBWT index for graph topology. The index must be the one
+    /// the graph was built for. Returns false and leaves the graph unchanged if
+    /// the node ranges or the sets of nodes do not match, or if the index is not
+    /// bidirectional.
+    bool set_gbwt(const gbwt::GBWT& gbwt_index);
+
+    /// Switch between storing the sequences in both orientations and storing
+    /// only the forward sequences. Rebuilds the sequence storage if the mode
+    /// changes.
+    void set_single_strand(bool single_strand);
+
+    /// Memory used by the sequences and their offsets in bytes.
+    size_t sequence_bytes() const;
+
+//------------------------------------------------------------------------------
+
 public:
     // Standard HandleGraph interface.
 
@@ -149,9 +213,26 @@ public:
     /// Convert handle_t to gbwt::node_type.
     static gbwt::node_type handle_to_node(const handle_t& handle) { return handlegraph::as_integer(handle); }
 
-    /// Get node sequence as a pointer and length.
+    /// A view of a node sequence in the orientation of a handle. A reverse
+    /// view reads the forward sequence backward and complements the bases.
+    struct strand_view {
+        const char* data; // The stored sequence.
+        size_t      length;
+        bool        reverse;
+
+        size_t size() const { return this->length; }
+        char operator[](size_t i) const {
+            return (this->reverse ? reverse_complement(this->data[this->length - 1 - i]) : this->data[i]);
+        }
+    };
+
+    /// Get node sequence as a pointer and length. In single-strand mode, the
+    /// handle must be in the forward orientation.
     std::pair<const char*, size_t> get_sequence_view(const handle_t& handle) const;
 
+    /// Get a view of the node sequence that works in both storage modes.
+    strand_view get_strand_view(const handle_t& handle) const;
+
     /// Determine if the node sequence starts with the given character.
     bool starts_with(const handle_t& handle, char c) const;
 
@@ -159,10 +240,10 @@ public:
     bool ends_with(const handle_t& handle, char c) const;
 
     /// Convert handle_t to gbwt::SearchState.
-    gbwt::SearchState get_state(const handle_t& handle) const { return this->index.find(handle_to_node(handle)); }
+    gbwt::SearchState get_state(const handle_t& handle) const { return this->index->find(handle_to_node(handle)); }
 
     /// Convert handle_t to gbwt::BidirectionalState.
-    gbwt::BidirectionalState get_bd_state(const handle_t& handle) const { return this->index.bdFind(handle_to_node(handle)); }
+    gbwt::BidirectionalState get_bd_state(const handle_t& handle) const { return this->index->bdFind(handle_to_node(handle)); }
 
     /// Visit all successor states of this state and call iteratee for the state.
     /// Stop and return false if the iteratee returns false.
@@ -178,8 +259,15 @@ public:
                       const std::function<bool(const gbwt::BidirectionalState&)>& iteratee) const;
 
 private:
-    size_t node_offset(gbwt::node_type node) const { return node - this->index.firstNode(); }
+    size_t node_offset(gbwt::node_type node) const { return node - this->first_node; }
     size_t node_offset(const handle_t& handle) const { return this->node_offset(handle_to_node(handle)); }
+
+    // Offset of the stored sequence for the handle. In single-strand mode, this is
+    // the offset of the forward orientation.
+    size_t stored_offset(const handle_t& handle) const {
+        size_t offset = this->node_offset(handle);
+        return (this->single_strand ? offset & ~static_cast<size_t>(1) : offset);
+    }
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,199 @@
+#include "gcsa_range_table.hpp"
+
+#include <algorithm>
+
+namespace vg {
+
+//------------------------------------------------------------------------------
+
+// Numerical class constants.
+
+constexpr size_t GCSARangeTable::KMER_LENGTH;
+constexpr size_t GCSARangeTable::KMER_MAX_LENGTH;
+
+constexpr std::uint32_t GCSARangeTable::Header::TAG;
+constexpr std::uint32_t GCSARangeTable::Header::VERSION;
+constexpr std::uint32_t GCSARangeTable::Header::MIN_VERSION;
+
+constexpr size_t GCSARangeTable::PACK_WIDTH;
+constexpr GCSARangeTable::key_type GCSARangeTable::PACK_MASK;
+
+//------------------------------------------------------------------------------
+
+// Other class variables.
+
+const std::string GCSARangeTable::EXTENSION = ".rtab";
+
+// Only upper case characters are encoded, as the GCSA may not treat lower case
+// characters in the same way.
+const std::uint8_t GCSARangeTable::CHAR_TO_PACK[256] = {
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+
+    4, 0, 4, 1,  4, 4, 4, 2,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  3, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
+    4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4
+};
+
+const char GCSARangeTable::PACK_TO_CHAR[4] = { 'A', 'C', 'G', 'T' };
+
+//------------------------------------------------------------------------------
+
+GCSARangeTable::Header::Header() :
+    tag(TAG), version(VERSION),
+    k(0),
+    gcsa_size(0), gcsa_order(0)
+{
+}
+
+GCSARangeTable::Header::Header(size_t kmer_length, const gcsa::GCSA& index) :
+    tag(TAG), version(VERSION),
+    k(kmer_length),
+    gcsa_size(index.size()), gcsa_order(index.order())
+{
+    if (this->k > KMER_MAX_LENGTH) {
+        std::cerr << "warning: [GCSARangeTable] Adjusting k from " << this->k << " to " << KMER_MAX_LENGTH << std::endl;
+        this->k = KMER_MAX_LENGTH;
+    }
+    if (this->k == 0) {
+        std::cerr << "warning: [GCSARangeTable] Adjusting k from " << this->k << " to " << 1 << std::endl;
+        this->k = 1;
+    }
+}
+
+bool GCSARangeTable::Header::check() const {
+    return (this->tag == TAG && this->version >= MIN_VERSION && this->version <= VERSION &&
+            this->k <= KMER_MAX_LENGTH);
+}
+
+bool GCSARangeTable::Header::operator==(const Header& another) const {
+    return (this->tag == another.tag && this->version == another.version &&
+            this->k == another.k &&
+            this->gcsa_size == another.gcsa_size && this->gcsa_order == another.gcsa_order);
+}
+
+//------------------------------------------------------------------------------
+
+GCSARangeTable::GCSARangeTable() {
+}
+
+namespace {
+
+/// Fills the table for all kmers with the given suffix of length depth, starting from the
+/// range of the suffix. The next character to prepend goes to the given position.
+void fill_range_table(const gcsa::GCSA& index, const char* pack_to_char,
+                      sdsl::int_vector<0>& starts, sdsl::int_vector<0>& ends,
+                      gcsa::range_type range, std::uint64_t key, size_t position) {
+    if (gcsa::Range::empty(range)) {
+        // The table was initialized with empty ranges.
+        return;
+    }
+    for (std::uint64_t code = 0; code < 4; code++) {
+        gcsa::range_type next = index.LF(range, index.alpha.char2comp[pack_to_char[code]]);
+        std::uint64_t next_key = key | (code << (2 * position));
+        if (position == 0) {
+            if (!gcsa::Range::empty(next)) {
+                starts[next_key] = next.first;
+                ends[next_key] = next.second;
+            }
+        } else {
+            fill_range_table(index, pack_to_char, starts, ends, next, next_key, position - 1);
+        }
+    }
+}
+
+}
+
+GCSARangeTable::GCSARangeTable(const gcsa::GCSA& index, size_t kmer_length) :
+    header(kmer_length, index)
+{
+    size_t kmers = size_t(1) << (PACK_WIDTH * this->k());
+    gcsa::range_type empty = gcsa::Range::empty_range();
+    size_t width = sdsl::bits::hi(std::max(std::max(index.size(), size_t(empty.first)), size_t(2))) + 1;
+    this->starts = sdsl::int_vector<0>(kmers, empty.first, width);
+    this->ends = sdsl::int_vector<0>(kmers, empty.second, width);
+
+    gcsa::range_type full_range(0, index.size() - 1);
+
+    // We build the table by backward searching from the full range. With long enough
+    // kmers, each suffix of length SPLIT_LENGTH fills a contiguous block of the table
+    // that ends at a word boundary, so the blocks can be built in parallel.
+    constexpr size_t SPLIT_LENGTH = 4;
+    if (this->k() < 2 * SPLIT_LENGTH) {
+        fill_range_table(index, PACK_TO_CHAR, this->starts, this->ends, full_range, 0, this->k() - 1);
+        return;
+    }
+
+    size_t blocks = size_t(1) << (PACK_WIDTH * SPLIT_LENGTH);
+    size_t low_bits = PACK_WIDTH * (this->k() - SPLIT_LENGTH);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t block = 0; block < blocks; block++) {
+        // The last character of the kmer is in the high-order bits of the block.
+        gcsa::range_type range = full_range;
+        for (size_t i = 0; i < SPLIT_LENGTH && !gcsa::Range::empty(range); i++) {
+            key_type code = (block >> (PACK_WIDTH * (SPLIT_LENGTH - 1 - i))) & PACK_MASK;
+            range = index.LF(range, index.alpha.char2comp[PACK_TO_CHAR[code]]);
+        }
+        fill_range_table(index, PACK_TO_CHAR, this->starts, this->ends, range,
+                         key_type(block) << low_bits, this->k() - SPLIT_LENGTH - 1);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+std::pair<size_t, bool> GCSARangeTable::serialize(std::ostream& out) const {
+    size_t bytes = 0;
+
+    out.write(reinterpret_cast<const char*>(&(this->header)), sizeof(Header));
+    bytes += sizeof(Header);
+    bytes += this->starts.serialize(out);
+    bytes += this->ends.serialize(out);
+
+    bool ok = out.good();
+    if (!ok) {
+        std::cerr << "error: [GCSARangeTable] serialization failed" << std::endl;
+    }
+
+    return std::make_pair(bytes, ok);
+}
+
+bool GCSARangeTable::load(std::istream& in) {
+    // Load and check the header.
+    in.read(reinterpret_cast<char*>(&(this->header)), sizeof(Header));
+    if (!in.good() || !(this->header.check())) {
+        std::cerr << "error: [GCSARangeTable] invalid or old range table file" << std::endl;
+        std::cerr << "error: [GCSARangeTable] table version is " << this->header.version << "; required >= " << Header::MIN_VERSION << std::endl;
+        return false;
+    }
+
+    this->starts.load(in);
+    this->ends.load(in);
+
+    bool ok = in.good() && this->starts.size() == (size_t(1) << (PACK_WIDTH * this->k())) && this->ends.size() == this->starts.size();
+    if (!ok) {
+        std::cerr << "error: [GCSARangeTable] range table loading failed" << std::endl;
+    }
+
+    return ok;
+}
+
+bool GCSARangeTable::compatible(const gcsa::GCSA& index) const {
+    return (!this->empty() && this->header.gcsa_size == index.size() && this->header.gcsa_order == index.order());
+}
+
+//------------------------------------------------------------------------------
+
+}
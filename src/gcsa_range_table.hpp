@@ -0,0 +1,129 @@
+#ifndef VG_GCSA_RANGE_TABLE_HPP_INCLUDED
+#define VG_GCSA_RANGE_TABLE_HPP_INCLUDED
+
+/** \file
+ * A precomputed table of GCSA ranges for all short kmers, used for jump-starting backward
+ * searches.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include <gcsa/gcsa.h>
+
+namespace vg {
+
+//------------------------------------------------------------------------------
+
+/**
+ * A table mapping every kmer over ACGT to its range in a GCSA index. The ranges are the
+ * same as the ones backward searching with LF() would produce, so a search can start from
+ * the range of the last k characters of the pattern instead of doing k LF() steps.
+ *
+ * We encode kmers using 2 bits/character with the first character in the low-order bits.
+ * Empty ranges are stored as gcsa::Range::empty_range().
+ *
+ * The table is only valid for the GCSA it was built from. We store the size and the order
+ * of the GCSA in the header, and compatible() can be used for checking that the table can
+ * be used with a given index.
+ *
+ * Table versions:
+ *
+ *   1  The initial version.
+ */
+class GCSARangeTable {
+public:
+    typedef std::uint64_t key_type;
+
+    // Public constants.
+    constexpr static size_t KMER_LENGTH     = 10;
+    constexpr static size_t KMER_MAX_LENGTH = 14;
+
+    /// File extension for range tables stored alongside GCSA files.
+    const static std::string EXTENSION; // ".rtab"
+
+    struct Header {
+        std::uint32_t tag, version;
+        std::uint64_t k;
+        std::uint64_t gcsa_size, gcsa_order;
+
+        constexpr static std::uint32_t TAG = 0x52544142; // "RTAB"
+        constexpr static std::uint32_t VERSION = 1;
+        constexpr static std::uint32_t MIN_VERSION = 1;
+
+        Header();
+        Header(size_t kmer_length, const gcsa::GCSA& index);
+
+        /// Returns false if the header is invalid.
+        bool check() const;
+
+        bool operator==(const Header& another) const;
+        bool operator!=(const Header& another) const { return !(this->operator==(another)); }
+    };
+
+    /// Creates an empty table.
+    GCSARangeTable();
+
+    /// Builds the table for kmers of the given length. Uses multiple threads if the kmers
+    /// are long enough.
+    GCSARangeTable(const gcsa::GCSA& index, size_t kmer_length = KMER_LENGTH);
+
+    /// Serializes the table to the ostream. Returns the number of bytes written and
+    /// true if the serialization was successful.
+    std::pair<size_t, bool> serialize(std::ostream& out) const;
+
+    /// Loads the table from the istream and returns true if successful.
+    bool load(std::istream& in);
+
+    /// Kmer length.
+    size_t k() const { return this->header.k; }
+
+    /// Number of kmers in the table.
+    size_t size() const { return this->starts.size(); }
+
+    /// Is the table empty?
+    bool empty() const { return (this->size() == 0); }
+
+    /// Can the table be used with the given GCSA?
+    bool compatible(const gcsa::GCSA& index) const;
+
+    /// Finds the GCSA range of the kmer starting at the iterator. Returns false if the kmer
+    /// contains characters other than ACGT.
+    template<class Iterator>
+    bool find(Iterator begin, gcsa::range_type& range) const {
+        key_type key = 0;
+        for (size_t i = 0; i < this->k(); i++, ++begin) {
+            key_type code = CHAR_TO_PACK[static_cast<std::uint8_t>(*begin)];
+            if (code > PACK_MASK) {
+                return false;
+            }
+            key |= code << (i * PACK_WIDTH);
+        }
+        range = gcsa::range_type(this->starts[key], this->ends[key]);
+        return true;
+    }
+
+    /// Returns the GCSA range for the given key.
+    gcsa::range_type operator[](key_type key) const {
+        return gcsa::range_type(this->starts[key], this->ends[key]);
+    }
+
+private:
+    constexpr static size_t   PACK_WIDTH = 2;
+    constexpr static key_type PACK_MASK  = 0x3;
+
+    // Arrays for converting between characters and their 2-bit encodings.
+    const static std::uint8_t CHAR_TO_PACK[256];
+    const static char         PACK_TO_CHAR[4];
+
+    Header              header;
+    sdsl::int_vector<0> starts, ends;
+};
+
+//------------------------------------------------------------------------------
+
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "gfa.hpp"
+#include "convert_handle.hpp"
 #include <gfakluge.hpp>
 
 // Use sonLib pinch graphs
@@ -6,6 +7,9 @@
 
 #include <structures/union_find.hpp>
 
+#include <cerrno>
+#include <cstdlib>
+
 namespace vg {
 
 using namespace std;
@@ -1074,6 +1078,418 @@ bool gfa_to_graph(istream& in, VG* graph, bool only_perfect_match) {
     
 }
 
+/// Get the ID that a segment name spells out, if it is a positive number that
+/// fits in an ID. Names too long to fit are treated as non-numeric.
+static bool parse_segment_id(const string& name, id_t& id) {
+    if (!is_number(name)) {
+        return false;
+    }
+    errno = 0;
+    long long parsed = strtoll(name.c_str(), nullptr, 10);
+    if (errno == ERANGE || parsed <= 0) {
+        return false;
+    }
+    id = parsed;
+    return true;
+}
+
+/// Represents a translation from GFA segment name to node ID for the streaming importer.
+/// Numeric names are used as IDs directly whenever possible, and are looked up in the graph
+/// itself, so only segments that have to be renamed take up any memory. Numeric names with
+/// leading zeros are always remembered, so that "05" and "5" stay different segments.
+class GFAStreamingTranslator {
+private:
+    /// The graph that the segments are being created in
+    const HandleGraph* graph;
+    /// Map from string name to ID for segments that could not use their own names,
+    /// or that are not spelled the way their ID would be
+    unordered_map<string, id_t> renamed;
+    /// The IDs that are used by renamed segments
+    unordered_set<id_t> renamed_ids;
+    /// What is the next ID that might be unused?
+    id_t next_unused = 1;
+public:
+    GFAStreamingTranslator(const HandleGraph* graph) : graph(graph) {}
+    /// Assign an ID to a segment name that is being defined. Returns 0 if the name is already defined.
+    id_t define(const string& name);
+    /// Get the ID of a segment name that has been defined, or 0 if it has not been defined yet.
+    id_t lookup(const string& name) const;
+};
+
+id_t GFAStreamingTranslator::define(const string& name) {
+    if (renamed.count(name)) {
+        // We already gave this name an ID
+        return 0;
+    }
+    
+    id_t assigned = 0;
+    id_t preferred;
+    if (parse_segment_id(name, preferred)) {
+        // There's a preferred number for this string.
+        // Only a name spelled exactly like its number can be found again without remembering it.
+        bool canonical = (name[0] != '0');
+        if (!graph->has_node(preferred)) {
+            // Use it, and budge out the assignment cursor past any numbers we have used.
+            next_unused = max(next_unused, preferred + 1);
+            if (canonical) {
+                return preferred;
+            }
+            assigned = preferred;
+        }
+        else if (canonical && !renamed_ids.count(preferred)) {
+            // The ID is taken by this same name
+            return 0;
+        }
+    }
+    
+    if (assigned == 0) {
+        // We need to find an unused number.
+        while (graph->has_node(next_unused)) {
+            next_unused++;
+        }
+        assigned = next_unused;
+        next_unused++;
+    }
+    
+    renamed[name] = assigned;
+    renamed_ids.insert(assigned);
+    return assigned;
+}
+
+id_t GFAStreamingTranslator::lookup(const string& name) const {
+    auto found = renamed.find(name);
+    if (found != renamed.end()) {
+        return found->second;
+    }
+    id_t id;
+    if (parse_segment_id(name, id) && name[0] != '0' && graph->has_node(id) && !renamed_ids.count(id)) {
+        return id;
+    }
+    return 0;
+}
+
+/// The outcome of trying to stream a GFA file into a graph
+enum class GFAStreamingResult {Success, Invalid, NeedsPinch};
+
+/// Returns true if a GFA overlap CIGAR describes a blunt adjacency
+static bool is_blunt_overlap(const string& cigar) {
+    if (cigar.empty() || cigar == "*") {
+        return true;
+    }
+    // Any nonzero operation length means there is an overlap
+    for (auto& elem : vcflib::splitCigar(cigar)) {
+        if (elem.first != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Split a GFA line into its tab-separated fields. Unlike split_delims(), this
+/// does not copy the line onto the stack, which matters for chromosome-length
+/// segments.
+static void split_gfa_line(const string& line, vector<string>& fields) {
+    fields.clear();
+    size_t begin = 0;
+    while (true) {
+        size_t end = line.find('\t', begin);
+        if (end == string::npos) {
+            fields.emplace_back(line, begin, string::npos);
+            return;
+        }
+        fields.emplace_back(line, begin, end - begin);
+        begin = end + 1;
+    }
+}
+
+/// Parse a GFA orientation field
+static bool parse_gfa_orientation(const string& orientation, bool& is_reverse) {
+    if (orientation == "+") {
+        is_reverse = false;
+        return true;
+    }
+    else if (orientation == "-") {
+        is_reverse = true;
+        return true;
+    }
+    return false;
+}
+
+/// Try to import a GFA file with only blunt links directly into the graph, one
+/// line at a time. Links and paths that refer to segments that have not been
+/// seen yet are held back until the end of the file. If replay is not null,
+/// every line read is also written to it. Paths that cross links that are not
+/// present are an error, unless only_perfect_match is set, in which case they
+/// are discarded with a warning, like gfa_to_graph() does.
+static GFAStreamingResult stream_blunt_gfa(istream& in, MutablePathDeletableHandleGraph* graph, ostream* replay,
+                                           bool only_perfect_match) {
+    
+    GFAStreamingTranslator translator(graph);
+    
+    // Links that we can't make yet, as source name, source reverse, sink name, sink reverse
+    vector<tuple<string, bool, string, bool>> pending_links;
+    
+    // GFA 1 paths that visit segments we haven't seen yet, as the visited names and orientations
+    vector<pair<string, vector<pair<string, bool>>>> pending_paths;
+    
+    // GFA 0.1 paths come one visit per line, so we collect them by path name and rank
+    map<string, map<int64_t, pair<string, bool>>> ranked_paths;
+    
+    // Why a path could not be created
+    enum class PathProblem {None, MissingSegment, MissingLink};
+    
+    // Add a path to the graph. If one of its segments is missing, or two of
+    // its consecutive visits are not connected by an edge, reports the problem
+    // and describes it in the given string.
+    auto create_path = [&](const string& name, const vector<pair<string, bool>>& visits, string& description) {
+        vector<handle_t> steps;
+        steps.reserve(visits.size());
+        for (auto& visit : visits) {
+            id_t id = translator.lookup(visit.first);
+            if (id == 0) {
+                description = "visits segment " + visit.first + ", which is not present";
+                return PathProblem::MissingSegment;
+            }
+            steps.push_back(graph->get_handle(id, visit.second));
+            if (steps.size() > 1 && !graph->has_edge(steps[steps.size() - 2], steps.back())) {
+                description = "crosses a link from segment " + visits[steps.size() - 2].first
+                    + " to segment " + visit.first + " that is not present";
+                return PathProblem::MissingLink;
+            }
+        }
+        path_handle_t path = graph->create_path_handle(name);
+        for (auto& step : steps) {
+            graph->append_step(path, step);
+        }
+        return PathProblem::None;
+    };
+    
+    // Create a path once the whole file has been read, when anything missing is really missing
+    auto finish_path = [&](const string& name, const vector<pair<string, bool>>& visits) {
+        string description;
+        PathProblem path_problem = create_path(name, visits, description);
+        if (path_problem == PathProblem::None) {
+            return true;
+        }
+        if (path_problem == PathProblem::MissingLink && only_perfect_match) {
+            // The link may have been removed for having a bad alignment.
+            cerr << "warning [gfa_to_handle_graph]: path " << name << " " << description << ". Discarding path!" << endl;
+            return true;
+        }
+        cerr << "error [gfa_to_handle_graph]: path " << name << " " << description << ". The GFA file is malformed!" << endl;
+        return false;
+    };
+    
+    // Problems with paths we are holding back don't matter until the end of the file
+    string problem;
+    
+    string line;
+    vector<string> fields;
+    while (getline(in, line)) {
+        if (replay != nullptr) {
+            *replay << line << '\n';
+        }
+        
+        if (line.empty() || line[0] == '#' || line[0] == 'H') {
+            // Comments and headers don't affect the graph
+            continue;
+        }
+        
+        split_gfa_line(line, fields);
+        
+        if (fields[0] == "S") {
+            if (fields.size() < 3) {
+                cerr << "error [gfa_to_handle_graph]: segment line has too few fields: " << line << endl;
+                return GFAStreamingResult::Invalid;
+            }
+            if (fields[2] == "*") {
+                // The sequence has to come from somewhere else
+                return GFAStreamingResult::NeedsPinch;
+            }
+            id_t id = translator.define(fields[1]);
+            if (id == 0) {
+                cerr << "error [gfa_to_handle_graph]: segment " << fields[1] << " is defined more than once" << endl;
+                return GFAStreamingResult::Invalid;
+            }
+            graph->create_handle(fields[2], id);
+        }
+        else if (fields[0] == "L") {
+            if (fields.size() < 5) {
+                cerr << "error [gfa_to_handle_graph]: link line has too few fields: " << line << endl;
+                return GFAStreamingResult::Invalid;
+            }
+            if (fields.size() > 5 && !is_blunt_overlap(fields[5])) {
+                // The pinch graph importer has to handle the overlap
+                return GFAStreamingResult::NeedsPinch;
+            }
+            bool from_rev, to_rev;
+            if (!parse_gfa_orientation(fields[2], from_rev) || !parse_gfa_orientation(fields[4], to_rev)) {
+                cerr << "error [gfa_to_handle_graph]: link line has an invalid orientation: " << line << endl;
+                return GFAStreamingResult::Invalid;
+            }
+            id_t from = translator.lookup(fields[1]);
+            id_t to = translator.lookup(fields[3]);
+            if (from != 0 && to != 0) {
+                graph->create_edge(graph->get_handle(from, from_rev), graph->get_handle(to, to_rev));
+            }
+            else {
+                // Wait until we've seen the segments
+                pending_links.emplace_back(fields[1], from_rev, fields[3], to_rev);
+            }
+        }
+        else if (fields[0] == "P") {
+            bool is_reverse;
+            if (fields.size() >= 6 && is_number(fields[3]) && parse_gfa_orientation(fields[4], is_reverse)) {
+                // This is a GFA 0.1 path line, with one segment per line
+                ranked_paths[fields[2]][std::stol(fields[3])] = make_pair(fields[1], is_reverse);
+            }
+            else if (fields.size() >= 3) {
+                // This is a GFA 1 path line, with a comma-separated list of oriented segments
+                vector<pair<string, bool>> visits;
+                const string& visit_list = fields[2];
+                size_t begin = 0;
+                while (begin < visit_list.size()) {
+                    size_t end = visit_list.find(',', begin);
+                    if (end == string::npos) {
+                        end = visit_list.size();
+                    }
+                    if (end - begin < 2 || !parse_gfa_orientation(visit_list.substr(end - 1, 1), is_reverse)) {
+                        cerr << "error [gfa_to_handle_graph]: path " << fields[1] << " has an invalid segment visit "
+                            << visit_list.substr(begin, end - begin) << endl;
+                        return GFAStreamingResult::Invalid;
+                    }
+                    visits.emplace_back(visit_list.substr(begin, end - begin - 1), is_reverse);
+                    begin = end + 1;
+                }
+                if (create_path(fields[1], visits, problem) != PathProblem::None) {
+                    // A segment or link may still be coming
+                    pending_paths.emplace_back(fields[1], move(visits));
+                }
+            }
+            else {
+                cerr << "error [gfa_to_handle_graph]: path line has too few fields: " << line << endl;
+                return GFAStreamingResult::Invalid;
+            }
+        }
+        else {
+            // Containments and GFA 2 records need the full importer
+            return GFAStreamingResult::NeedsPinch;
+        }
+    }
+    
+    // Now all the segments exist, so we can finish the links and paths we had to wait on
+    
+    for (auto& link : pending_links) {
+        id_t from = translator.lookup(get<0>(link));
+        id_t to = translator.lookup(get<2>(link));
+        if (from == 0 || to == 0) {
+            cerr << "error [gfa_to_handle_graph]: link from " << get<0>(link) << " to " << get<2>(link)
+                << " refers to a segment that is not present" << endl;
+            return GFAStreamingResult::Invalid;
+        }
+        graph->create_edge(graph->get_handle(from, get<1>(link)), graph->get_handle(to, get<3>(link)));
+    }
+    
+    for (auto& path : pending_paths) {
+        if (!finish_path(path.first, path.second)) {
+            return GFAStreamingResult::Invalid;
+        }
+    }
+    
+    for (auto& path : ranked_paths) {
+        vector<pair<string, bool>> visits;
+        visits.reserve(path.second.size());
+        for (auto& rank_and_visit : path.second) {
+            visits.emplace_back(move(rank_and_visit.second));
+        }
+        if (!finish_path(path.first, visits)) {
+            return GFAStreamingResult::Invalid;
+        }
+    }
+    
+    return GFAStreamingResult::Success;
+}
+
+bool gfa_to_handle_graph(istream& in, MutablePathDeletableHandleGraph* graph, bool only_perfect_match) {
+    
+    // Remember where we started, in case we need to go back and use the pinch graph
+    streampos start = in.tellg();
+    bool seekable = (start != streampos(-1));
+    
+    // If we can't go back, we'll have to hold on to what we read. It goes to
+    // disk and not memory, since the GFA can be much bigger than the graph.
+    string replay_filename;
+    ofstream replay;
+    if (!seekable) {
+        replay_filename = temp_file::create("gfa-replay");
+        replay.open(replay_filename);
+        if (!replay) {
+            cerr << "error [gfa_to_handle_graph]: could not open temporary file " << replay_filename << endl;
+            exit(1);
+        }
+    }
+    
+    GFAStreamingResult result = stream_blunt_gfa(in, graph, seekable ? nullptr : &replay, only_perfect_match);
+    
+    if (result != GFAStreamingResult::NeedsPinch && !seekable) {
+        // We won't be replaying anything
+        replay.close();
+        temp_file::remove(replay_filename);
+    }
+    
+    if (result == GFAStreamingResult::Invalid) {
+        return false;
+    }
+    
+    VG* vg_graph = dynamic_cast<VG*>(graph);
+    
+    if (result == GFAStreamingResult::Success) {
+        if (vg_graph != nullptr) {
+            // Save the paths to the graph
+            vg_graph->paths.rebuild_mapping_aux();
+            vg_graph->paths.to_graph(vg_graph->graph);
+        }
+        return true;
+    }
+    
+    // Otherwise the GFA has overlaps, so start over with the pinch graph importer
+    graph->clear();
+    
+    istream* source = &in;
+    ifstream replayed;
+    if (seekable) {
+        in.clear();
+        in.seekg(start);
+    }
+    else {
+        // Follow what we already read with the rest of the stream
+        if (in.peek() != EOF) {
+            replay << in.rdbuf();
+        }
+        replay.close();
+        replayed.open(replay_filename);
+        source = &replayed;
+    }
+    
+    bool success;
+    if (vg_graph != nullptr) {
+        success = gfa_to_graph(*source, vg_graph, only_perfect_match);
+    }
+    else {
+        VG imported;
+        success = gfa_to_graph(*source, &imported, only_perfect_match);
+        if (success) {
+            convert_path_handle_graph(&imported, graph);
+        }
+    }
+    
+    if (!seekable) {
+        replayed.close();
+        temp_file::remove(replay_filename);
+    }
+    return success;
+}
+
 void graph_to_gfa(const VG* graph, ostream& out) {
   GFAKluge gg;
   gg.set_version(1.0);
@@ -33,6 +33,21 @@ using namespace std;
  */
 bool gfa_to_graph(istream& in, VG* graph, bool only_perfect_match = false);
 
+/**
+ * Import the given GFA file into the given (empty) graph in a single streaming
+ * pass, without holding the GFA in memory. This only works for GFAs in which
+ * all links are blunt (have no overlap); as soon as a link with an overlap or
+ * another record type that needs the pinch graph (such as a containment) is
+ * encountered, the graph is cleared and the whole file is imported with
+ * gfa_to_graph() instead, passing along only_perfect_match. If the input stream
+ * cannot seek, the lines read are copied to a temporary file so that they can
+ * be replayed.
+ *
+ * Returns true if the import was successful, and false if the GFA file is
+ * invalid, including when a path crosses a link that is not present.
+ */
+bool gfa_to_handle_graph(istream& in, MutablePathDeletableHandleGraph* graph, bool only_perfect_match = false);
+
 /// Export the given VG graph to the given GFA file.
 void graph_to_gfa(const VG* graph, ostream& out);
 
@@ -0,0 +1,122 @@
+#include "index_loader.hpp"
+
+#include <exception>
+#include <thread>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+/**
+ * \file index_loader.cpp: implementation of the IndexLoader class
+ */
+ 
+namespace vg {
+using namespace std;
+
+void IndexLoader::add(const string& name, const function<void()>& job) {
+    jobs.emplace_back(name, job);
+}
+
+void IndexLoader::run() {
+    auto start = chrono::steady_clock::now();
+    
+    // Each thread records its own time and any exception it hit
+    vector<double> job_durations(jobs.size(), 0);
+    vector<exception_ptr> failures(jobs.size());
+    
+    vector<thread> threads;
+    threads.reserve(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        threads.emplace_back([&, i]() {
+            auto job_start = chrono::steady_clock::now();
+            try {
+                jobs[i].second();
+            } catch (...) {
+                failures[i] = current_exception();
+            }
+            job_durations[i] = chrono::duration<double>(chrono::steady_clock::now() - job_start).count();
+        });
+    }
+    for (auto& job_thread : threads) {
+        job_thread.join();
+    }
+    
+    total_duration += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (size_t i = 0; i < jobs.size(); i++) {
+        durations.emplace_back(jobs[i].first, job_durations[i]);
+    }
+    jobs.clear();
+    
+    for (auto& failure : failures) {
+        if (failure) {
+            rethrow_exception(failure);
+        }
+    }
+}
+
+void IndexLoader::report(ostream& out) const {
+    for (auto& name_and_duration : durations) {
+        out << "Loaded " << name_and_duration.first << " in " << name_and_duration.second << " seconds" << endl;
+    }
+    out << "Loaded " << durations.size() << " indexes in " << total_duration << " seconds" << endl;
+}
+
+double IndexLoader::seconds() const {
+    return total_duration;
+}
+
+unordered_map<string, IndexLoader::ResidentIndex>& IndexLoader::resident_indexes() {
+    static unordered_map<string, ResidentIndex> indexes;
+    return indexes;
+}
+
+string IndexLoader::canonical_name(const string& file_name) {
+    char resolved[PATH_MAX];
+    if (realpath(file_name.c_str(), resolved) == nullptr) {
+        return "";
+    }
+    return resolved;
+}
+
+void IndexLoader::make_resident(const string& file_name, const type_index& type, unique_ptr<void, void(*)(void*)>&& index) {
+    string name = canonical_name(file_name);
+    struct stat file_stat;
+    if (name.empty() || stat(name.c_str(), &file_stat) != 0) {
+        cerr << "error:[IndexLoader] cannot make index resident because " << file_name << " does not exist" << endl;
+        exit(1);
+    }
+    
+    // Replace anything we had for the file
+    auto& indexes = resident_indexes();
+    indexes.erase(name);
+    indexes.emplace(name, ResidentIndex{type, std::move(index), (int64_t) file_stat.st_size, (int64_t) file_stat.st_mtime});
+}
+
+void* IndexLoader::take_resident(const string& file_name, const type_index& type) {
+    auto& indexes = resident_indexes();
+    if (indexes.empty()) {
+        // Not a resident process
+        return nullptr;
+    }
+    
+    string name = canonical_name(file_name);
+    auto found = indexes.find(name);
+    if (found == indexes.end() || found->second.type != type) {
+        return nullptr;
+    }
+    
+    // Only use the index if the file is still the one we loaded
+    struct stat file_stat;
+    if (stat(name.c_str(), &file_stat) != 0 || file_stat.st_size != found->second.file_size
+        || file_stat.st_mtime != found->second.file_mtime) {
+        cerr << "warning:[IndexLoader] " << file_name << " has changed since it was made resident, loading it again" << endl;
+        return nullptr;
+    }
+    
+    void* index = found->second.index.release();
+    indexes.erase(found);
+    return index;
+}
+
+}
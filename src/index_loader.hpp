@@ -0,0 +1,121 @@
+#ifndef VG_INDEX_LOADER_HPP_INCLUDED
+#define VG_INDEX_LOADER_HPP_INCLUDED
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+/** 
+ * \file index_loader.hpp
+ * Contains the IndexLoader class, for loading several indexes at once.
+ */
+ 
+namespace vg {
+
+using namespace std;
+
+/**
+ * Loads a set of indexes concurrently, one thread per index, and times them.
+ *
+ * Index loading is mostly reading and deserializing files, so a mapper that
+ * needs several big indexes can start up in about the time the slowest one
+ * takes to load, instead of the sum of all of them.
+ *
+ * Jobs must not depend on each other. Anything that connects indexes together
+ * (like DistanceIndex::setGraph()) should be done after run() returns.
+ *
+ * A long-running process (vg serve) can also make indexes resident. Mapping
+ * jobs it forks off then take the copies already in memory instead of loading
+ * the files again.
+ */
+class IndexLoader {
+public:
+    /// Add a job that loads the index with the given name. The job will be run
+    /// on its own thread by run().
+    void add(const string& name, const function<void()>& job);
+    
+    /// Add a job that sets dest to the unique_ptr returned by load, unless the
+    /// index in the given file is resident in this process and the file hasn't
+    /// changed since. In that case dest takes the resident copy right away.
+    template<class T, class Loader>
+    void add(const string& file_name, unique_ptr<T>& dest, const Loader& load);
+    
+    /// Keep the index loaded from the given file in memory, so that later
+    /// add() calls in this process, or in processes forked from it, can use it.
+    /// Each resident index can only be taken once per process.
+    template<class T>
+    static void make_resident(const string& file_name, unique_ptr<T>&& index);
+    
+    /// Run all the jobs added since the last run, and wait for them to
+    /// finish. If any job throws, rethrows the first exception after all the
+    /// jobs are done.
+    void run();
+    
+    /// Write how long each index took to load, and how long loading took
+    /// overall, to the given stream.
+    void report(ostream& out) const;
+    
+    /// Get the total wall-clock time spent in run(), in seconds.
+    double seconds() const;
+
+protected:
+    /// The jobs waiting to be run, with their names
+    vector<pair<string, function<void()>>> jobs;
+    
+    /// The names of the jobs that have been run, and how long each took
+    vector<pair<string, double>> durations;
+    
+    /// The total wall-clock time spent in run()
+    double total_duration = 0;
+    
+    /// An index kept in memory by make_resident(), with the size and
+    /// modification time the file had when we loaded it.
+    struct ResidentIndex {
+        type_index type;
+        unique_ptr<void, void(*)(void*)> index;
+        int64_t file_size;
+        int64_t file_mtime;
+    };
+    
+    /// Get the resident indexes by canonical file name. This lives in a
+    /// function so it is constructed before first use.
+    static unordered_map<string, ResidentIndex>& resident_indexes();
+    
+    /// Get the canonical name of the file, or an empty string if it doesn't exist.
+    static string canonical_name(const string& file_name);
+    
+    /// Store an index as resident, taking ownership of it.
+    static void make_resident(const string& file_name, const type_index& type, unique_ptr<void, void(*)(void*)>&& index);
+    
+    /// Take ownership of the resident index of the given type loaded from the
+    /// file, or return nullptr if there isn't an up to date one.
+    static void* take_resident(const string& file_name, const type_index& type);
+};
+
+template<class T, class Loader>
+void IndexLoader::add(const string& file_name, unique_ptr<T>& dest, const Loader& load) {
+    void* resident = take_resident(file_name, type_index(typeid(T)));
+    if (resident != nullptr) {
+        dest.reset(static_cast<T*>(resident));
+        durations.emplace_back(file_name + " (resident)", 0.0);
+    } else {
+        add(file_name, [&dest, load]() { dest = load(); });
+    }
+}
+
+template<class T>
+void IndexLoader::make_resident(const string& file_name, unique_ptr<T>&& index) {
+    unique_ptr<void, void(*)(void*)> erased(index.release(), [](void* item) {
+        delete static_cast<T*>(item);
+    });
+    make_resident(file_name, type_index(typeid(T)), std::move(erased));
+}
+
+}
+
+#endif
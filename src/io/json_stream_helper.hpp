@@ -1,9 +1,12 @@
 #ifndef VG_IO_JSON_STREAM_HELPER_HPP_INCLUDED
 #define VG_IO_JSON_STREAM_HELPER_HPP_INCLUDED
 
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include <iostream>
+#include <exception>
+#include <omp.h>
 
 #include <vg/io/stream.hpp>
 #include "json2pb.h"
@@ -12,6 +15,34 @@ namespace vg {
 
 namespace io {
 
+/**
+ * Converts a stream of objects on all OpenMP threads while keeping them in
+ * order. Objects are pushed in one at a time on a single thread and collected
+ * into chunks. Each chunk is converted in parallel, and then handed to the
+ * emit function in input order, on the pushing thread. Call flush() after the
+ * last object to emit the final partial chunk.
+ */
+template <class In, class Out>
+class OrderedParallelConverter
+{
+public:
+    /// Make a converter that collects per_thread_chunk objects for each thread
+    /// before converting.
+    OrderedParallelConverter(const std::function<void(In&, Out&)>& convert,
+                             const std::function<void(std::vector<Out>&)>& emit,
+                             size_t per_thread_chunk = 256);
+    /// Add an object to convert, possibly converting and emitting a chunk.
+    void push(In&& item);
+    /// Convert and emit everything collected so far.
+    void flush();
+private:
+    std::function<void(In&, Out&)> convert;
+    std::function<void(std::vector<Out>&)> emit;
+    size_t max_chunk;
+    std::vector<In> inputs;
+    std::vector<Out> outputs;
+};
+
 // It's handy to be able to stream in JSON via vg view for testing.
 // This helper class takes this functionality from vg view -J and
 // makes it more generic, so it can be used for other types than Graph.
@@ -27,7 +58,12 @@ public:
     std::function<bool(T&)> get_read_fn();
     // read json stream (using above fn), and directly write to out in either
     // protobuf or json format. If writing in protobuf, append an EOF marker. 
+    // Parsing is done on all OpenMP threads, and the output is the same as
+    // the serial conversion would produce.
     int64_t write(std::ostream& out, bool json_out = false, int64_t buf_size = 1000);
+    // read the whole json stream, parsing it on all OpenMP threads, and call
+    // lambda on each object in stream order on the calling thread.
+    int64_t for_each_ordered(const std::function<void(T&)>& lambda);
 private:
     FILE* _fp;
 };
@@ -35,6 +71,56 @@ private:
 
 // Implementation of above:
 
+template <class In, class Out>
+inline OrderedParallelConverter<In, Out>::OrderedParallelConverter(const std::function<void(In&, Out&)>& convert,
+                                                                   const std::function<void(std::vector<Out>&)>& emit,
+                                                                   size_t per_thread_chunk) :
+    convert(convert), emit(emit), max_chunk(std::max<size_t>(per_thread_chunk, 1) * omp_get_max_threads()) {
+    inputs.reserve(max_chunk);
+}
+
+template <class In, class Out>
+inline void OrderedParallelConverter<In, Out>::push(In&& item) {
+    inputs.emplace_back(std::move(item));
+    if (inputs.size() >= max_chunk) {
+        flush();
+    }
+}
+
+template <class In, class Out>
+inline void OrderedParallelConverter<In, Out>::flush() {
+    if (inputs.empty()) {
+        return;
+    }
+    outputs.resize(inputs.size());
+    
+    // Exceptions can't leave the parallel region, so hold on to the first one
+    // in stream order and rethrow it once all the threads are done.
+    std::exception_ptr error;
+    size_t error_index = inputs.size();
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t i = 0; i < inputs.size(); i++) {
+        try {
+            convert(inputs[i], outputs[i]);
+        } catch (...) {
+#pragma omp critical (ordered_parallel_converter_error)
+            {
+                if (i < error_index) {
+                    error_index = i;
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    
+    emit(outputs);
+    inputs.clear();
+    outputs.clear();
+}
+
 template <class T>
 inline JSONStreamHelper<T>::JSONStreamHelper(const std::string& file_name) {
     if (file_name == "-") {
@@ -89,39 +175,72 @@ inline std::function<bool(T&)> JSONStreamHelper<T>::get_read_fn() {
 
 template<class T>
 inline int64_t JSONStreamHelper<T>::write(std::ostream& out, bool json_out,
-                                          int64_t buf_size) {    
-    std::function<bool(T&)> reader = get_read_fn();        
-    std::vector<T> buf;
+                                          int64_t buf_size) {
     int64_t total = 0;
-    bool good = true;
-    std::function<T(size_t)> lambda = [&](size_t i) -> T {return buf[i];};
-    while (good) {
-        T obj;
-        good = reader(obj);
-        if (good) {
-            buf.push_back(obj);
-        }
-        if (!good || buf.size() >= buf_size) {
-            if (!json_out) {
-                vg::io::write(out, buf.size(), lambda);
-            } else {
-                for (int i = 0; i < buf.size(); ++i) {
-                    out << pb2json(buf[i]);
-                }
+    std::string text;
+    if (!json_out) {
+        // Emit protobuf groups of buf_size objects, just as if we had
+        // buffered them up one at a time.
+        OrderedParallelConverter<std::string, T> converter([](std::string& json, T& obj) {
+            json2pb(obj, json);
+        }, [&](std::vector<T>& objs) {
+            for (size_t i = 0; i < objs.size(); i += buf_size) {
+                size_t count = std::min<size_t>(buf_size, objs.size() - i);
+                std::function<T(size_t)> lambda = [&](size_t j) -> T {return objs[i + j];};
+                vg::io::write(out, count, lambda);
             }
-            total += buf.size();
-            buf.clear();
+            total += objs.size();
+        }, buf_size);
+        while (json_read_object(_fp, text)) {
+            converter.push(std::move(text));
+        }
+        converter.flush();
+        if (total % buf_size == 0) {
+            // The serial conversion always ends with a write of the leftover
+            // buffer, even if it is empty.
+            std::function<T(size_t)> lambda = [](size_t j) -> T {return T();};
+            vg::io::write(out, 0, lambda);
         }
-    }
-    
-    if (!json_out) {
         vg::io::finish(out);
+    } else {
+        OrderedParallelConverter<std::string, std::string> converter([](std::string& json, std::string& converted) {
+            T obj;
+            json2pb(obj, json);
+            converted = pb2json(obj);
+        }, [&](std::vector<std::string>& converted) {
+            for (auto& json : converted) {
+                out << json;
+            }
+            total += converted.size();
+        }, buf_size);
+        while (json_read_object(_fp, text)) {
+            converter.push(std::move(text));
+        }
+        converter.flush();
     }
     
     out.flush();
     return total;
 }
 
+template<class T>
+inline int64_t JSONStreamHelper<T>::for_each_ordered(const std::function<void(T&)>& lambda) {
+    int64_t total = 0;
+    OrderedParallelConverter<std::string, T> converter([](std::string& json, T& obj) {
+        json2pb(obj, json);
+    }, [&](std::vector<T>& objs) {
+        for (auto& obj : objs) {
+            lambda(obj);
+        }
+        total += objs.size();
+    });
+    std::string text;
+    while (json_read_object(_fp, text)) {
+        converter.push(std::move(text));
+    }
+    converter.flush();
+    return total;
+}
 }
 
 }
@@ -7,10 +7,13 @@
 
 #include "register_loader_saver_distance_index.hpp"
 #include "register_loader_saver_gbwt.hpp"
+#include "register_loader_saver_gbwtgraph.hpp"
 #include "register_loader_saver_gcsa.hpp"
 #include "register_loader_saver_lcp.hpp"
 #include "register_loader_saver_minimizer.hpp"
+#include "register_loader_saver_range_table.hpp"
 #include "register_loader_saver_snarl_manager.hpp"
+#include "register_loader_saver_snarl_tree_index.hpp"
 #include "register_loader_saver_vg.hpp"
 #include "register_loader_saver_xg.hpp"
 
@@ -26,10 +29,13 @@ using namespace std;
 bool register_libvg_io() {
     register_loader_saver_distance_index();
     register_loader_saver_gbwt();
+    register_loader_saver_gbwtgraph();
     register_loader_saver_gcsa();
     register_loader_saver_lcp();
     register_loader_saver_minimizer();
+    register_loader_saver_range_table();
     register_loader_saver_snarl_manager();
+    register_loader_saver_snarl_tree_index();
     register_loader_saver_vg();
     register_loader_saver_xg();
     return true;
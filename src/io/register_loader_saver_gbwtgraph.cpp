@@ -0,0 +1,38 @@
+/**
+ * \file register_loader_saver_gbwtgraph.cpp
+ * Defines IO for GBWTGraph from stream files.
+ */
+
+#include <vg/io/registry.hpp>
+#include "register_loader_saver_gbwtgraph.hpp"
+
+#include "../gbwt_helper.hpp"
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+using namespace vg::io;
+
+void register_loader_saver_gbwtgraph() {
+    // The GBWT index is stored separately, so the caller must call set_gbwt()
+    // on the loaded graph.
+    Registry::register_bare_loader_saver<GBWTGraph>("GBWTGraph", [](istream& input) -> void* {
+        GBWTGraph* graph = new GBWTGraph();
+        if (!graph->load(input)) {
+            cerr << "error[register_loader_saver_gbwtgraph]: could not load GBWTGraph" << endl;
+            exit(1);
+        }
+        
+        // Return the graph so the caller owns it.
+        return static_cast<void*>(graph);
+    }, [](const void* graph_void, ostream& output) {
+        assert(graph_void != nullptr);
+        static_cast<const GBWTGraph*>(graph_void)->serialize(output);
+    });
+}
+
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef VG_IO_REGISTER_LOADER_SAVER_GBWTGRAPH_HPP_INCLUDED
+#define VG_IO_REGISTER_LOADER_SAVER_GBWTGRAPH_HPP_INCLUDED
+
+/**
+ * \file register_loader_saver_gbwtgraph.hpp
+ * Defines IO for GBWTGraph from stream files.
+ */
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+
+void register_loader_saver_gbwtgraph();
+
+}
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * \file register_loader_saver_range_table.cpp
+ * Defines IO for a GCSA range table from stream files.
+ */
+
+#include <vg/io/registry.hpp>
+#include "register_loader_saver_range_table.hpp"
+
+#include "../gcsa_range_table.hpp"
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+using namespace vg::io;
+
+void register_loader_saver_range_table() {
+    Registry::register_bare_loader_saver<GCSARangeTable>("GCSARangeTable", [](istream& input) -> void* {
+        GCSARangeTable* table = new GCSARangeTable();
+        table->load(input);
+        
+        // Return the table so the caller owns it.
+        return static_cast<void*>(table);
+    }, [](const void* table_void, ostream& output) {
+        assert(table_void != nullptr);
+        static_cast<const GCSARangeTable*>(table_void)->serialize(output);
+    });
+}
+
+}
+
+}
+
@@ -0,0 +1,21 @@
+#ifndef VG_IO_REGISTER_LOADER_SAVER_RANGE_TABLE_HPP_INCLUDED
+#define VG_IO_REGISTER_LOADER_SAVER_RANGE_TABLE_HPP_INCLUDED
+
+/**
+ * \file register_loader_saver_range_table.hpp
+ * Defines IO for a GCSA range table from stream files.
+ */
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+
+void register_loader_saver_range_table();
+
+}
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * \file register_loader_saver_snarl_tree_index.cpp
+ * Defines IO for a SnarlTreeIndex from stream files.
+ */
+
+#include <vg/io/registry.hpp>
+#include "register_loader_saver_snarl_tree_index.hpp"
+
+#include "../snarl_tree_index.hpp"
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+using namespace vg::io;
+
+void register_loader_saver_snarl_tree_index() {
+    Registry::register_bare_loader_saver<SnarlTreeIndex>("SNARLTREE", [](istream& input) -> void* {
+        // Allocate an index and hand it the stream
+        SnarlTreeIndex* index = new SnarlTreeIndex(input);
+        
+        // Return it so the caller owns it.
+        return (void*) index;
+    }, [](const void* index_void, ostream& output) {
+        // Cast to SnarlTreeIndex and serialize to the stream.
+        assert(index_void != nullptr);
+        ((const SnarlTreeIndex*) index_void)->serialize(output);
+    });
+}
+
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef VG_IO_REGISTER_LOADER_SAVER_SNARL_TREE_INDEX_HPP_INCLUDED
+#define VG_IO_REGISTER_LOADER_SAVER_SNARL_TREE_INDEX_HPP_INCLUDED
+
+/**
+ * \file register_loader_saver_snarl_tree_index.hpp
+ * Defines IO for a SnarlTreeIndex from stream files.
+ */
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+
+void register_loader_saver_snarl_tree_index();
+
+}
+
+}
+
+#endif
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <cassert>
+#include <cctype>
 
 #include <google/protobuf/util/json_util.h>
 #include <jansson.h>
@@ -88,3 +89,52 @@ std::string pb2json(const Message &msg) {
     
     return buffer;
 }
+
+bool json_read_object(FILE* fp, std::string& buf) {
+    buf.clear();
+    
+    // Skip whitespace between records
+    int c;
+    do {
+        c = getc(fp);
+        if (c == EOF) {
+            return false;
+        }
+    } while (isspace(c));
+    
+    if (c != '{') {
+        throw std::runtime_error("Malformed JSON: not an object");
+    }
+    
+    // Copy characters until the brackets we opened are closed, ignoring any
+    // brackets inside strings.
+    size_t depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    while (true) {
+        buf.push_back((char) c);
+        if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+            if (depth == 0) {
+                return true;
+            }
+        }
+        
+        c = getc(fp);
+        if (c == EOF) {
+            throw std::runtime_error("Load failed: file ended inside a JSON object");
+        }
+    }
+}
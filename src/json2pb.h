@@ -28,6 +28,12 @@ void json2pb(google::protobuf::Message &msg, FILE* file);
 void json2pb(google::protobuf::Message &msg, const char *buf, size_t size);
 std::string pb2json(const google::protobuf::Message &msg);
 
+/// Read the next top-level JSON object from the file into buf, skipping any
+/// whitespace before it. Returns false if the file ends before another object
+/// starts. The object is only delimited, not parsed, so the text can be handed
+/// to json2pb() on another thread.
+bool json_read_object(FILE* file, std::string& buf);
+
 
 
 #endif//VG_JSON2PB_H_INCLUDED
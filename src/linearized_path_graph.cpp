@@ -0,0 +1,205 @@
+/**
+ * \file linearized_path_graph.cpp: contains the implementation of LinearizedPathGraph
+ * and its segment cache
+ */
+
+#include "linearized_path_graph.hpp"
+
+#include <handlegraph/util.hpp>
+
+namespace vg {
+
+using namespace std;
+
+    LinearizedPathSegment::LinearizedPathSegment(const xg::XG* xindex, size_t path_rank, const xg::XGPath& xpath,
+                                                 size_t first_step, size_t last_step) :
+        xindex(xindex), path_rank(path_rank), first_step(first_step), last_step(last_step) {
+
+        assert(first_step <= last_step && last_step <= xpath.positions.size());
+
+        steps.reserve(last_step - first_step);
+        step_starts.reserve(last_step - first_step + 1);
+
+        for (size_t i = first_step; i < last_step; i++) {
+            id_t node_id = xpath.node(i);
+            bool rev = xpath.is_reverse(i);
+            steps.emplace_back(node_id, rev);
+            step_starts.push_back(sequence.size());
+
+            // add this step's sequence in the path orientation
+            if (rev) {
+                sequence.append(reverse_complement(xindex->node_sequence(node_id)));
+            }
+            else {
+                sequence.append(xindex->node_sequence(node_id));
+            }
+        }
+        step_starts.push_back(sequence.size());
+
+        reverse_sequence = reverse_complement(sequence);
+    }
+
+    bool LinearizedPathSegment::contains(const xg::XG* other_xindex, size_t other_path_rank, size_t begin, size_t end) const {
+        return (other_xindex == xindex && other_path_rank == path_rank && begin >= first_step && end <= last_step);
+    }
+
+    LinearizedPathSegmentCache::LinearizedPathSegmentCache(size_t capacity) : capacity(capacity) {
+        // nothing to do
+    }
+
+    shared_ptr<const LinearizedPathSegment> LinearizedPathSegmentCache::get(const xg::XG* xindex, size_t path_rank,
+                                                                            const xg::XGPath& xpath, size_t begin,
+                                                                            size_t end, size_t padding) {
+
+        for (auto iter = segments.begin(); iter != segments.end(); iter++) {
+            if ((*iter)->contains(xindex, path_rank, begin, end)) {
+                // move this segment to the front of the queue
+                hits++;
+                if (iter != segments.begin()) {
+                    segments.splice(segments.begin(), segments, iter);
+                }
+                return segments.front();
+            }
+        }
+
+        misses++;
+
+        // we need a new segment, expand the interval by the padding in both directions so
+        // that nearby requests will also be able to use it
+        size_t path_length = xpath.offsets.size();
+        size_t first_pos = xpath.positions[begin];
+        size_t last_pos = (end < xpath.positions.size() ? xpath.positions[end] : path_length) - 1;
+
+        size_t padded_begin = xpath.offset_at_position(first_pos > padding ? first_pos - padding : 0);
+        size_t padded_end = xpath.offset_at_position(min(last_pos + padding, path_length - 1)) + 1;
+
+        auto segment = make_shared<const LinearizedPathSegment>(xindex, path_rank, xpath, padded_begin, padded_end);
+
+        segments.push_front(segment);
+        while (segments.size() > capacity) {
+            // the views keep the segment alive if they are still using it
+            segments.pop_back();
+        }
+
+        return segment;
+    }
+
+    LinearizedPathGraph::LinearizedPathGraph(shared_ptr<const LinearizedPathSegment> segment, size_t begin, size_t end) :
+        segment(segment), first(begin - segment->first_step), num_steps(end - begin) {
+        assert(segment->first_step <= begin && begin <= end && end <= segment->last_step);
+    }
+
+    inline pair<size_t, bool> LinearizedPathGraph::segment_step(id_t node_id) const {
+        if (node_id <= num_steps) {
+            // forward strand, in path order
+            return make_pair(first + node_id - 1, false);
+        }
+        else {
+            // reverse strand, in reverse path order
+            return make_pair(first + 2 * num_steps - node_id, true);
+        }
+    }
+
+    bool LinearizedPathGraph::has_node(id_t node_id) const {
+        return node_id > 0 && node_id <= 2 * num_steps;
+    }
+
+    handle_t LinearizedPathGraph::get_handle(const id_t& node_id, bool is_reverse) const {
+        return handlegraph::number_bool_packing::pack(node_id, is_reverse);
+    }
+
+    id_t LinearizedPathGraph::get_id(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::unpack_number(handle);
+    }
+
+    bool LinearizedPathGraph::get_is_reverse(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::unpack_bit(handle);
+    }
+
+    handle_t LinearizedPathGraph::flip(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::toggle_bit(handle);
+    }
+
+    size_t LinearizedPathGraph::get_length(const handle_t& handle) const {
+        size_t i = segment_step(get_id(handle)).first;
+        return segment->step_starts[i + 1] - segment->step_starts[i];
+    }
+
+    string LinearizedPathGraph::get_sequence(const handle_t& handle) const {
+        pair<size_t, bool> step = segment_step(get_id(handle));
+        size_t begin = segment->step_starts[step.first];
+        size_t length = segment->step_starts[step.first + 1] - begin;
+
+        string seq;
+        if (step.second) {
+            // read the reverse strand from the opposite end of the reverse complemented sequence
+            seq = segment->reverse_sequence.substr(segment->sequence.size() - begin - length, length);
+        }
+        else {
+            seq = segment->sequence.substr(begin, length);
+        }
+
+        if (get_is_reverse(handle)) {
+            seq = reverse_complement(seq);
+        }
+        return seq;
+    }
+
+    bool LinearizedPathGraph::follow_edges_impl(const handle_t& handle, bool go_left,
+                                                const function<bool(const handle_t&)>& iteratee) const {
+
+        // each strand is a separate chain, find where we are in the chain
+        id_t node_id = get_id(handle);
+        id_t chain_start = node_id <= num_steps ? 1 : num_steps + 1;
+        id_t chain_end = chain_start + num_steps - 1;
+        bool backward = get_is_reverse(handle);
+
+        if (go_left != backward) {
+            // moving toward the start of the chain
+            if (node_id == chain_start) {
+                return true;
+            }
+            return iteratee(get_handle(node_id - 1, backward));
+        }
+        else {
+            // moving toward the end of the chain
+            if (node_id == chain_end) {
+                return true;
+            }
+            return iteratee(get_handle(node_id + 1, backward));
+        }
+    }
+
+    bool LinearizedPathGraph::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+        // paths intervals should be short so we don't bother with parallel mode
+        for (id_t node_id = 1; node_id <= 2 * num_steps; node_id++) {
+            if (!iteratee(get_handle(node_id, false))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t LinearizedPathGraph::node_size() const {
+        return 2 * num_steps;
+    }
+
+    id_t LinearizedPathGraph::min_node_id() const {
+        return 1;
+    }
+
+    id_t LinearizedPathGraph::max_node_id() const {
+        return 2 * num_steps;
+    }
+
+    unordered_map<id_t, pair<id_t, bool>> LinearizedPathGraph::node_translation() const {
+        unordered_map<id_t, pair<id_t, bool>> node_trans;
+        node_trans.reserve(2 * num_steps);
+        for (id_t node_id = 1; node_id <= 2 * num_steps; node_id++) {
+            pair<size_t, bool> step = segment_step(node_id);
+            const pair<id_t, bool>& oriented_node = segment->steps[step.first];
+            node_trans[node_id] = make_pair(oriented_node.first, oriented_node.second != step.second);
+        }
+        return node_trans;
+    }
+}
@@ -0,0 +1,188 @@
+#ifndef VG_LINEARIZED_PATH_GRAPH_HPP_INCLUDED
+#define VG_LINEARIZED_PATH_GRAPH_HPP_INCLUDED
+
+/** \file
+ * linearized_path_graph.hpp: defines a lightweight handle graph view of an interval
+ * of an embedded path, along with a small cache of recently used path segments
+ */
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "handle.hpp"
+#include "xg.hpp"
+
+namespace vg {
+
+using namespace std;
+
+    /**
+     * A contiguous run of steps along an XG path, with the sequences of the
+     * steps concatenated in the path's orientation. Segments are immutable once
+     * extracted, so they can be shared between LinearizedPathGraph views.
+     */
+    struct LinearizedPathSegment {
+
+        /// Copy the steps [first_step, last_step) of a path out of the XG
+        LinearizedPathSegment(const xg::XG* xindex, size_t path_rank, const xg::XGPath& xpath,
+                              size_t first_step, size_t last_step);
+
+        /// The index this segment was extracted from
+        const xg::XG* xindex;
+        /// The rank of the path in the index
+        size_t path_rank;
+        /// The first step of the path contained in the segment
+        size_t first_step;
+        /// The step of the path after the last one contained in the segment
+        size_t last_step;
+
+        /// The node ID and orientation of each step
+        vector<pair<id_t, bool>> steps;
+        /// The offset of the start of each step in the sequences, with a past-the-end sentinel
+        vector<size_t> step_starts;
+        /// The sequence of the path along the segment
+        string sequence;
+        /// The reverse complement of the sequence
+        string reverse_sequence;
+
+        /// Returns true if the segment contains all of the steps [begin, end) on the given path
+        bool contains(const xg::XG* other_xindex, size_t other_path_rank, size_t begin, size_t end) const;
+    };
+
+    /**
+     * A per-thread LRU cache of LinearizedPathSegments. Requests for an interval of
+     * steps are served from any cached segment that contains them, so that reads
+     * that hit overlapping stretches of a path share a single extraction.
+     * Not thread safe.
+     */
+    class LinearizedPathSegmentCache {
+    public:
+
+        /// Make a cache that holds up to the given number of segments
+        LinearizedPathSegmentCache(size_t capacity = 16);
+
+        /// Get a segment that contains the steps [begin, end) of the path,
+        /// extracting one with the indicated number of bases of padding on
+        /// either side if none of the cached segments contain it.
+        shared_ptr<const LinearizedPathSegment> get(const xg::XG* xindex, size_t path_rank, const xg::XGPath& xpath,
+                                                    size_t begin, size_t end, size_t padding);
+
+        /// The number of requests that were served from the cache
+        size_t hits = 0;
+        /// The number of requests that required a new extraction
+        size_t misses = 0;
+
+    private:
+
+        /// The cached segments, most recently used first
+        list<shared_ptr<const LinearizedPathSegment>> segments;
+
+        /// The maximum number of segments to hold
+        size_t capacity;
+    };
+
+    /**
+     * A HandleGraph implementation that presents an interval of a path as a
+     * linear chain of nodes, with its strands split into two separate chains
+     * so that the graph is single-stranded. Nodes 1 to n are the steps of the
+     * interval in the path's orientation, and nodes n + 1 to 2n are their
+     * reverse complements, in the reverse order. Multiple visits to the same
+     * node on the path become distinct nodes.
+     *
+     * The sequences are backed by a shared LinearizedPathSegment, so making
+     * a view does not copy any sequence.
+     */
+    class LinearizedPathGraph : public HandleGraph {
+    public:
+
+        /// Make a view of the steps [begin, end) of the path in the segment,
+        /// which must contain them.
+        LinearizedPathGraph(shared_ptr<const LinearizedPathSegment> segment, size_t begin, size_t end);
+
+        /// Default constructor -- not actually functional
+        LinearizedPathGraph() = default;
+
+        /// Default destructor
+        ~LinearizedPathGraph() = default;
+
+        //////////////////////////
+        /// HandleGraph interface
+        //////////////////////////
+
+        /// Method to check if a node exists by ID
+        virtual bool has_node(id_t node_id) const;
+
+        /// Look up the handle for the node with the given ID in the given orientation
+        virtual handle_t get_handle(const id_t& node_id, bool is_reverse = false) const;
+
+        /// Get the ID from a handle
+        virtual id_t get_id(const handle_t& handle) const;
+
+        /// Get the orientation of a handle
+        virtual bool get_is_reverse(const handle_t& handle) const;
+
+        /// Invert the orientation of a handle (potentially without getting its ID)
+        virtual handle_t flip(const handle_t& handle) const;
+
+        /// Get the length of a node
+        virtual size_t get_length(const handle_t& handle) const;
+
+        /// Get the sequence of a node, presented in the handle's local forward
+        /// orientation.
+        virtual string get_sequence(const handle_t& handle) const;
+
+    protected:
+
+        /// Loop over all the handles to next/previous (right/left) nodes. Passes
+        /// them to a callback which returns false to stop iterating and true to
+        /// continue. Returns true if we finished and false if we stopped early.
+        virtual bool follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+
+        /// Loop over all the nodes in the graph in their local forward
+        /// orientations, in their internal stored order. Stop if the iteratee
+        /// returns false. Can be told to run in parallel, in which case stopping
+        /// after a false return value is on a best-effort basis and iteration
+        /// order is not defined.
+        virtual bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+
+    public:
+
+        /// Return the number of nodes in the graph
+        /// TODO: can't be node_count because XG has a field named node_count.
+        virtual size_t node_size() const;
+
+        /// Return the smallest ID in the graph, or some smaller number if the
+        /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+        virtual id_t min_node_id() const;
+
+        /// Return the largest ID in the graph, or some larger number if the
+        /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+        virtual id_t max_node_id() const;
+
+        //////////////////////////
+        /// Additional Interface
+        //////////////////////////
+
+        /// Get the translation from the node IDs of this graph to the oriented node IDs
+        /// of the backing XG, in the format used by MultipathAlignmentGraph
+        unordered_map<id_t, pair<id_t, bool>> node_translation() const;
+
+    private:
+
+        /// Get the index of the step within the segment that a node ID corresponds to,
+        /// and whether the node is on the reverse strand of the path
+        inline pair<size_t, bool> segment_step(id_t node_id) const;
+
+        /// The segment that holds the sequences
+        shared_ptr<const LinearizedPathSegment> segment;
+
+        /// The index of the first step of the interval within the segment
+        size_t first = 0;
+
+        /// The number of steps in the interval
+        size_t num_steps = 0;
+    };
+}
+
+#endif
@@ -10,6 +10,8 @@ namespace vg {
 
 // init the static memo
 thread_local vector<size_t> BaseMapper::adaptive_reseed_length_memo;
+thread_local Mapper::RescueNeighborhoodCache Mapper::rescue_neighborhood_cache;
+atomic<size_t> Mapper::next_rescue_cache_id(0);
 
 BaseMapper::BaseMapper(xg::XG* xidex,
                        gcsa::GCSA* g,
@@ -106,9 +108,21 @@ BaseMapper::find_mems_simple(string::const_iterator seq_begin,
     MaximalExactMatch match(cursor, cursor, full_range);
     gcsa::range_type last_range = match.range;
     --cursor; // start off looking at the last character in the query
+    // the length of the kmers we can jump over with the range table
+    int64_t jump_length = range_table ? range_table->k() : 0;
+    bool can_jump = (range_table && jump_length <= (int64_t) gcsa->order()
+                     && (!max_mem_length || jump_length <= max_mem_length));
     while (cursor >= seq_begin) {
         // hold onto our previous range
         last_range = match.range;
+        // when starting a new MEM, look up the range of the last kmer instead of taking the
+        // first LF steps one at a time (none of them can fail if the kmer range is non-empty)
+        if (can_jump && match.range == full_range && match.end == cursor + 1
+            && jump_start_search(seq_begin, match.end, match.range)) {
+            cursor -= jump_length;
+            match.begin = cursor + 1;
+            continue;
+        }
         // execute one step of LF mapping
         match.range = gcsa->LF(match.range, gcsa->alpha.char2comp[*cursor]);
         if (gcsa::Range::empty(match.range)
@@ -325,9 +339,25 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
     vector<int> lcp_maxima;
     
 
+    // the length of the kmers we can jump over with the range table
+    int64_t jump_length = range_table ? range_table->k() : 0;
+    bool can_jump = (range_table && !record_max_lcp && jump_length <= (int64_t) gcsa->order()
+                     && (!max_mem_length || jump_length <= max_mem_length));
+
     // loop maintains invariant that match.range contains the hits for seq[cursor+1:match.end]
     while (cursor >= seq_begin) {
         
+        // when starting a new MEM, look up the range of the last kmer instead of taking the
+        // first LF steps one at a time (none of them can fail if the kmer range is non-empty,
+        // and a kmer containing an N is not in the table)
+        if (can_jump && match.range == full_range && match.end == cursor + 1
+            && jump_start_search(seq_begin, match.end, match.range)) {
+            prev_iter_jumped_lcp = false;
+            mem_length += jump_length;
+            cursor -= jump_length;
+            continue;
+        }
+        
         // break the MEM on N; which for DNA we assume is non-informative
         // this *will* match many places in assemblies, but it isn't helpful
         if (*cursor == 'N') {
@@ -844,6 +874,10 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
     // the leftmost possible index of the next sub-MEM
     string::const_iterator leftmost_extension_bound = mems[mem_idx].begin;
     
+    // we can use the range table if the kmer is no longer than the burn-in, so that the only
+    // count check before the end of the kmer can be at the end of the search
+    bool can_jump = (range_table && (int64_t) range_table->k() <= sub_mem_thinning_burn_in);
+    
     while (probe_string_end <= mems[mem_idx].end) {
         
         // locate the probe substring of length equal to the minimum length for a sub-MEM
@@ -863,11 +897,22 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
         string::const_iterator cursor = probe_string_end - 1;
         gcsa::range_type range = gcsa::range_type(0, gcsa->size() - 1);
         
+        // skip the LF steps for the last kmer if no count would be checked before its end
+        bool jumped = can_jump && jump_start_search(probe_string_begin, probe_string_end, range);
+        if (jumped) {
+            cursor = probe_string_end - range_table->k();
+        }
+        
         // check if the probe substring is more frequent than the SMEM its contained in
         bool probe_string_more_frequent = true;
         while (cursor >= probe_string_begin) {
             
-            range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+            if (jumped) {
+                jumped = false;
+            }
+            else {
+                range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+            }
             
             // do a count operation if we've reached the beginning of the probe string or at invervals of the thinning parameter
             // past the burn-in parameter
@@ -939,11 +984,21 @@ void BaseMapper::find_sub_mems_fast(const vector<MaximalExactMatch>& mems,
                 cursor = middle - 1;
                 range = gcsa::range_type(0, gcsa->size() - 1);
                 
+                jumped = can_jump && jump_start_search(probe_string_begin, middle, range);
+                if (jumped) {
+                    cursor = middle - range_table->k();
+                }
+                
                 // check if there is an independent occurrence of this substring outside of the SMEM
                 bool contained_in_independent_match = true;
                 while (cursor >= probe_string_begin) {
                     
-                    range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+                    if (jumped) {
+                        jumped = false;
+                    }
+                    else {
+                        range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+                    }
                     
                     // do count operations on the final index and on intervals of the thinning parameter once we pass the
                     // burn in parameter
@@ -1356,8 +1411,9 @@ void BaseMapper::first_hit_positions_by_index(MaximalExactMatch& mem,
     
     // in case the first hit occurs in more than one place, accumulate all the hits
     if (all_first_hits.size() > 1) {
+        // reused for each of the other first hits
+        vector<set<pos_t>> temp_positions_by_index;
         for (size_t i = 1; i < all_first_hits.size(); i++) {
-            vector<set<pos_t>> temp_positions_by_index;
             mem_positions_by_index(mem, make_pos_t(all_first_hits[i]),
                                    temp_positions_by_index);
             
@@ -1378,6 +1434,9 @@ void BaseMapper::fill_nonredundant_sub_mem_nodes(vector<MaximalExactMatch>& pare
     // for each MEM, a vector of the positions that it touches at each index along the MEM
     vector<vector<set<pos_t>>> positions_by_index(parent_mems.size());
     
+    // the hits at one index of a sub-MEM's range, reused across indexes and sub-MEMs
+    vector<gcsa::node_type> hits;
+    
     for (auto iter = sub_mem_records_begin; iter != sub_mem_records_end; iter++) {
         
         pair<MaximalExactMatch, vector<size_t> >& sub_mem_and_parents = *iter;
@@ -1411,7 +1470,7 @@ void BaseMapper::fill_nonredundant_sub_mem_nodes(vector<MaximalExactMatch>& pare
             
             
             // add the locations of the hits, but do not remove duplicates yet
-            vector<gcsa::node_type> hits;
+            hits.clear();
             gcsa->locate(i, hits, true, false);
             
             // the number of subsequent hits (including these) that are inside a parent MEM
@@ -1437,9 +1496,7 @@ void BaseMapper::fill_nonredundant_sub_mem_nodes(vector<MaximalExactMatch>& pare
             }
             else {
                 // these are nonredundant sub MEM hits, add them
-                for (gcsa::node_type node : hits) {
-                    sub_mem.nodes.push_back(node);
-                }
+                sub_mem.nodes.insert(sub_mem.nodes.end(), hits.begin(), hits.end());
             }
         }
         
@@ -1577,6 +1634,27 @@ bool BaseMapper::has_fixed_fragment_length_distr() {
 void BaseMapper::force_fragment_length_distr(double mean, double stddev) {
     fragment_length_distr.force_parameters(mean, stddev);
 }
+
+void BaseMapper::set_range_table(const GCSARangeTable* table) {
+    if (table != nullptr && (gcsa == nullptr || !table->compatible(*gcsa))) {
+        cerr << "error:[vg::Mapper] range table was not built from the GCSA2 index used for mapping" << endl;
+        exit(1);
+    }
+    range_table = table;
+}
+
+bool BaseMapper::jump_start_search(string::const_iterator begin, string::const_iterator end,
+                                   gcsa::range_type& range) const {
+    if (range_table == nullptr || end - begin < (int64_t) range_table->k()) {
+        return false;
+    }
+    gcsa::range_type kmer_range;
+    if (!range_table->find(end - range_table->k(), kmer_range) || gcsa::Range::empty(kmer_range)) {
+        return false;
+    }
+    range = kmer_range;
+    return true;
+}
     
 void BaseMapper::apply_haplotype_consistency_scores(const vector<Alignment*>& alns) {
     if (haplo_score_provider == nullptr) {
@@ -1770,6 +1848,9 @@ Mapper::Mapper(xg::XG* xidex,
     , identity_weight(2)
     , pair_rescue_hang_threshold(0.7)
     , pair_rescue_retry_threshold(0.5)
+    , rescue_cache_size(0)
+    , rescue_kmer_size(0)
+    , rescue_min_kmer_hits(1)
     , include_full_length_bonuses(true)
 {
     // bench_init(bench[0]); bench_init(bench[1]); bench_init(bench[2]); bench_init(bench[3]);
@@ -2039,6 +2120,183 @@ vector<pos_t> Mapper::likely_mate_positions(const Alignment& aln, bool is_first_
     return likely;
 }
 
+void for_each_canonical_kmer(const string& sequence, int kmer_size, const function<void(uint64_t)>& lambda) {
+    uint64_t mask = kmer_size >= 32 ? numeric_limits<uint64_t>::max() : (uint64_t(1) << (2 * kmer_size)) - 1;
+    uint64_t forward = 0;
+    uint64_t reverse_complement = 0;
+    int valid = 0;
+    for (char c : sequence) {
+        uint64_t code;
+        switch (c) {
+        case 'A': case 'a': code = 0; break;
+        case 'C': case 'c': code = 1; break;
+        case 'G': case 'g': code = 2; break;
+        case 'T': case 't': code = 3; break;
+        default:
+            valid = 0;
+            continue;
+        }
+        forward = ((forward << 2) | code) & mask;
+        reverse_complement = (reverse_complement >> 2) | ((3 - code) << (2 * (kmer_size - 1)));
+        if (++valid >= kmer_size) {
+            lambda(min(forward, reverse_complement));
+        }
+    }
+}
+
+bool Mapper::RescueNeighborhood::extract_context(const pos_t& pos, int64_t length, Graph& context) const {
+    // this walks the neighborhood the same way XG::graph_context_g walks the
+    // index, so that it comes out with the same nodes
+    auto is_inverting = [](const Edge& e) {
+            return !(e.from_start() == e.to_end())
+            && (e.from_start() || e.to_end());
+    };
+    Graph extracted;
+    set<pos_t> seen;
+    set<pos_t> nexts;
+    nexts.insert(pos);
+    int64_t distance = -offset(pos); // don't count what we won't traverse, so back out the part of the node not relative-forward
+    while (!nexts.empty()) {
+        set<pos_t> todo;
+        int nextd = 0;
+        for (auto& next : nexts) {
+            if (!seen.count(next)) {
+                seen.insert(next);
+                auto found = node_index.find(id(next));
+                if (found == node_index.end()) {
+                    // the walk left the neighborhood
+                    return false;
+                }
+                const Node& node = graph.node(found->second);
+                *extracted.add_node() = node;
+                nextd = nextd == 0 ? node.sequence().size() : min(nextd, (int)node.sequence().size());
+                auto edges = node_edges.find(id(next));
+                if (edges == node_edges.end()) {
+                    continue;
+                }
+                for (auto& e : edges->second) {
+                    const Edge& edge = graph.edge(e);
+                    *extracted.add_edge() = edge;
+                    // look at the next positions we could reach
+                    if (!is_rev(next)) {
+                        // we are on the forward strand, the next things from this node come off the end
+                        if ((edge.to() == id(next) && edge.to_end()) || (edge.from() == id(next) && !edge.from_start())) {
+                            id_t nid = (edge.from() == id(next) ? edge.to() : edge.from());
+                            todo.insert(make_pos_t(nid, is_inverting(edge), 0));
+                        }
+                    } else {
+                        // we are on the reverse strand, the next things from this node come off the start
+                        if ((edge.to() == id(next) && !edge.to_end()) || (edge.from() == id(next) && edge.from_start())) {
+                            id_t nid = (edge.to() == id(next) ? edge.from() : edge.to());
+                            todo.insert(make_pos_t(nid, !is_inverting(edge), 0));
+                        }
+                    }
+                }
+            }
+        }
+        distance += nextd;
+        if (distance > length) {
+            break;
+        }
+        nexts = todo;
+    }
+    context.MergeFrom(extracted);
+    return true;
+}
+
+shared_ptr<Mapper::RescueNeighborhood> Mapper::rescue_neighborhood(id_t node_id, int64_t context_length) {
+    auto& cache = rescue_neighborhood_cache;
+    if (cache.mapper_id != rescue_cache_id || cache.context_length != context_length
+        || cache.kmer_size != rescue_kmer_size || cache.capacity != rescue_cache_size) {
+        // What we have cached was extracted for a different mapper,
+        // configuration or fragment model, so start over
+        cache.mapper_id = rescue_cache_id;
+        cache.context_length = context_length;
+        cache.kmer_size = rescue_kmer_size;
+        cache.capacity = rescue_cache_size;
+        cache.neighborhoods.reset(rescue_cache_size ? new LRUCache<id_t, shared_ptr<RescueNeighborhood>>(rescue_cache_size) : nullptr);
+    }
+    if (cache.neighborhoods) {
+        auto cached = cache.neighborhoods->retrieve(node_id);
+        if (cached.second) {
+            return cached.first;
+        }
+    }
+    
+    // Extract from the start of the node on each strand, and go far enough
+    // that the neighborhood covers the context around any offset on the node,
+    // so that all the positions on the node can share it.
+    auto neighborhood = make_shared<RescueNeighborhood>();
+    int64_t length = context_length + get_node_length(node_id);
+    neighborhood->graph.MergeFrom(xindex->graph_context_id(make_pos_t(node_id, false, 0), length));
+    neighborhood->graph.MergeFrom(xindex->graph_context_id(make_pos_t(node_id, true, 0), length));
+    // keep the edges leading out, so that walks can tell when they leave
+    remove_duplicates(neighborhood->graph);
+    for (int i = 0; i < neighborhood->graph.node_size(); ++i) {
+        neighborhood->node_index[neighborhood->graph.node(i).id()] = i;
+    }
+    for (int i = 0; i < neighborhood->graph.edge_size(); ++i) {
+        auto& edge = neighborhood->graph.edge(i);
+        neighborhood->node_edges[edge.from()].push_back(i);
+        if (edge.to() != edge.from()) {
+            neighborhood->node_edges[edge.to()].push_back(i);
+        }
+    }
+    
+    if (rescue_kmer_size > 0) {
+        // Index the kmers in the nodes, and the ones crossing each edge
+        auto& kmers = neighborhood->kmers;
+        auto add_kmer = [&](uint64_t kmer) { kmers.push_back(kmer); };
+        unordered_map<id_t, const string*> node_sequence;
+        for (auto& node : neighborhood->graph.node()) {
+            for_each_canonical_kmer(node.sequence(), rescue_kmer_size, add_kmer);
+            node_sequence[node.id()] = &node.sequence();
+        }
+        size_t overhang = rescue_kmer_size - 1;
+        for (auto& edge : neighborhood->graph.edge()) {
+            auto from = node_sequence.find(edge.from());
+            auto to = node_sequence.find(edge.to());
+            if (from == node_sequence.end() || to == node_sequence.end()) {
+                continue;
+            }
+            string left = edge.from_start() ? reverse_complement(*from->second) : *from->second;
+            string right = edge.to_end() ? reverse_complement(*to->second) : *to->second;
+            if (left.size() > overhang) {
+                left.erase(0, left.size() - overhang);
+            }
+            right.resize(min(right.size(), overhang));
+            for_each_canonical_kmer(left + right, rescue_kmer_size, add_kmer);
+        }
+        sort(kmers.begin(), kmers.end());
+        kmers.erase(unique(kmers.begin(), kmers.end()), kmers.end());
+    }
+    
+    if (cache.neighborhoods) {
+        cache.neighborhoods->put(node_id, neighborhood);
+    }
+    return neighborhood;
+}
+
+bool Mapper::rescue_prefilter(const string& sequence, const vector<shared_ptr<RescueNeighborhood>>& neighborhoods) const {
+    if (rescue_kmer_size <= 0 || rescue_min_kmer_hits <= 0) {
+        return true;
+    }
+    int hits = 0;
+    bool passed = false;
+    for_each_canonical_kmer(sequence, rescue_kmer_size, [&](uint64_t kmer) {
+        if (passed) {
+            return;
+        }
+        for (auto& neighborhood : neighborhoods) {
+            if (binary_search(neighborhood->kmers.begin(), neighborhood->kmers.end(), kmer)) {
+                passed = (++hits >= rescue_min_kmer_hits);
+                break;
+            }
+        }
+    });
+    return passed;
+}
+
 pair<bool, bool> Mapper::pair_rescue(Alignment& mate1, Alignment& mate2,
                                      bool& tried1, bool& tried2,
                                      int match_score, int full_length_bonus, bool traceback, bool xdrop_alignment) {
@@ -2086,23 +2344,47 @@ pair<bool, bool> Mapper::pair_rescue(Alignment& mate1, Alignment& mate2,
         return make_pair(false, false);
     }
     if (mate_positions.empty()) return make_pair(false, false); // can't rescue because the selected mate is unaligned
-    Graph graph;
     set<bool> orientations;
 #ifdef debug_rescue
     if (debug) cerr << "got " << mate_positions.size() << " mate positions" << endl;
 #endif
+    int get_at_least = (!frag_stats.cached_fragment_length_mean ? frag_stats.fragment_max
+                        : min(frag_stats.fragment_max/2,
+                              (int64_t)max((double)frag_stats.cached_fragment_length_stdev * 10.0,
+                                           mate1.sequence().size() * 3.0)));
+    //cerr << "Getting at least " << get_at_least << endl;
+    // pairs landing on the same nodes share the neighborhoods this thread
+    // extracted recently, but only extract them if we cache or pre-filter
+    bool use_neighborhoods = rescue_cache_size > 0 || rescue_kmer_size > 0;
+    vector<shared_ptr<RescueNeighborhood>> neighborhoods;
     for (auto& mate_pos : mate_positions) {
 #ifdef debug_rescue
         if (debug) cerr << "aiming for " << mate_pos << endl;
 #endif
         orientations.insert(is_rev(mate_pos));
-        int get_at_least = (!frag_stats.cached_fragment_length_mean ? frag_stats.fragment_max
-                            : min(frag_stats.fragment_max/2,
-                                  (int64_t)max((double)frag_stats.cached_fragment_length_stdev * 10.0,
-                                               mate1.sequence().size() * 3.0)));
-        //cerr << "Getting at least " << get_at_least << endl;
-        graph.MergeFrom(xindex->graph_context_id(mate_pos, get_at_least/2));
-        graph.MergeFrom(xindex->graph_context_id(reverse(mate_pos, get_node_length(id(mate_pos))), get_at_least/2));
+        if (use_neighborhoods) {
+            neighborhoods.push_back(rescue_neighborhood(id(mate_pos), get_at_least/2));
+        }
+    }
+    if (use_neighborhoods && !rescue_prefilter(rescue_off_first ? mate2.sequence() : mate1.sequence(), neighborhoods)) {
+        // the mate can't align well here, so don't pay for the alignment, but
+        // count it against the rescue budget as if we had tried
+#ifdef debug_rescue
+        if (debug) cerr << "rescue pre-filter found too few shared kmers" << endl;
+#endif
+        tried1 = rescue_off_second;
+        tried2 = rescue_off_first;
+        return make_pair(false, false);
+    }
+    Graph graph;
+    for (size_t i = 0; i < mate_positions.size(); ++i) {
+        // cut out the same context around the mate position as the index would give us
+        auto& mate_pos = mate_positions[i];
+        for (auto& from : { mate_pos, reverse(mate_pos, get_node_length(id(mate_pos))) }) {
+            if (!use_neighborhoods || !neighborhoods[i]->extract_context(from, get_at_least/2, graph)) {
+                graph.MergeFrom(xindex->graph_context_id(from, get_at_least/2));
+            }
+        }
         //if (debug) cerr << "rescue got graph " << pb2json(graph) << endl;
         // if we're reversed, align the reverse sequence and flip it back
         // align against it
@@ -2365,7 +2647,9 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
     if (debug) cerr << "mems for read 1 " << mems_to_json(mems1) << endl;
     if (debug) cerr << "mems for read 2 " << mems_to_json(mems2) << endl;
 
-    auto transition_weight = [&](const MaximalExactMatch& m1, const MaximalExactMatch& m2) {
+    auto transition_weight = [&](const MEMChainModelVertex& v1, const MEMChainModelVertex& v2) {
+        const MaximalExactMatch& m1 = *v1.mem;
+        const MaximalExactMatch& m2 = *v2.mem;
 
 #ifdef debug_mapper
 #pragma omp critical
@@ -2375,14 +2659,14 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
 #endif
 
         // set up positions for distance query
-        pos_t m1_pos = make_pos_t(m1.nodes.front());
-        pos_t m2_pos = make_pos_t(m2.nodes.front());
+        pos_t m1_pos = make_pos_t(v1.node);
+        pos_t m2_pos = make_pos_t(v2.node);
 
         // are the two mems in a different fragment?
         // we handle the distance metric differently in these cases
-        if (m1.fragment < m2.fragment) {
+        if (v1.fragment < v2.fragment) {
             int64_t max_length = frag_stats.fragment_max;
-            pair<int64_t, int64_t> d = mem_min_oriented_distances(m1, m2);
+            pair<int64_t, int64_t> d = v1.min_oriented_distances(v2);
             // if we have a cached fragment orientation, use it to pick the min distance with the correct path relative orientation
             int64_t approx_dist = (!frag_stats.fragment_size ? min(d.first, d.second)
                                    : (frag_stats.cached_fragment_orientation_same ? d.first : d.second));
@@ -2399,15 +2683,15 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
             } else {
                 return 1.0/approx_dist * (m1.length() + m2.length());
             }
-        } else if (m1.fragment > m2.fragment) {
+        } else if (v1.fragment > v2.fragment) {
             // don't allow going backwards in the threads
             return -std::numeric_limits<double>::max();
         } else {
-            pos_t m1_pos = make_pos_t(m1.nodes.front());
-            pos_t m2_pos = make_pos_t(m2.nodes.front());
+            pos_t m1_pos = make_pos_t(v1.node);
+            pos_t m2_pos = make_pos_t(v2.node);
             int max_length = max(read1.sequence().size(), read2.sequence().size());
             double overlap_length = mems_overlap_length(m1, m2);
-            pair<int64_t, int64_t> distances = mem_min_oriented_distances(m1, m2);
+            pair<int64_t, int64_t> distances = v1.min_oriented_distances(v2);
             int64_t dist_fwd = distances.first; // use only the forward orientation
             //int64_t dist_inv = distances.second;
             if (dist_fwd > max_length) {
@@ -2442,8 +2726,16 @@ pair<vector<Alignment>, vector<Alignment>> Mapper::align_paired_multi(
         }
 #endif
     
+        // the chainer refers back to these MEMs until we are done with it, and
+        // the transition weights compare their fragments
+        vector<vector<MaximalExactMatch> > fragment_mems = { mems1, mems2 };
+        for (int i = 0; i < fragment_mems.size(); ++i) {
+            for (auto& mem : fragment_mems[i]) {
+                mem.fragment = i + 1;
+            }
+        }
         MEMChainModel chainer({ read1.sequence().size(), read2.sequence().size() },
-                              { mems1, mems2 },
+                              fragment_mems,
                               [&](pos_t n) -> int64_t {
                                   return approx_position(n);
                               },
@@ -3112,12 +3404,14 @@ Mapper::align_mem_multi(const Alignment& aln,
     // go through the ordered single-hit MEMs
     // build the clustering model
     // find the alignments that are the best-scoring walks through it
-    auto transition_weight = [&](const MaximalExactMatch& m1, const MaximalExactMatch& m2) {
-        pos_t m1_pos = make_pos_t(m1.nodes.front());
-        pos_t m2_pos = make_pos_t(m2.nodes.front());
+    auto transition_weight = [&](const MEMChainModelVertex& v1, const MEMChainModelVertex& v2) {
+        const MaximalExactMatch& m1 = *v1.mem;
+        const MaximalExactMatch& m2 = *v2.mem;
+        pos_t m1_pos = make_pos_t(v1.node);
+        pos_t m2_pos = make_pos_t(v2.node);
         int64_t max_length = aln.sequence().size();
         double overlap_length = mems_overlap_length(m1, m2);
-        pair<int64_t, int64_t> distances = mem_min_oriented_distances(m1, m2);
+        pair<int64_t, int64_t> distances = v1.min_oriented_distances(v2);
         int64_t dist_fwd = distances.first; // use only the forward orientation
         //int64_t dist_inv = distances.second;
         if (dist_fwd > max_length) {
@@ -3135,7 +3429,13 @@ Mapper::align_mem_multi(const Alignment& aln,
     // establish the chains
     vector<vector<MaximalExactMatch> > clusters;
     if (total_multimaps) {
-        MEMChainModel chainer({ aln.sequence().size() }, { mems },
+        // the chainer refers back to these MEMs until we are done with it, and
+        // the transition weights compare their fragments
+        vector<vector<MaximalExactMatch> > fragment_mems = { mems };
+        for (auto& mem : fragment_mems.front()) {
+            mem.fragment = 1;
+        }
+        MEMChainModel chainer({ aln.sequence().size() }, fragment_mems,
                               [&](pos_t n) {
                                   return approx_position(n);
                               },
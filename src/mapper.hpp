@@ -5,6 +5,7 @@
 #include <map>
 #include <chrono>
 #include <ctime>
+#include <atomic>
 #include "omp.h"
 #include "vg.hpp"
 #include "xg.hpp"
@@ -27,6 +28,7 @@
 #include "translator.hpp"
 // TODO: pull out ScoreProvider into its own file
 #include "haplotypes.hpp"
+#include "gcsa_range_table.hpp"
 
 // #define BENCH
 // #include "bench.h"
@@ -189,6 +191,10 @@ public:
     /// estimating them.
     void force_fragment_length_distr(double mean, double stddev);
     
+    /// Use the given kmer range table to jump-start backward searches in the GCSA. The table
+    /// must have been built from the same GCSA. Pass null to stop using a table.
+    void set_range_table(const GCSARangeTable* table);
+    
     // MEM-based mapping
     // find maximal exact matches
     // These are SMEMs by definition when shorter than the max_mem_length or GCSA2 order.
@@ -322,6 +328,12 @@ protected:
     // Algorithm for choosing an adaptive reseed length based on the length of the parent MEM
     size_t get_adaptive_min_reseed_length(size_t parent_mem_length);
     
+    /// If there is a range table and the kmer ending at end starts at or after begin, look up
+    /// the GCSA range of the kmer. Returns true and sets range if the range is non-empty, in
+    /// which case backward search can continue from end - range_table->k().
+    bool jump_start_search(string::const_iterator begin, string::const_iterator end,
+                           gcsa::range_type& range) const;
+    
     /// Score all of the alignments in the vector for haplotype consistency. If
     /// all of them can be scored (i.e. none of them visit nodes/edges with no
     /// haplotypes), adjust all of their scores to reflect haplotype
@@ -339,6 +351,9 @@ protected:
     gcsa::GCSA* gcsa = nullptr;
     gcsa::LCPArray* lcp = nullptr;
     
+    // Optional kmer range table for the GCSA
+    const GCSARangeTable* range_table = nullptr;
+    
     // Haplotype score provider, if any, for determining haplotype concordance
     haplo::ScoreProvider* haplo_score_provider = nullptr;
     
@@ -496,6 +511,52 @@ public:
 
     /// use the fragment configuration statistics to rescue more precisely
     pair<bool, bool> pair_rescue(Alignment& mate1, Alignment& mate2, bool& tried1, bool& tried2, int match_score, int full_length_bonus, bool traceback, bool xdrop_alignment);
+    
+    /// A graph neighborhood that pair rescue has pulled out of the xg index,
+    /// along with the sorted canonical kmers of its sequence.
+    struct RescueNeighborhood {
+        /// The nodes and all of their edges, including edges leading out
+        Graph graph;
+        vector<uint64_t> kmers;
+        /// Where each node is in the graph
+        unordered_map<id_t, size_t> node_index;
+        /// Which edges in the graph touch each node
+        unordered_map<id_t, vector<size_t>> node_edges;
+        
+        /// Add what XG::graph_context_id would extract from the position to
+        /// the context graph, without going back to the index. Returns false,
+        /// leaving the context graph alone, if that would need nodes that
+        /// are not in the neighborhood.
+        bool extract_context(const pos_t& pos, int64_t length, Graph& context) const;
+    };
+    
+    /// Get the graph around the node that pair rescue can extract contexts of
+    /// up to the given length from, at any offset on the node. Reuses this
+    /// thread's recent extractions if possible.
+    shared_ptr<RescueNeighborhood> rescue_neighborhood(id_t node_id, int64_t context_length);
+    /// Returns false if the sequence shares too few kmers with the
+    /// neighborhoods for an alignment to them to be worth trying.
+    bool rescue_prefilter(const string& sequence, const vector<shared_ptr<RescueNeighborhood>>& neighborhoods) const;
+    
+private:
+    /// Recently extracted rescue neighborhoods, keyed by the node they are
+    /// around. Entries are only valid for the mapper, context length and kmer
+    /// size the cache was filled with.
+    struct RescueNeighborhoodCache {
+        size_t mapper_id = 0;
+        int64_t context_length = 0;
+        int kmer_size = 0;
+        size_t capacity = 0;
+        unique_ptr<LRUCache<id_t, shared_ptr<RescueNeighborhood>>> neighborhoods;
+    };
+    // thread_local so that each mapping thread has its own cache
+    thread_local static RescueNeighborhoodCache rescue_neighborhood_cache;
+    // tells this mapper's cache entries apart, even from a mapper since
+    // destroyed at the same address
+    static atomic<size_t> next_rescue_cache_id;
+    size_t rescue_cache_id = ++next_rescue_cache_id;
+    
+public:
 
     set<MaximalExactMatch*> resolve_paired_mems(vector<MaximalExactMatch>& mems1,
                                                 vector<MaximalExactMatch>& mems2);
@@ -666,6 +727,9 @@ public:
 
     double pair_rescue_hang_threshold;
     double pair_rescue_retry_threshold;
+    size_t rescue_cache_size; // rescue neighborhoods kept per thread, 0 to disable caching (only helps when nearby pairs are mapped together)
+    int rescue_kmer_size; // kmer size for the rescue pre-filter, 0 (the default) to disable it
+    int rescue_min_kmer_hits; // only align a rescued mate to neighborhoods sharing this many kmers with it
     
     // Keep track of fragment length distribution statistics
     FragmentLengthStatistics frag_stats;
@@ -677,6 +741,11 @@ public:
 // utility
 const vector<string> balanced_kmers(const string& seq, int kmer_size, int stride);
 
+/// Call the lambda on the canonical (smaller of the two strands) 2-bit
+/// encoding of each kmer of the sequence, skipping kmers that contain
+/// non-ACGT characters. Kmers can be up to 32 bases.
+void for_each_canonical_kmer(const string& sequence, int kmer_size, const function<void(uint64_t)>& lambda);
+
 set<pos_t> gcsa_nodes_to_positions(const vector<gcsa::node_type>& nodes);
 
 int sub_overlaps_of_first_aln(const vector<Alignment>& alns, float overlap_fraction);
@@ -21,6 +21,7 @@ constexpr MinimizerIndex::code_type MinimizerIndex::NO_VALUE;
 constexpr std::uint32_t MinimizerIndex::Header::TAG;
 constexpr std::uint32_t MinimizerIndex::Header::VERSION;
 constexpr std::uint32_t MinimizerIndex::Header::MIN_VERSION;
+constexpr std::uint64_t MinimizerIndex::Header::FLAG_SYNCMER_MASK;
 
 constexpr size_t MinimizerIndex::PACK_WIDTH;
 constexpr MinimizerIndex::key_type MinimizerIndex::PACK_MASK;
@@ -104,9 +105,9 @@ MinimizerIndex::Header::Header() :
 {
 }
 
-MinimizerIndex::Header::Header(size_t kmer_length, size_t window_length, size_t max_occs_per_key) :
+MinimizerIndex::Header::Header(size_t kmer_length, size_t window_length, size_t max_occs_per_key, size_t syncmer_length) :
     tag(TAG), version(VERSION),
-    flags(0),
+    flags(syncmer_length & FLAG_SYNCMER_MASK),
     k(kmer_length), w(window_length),
     keys(0), capacity(INITIAL_CAPACITY), max_keys(INITIAL_CAPACITY * MAX_LOAD_FACTOR),
     values(0), max_occs(max_occs_per_key),
@@ -125,6 +126,12 @@ void MinimizerIndex::Header::sanitize() {
         this->k = 1;
     }
 
+    size_t s = this->flags & FLAG_SYNCMER_MASK;
+    if (s >= this->k) {
+        std::cerr << "warning: [MinimizerIndex] Adjusting s from " << s << " to " << (this->k - 1) << std::endl;
+        this->flags = (this->flags & ~FLAG_SYNCMER_MASK) | (this->k - 1);
+    }
+
     if (this->w == 0) {
         std::cerr << "warning: [MinimizerIndex] Adjusting w from " << this->w << " to " << 1 << std::endl;
         this->w = 1;
@@ -137,7 +144,12 @@ void MinimizerIndex::Header::sanitize() {
 }
 
 bool MinimizerIndex::Header::check() const {
-    return (this->tag == TAG && this->version >= MIN_VERSION && this->version <= VERSION && this->flags == 0);
+    if (this->tag != TAG || this->version < MIN_VERSION || this->version > VERSION) {
+        return false;
+    }
+    // Version 2 has no flags.
+    std::uint64_t allowed_flags = (this->version >= 3 ? FLAG_SYNCMER_MASK : 0);
+    return ((this->flags & ~allowed_flags) == 0);
 }
 
 bool MinimizerIndex::Header::operator==(const Header& another) const {
@@ -158,8 +170,8 @@ MinimizerIndex::MinimizerIndex() :
 {
 }
 
-MinimizerIndex::MinimizerIndex(size_t kmer_length, size_t window_length,  size_t max_occs_per_key) :
-    header(kmer_length, window_length, max_occs_per_key),
+MinimizerIndex::MinimizerIndex(size_t kmer_length, size_t window_length,  size_t max_occs_per_key, size_t syncmer_length) :
+    header(kmer_length, window_length, max_occs_per_key, syncmer_length),
     hash_table(this->header.capacity, empty_cell()),
     is_pointer(this->header.capacity, false)
 {
@@ -565,6 +577,50 @@ update_reverse_key(MinimizerIndex::key_type& key, size_t k, unsigned char c) {
     }
 }
 
+/*
+  Canonical hashes of the last k - s + 1 s-mers, for determining whether the kmer ending
+  at the last character is a closed syncmer: the smallest s-mer hash is at either end.
+  Because the hashes are canonical, a kmer and its reverse complement agree.
+  With s == 0, every kmer is a syncmer.
+*/
+struct SyncmerTracker {
+    typedef MinimizerIndex::key_type key_type;
+
+    std::vector<size_t> hashes;
+    size_t s, chars;
+    size_t valid_chars;
+    key_type forward_key, reverse_key;
+
+    SyncmerTracker(size_t k, size_t s) :
+        hashes((s > 0 ? k - s + 1 : 0), 0), s(s), chars(0),
+        valid_chars(0), forward_key(0), reverse_key(0)
+    {
+    }
+
+    void update(unsigned char c) {
+        if (this->s == 0) {
+            return;
+        }
+        update_forward_key(this->forward_key, this->s, c, this->valid_chars);
+        update_reverse_key(this->reverse_key, this->s, c);
+        if (this->valid_chars >= this->s) {
+            this->hashes[this->chars % this->hashes.size()] = std::min(wang_hash_64(this->forward_key), wang_hash_64(this->reverse_key));
+        }
+        this->chars++;
+    }
+
+    // Assumes that the kmer ending at the last character is valid.
+    bool is_syncmer() const {
+        if (this->s == 0) {
+            return true;
+        }
+        size_t n = this->hashes.size();
+        size_t first = this->hashes[(this->chars - n) % n], last = this->hashes[(this->chars - 1) % n];
+        size_t smallest = *std::min_element(this->hashes.begin(), this->hashes.end());
+        return (first == smallest || last == smallest);
+    }
+};
+
 } // namespace mi
 
 
@@ -578,10 +634,12 @@ MinimizerIndex::minimizer(std::string::const_iterator begin, std::string::const_
     size_t valid_chars = 0, best_hash = 0;
     bool found = false;
     key_type forward_key = 0, reverse_key = 0;
+    mi::SyncmerTracker syncmers(this->k(), this->s());
     for (std::string::const_iterator iter = begin; iter != end; ++iter) {
         mi::update_forward_key(forward_key, this->k(), *iter, valid_chars);
         mi::update_reverse_key(reverse_key, this->k(), *iter);
-        if (valid_chars >= this->k()) {
+        syncmers.update(*iter);
+        if (valid_chars >= this->k() && syncmers.is_syncmer()) {
             size_t forward_hash = wang_hash_64(forward_key), reverse_hash = wang_hash_64(reverse_key);
             size_t hash = std::min(forward_hash, reverse_hash);
             if (!found || hash < result.hash) {
@@ -616,13 +674,15 @@ MinimizerIndex::minimizers(std::string::const_iterator begin, std::string::const
 
     // Find the minimizers.
     mi::CircularBuffer buffer(this->w());
+    mi::SyncmerTracker syncmers(this->k(), this->s());
     size_t valid_chars = 0, start_pos = 0;
     key_type forward_key = 0, reverse_key = 0;
     std::string::const_iterator iter = begin;
     while (iter != end) {
         mi::update_forward_key(forward_key, this->k(), *iter, valid_chars);
         mi::update_reverse_key(reverse_key, this->k(), *iter);
-        if (valid_chars >= this->k()) {
+        syncmers.update(*iter);
+        if (valid_chars >= this->k() && syncmers.is_syncmer()) {
             buffer.advance(start_pos, forward_key, reverse_key);
         } else {
             buffer.advance(start_pos);
@@ -687,25 +747,38 @@ std::vector<pos_t> MinimizerIndex::find(const minimizer_type& minimizer) const {
 }
 
 size_t MinimizerIndex::count(const minimizer_type& minimizer) const {
+    return this->occurrences(minimizer).size();
+}
+
+MinimizerIndex::occurrence_view MinimizerIndex::occurrences(const minimizer_type& minimizer) const {
+    occurrence_view result { nullptr, 0 };
     if (minimizer.empty()) {
-        return 0;
+        return result;
     }
 
     size_t offset = this->find_offset(minimizer.key, minimizer.hash);
-    cell_type cell = this->hash_table[offset];
+    const cell_type& cell = this->hash_table[offset];
     if (cell.first == minimizer.key) {
         if (this->is_pointer[offset]) {
-            return cell.second.pointer->size();
-        } else {
-            if (cell.second.value == NO_VALUE) {
-                return 0;
-            } else {
-                return 1;
-            }
+            result.first = cell.second.pointer->data();
+            result.length = cell.second.pointer->size();
+        } else if (cell.second.value != NO_VALUE) {
+            result.first = &(cell.second.value);
+            result.length = 1;
         }
     }
 
-    return 0;
+    return result;
+}
+
+size_t MinimizerIndex::append_occurrences(const minimizer_type& minimizer, std::vector<pos_t>& output, size_t hit_cap) const {
+    occurrence_view occs = this->occurrences(minimizer);
+    if (occs.size() <= hit_cap) {
+        for (code_type pos : occs) {
+            output.emplace_back(decode(pos));
+        }
+    }
+    return occs.size();
 }
 
 size_t MinimizerIndex::find_offset(key_type key, size_t hash) const {
@@ -25,6 +25,10 @@ namespace vg {
  * complements.
  * There is an option to specify an upper bound for the number of occurrences of each
  * minimizer. If the actual number is higher, the occurrences will not be stored.
+ * There is also an option to down-sample the minimizers by only considering kmers that
+ * are closed syncmers: the smallest of their s-mers (by canonical hash) is at the start
+ * or at the end. Whether a kmer is a syncmer depends only on the kmer itself, so the
+ * sampling is the same for the graph and the reads, and in both orientations.
  *
  * Index versions:
  *
@@ -33,6 +37,9 @@ namespace vg {
  *   2  Minimizer selection is based on hashes instead of lexicographic order. A sequence and
  *      its reverse complement have the same minimizers, reducing index size by 50%. Not
  *      compatible with version 1.
+ *
+ *   3  Optional syncmer sampling. The low-order bits of the flags store the s-mer length.
+ *      Compatible with version 2.
  */
 class MinimizerIndex {
 public:
@@ -60,6 +67,19 @@ public:
 
     static cell_type empty_cell() { return cell_type(NO_KEY, { NO_VALUE }); }
 
+    /// A read-only view of the encoded occurrences of a minimizer in the index's own
+    /// storage. Use decode() to get the positions. The view is invalidated by any
+    /// modification of the index.
+    struct occurrence_view {
+        const code_type* first;
+        size_t           length;
+
+        const code_type* begin() const { return this->first; }
+        const code_type* end() const { return this->first + this->length; }
+        size_t size() const { return this->length; }
+        bool empty() const { return (this->length == 0); }
+    };
+
     struct minimizer_type {
         key_type    key;        // Encoded minimizer.
         size_t      hash;       // Hash of the minimizer.
@@ -90,11 +110,14 @@ public:
         size_t        unique, frequent;
 
         constexpr static std::uint32_t TAG = 0x31513151;
-        constexpr static std::uint32_t VERSION = 2;
+        constexpr static std::uint32_t VERSION = 3;
         constexpr static std::uint32_t MIN_VERSION = 2;
 
+        // Syncmer s-mer length, or 0 if all kmers are minimizer candidates.
+        constexpr static std::uint64_t FLAG_SYNCMER_MASK = 0xFF;
+
         Header();
-        Header(size_t kmer_length, size_t window_length, size_t max_occs_per_key);
+        Header(size_t kmer_length, size_t window_length, size_t max_occs_per_key, size_t syncmer_length);
         void sanitize();
         bool check() const;
 
@@ -107,8 +130,9 @@ public:
     /// Constructs an index with the default parameters.
     MinimizerIndex();
 
-    /// Constructs an index with the specified parameter values.
-    MinimizerIndex(size_t kmer_length, size_t window_length, size_t max_occs_per_key = MAX_OCCS);
+    /// Constructs an index with the specified parameter values. If syncmer_length is
+    /// nonzero, only closed syncmers with s-mers of that length can be minimizers.
+    MinimizerIndex(size_t kmer_length, size_t window_length, size_t max_occs_per_key = MAX_OCCS, size_t syncmer_length = 0);
 
     /// Copy constructor.
     MinimizerIndex(const MinimizerIndex& source);
@@ -179,6 +203,18 @@ public:
     /// Use minimizer() or minimizers() to get the minimizer.
     size_t count(const minimizer_type& minimizer) const;
 
+    /// Returns the occurrences of the minimizer as a view of the index's own storage,
+    /// using a single hash table probe and no allocation. If the occurrence limit has
+    /// been exceeded, the view is empty. The occurrences are sorted.
+    /// If the minimizer is in reverse orientation, use reverse_base_pos() to reverse
+    /// the decoded occurrences.
+    occurrence_view occurrences(const minimizer_type& minimizer) const;
+
+    /// Appends the decoded occurrences of the minimizer to the output vector if there
+    /// are at most hit_cap of them, using a single hash table probe. Returns the
+    /// occurrence count as count() does, whether or not anything was appended.
+    size_t append_occurrences(const minimizer_type& minimizer, std::vector<pos_t>& output, size_t hit_cap = MAX_OCCS) const;
+
 //------------------------------------------------------------------------------
 
     /// Length of the kmers in the index.
@@ -187,6 +223,9 @@ public:
     /// Window length for the minimizers.
     size_t w() const { return this->header.w; }
 
+    /// Length of the s-mers for syncmer sampling, or 0 if there is no sampling.
+    size_t s() const { return this->header.flags & Header::FLAG_SYNCMER_MASK; }
+
     /// Number of keys in the index.
     size_t size() const { return this->header.keys; }
 
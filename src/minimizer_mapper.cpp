@@ -5,12 +5,16 @@
 
 #include "minimizer_mapper.hpp"
 #include "annotation.hpp"
-#include "path_subgraph.hpp"
+#include "tree_subgraph.hpp"
 #include "multipath_alignment.hpp"
 #include "funnel.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <deque>
+#include <tuple>
+#include <array>
+#include <cmath>
 
 // We define this to turn on the detailed funnel instrumentation and correctness tracking.
 // Without this we just track per-read time.
@@ -27,12 +31,72 @@ using namespace std;
 MinimizerMapper::MinimizerMapper(const xg::XG* xg_index, const gbwt::GBWT* gbwt_index, const MinimizerIndex* minimizer_index,
     SnarlManager* snarl_manager, DistanceIndex* distance_index) :
     xg_index(xg_index), gbwt_index(gbwt_index), minimizer_index(minimizer_index),
-    snarl_manager(snarl_manager), distance_index(distance_index), gbwt_graph(*gbwt_index, *xg_index),
+    snarl_manager(snarl_manager), distance_index(distance_index),
+    owned_gbwt_graph(new GBWTGraph(*gbwt_index, *xg_index)), gbwt_graph(*owned_gbwt_graph),
     extender(gbwt_graph) {
     
     // Nothing to do!
 }
 
+MinimizerMapper::MinimizerMapper(const xg::XG* xg_index, const GBWTGraph& gbwt_graph, const MinimizerIndex* minimizer_index,
+    SnarlManager* snarl_manager, DistanceIndex* distance_index) :
+    xg_index(xg_index), gbwt_index(gbwt_graph.index), minimizer_index(minimizer_index),
+    snarl_manager(snarl_manager), distance_index(distance_index), gbwt_graph(gbwt_graph),
+    extender(gbwt_graph) {
+    
+    // Nothing to do!
+}
+
+MinimizerMapper::WorkBudget MinimizerMapper::start_budget() const {
+    WorkBudget budget;
+    budget.seeds_left = max_seeds == 0 ? numeric_limits<size_t>::max() : max_seeds;
+    budget.dp_cells_left = max_dp_cells;
+    budget.gbwt_states_left = max_gbwt_states == 0 ? numeric_limits<size_t>::max() : max_gbwt_states;
+    return budget;
+}
+
+void MinimizerMapper::finish_budget(const WorkBudget& budget, Alignment& out) const {
+    work_limit_counts.reads++;
+    if (budget.seeds_limited) {
+        work_limit_counts.seeds_limited++;
+    }
+    if (budget.dp_limited) {
+        work_limit_counts.dp_limited++;
+    }
+    if (budget.gbwt_limited) {
+        work_limit_counts.gbwt_limited++;
+    }
+    if (budget.clusters_limited) {
+        work_limit_counts.clusters_limited++;
+    }
+    if (budget.stopped_at_mapq_cap) {
+        work_limit_counts.stopped_at_mapq_cap++;
+    }
+    
+    set_annotation(out, "seed_budget_limited", budget.seeds_limited);
+    set_annotation(out, "dp_budget_limited", budget.dp_limited);
+    set_annotation(out, "gbwt_budget_limited", budget.gbwt_limited);
+    set_annotation(out, "clusters_limited", budget.clusters_limited);
+    set_annotation(out, "stopped_at_mapq_cap", budget.stopped_at_mapq_cap);
+}
+
+void MinimizerMapper::report_work_limits(ostream& out) const {
+    size_t reads = work_limit_counts.reads;
+    auto report = [&](const string& what, size_t count) {
+        out << what << ": " << count;
+        if (reads != 0) {
+            out << " (" << (100.0 * count / reads) << "%)";
+        }
+        out << endl;
+    };
+    out << "Reads mapped: " << reads << endl;
+    report("Reads out of seed budget", work_limit_counts.seeds_limited);
+    report("Reads out of DP cell budget", work_limit_counts.dp_limited);
+    report("Reads out of GBWT search budget", work_limit_counts.gbwt_limited);
+    report("Reads with low-coverage clusters skipped", work_limit_counts.clusters_limited);
+    report("Reads stopped with MAPQ settled", work_limit_counts.stopped_at_mapq_cap);
+}
+
 void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
     // For each input alignment
         
@@ -49,126 +113,503 @@ void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
         aln.set_read_group(read_group);
     }
     
-#ifdef INSTRUMENT_MAPPING
-    // Start the minimizer finding stage
-    funnel.stage("minimizer");
-#endif
-    
-    // We will find all the seed hits
-    vector<pos_t> seeds;
-    
     // This will hold all the minimizers in the query
     vector<MinimizerIndex::minimizer_type> minimizers;
-    // And either way this will map from seed to minimizer that generated it
+    // We will find all the seed hits
+    vector<pos_t> seeds;
+    // And this will map from seed to minimizer that generated it
     vector<size_t> seed_to_source;
     
-    // Find minimizers in the query
-    minimizers = minimizer_index->minimizers(aln.sequence());
+    // This read only gets to do so much work
+    WorkBudget budget = start_budget();
     
+    find_seeds(aln, minimizers, seeds, seed_to_source, budget, funnel);
+
 #ifdef INSTRUMENT_MAPPING
-#ifdef TRACK_PROVENANCE
-    // Record how many we found, as new lines.
-    funnel.introduce(minimizers.size());
+    // Begin the clustering stage
+    funnel.stage("cluster");
 #endif
+        
+    // Cluster the seeds. Get sets of input seed indexes that go together.
+    vector<vector<size_t>> clusters = clusterer.cluster_seeds(seeds, distance_limit, *snarl_manager, *distance_index);
     
-    // Start the minimizer locating stage
-    funnel.stage("seed");
+    // Extend and align the best clusters. Everything has to become an alignment.
+    vector<size_t> alignment_clusters;
+    vector<Alignment> alignments = align_clusters(aln, clusters, minimizers, seeds, seed_to_source, stop_at_mapq_cap,
+        budget, funnel, alignment_clusters);
+    
+    // Order the Alignments by score
+    vector<size_t> alignments_in_order;
+    alignments_in_order.reserve(alignments.size());
+    for (size_t i = 0; i < alignments.size(); i++) {
+        alignments_in_order.push_back(i);
+    }
+    
+    // Sort again by actual score instead of extennsion score
+    std::sort(alignments_in_order.begin(), alignments_in_order.end(), [&](const size_t& a, const size_t& b) -> bool {
+        // Return true if a must come before b (i.e. it has a larger score)
+        return alignments[a].score() > alignments[b].score();
+    });
+    
+#ifdef INSTRUMENT_MAPPING
+    // Now say we are finding the winner(s)
+    funnel.stage("winner");
 #endif
-
-    size_t rejected_count = 0;
-    for (size_t i = 0; i < minimizers.size(); i++) {
-        // For each minimizer
+    
+    vector<Alignment> mappings;
+    mappings.reserve(min(alignments_in_order.size(), max_multimaps));
+    for (size_t i = 0; i < alignments_in_order.size() && i < max_multimaps; i++) {
+        // For each output slot, fill it with the alignment at that rank if available.
+        size_t& alignment_num = alignments_in_order[i];
+        mappings.emplace_back(std::move(alignments[alignment_num]));
         
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
-        // Say we're working on it
-        funnel.processing_input(i);
+        // Tell the funnel
+        funnel.project(alignment_num);
+        funnel.score(alignment_num, mappings.back().score());
 #endif
 #endif
-        
-        if (hit_cap == 0 || minimizer_index->count(minimizers[i]) <= hit_cap) {
-            // The minimizer is infrequent enough to be informative, so feed it into clustering
-            
-            // How many seeds were there before now?
-            size_t seeds_before = seeds.size();
-            
-            // Locate it in the graph
-            for (auto& hit : minimizer_index->find(minimizers[i])) {
-                // Reverse the hits for a reverse minimizer
-                if (minimizers[i].is_reverse) {
-                    size_t node_length = extender.graph->get_length(extender.graph->get_handle(id(hit)));
-                    hit = reverse_base_pos(hit, node_length);
-                }
-                // For each position, remember it and what minimizer it came from
-                seeds.push_back(hit);
-                seed_to_source.push_back(i);
-            }
-            
+    }
+
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
-            // Record in the funnel that this minimizer gave rise to these seeds.
-            funnel.expand(i, seeds.size() - seeds_before);
+    if (max_multimaps < alignments_in_order.size()) {
+        // Some things stop here
+        funnel.kill_all(alignments_in_order.begin() + max_multimaps, alignments_in_order.end());
+    }
 #endif
+    
+    funnel.substage("mapq");
 #endif
+    
+    // Grab all the scores for MAPQ computation.
+    vector<double> scores;
+    scores.reserve(alignments.size());
+    for (size_t i = 0; i < mappings.size(); i++) {
+        // Grab the scores of the alignments we are outputting
+        scores.push_back(mappings[i].score());
+    }
+    for (size_t i = mappings.size(); i < alignments_in_order.size(); i++) {
+        // And of the alignments we aren't
+        scores.push_back(alignments[alignments_in_order[i]].score());
+    }
+        
+#ifdef debug
+    cerr << "For scores ";
+    for (auto& score : scores) cerr << score << " ";
+#endif
+
+    size_t winning_index;
+    double mapq = get_regular_aligner()->maximum_mapping_quality_exact(scores, &winning_index);
+    
+#ifdef debug
+    cerr << "MAPQ is " << mapq << endl;
+#endif
+        
+    // Make sure to clamp 0-60.
+    mappings.front().set_mapping_quality(max(min(mapq, 60.0), 0.0));
+    
+#ifdef INSTRUMENT_MAPPING
+    funnel.substage_stop();
+#endif
+    
+    for (size_t i = 0; i < mappings.size(); i++) {
+        // For each output alignment in score order
+        auto& out = mappings[i];
+        
+        // Assign primary and secondary status
+        out.set_is_secondary(i > 0);
+    }
+    
+    // Count and annotate the work limits we hit
+    finish_budget(budget, mappings[0]);
+    
+    // Stop timing with the funnel
+    funnel.stop();
+    
+    // Annotate with total, stage, and substage runtimes.
+    // If we didn't record stages, we just get the total.
+    funnel.for_each_time([&](const string& stage, const string& substage, double seconds) {
+        if (stage == "") {
+            // Overall runtime
+            set_annotation(mappings[0], "map_seconds", seconds);
         } else {
-            // The minimizer is too frequent
-            rejected_count++;
-            
+            if (substage == "") {
+                // Overall time for this stage
+                set_annotation(mappings[0], "stage_" + stage + "_seconds", seconds);
+            } else {
+                // Time for just this substage
+                set_annotation(mappings[0], "stage_" + stage + "_" + substage + "_seconds", seconds);
+            }
+        }
+    });
+
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
-            // Record in the funnel thast we rejected it
-            funnel.kill(i);
+#ifdef TRACK_CORRECTNESS
+    // And with the last stage at which we had any descendants of the correct seed hit locations
+    set_annotation(mappings[0], "last_correct_stage", funnel.last_correct_stage());
+#endif
 #endif
 #endif
+    
+    // Ship out all the aligned alignments
+    alignment_emitter.emit_mapped_single(std::move(mappings));
+
+#ifdef debug
+    // Dump the funnel info graph.
+    funnel.to_dot(cerr);
+#endif
+}
+
+void MinimizerMapper::map_paired(Alignment& aln1, Alignment& aln2, AlignmentEmitter& alignment_emitter) {
+    // Each mate gets its own funnel, so each can be annotated with its own times.
+    array<Alignment*, 2> mates {&aln1, &aln2};
+    array<Funnel, 2> funnels;
+    
+    // This will hold all the minimizers in each mate
+    array<vector<MinimizerIndex::minimizer_type>, 2> minimizers;
+    // We will find all the seed hits for each mate
+    array<vector<pos_t>, 2> seeds;
+    // And this will map from seed to minimizer that generated it, per mate
+    array<vector<size_t>, 2> seed_to_source;
+    // And each mate only gets to do so much work
+    array<WorkBudget, 2> budgets {start_budget(), start_budget()};
+    
+    for (size_t mate = 0; mate < 2; mate++) {
+        funnels[mate].start(mates[mate]->name());
+        
+        // Annotate the original read with metadata
+        if (!sample_name.empty()) {
+            mates[mate]->set_sample_name(sample_name);
+        }
+        if (!read_group.empty()) {
+            mates[mate]->set_read_group(read_group);
         }
         
+        find_seeds(*mates[mate], minimizers[mate], seeds[mate], seed_to_source[mate], budgets[mate], funnels[mate]);
+    }
+    
+    // Cluster each mate's seeds at read scale, and all the seeds together at
+    // fragment scale. Each read cluster lands entirely in one fragment cluster,
+    // because the fragment distance limit is the larger one.
+    array<vector<vector<size_t>>, 2> clusters;
+    for (size_t mate = 0; mate < 2; mate++) {
 #ifdef INSTRUMENT_MAPPING
-#ifdef TRACK_PROVENANCE
-        // Say we're done with this input item
-        funnel.processed_input();
+        funnels[mate].stage("cluster");
 #endif
+        clusters[mate] = clusterer.cluster_seeds(seeds[mate], distance_limit, *snarl_manager, *distance_index);
+    }
+    
+    vector<pos_t> all_seeds;
+    all_seeds.reserve(seeds[0].size() + seeds[1].size());
+    all_seeds.insert(all_seeds.end(), seeds[0].begin(), seeds[0].end());
+    all_seeds.insert(all_seeds.end(), seeds[1].begin(), seeds[1].end());
+    vector<vector<size_t>> fragment_clusters = clusterer.cluster_seeds(all_seeds, max(fragment_distance_limit, distance_limit),
+        *snarl_manager, *distance_index);
+    
+    // Work out which fragment cluster each seed ended up in
+    vector<size_t> seed_fragment(all_seeds.size(), numeric_limits<size_t>::max());
+    for (size_t i = 0; i < fragment_clusters.size(); i++) {
+        for (auto& seed_index : fragment_clusters[i]) {
+            seed_fragment[seed_index] = i;
+        }
+    }
+    
+#ifdef debug
+    cerr << "Found " << fragment_clusters.size() << " fragment clusters" << endl;
 #endif
+    
+    // Align each mate, and remember the fragment cluster each alignment came from.
+    array<vector<Alignment>, 2> alignments;
+    array<vector<size_t>, 2> alignment_fragments;
+    for (size_t mate = 0; mate < 2; mate++) {
+        vector<size_t> alignment_clusters;
+        // Pair MAPQ depends on both mates, so one mate's MAPQ being settled
+        // is no reason to stop aligning it.
+        alignments[mate] = align_clusters(*mates[mate], clusters[mate], minimizers[mate], seeds[mate], seed_to_source[mate],
+            false, budgets[mate], funnels[mate], alignment_clusters);
+        
+        // Mate 2's seeds come after mate 1's in the fragment clustering
+        size_t seed_offset = mate == 0 ? 0 : seeds[0].size();
+        for (auto& cluster_num : alignment_clusters) {
+            if (cluster_num == numeric_limits<size_t>::max() || clusters[mate][cluster_num].empty()) {
+                alignment_fragments[mate].push_back(numeric_limits<size_t>::max());
+            } else {
+                alignment_fragments[mate].push_back(seed_fragment[seed_offset + clusters[mate][cluster_num].front()]);
+            }
+        }
     }
-
+    
 #ifdef INSTRUMENT_MAPPING
-#ifdef TRACK_PROVENANCE
-#ifdef TRACK_CORRECTNESS
-    // Tag seeds with correctness based on proximity along paths to the input read's refpos
-    funnel.substage("correct");
+    for (auto& funnel : funnels) {
+        funnel.stage("pair");
+    }
+#endif
     
-    if (aln.refpos_size() != 0) {
-        // Take the first refpos as the true position.
-        auto& true_pos = aln.refpos(0);
-        
-        for (size_t i = 0; i < seeds.size(); i++) {
-            // Find every seed's reference positions. This maps from path name to pairs of offset and orientation.
-            auto offsets = xg_index->nearest_offsets_in_paths(seeds[i], 100);
-            for (auto& hit_pos : offsets[true_pos.name()]) {
-                // Look at all the ones on the path the read's true position is on.
-                if (abs((int64_t)hit_pos.first - (int64_t) true_pos.offset()) < 200) {
-                    // Call this seed hit close enough to be correct
-                    funnel.tag_correct(i);
-                }
+    // Pair up alignments of the two mates from the same fragment cluster, if
+    // they face each other the way the library was sequenced.
+    // Each pair is the index of the alignment of mate 1, then of mate 2.
+    vector<pair<size_t, size_t>> paired_alignments;
+    vector<double> paired_scores;
+    // Remember which alignments found a partner
+    array<vector<bool>, 2> is_paired {vector<bool>(alignments[0].size()), vector<bool>(alignments[1].size())};
+    
+    auto try_pair = [&](size_t i, size_t j) {
+        // Pair up alignment i of mate 1 and alignment j of mate 2 if they are properly oriented.
+        auto& alignment1 = alignments[0][i];
+        auto& alignment2 = alignments[1][j];
+        double score = pair_score(alignment1, alignment2);
+        if (!std::isnan(score)) {
+            paired_alignments.emplace_back(i, j);
+            paired_scores.push_back(score);
+            is_paired[0][i] = true;
+            is_paired[1][j] = true;
+        }
+    };
+    
+    for (size_t i = 0; i < alignments[0].size(); i++) {
+        for (size_t j = 0; j < alignments[1].size(); j++) {
+            if (alignment_fragments[0][i] != numeric_limits<size_t>::max() &&
+                alignment_fragments[0][i] == alignment_fragments[1][j]) {
+                try_pair(i, j);
             }
         }
     }
+    
+    // Rescue the other mate near the best alignments that didn't find a partner.
+    for (size_t mate = 0; mate < 2; mate++) {
+        size_t other = 1 - mate;
+        
+        // Look at the alignments of this mate in score order
+        vector<size_t> alignments_in_order;
+        for (size_t i = 0; i < alignments[mate].size(); i++) {
+            alignments_in_order.push_back(i);
+        }
+        std::sort(alignments_in_order.begin(), alignments_in_order.end(), [&](const size_t& a, const size_t& b) -> bool {
+            return alignments[mate][a].score() > alignments[mate][b].score();
+        });
+        
+        size_t attempts = 0;
+        for (size_t i = 0; i < alignments_in_order.size() && attempts < max_rescue_attempts; i++) {
+            size_t anchor_num = alignments_in_order[i];
+            if (is_paired[mate][anchor_num] || alignments[mate][anchor_num].path().mapping_size() == 0) {
+                // Already paired or not aligned
+                continue;
+            }
+            attempts++;
+            
+#ifdef INSTRUMENT_MAPPING
+            funnels[other].substage("rescue");
 #endif
+            
+            Alignment rescued = *mates[other];
+            if (rescue_mate(alignments[mate][anchor_num], mate == 0, *mates[other], minimizers[other], rescued,
+                budgets[other], funnels[other])) {
+                set_annotation(rescued, "rescued", true);
+                alignments[other].emplace_back(std::move(rescued));
+                alignment_fragments[other].push_back(alignment_fragments[mate][anchor_num]);
+                is_paired[other].push_back(false);
+                
+                size_t rescued_num = alignments[other].size() - 1;
+                if (mate == 0) {
+                    try_pair(anchor_num, rescued_num);
+                } else {
+                    try_pair(rescued_num, anchor_num);
+                }
+            }
+            
+#ifdef INSTRUMENT_MAPPING
+            funnels[other].substage_stop();
 #endif
+        }
+    }
+    
+#ifdef INSTRUMENT_MAPPING
+    for (auto& funnel : funnels) {
+        funnel.stage("winner");
+    }
 #endif
+    
+    // These will hold the output alignments for each mate, in pair rank order.
+    vector<Alignment> mappings1;
+    vector<Alignment> mappings2;
+    
+    if (!paired_alignments.empty()) {
+        // Order the pairs by combined score
+        vector<size_t> pairs_in_order;
+        for (size_t i = 0; i < paired_alignments.size(); i++) {
+            pairs_in_order.push_back(i);
+        }
+        std::sort(pairs_in_order.begin(), pairs_in_order.end(), [&](const size_t& a, const size_t& b) -> bool {
+            return paired_scores[a] > paired_scores[b];
+        });
+        
+        for (size_t i = 0; i < pairs_in_order.size() && i < max_multimaps; i++) {
+            // Copy, because the same alignment of one mate may be in several pairs
+            auto& paired = paired_alignments[pairs_in_order[i]];
+            mappings1.push_back(alignments[0][paired.first]);
+            mappings2.push_back(alignments[1][paired.second]);
+        }
+        
+        // Compute MAPQ from all the pair scores, in rank order
+        vector<double> scores;
+        scores.reserve(pairs_in_order.size());
+        for (auto& pair_num : pairs_in_order) {
+            scores.push_back(paired_scores[pair_num]);
+        }
+        size_t winning_index;
+        double mapq = get_regular_aligner()->maximum_mapping_quality_exact(scores, &winning_index);
         
 #ifdef debug
-    cerr << "Read " << aln.name() << ": " << aln.sequence() << endl;
-    cerr << "Found " << seeds.size() << " seeds from " << (minimizers.size() - rejected_count) << " minimizers, rejected " << rejected_count << endl;
+        cerr << "Pair MAPQ is " << mapq << endl;
 #endif
+        
+        // Make sure to clamp 0-60.
+        mappings1.front().set_mapping_quality(max(min(mapq, 60.0), 0.0));
+        mappings2.front().set_mapping_quality(max(min(mapq, 60.0), 0.0));
+    } else {
+        // Nothing pairs, so send out each mate's best alignment on its own.
+        array<vector<Alignment>*, 2> mappings {&mappings1, &mappings2};
+        for (size_t mate = 0; mate < 2; mate++) {
+            vector<double> scores;
+            size_t best = 0;
+            for (size_t i = 0; i < alignments[mate].size(); i++) {
+                scores.push_back(alignments[mate][i].score());
+                if (alignments[mate][i].score() > alignments[mate][best].score()) {
+                    best = i;
+                }
+            }
+            // Put the best one first for MAPQ
+            std::swap(scores[0], scores[best]);
+            size_t winning_index;
+            double mapq = get_regular_aligner()->maximum_mapping_quality_exact(scores, &winning_index);
+            
+            mappings[mate]->emplace_back(std::move(alignments[mate][best]));
+            mappings[mate]->front().set_mapping_quality(max(min(mapq, 60.0), 0.0));
+        }
+    }
+    
+    for (size_t i = 0; i < mappings1.size(); i++) {
+        // Link up the mates and assign primary and secondary status
+        mappings1[i].mutable_fragment_next()->set_name(aln2.name());
+        mappings2[i].mutable_fragment_prev()->set_name(aln1.name());
+        mappings1[i].set_is_secondary(i > 0);
+        mappings2[i].set_is_secondary(i > 0);
+    }
+    
+    array<Alignment*, 2> primaries {&mappings1.front(), &mappings2.front()};
+    for (size_t mate = 0; mate < 2; mate++) {
+        // Count and annotate the work limits we hit
+        finish_budget(budgets[mate], *primaries[mate]);
+        
+        // Stop timing with the funnel
+        funnels[mate].stop();
+        
+        // Annotate with total, stage, and substage runtimes.
+        funnels[mate].for_each_time([&](const string& stage, const string& substage, double seconds) {
+            if (stage == "") {
+                // Overall runtime
+                set_annotation(*primaries[mate], "map_seconds", seconds);
+            } else {
+                if (substage == "") {
+                    // Overall time for this stage
+                    set_annotation(*primaries[mate], "stage_" + stage + "_seconds", seconds);
+                } else {
+                    // Time for just this substage
+                    set_annotation(*primaries[mate], "stage_" + stage + "_" + substage + "_seconds", seconds);
+                }
+            }
+        });
+    }
+    
+    // Ship out the pairs
+    alignment_emitter.emit_mapped_pair(std::move(mappings1), std::move(mappings2), fragment_distance_limit);
+}
 
-#ifdef INSTRUMENT_MAPPING
-    // Begin the clustering stage
-    funnel.stage("cluster");
+bool MinimizerMapper::rescue_mate(const Alignment& anchor, bool anchor_is_first, const Alignment& mate,
+    const vector<MinimizerIndex::minimizer_type>& mate_minimizers, Alignment& out, WorkBudget& budget, Funnel& funnel) const {
+
+    pos_t anchor_pos = initial_position(anchor.path());
+    
+    // Find all the mate's seed hits in the neighborhood of the anchor
+    vector<pair<size_t, pos_t>> seed_matchings;
+    for (auto& minimizer : mate_minimizers) {
+        // Look the minimizer up once, without copying its occurrences
+        MinimizerIndex::occurrence_view occs = minimizer_index->occurrences(minimizer);
+        if (rescue_hit_cap != 0 && occs.size() > rescue_hit_cap) {
+            // Too frequent even for rescue
+            continue;
+        }
+        for (MinimizerIndex::code_type code : occs) {
+            pos_t hit = MinimizerIndex::decode(code);
+            // Reverse the hits for a reverse minimizer
+            if (minimizer.is_reverse) {
+                size_t node_length = extender.graph->get_length(extender.graph->get_handle(id(hit)));
+                hit = reverse_base_pos(hit, node_length);
+            }
+            // The hit is part of the fragment if mate 1 reaches it on the
+            // other strand, so it takes one oriented distance lookup.
+            int64_t distance = anchor_is_first ? fragment_length(anchor_pos, hit) : fragment_length(hit, anchor_pos);
+            if (distance != -1 && distance <= (int64_t) fragment_distance_limit) {
+                seed_matchings.emplace_back(minimizer.offset, hit);
+            }
+        }
+    }
+    
+#ifdef debug
+    cerr << "Rescuing " << mate.name() << " from " << seed_matchings.size() << " nearby seeds" << endl;
 #endif
-        
-    // Cluster the seeds. Get sets of input seed indexes that go together.
-    vector<vector<size_t>> clusters = clusterer.cluster_seeds(seeds, distance_limit, *snarl_manager, *distance_index);
     
+    if (seed_matchings.empty()) {
+        return false;
+    }
+    
+    // Extend the nearby hits and align what we get
+    vector<GaplessExtension> extensions = extender.extend(seed_matchings, mate.sequence());
+    int score_estimate = estimate_extension_group_score(mate, extensions);
+    if (score_estimate <= 0) {
+        return false;
+    }
+    
+    out.clear_path();
+    out.set_score(0);
+    out.set_identity(0);
+    align_extensions(mate, extensions, score_estimate, out, budget, funnel);
+    
+    return out.path().mapping_size() != 0 && out.score() > 0;
+}
+
+int64_t MinimizerMapper::fragment_length(const pos_t& mate1_start, const pos_t& mate2_start) const {
+    // Mate 2 is read from the other strand, so the fragment ends where the
+    // reverse complement of mate 2 ends, which is its start flipped over.
+    size_t mate2_length = extender.graph->get_length(extender.graph->get_handle(id(mate2_start)));
+    return distance_index->minDistance(mate1_start, reverse_base_pos(mate2_start, mate2_length));
+}
+
+double MinimizerMapper::fragment_length_log_likelihood(int64_t length) const {
+    double dev = length - fragment_length_mean;
+    return -dev * dev / (2.0 * fragment_length_stdev * fragment_length_stdev);
+}
+
+double MinimizerMapper::pair_score(const Alignment& aln1, const Alignment& aln2) const {
+    if (aln1.path().mapping_size() == 0 || aln2.path().mapping_size() == 0) {
+        return numeric_limits<double>::quiet_NaN();
+    }
+    int64_t length = fragment_length(initial_position(aln1.path()), initial_position(aln2.path()));
+    if (length == -1) {
+        // The mates do not face each other
+        return numeric_limits<double>::quiet_NaN();
+    }
+    // Convert the log likelihood of the fragment length to alignment score units
+    return aln1.score() + aln2.score() + fragment_length_log_likelihood(length) / get_regular_aligner()->log_base;
+}
+
+vector<Alignment> MinimizerMapper::align_clusters(Alignment& aln, const vector<vector<size_t>>& clusters,
+    const vector<MinimizerIndex::minimizer_type>& minimizers, const vector<pos_t>& seeds, const vector<size_t>& seed_to_source,
+    bool may_stop_at_mapq_cap, WorkBudget& budget, Funnel& funnel, vector<size_t>& alignment_clusters) const {
+
 #ifdef INSTRUMENT_MAPPING
     funnel.substage("score");
 #endif
@@ -188,37 +629,7 @@ void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
 #endif
         
         // Score the cluster in read coverage.
-        
-        // We set bits in here to true when query anchors cover them
-        vector<bool> covered(aln.sequence().size());
-        // We use this to convert iterators to indexes
-        auto start = aln.sequence().begin();
-        
-        for (auto& hit_index : cluster) {
-            // For each hit in the cluster, work out what anchor sequence it is from.
-            size_t source_index = seed_to_source.at(hit_index);
-
-            // The offset of a reverse minimizer is the endpoint of the kmer
-            size_t start_offset = minimizers[source_index].offset;
-            if (minimizers[source_index].is_reverse) {
-                start_offset = start_offset + 1 - minimizer_index->k();
-            }
-            
-            for (size_t i = start_offset; i < start_offset + minimizer_index->k(); i++) {
-                // Set all the bits in read space for that minimizer.
-                // Each minimizr is a length-k exact match starting at a position
-                covered[i] = true;
-            }
-        }
-        
-        // Count up the covered positions
-        size_t covered_count = 0;
-        for (auto bit : covered) {
-            covered_count += bit;
-        }
-        
-        // Turn that into a fraction
-        read_coverage_by_cluster.push_back(covered_count / (double) covered.size());
+        read_coverage_by_cluster.push_back(cluster_coverage(aln, cluster, minimizers, seed_to_source));
         
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
@@ -262,13 +673,29 @@ void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
         // For each cluster, in sorted order
         size_t& cluster_num = cluster_indexes_in_order[i];
         
+        if (i >= 2 && min_cluster_coverage_fraction > 0 && read_coverage_by_cluster[cluster_num] <
+            min_cluster_coverage_fraction * read_coverage_by_cluster[cluster_indexes_in_order[0]]) {
+            // Always extend the first and second. Past that, a cluster covering
+            // so much less of the read than the best one won't affect the
+            // result, and neither will any after it.
+            budget.clusters_limited = true;
+            
+#ifdef INSTRUMENT_MAPPING
+#ifdef TRACK_PROVENANCE
+            funnel.kill_all(cluster_indexes_in_order.begin() + i, cluster_indexes_in_order.end());
+#endif
+#endif
+            
+            break;
+        }
+        
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
         funnel.processing_input(cluster_num);
 #endif
 #endif
 
-        vector<size_t>& cluster = clusters[cluster_num];
+        const vector<size_t>& cluster = clusters[cluster_num];
 
 #ifdef debug
         cerr << "Cluster " << cluster_num << " rank " << i << ": " << endl;
@@ -376,64 +803,32 @@ void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
 
         auto& extensions = cluster_extensions[extension_num];
         
+        if (i >= 2 && may_stop_at_mapq_cap && mapq_is_settled(alignments, cluster_extension_scores,
+            extension_indexes_in_order.begin() + i, extension_indexes_in_order.begin() + min(extension_indexes_in_order.size(), max_alignments))) {
+            // Even if everything left aligned as well as estimated, the MAPQ
+            // of the best alignment would stay at the cap. Don't do any more.
+            budget.stopped_at_mapq_cap = true;
+            
+#ifdef INSTRUMENT_MAPPING
+#ifdef TRACK_PROVENANCE
+            funnel.kill_all(extension_indexes_in_order.begin() + i, extension_indexes_in_order.end());
+            funnel.processed_input();
+#endif
+#endif
+            
+            break;
+        }
+        
         if (i < 2 || score_is_significant(cluster_extension_scores[extension_num], best_score, second_best_score)) {
             // Always take the first and second.
             // For later ones, check if this score is significant relative to the running best and second best scores.
             
             // If so, get an Alignment out of it somehow, and throw it in.
             alignments.emplace_back(aln);
+            alignment_clusters.push_back(cluster_indexes_in_order[extension_num]);
             Alignment& out = alignments.back();
             
-            if (extensions.size() == 1 && extensions[0].full()) {
-                // We got a full-length extension, so directly convert to an Alignment.
-                
-#ifdef INSTRUMENT_MAPPING
-                funnel.substage("direct");
-#endif
-
-                *out.mutable_path() = extensions[0].path;
-                
-                // The score estimate is exact.
-                int alignment_score = cluster_extension_scores[extension_num];
-                
-                // Compute identity from mismatch count.
-                size_t mismatch_count = extensions[0].mismatches();
-                double identity = out.sequence().size() == 0 ? 0.0 : (out.sequence().size() - mismatch_count) / (double) out.sequence().size();
-                
-                // Fill in the score and identity
-                out.set_score(alignment_score);
-                out.set_identity(identity);
-                
-#ifdef INSTRUMENT_MAPPING
-                // Stop the timer on the current substage
-                funnel.substage_stop();
-#endif
-            } else if (do_chaining) {
-                // We need to do chaining.
-                
-#ifdef INSTRUMENT_MAPPING
-                funnel.substage("chain");
-#endif
-                
-                // Sort the extended seeds by read start position.
-                // TODO: Score estimation may have sorted them already.
-                std::sort(extensions.begin(), extensions.end(), [&](const GaplessExtension& a, const GaplessExtension& b) -> bool {
-                    // Return true if a needs to come before b.
-                    // This will happen if a is earlier in the read than b.
-                    return a.core_interval.first < b.core_interval.first;
-                });
-                
-                // Do the chaining and compute an alignment into out.
-                chain_extended_seeds(aln, extensions, out);
-                
-#ifdef INSTRUMENT_MAPPING
-                // We're done chaining. Next alignment may not go through this substage.
-                funnel.substage_stop();
-#endif
-            } else {
-                // We would do chaining but it is disabled.
-                // Leave out unaligned
-            }
+            align_extensions(aln, extensions, cluster_extension_scores[extension_num], out, budget, funnel);
             
             // Update the running best and second best scores.
             if (out.score() > best_score) {
@@ -471,6 +866,7 @@ void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
     if (alignments.size() == 0) {
         // Produce an unaligned Alignment
         alignments.emplace_back(aln);
+        alignment_clusters.push_back(numeric_limits<size_t>::max());
         
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
@@ -480,126 +876,239 @@ void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
 #endif
     }
     
-    // Order the Alignments by score
-    vector<size_t> alignments_in_order;
-    alignments_in_order.reserve(alignments.size());
-    for (size_t i = 0; i < alignments.size(); i++) {
-        alignments_in_order.push_back(i);
-    }
+    return alignments;
+}
+
+void MinimizerMapper::find_seeds(const Alignment& aln, vector<MinimizerIndex::minimizer_type>& minimizers,
+    vector<pos_t>& seeds, vector<size_t>& seed_to_source, WorkBudget& budget, Funnel& funnel) const {
+
+#ifdef INSTRUMENT_MAPPING
+    // Start the minimizer finding stage
+    funnel.stage("minimizer");
+#endif
     
-    // Sort again by actual score instead of extennsion score
-    std::sort(alignments_in_order.begin(), alignments_in_order.end(), [&](const size_t& a, const size_t& b) -> bool {
-        // Return true if a must come before b (i.e. it has a larger score)
-        return alignments[a].score() > alignments[b].score();
-    });
+    // Find minimizers in the query
+    minimizers = minimizer_index->minimizers(aln.sequence());
     
 #ifdef INSTRUMENT_MAPPING
-    // Now say we are finding the winner(s)
-    funnel.stage("winner");
+#ifdef TRACK_PROVENANCE
+    // Record how many we found, as new lines.
+    funnel.introduce(minimizers.size());
 #endif
     
-    vector<Alignment> mappings;
-    mappings.reserve(min(alignments_in_order.size(), max_multimaps));
-    for (size_t i = 0; i < alignments_in_order.size() && i < max_multimaps; i++) {
-        // For each output slot, fill it with the alignment at that rank if available.
-        size_t& alignment_num = alignments_in_order[i];
-        mappings.emplace_back(std::move(alignments[alignment_num]));
+    // Start the minimizer locating stage
+    funnel.stage("seed");
+#endif
+
+    // Look each minimizer up once, without copying its occurrences, and see
+    // which ones are infrequent enough to be informative.
+    vector<MinimizerIndex::occurrence_view> occurrences;
+    occurrences.reserve(minimizers.size());
+    vector<bool> admitted(minimizers.size(), false);
+    vector<size_t> informative;
+    size_t informative_hits = 0;
+    for (size_t i = 0; i < minimizers.size(); i++) {
+        occurrences.push_back(minimizer_index->occurrences(minimizers[i]));
+        if (hit_cap == 0 || occurrences.back().size() <= hit_cap) {
+            admitted[i] = true;
+            informative.push_back(i);
+            informative_hits += occurrences.back().size();
+        }
+    }
+    
+    if (informative_hits > budget.seeds_left) {
+        // We can't afford all the hits, so take the minimizers with the fewest hits first.
+        std::stable_sort(informative.begin(), informative.end(), [&](const size_t& a, const size_t& b) -> bool {
+            return occurrences[a].size() < occurrences[b].size();
+        });
+        for (auto& i : informative) {
+            if (occurrences[i].size() <= budget.seeds_left) {
+                budget.seeds_left -= occurrences[i].size();
+            } else {
+                admitted[i] = false;
+            }
+        }
+        budget.seeds_limited = true;
+    } else {
+        budget.seeds_left -= informative_hits;
+    }
+
+    size_t rejected_count = 0;
+    for (size_t i = 0; i < minimizers.size(); i++) {
+        // For each minimizer
         
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
-        // Tell the funnel
-        funnel.project(alignment_num);
-        funnel.score(alignment_num, mappings.back().score());
+        // Say we're working on it
+        funnel.processing_input(i);
+#endif
+#endif
+        
+        const MinimizerIndex::occurrence_view& occs = occurrences[i];
+        
+        if (admitted[i]) {
+            // The minimizer is infrequent enough to be informative, so feed it into clustering
+            
+            // How many seeds were there before now?
+            size_t seeds_before = seeds.size();
+            
+            // Locate it in the graph
+            for (MinimizerIndex::code_type code : occs) {
+                pos_t hit = MinimizerIndex::decode(code);
+                // Reverse the hits for a reverse minimizer
+                if (minimizers[i].is_reverse) {
+                    size_t node_length = extender.graph->get_length(extender.graph->get_handle(id(hit)));
+                    hit = reverse_base_pos(hit, node_length);
+                }
+                // For each position, remember it and what minimizer it came from
+                seeds.push_back(hit);
+                seed_to_source.push_back(i);
+            }
+            
+#ifdef INSTRUMENT_MAPPING
+#ifdef TRACK_PROVENANCE
+            // Record in the funnel that this minimizer gave rise to these seeds.
+            funnel.expand(i, seeds.size() - seeds_before);
+#endif
+#endif
+        } else {
+            // The minimizer is too frequent, or we ran out of seed budget
+            rejected_count++;
+            
+#ifdef INSTRUMENT_MAPPING
+#ifdef TRACK_PROVENANCE
+            // Record in the funnel thast we rejected it
+            funnel.kill(i);
+#endif
+#endif
+        }
+        
+#ifdef INSTRUMENT_MAPPING
+#ifdef TRACK_PROVENANCE
+        // Say we're done with this input item
+        funnel.processed_input();
 #endif
 #endif
     }
 
 #ifdef INSTRUMENT_MAPPING
 #ifdef TRACK_PROVENANCE
-    if (max_multimaps < alignments_in_order.size()) {
-        // Some things stop here
-        funnel.kill_all(alignments_in_order.begin() + max_multimaps, alignments_in_order.end());
+#ifdef TRACK_CORRECTNESS
+    // Tag seeds with correctness based on proximity along paths to the input read's refpos
+    funnel.substage("correct");
+    
+    if (aln.refpos_size() != 0) {
+        // Take the first refpos as the true position.
+        auto& true_pos = aln.refpos(0);
+        
+        for (size_t i = 0; i < seeds.size(); i++) {
+            // Find every seed's reference positions. This maps from path name to pairs of offset and orientation.
+            auto offsets = xg_index->nearest_offsets_in_paths(seeds[i], 100);
+            for (auto& hit_pos : offsets[true_pos.name()]) {
+                // Look at all the ones on the path the read's true position is on.
+                if (abs((int64_t)hit_pos.first - (int64_t) true_pos.offset()) < 200) {
+                    // Call this seed hit close enough to be correct
+                    funnel.tag_correct(i);
+                }
+            }
+        }
     }
 #endif
-    
-    funnel.substage("mapq");
 #endif
-    
-    // Grab all the scores for MAPQ computation.
-    vector<double> scores;
-    scores.reserve(alignments.size());
-    for (size_t i = 0; i < mappings.size(); i++) {
-        // Grab the scores of the alignments we are outputting
-        scores.push_back(mappings[i].score());
-    }
-    for (size_t i = mappings.size(); i < alignments_in_order.size(); i++) {
-        // And of the alignments we aren't
-        scores.push_back(alignments[alignments_in_order[i]].score());
-    }
+#endif
         
 #ifdef debug
-    cerr << "For scores ";
-    for (auto& score : scores) cerr << score << " ";
+    cerr << "Read " << aln.name() << ": " << aln.sequence() << endl;
+    cerr << "Found " << seeds.size() << " seeds from " << (minimizers.size() - rejected_count) << " minimizers, rejected " << rejected_count << endl;
 #endif
+}
 
-    size_t winning_index;
-    double mapq = get_regular_aligner()->maximum_mapping_quality_exact(scores, &winning_index);
-    
-#ifdef debug
-    cerr << "MAPQ is " << mapq << endl;
-#endif
-        
-    // Make sure to clamp 0-60.
-    mappings.front().set_mapping_quality(max(min(mapq, 60.0), 0.0));
-    
-#ifdef INSTRUMENT_MAPPING
-    funnel.substage_stop();
-#endif
+double MinimizerMapper::cluster_coverage(const Alignment& aln, const vector<size_t>& cluster,
+    const vector<MinimizerIndex::minimizer_type>& minimizers, const vector<size_t>& seed_to_source) const {
+
+    // We set bits in here to true when query anchors cover them
+    vector<bool> covered(aln.sequence().size());
     
-    for (size_t i = 0; i < mappings.size(); i++) {
-        // For each output alignment in score order
-        auto& out = mappings[i];
+    for (auto& hit_index : cluster) {
+        // For each hit in the cluster, work out what anchor sequence it is from.
+        size_t source_index = seed_to_source.at(hit_index);
+
+        // The offset of a reverse minimizer is the endpoint of the kmer
+        size_t start_offset = minimizers[source_index].offset;
+        if (minimizers[source_index].is_reverse) {
+            start_offset = start_offset + 1 - minimizer_index->k();
+        }
         
-        // Assign primary and secondary status
-        out.set_is_secondary(i > 0);
+        for (size_t i = start_offset; i < start_offset + minimizer_index->k(); i++) {
+            // Set all the bits in read space for that minimizer.
+            // Each minimizr is a length-k exact match starting at a position
+            covered[i] = true;
+        }
     }
     
-    // Stop timing with the funnel
-    funnel.stop();
+    // Count up the covered positions
+    size_t covered_count = 0;
+    for (auto bit : covered) {
+        covered_count += bit;
+    }
     
-    // Annotate with total, stage, and substage runtimes.
-    // If we didn't record stages, we just get the total.
-    funnel.for_each_time([&](const string& stage, const string& substage, double seconds) {
-        if (stage == "") {
-            // Overall runtime
-            set_annotation(mappings[0], "map_seconds", seconds);
-        } else {
-            if (substage == "") {
-                // Overall time for this stage
-                set_annotation(mappings[0], "stage_" + stage + "_seconds", seconds);
-            } else {
-                // Time for just this substage
-                set_annotation(mappings[0], "stage_" + stage + "_" + substage + "_seconds", seconds);
-            }
-        }
-    });
+    // Turn that into a fraction
+    return covered_count / (double) covered.size();
+}
 
+void MinimizerMapper::align_extensions(const Alignment& aln, vector<GaplessExtension>& extensions, int score_estimate,
+    Alignment& out, WorkBudget& budget, Funnel& funnel) const {
+    
+    if (extensions.size() == 1 && extensions[0].full()) {
+        // We got a full-length extension, so directly convert to an Alignment.
+        
 #ifdef INSTRUMENT_MAPPING
-#ifdef TRACK_PROVENANCE
-#ifdef TRACK_CORRECTNESS
-    // And with the last stage at which we had any descendants of the correct seed hit locations
-    set_annotation(mappings[0], "last_correct_stage", funnel.last_correct_stage());
+        funnel.substage("direct");
 #endif
+
+        *out.mutable_path() = extensions[0].to_path(gbwt_graph, out.sequence());
+        
+        // The score estimate is exact.
+        int alignment_score = score_estimate;
+        
+        // Compute identity from mismatch count.
+        size_t mismatch_count = extensions[0].mismatches();
+        double identity = out.sequence().size() == 0 ? 0.0 : (out.sequence().size() - mismatch_count) / (double) out.sequence().size();
+        
+        // Fill in the score and identity
+        out.set_score(alignment_score);
+        out.set_identity(identity);
+        
+#ifdef INSTRUMENT_MAPPING
+        // Stop the timer on the current substage
+        funnel.substage_stop();
 #endif
+    } else if (do_chaining) {
+        // We need to do chaining.
+        
+#ifdef INSTRUMENT_MAPPING
+        funnel.substage("chain");
 #endif
-    
-    // Ship out all the aligned alignments
-    alignment_emitter.emit_mapped_single(std::move(mappings));
-
-#ifdef debug
-    // Dump the funnel info graph.
-    funnel.to_dot(cerr);
+        
+        // Sort the extended seeds by read start position.
+        // TODO: Score estimation may have sorted them already.
+        std::sort(extensions.begin(), extensions.end(), [&](const GaplessExtension& a, const GaplessExtension& b) -> bool {
+            // Return true if a needs to come before b.
+            // This will happen if a is earlier in the read than b.
+            return a.core_interval.first < b.core_interval.first;
+        });
+        
+        // Do the chaining and compute an alignment into out.
+        chain_extended_seeds(aln, extensions, out, budget);
+        
+#ifdef INSTRUMENT_MAPPING
+        // We're done chaining. Next alignment may not go through this substage.
+        funnel.substage_stop();
 #endif
+    } else {
+        // We would do chaining but it is disabled.
+        // Leave out unaligned
+    }
 }
 
 int MinimizerMapper::estimate_extension_group_score(const Alignment& aln, vector<GaplessExtension>& extended_seeds) const {
@@ -612,7 +1121,7 @@ int MinimizerMapper::estimate_extension_group_score(const Alignment& aln, vector
         // Compute a score using the Aligner, which handles all the full length bonuses and so on.
         // To do that we make a fake copy Alignment.
         Alignment temp = aln;
-        *temp.mutable_path() = extended_seeds[0].path;
+        *temp.mutable_path() = extended_seeds[0].to_path(gbwt_graph, aln.sequence());
         // TODO: have an implementation of this that takes a Path and a string and/or quality.
         // TODO: Just do this based on mismatch count and match count but with aligner score parameters.
         return get_regular_aligner()->score_ungapped_alignment(temp);
@@ -770,20 +1279,45 @@ bool MinimizerMapper::score_is_significant(int score_estimate, int best_score, i
     return false;
 }
 
-void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, Alignment& out) const {
+bool MinimizerMapper::mapq_is_settled(const vector<Alignment>& alignments, const vector<int>& score_estimates,
+    vector<size_t>::const_iterator unaligned_begin, vector<size_t>::const_iterator unaligned_end) const {
+    
+    vector<double> scores;
+    scores.reserve(alignments.size() + (unaligned_end - unaligned_begin));
+    for (auto& alignment : alignments) {
+        scores.push_back(alignment.score());
+    }
+    for (auto it = unaligned_begin; it != unaligned_end; ++it) {
+        scores.push_back(max(score_estimates[*it], 0));
+    }
+    if (scores.empty()) {
+        return false;
+    }
+    
+    size_t winning_index;
+    double mapq = get_regular_aligner()->maximum_mapping_quality_exact(scores, &winning_index);
+    // An unaligned group might still beat everything we have, so only an
+    // aligned winner can settle the MAPQ.
+    return winning_index < alignments.size() && mapq >= 60.0;
+}
+
+void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, Alignment& out,
+    WorkBudget& budget) const {
 
 #ifdef debug
     cerr << "Trying again to chain " << extended_seeds.size() << " extended seeds" << endl;
 #endif
 
-    // Find the paths between pairs of extended seeds that agree with haplotypes.
+    // Find the forests of haplotype-consistent walks between pairs of extended seeds, and out from the ends.
     // We don't actually need the read sequence for this, just the read length for longest gap computation.
     // The paths in the seeds know the hit length.
     // We assume all overlapping hits are exclusive.
-    unordered_map<size_t, unordered_map<size_t, vector<Path>>> paths_between_seeds = find_connecting_paths(extended_seeds,
-        aln.sequence().size());
+    // Some pairs of extended seeds also abut directly, besides having walks between them.
+    unordered_map<size_t, unordered_set<size_t>> direct_connections;
+    unordered_map<size_t, unordered_map<size_t, vector<TreeSubgraph::TreeNode>>> trees_between_seeds = find_connecting_trees(extended_seeds,
+        aln.sequence().size(), budget, direct_connections);
         
-    // We're going to record source and sink path count distributions, for debugging
+    // We're going to record source and sink haplotype count distributions, for debugging
     vector<double> tail_path_counts;
     
     // We're also going to record read sequence lengths for tails
@@ -791,6 +1325,25 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
     
     // And DP matrix areas for tails
     vector<double> tail_dp_areas;
+    
+    // We only get to fill so many DP cells for this read, over all its alignments
+    size_t& dp_cells_left = budget.dp_cells_left;
+    // Count the tails and gaps we had to simplify because we ran out
+    size_t dp_budget_fallbacks = 0;
+    
+    // Get the length of all the walks in a forest
+    auto forest_length = [](const vector<TreeSubgraph::TreeNode>& forest) -> size_t {
+        size_t length = 0;
+        for (auto& node : forest) {
+            length += node.length;
+        }
+        return length;
+    };
+    
+    // Get the lengths of backing nodes, for flipping Paths
+    auto node_length = [&](id_t id) -> size_t {
+        return gbwt_graph.get_length(gbwt_graph.get_handle(id));
+    };
 
     // Make a MultipathAlignment and feed in all the extended seeds as subpaths
     MultipathAlignment mp;
@@ -798,10 +1351,10 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
     transfer_read_metadata(aln, mp);
     for (auto& extended_seed : extended_seeds) {
         Subpath* s = mp.add_subpath();
-        // Copy in the path.
-        *s->mutable_path() = extended_seed.path;
+        // Build the path, which is the only time we make a Path for the extension.
+        *s->mutable_path() = extended_seed.to_path(gbwt_graph, aln.sequence());
         // Score it
-        s->set_score(get_regular_aligner()->score_partial_alignment(aln, gbwt_graph, extended_seed.path,
+        s->set_score(get_regular_aligner()->score_partial_alignment(aln, gbwt_graph, s->path(),
             aln.sequence().begin() + extended_seed.core_interval.first));
         // The position in the read it occurs at will be handled by the multipath topology.
         if (extended_seed.core_interval.first == 0) {
@@ -810,96 +1363,63 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
         }
     }
 
-    for (auto& kv : paths_between_seeds[numeric_limits<size_t>::max()]) {
+    for (auto& kv : trees_between_seeds[numeric_limits<size_t>::max()]) {
         // For each source extended seed
         const size_t& source = kv.first;
         
         // Grab the part of the read sequence that comes before it
         string before_sequence = aln.sequence().substr(0, extended_seeds[source].core_interval.first); 
         
+        // The forest goes left from the source, in the reverse orientation
+        size_t dp_area = before_sequence.size() * forest_length(kv.second);
+        TreeSubgraph forest(&gbwt_graph, std::move(kv.second));
+        
 #ifdef debug
-        cerr << "There is a path into source extended seed " << source
-            << ": \"" << before_sequence << "\" against " << kv.second.size() << " haplotypes" << endl;
+        cerr << "There is a forest into source extended seed " << source
+            << ": \"" << before_sequence << "\" against " << forest.leaf_count() << " haplotypes" << endl;
 #endif
         
         // Record that a source has this many incoming haplotypes to process.
-        tail_path_counts.push_back(kv.second.size());
+        tail_path_counts.push_back(forest.leaf_count());
         // Against a sequence this long
         tail_lengths.push_back(before_sequence.size());
         
-        // We want the best alignment, to the base graph, done against any target path
+        // We want the best alignment, to the base graph
         Path best_path;
         // And its score
-        int64_t best_score = numeric_limits<int64_t>::min();
-
-        // We can align it once per target path
-        for (auto& path : kv.second) {
-            // For each path we can take to get to the source
+        int64_t best_score = 0;
+        
+        if (forest.node_size() != 0 && dp_area <= dp_cells_left) {
+            // Align the reverse complement of the sequence pinned to the start of the forest, accounting for full length bonus
+            Alignment before_alignment;
+            before_alignment.set_sequence(reverse_complement(before_sequence));
+            get_regular_aligner()->align_pinned(before_alignment, forest, true);
             
-            if (path.mapping_size() == 0) {
-                // We might have extra read before where the graph starts. Handle leading insertions.
-                // We consider a pure softclip.
-                // We don't consider an empty sequence because if that were the case
-                // we would not have any paths_between_seeds entries for the dangling-left-sequence sentinel.
-                if (best_score < 0) {
-                    best_score = 0;
-                    best_path.clear_mapping();
-                    Mapping* m = best_path.add_mapping();
-                    Edit* e = m->add_edit();
-                    e->set_from_length(0);
-                    e->set_to_length(before_sequence.size());
-                    e->set_sequence(before_sequence);
-                    // Since the softclip consumes no graph, we place it on the node we are going to.
-                    *m->mutable_position() = extended_seeds[source].path.mapping(0).position();
-                    
-#ifdef debug
-                    cerr << "New best alignment: " << pb2json(best_path) << endl;
-#endif
-                }
-            } else {
-
-                // Make a subgraph.
-                // TODO: don't copy the path
-                PathSubgraph subgraph(&gbwt_graph, path);
-                
-                // Do right-pinned alignment to the path subgraph with GSSWAligner.
-                Alignment before_alignment;
-                before_alignment.set_sequence(before_sequence);
-                // TODO: pre-make the topological order
-                
-#ifdef debug
-                cerr << "Align " << pb2json(before_alignment) << " pinned right vs:" << endl;
-                subgraph.for_each_handle([&](const handle_t& here) {
-                    cerr << subgraph.get_id(here) << " (" << subgraph.get_sequence(here) << "): " << endl;
-                    subgraph.follow_edges(here, true, [&](const handle_t& there) {
-                        cerr << "\t" << subgraph.get_id(there) << " (" << subgraph.get_sequence(there) << ") ->" << endl;
-                    });
-                    subgraph.follow_edges(here, false, [&](const handle_t& there) {
-                        cerr << "\t-> " << subgraph.get_id(there) << " (" << subgraph.get_sequence(there) << ")" << endl;
-                    });
-                });
-#endif
-
-                // Align, accounting for full length bonus
-                get_regular_aligner()->align_pinned(before_alignment, subgraph, false);
-                
-                // Record size of DP matrix filled
-                tail_dp_areas.push_back(before_sequence.size() * path_from_length(path));
-
-                if (before_alignment.score() > best_score) {
-                    // This is a new best alignment. Translate from subgraph into base graph and keep it
-                    best_path = subgraph.translate_down(before_alignment.path());
-                    best_score = before_alignment.score();
-                    
-#ifdef debug
-                    cerr << "New best alignment against: " << pb2json(path) << " is " << pb2json(best_path) << endl;
-#endif
-                }
+            // Record size of DP matrix filled
+            tail_dp_areas.push_back(dp_area);
+            dp_cells_left -= dp_area;
+            
+            // Translate from the forest into the base graph and flip back around to read orientation
+            best_path = reverse_complement_path(forest.translate_down(before_alignment.path()), node_length);
+            best_score = before_alignment.score();
+        } else {
+            // We might have extra read before where the graph starts, or no budget left
+            // to align it. We consider a pure softclip.
+            if (forest.node_size() != 0) {
+                dp_budget_fallbacks++;
             }
+            Mapping* m = best_path.add_mapping();
+            Edit* e = m->add_edit();
+            e->set_from_length(0);
+            e->set_to_length(before_sequence.size());
+            e->set_sequence(before_sequence);
+            // Since the softclip consumes no graph, we place it on the node we are going to.
+            *m->mutable_position() = extended_seeds[source].starting_position(gbwt_graph);
         }
         
-        // We really should have gotten something
-        assert(best_path.mapping_size() != 0);
+#ifdef debug
+        cerr << "Best alignment: " << pb2json(best_path) << endl;
+#endif
 
         // Put it in the MultipathAlignment
         Subpath* s = mp.add_subpath();
@@ -909,10 +1429,6 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
         // And make the edge from it to the correct source
         s->add_next(source);
         
-#ifdef debug
-        cerr << "Resulting source subpath: " << pb2json(*s) << endl;
-#endif
-        
         // And mark it as a start subpath
         mp.add_start(mp.subpath_size() - 1);
     }
@@ -920,7 +1436,7 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
     // We must have somewhere to start.
     assert(mp.start_size() > 0);
 
-    for (auto& from_and_edges : paths_between_seeds) {
+    for (auto& from_and_edges : trees_between_seeds) {
         const size_t& from = from_and_edges.first;
         if (from == numeric_limits<size_t>::max()) {
             continue;
@@ -930,103 +1446,60 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
         // Work out where the extended seed ends in the read
         size_t from_end = extended_seeds[from].core_interval.second;
         
-        for (auto& to_and_paths : from_and_edges.second) {
-            const size_t& to = to_and_paths.first;
+        for (auto& to_and_forest : from_and_edges.second) {
+            const size_t& to = to_and_forest.first;
             // For all the edges to other extended seeds
             
-#ifdef debug
-            cerr << "Consider " << to_and_paths.second.size() << " paths between extended seeds " << to << " and " << from << endl;
-#endif
-
             if (to == numeric_limits<size_t>::max()) {
-                // Do a bunch of left pinned alignments for the tails.
+                // Do a left pinned alignment for the tail.
                 
                 // Find the sequence
                 string trailing_sequence = aln.sequence().substr(from_end);
                 
                 if (!trailing_sequence.empty()) {
-                    // There is actual trailing sequence to align on this escape path
+                    // There is actual trailing sequence to align on this escape forest
+                    
+                    size_t dp_area = trailing_sequence.size() * forest_length(to_and_forest.second);
+                    TreeSubgraph forest(&gbwt_graph, std::move(to_and_forest.second));
                     
                     // Record that a sink has this many outgoing haplotypes to process.
-                    tail_path_counts.push_back(to_and_paths.second.size());
+                    tail_path_counts.push_back(forest.leaf_count());
                     // Against a sequence this size
                     tail_lengths.push_back(trailing_sequence.size());
 
                     // Find the best path in backing graph space
                     Path best_path;
                     // And its score
-                    int64_t best_score = numeric_limits<int64_t>::min();
-
-                    // We can align it once per target path
-                    for (auto& path : to_and_paths.second) {
-                        // For each path we can take to leave the "from" sink
+                    int64_t best_score = 0;
+                    
+                    if (forest.node_size() != 0 && dp_area <= dp_cells_left) {
+                        // Do left-pinned alignment to the forest
+                        Alignment after_alignment;
+                        after_alignment.set_sequence(trailing_sequence);
+                        get_regular_aligner()->align_pinned(after_alignment, forest, true);
                         
-                        if (path.mapping_size() == 0) {
-                            // Consider the case of a nonempty trailing
-                            // softclip that bumped up against the end
-                            // of the underlying graph.
-                            
-                            if (best_score < 0) {
-                                best_score = 0;
-                                best_path.clear_mapping();
-                                Mapping* m = best_path.add_mapping();
-                                Edit* e = m->add_edit();
-                                e->set_from_length(0);
-                                e->set_to_length(trailing_sequence.size());
-                                e->set_sequence(trailing_sequence);
-                                // We need to set a position at the end of where we are coming from.
-                                const Mapping& prev_mapping = extended_seeds[from].path.mapping(
-                                    extended_seeds[from].path.mapping_size() - 1);
-                                const Position& coming_from = prev_mapping.position();
-                                size_t last_node_length = gbwt_graph.get_length(gbwt_graph.get_handle(coming_from.node_id()));
-                                m->mutable_position()->set_node_id(coming_from.node_id());
-                                m->mutable_position()->set_is_reverse(coming_from.is_reverse());
-                                m->mutable_position()->set_offset(last_node_length);
-                                
-                                // We should only have this case if we are coming from the end of a node.
-                                assert(mapping_from_length(prev_mapping) + coming_from.offset() == last_node_length);
-                            }
-                        } else {
-
-                            // Make a subgraph.
-                            // TODO: don't copy the path
-                            PathSubgraph subgraph(&gbwt_graph, path);
-                            
-                            // Do left-pinned alignment to the path subgraph
-                            Alignment after_alignment;
-                            after_alignment.set_sequence(trailing_sequence);
-                            // TODO: pre-make the topological order
-
-#ifdef debug
-                            cerr << "Align " << pb2json(after_alignment) << " pinned left vs:" << endl;
-                            subgraph.for_each_handle([&](const handle_t& here) {
-                                cerr << subgraph.get_id(here) << " (" << subgraph.get_sequence(here) << "): " << endl;
-                                subgraph.follow_edges(here, true, [&](const handle_t& there) {
-                                    cerr << "\t" << subgraph.get_id(there) << " (" << subgraph.get_sequence(there) << ") ->" << endl;
-                                });
-                                subgraph.follow_edges(here, false, [&](const handle_t& there) {
-                                    cerr << "\t-> " << subgraph.get_id(there) << " (" << subgraph.get_sequence(there) << ")" << endl;
-                                });
-                            });
-#endif
-
-                            get_regular_aligner()->align_pinned(after_alignment, subgraph, true);
-                            
-                            // Record size of DP matrix filled
-                            tail_dp_areas.push_back(trailing_sequence.size() * path_from_length(path));
-
-                            if (after_alignment.score() > best_score) {
-                                // This is a new best alignment. Translate from subgraph into base graph and keep it
-                                best_path = subgraph.translate_down(after_alignment.path());
-                                best_score = after_alignment.score();
-                            }
+                        // Record size of DP matrix filled
+                        tail_dp_areas.push_back(dp_area);
+                        dp_cells_left -= dp_area;
+                        
+                        // Translate from the forest into the base graph
+                        best_path = forest.translate_down(after_alignment.path());
+                        best_score = after_alignment.score();
+                    } else {
+                        // Consider the case of a nonempty trailing softclip that bumped up
+                        // against the end of the underlying graph, or that we have no budget
+                        // left to align.
+                        if (forest.node_size() != 0) {
+                            dp_budget_fallbacks++;
                         }
+                        Mapping* m = best_path.add_mapping();
+                        Edit* e = m->add_edit();
+                        e->set_from_length(0);
+                        e->set_to_length(trailing_sequence.size());
+                        e->set_sequence(trailing_sequence);
+                        // We need to set a position at the end of where we are coming from.
+                        *m->mutable_position() = extended_seeds[from].tail_position(gbwt_graph);
                     }
-                    
-                    // We need to come after from with this path
-
-                    // We really should have gotten something
-                    assert(best_path.mapping_size() != 0);
 
                     // Put it in the MultipathAlignment
                     Subpath* s = mp.add_subpath();
@@ -1037,7 +1510,7 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
                     mp.mutable_subpath(from)->add_next(mp.subpath_size() - 1);
                 }
                 
-                // If there's no sequence to align on the path going off to nowhere, don't do anything.
+                // If there's no sequence to align on the forest going off to nowhere, don't do anything.
                 
             } else {
                 // Do alignments between from and to
@@ -1049,78 +1522,98 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
                 // Find the best path in backing graph space (which may be empty)
                 Path best_path;
                 // And its score
-                int64_t best_score = numeric_limits<int64_t>::min();
-
-                // We can align it once per target path
-                for (auto& path : to_and_paths.second) {
-                    // For each path we can take to get to the source
-                    
-                    if (path.mapping_size() == 0) {
-                        // We're aligning against nothing
-                        if (intervening_sequence.empty()) {
-                            // Consider the nothing to nothing alignment, score 0
-                            if (best_score < 0) {
-                                best_score = 0;
-                                best_path.clear_mapping();
-                            }
+                int64_t best_score = 0;
+                
+                // Can we go straight from from to to without taking any graph?
+                bool direct = to_and_forest.second.empty() ||
+                    (direct_connections.count(from) && direct_connections[from].count(to));
+                if (direct && intervening_sequence.empty()) {
+                    // Nothing that takes any graph can beat going straight there
+                    to_and_forest.second.clear();
+                }
+                
+                if (!to_and_forest.second.empty()) {
+                    size_t dp_area = intervening_sequence.size() * forest_length(to_and_forest.second);
+                    if (dp_area > dp_cells_left) {
+                        // We can't afford all the haplotypes.
+                        dp_budget_fallbacks++;
+                        if (direct) {
+                            // Just take the direct connection.
+                            to_and_forest.second.clear();
+                            dp_area = 0;
                         } else {
-                            // Consider the something to nothing alignment.
-                            // We can't use the normal code path because the BandedGlobalAligner 
-                            // wouldn't be able to generate a position form an empty graph.
-                            
-                            // We know the extended seeds we are between won't start/end with gaps, so we own the gap open.
-                            int64_t score = get_regular_aligner()->score_gap(intervening_sequence.size());
-                            if (score > best_score) {
-                                best_path.clear_mapping();
-                                Mapping* m = best_path.add_mapping();
-                                Edit* e = m->add_edit();
-                                e->set_from_length(0);
-                                e->set_to_length(intervening_sequence.size());
-                                e->set_sequence(intervening_sequence);
-                                // We can copy the position of where we are going to, since we consume no graph.
-                                *m->mutable_position() = extended_seeds[to].path.mapping(0).position();
-                            }
+                            // Just use the shortest one.
+                            to_and_forest.second = shortest_walk(to_and_forest.second);
+                            dp_area = intervening_sequence.size() * forest_length(to_and_forest.second);
+                        }
+                    }
+                    
+                    if (to_and_forest.second.empty()) {
+                        // We gave up on the forest
+                    } else if (dp_area > dp_cells_left) {
+                        // We can't even afford the shortest haplotype. Delete it and insert
+                        // the read sequence instead, which takes no DP at all.
+                        size_t walk_length = 0;
+                        for (auto& node : to_and_forest.second) {
+                            Mapping* m = best_path.add_mapping();
+                            m->mutable_position()->set_node_id(gbwt_graph.get_id(node.handle));
+                            m->mutable_position()->set_is_reverse(gbwt_graph.get_is_reverse(node.handle));
+                            m->mutable_position()->set_offset(node.offset);
+                            Edit* e = m->add_edit();
+                            e->set_from_length(node.length);
+                            e->set_to_length(0);
+                            walk_length += node.length;
+                        }
+                        best_score = get_regular_aligner()->score_gap(walk_length);
+                        if (!intervening_sequence.empty()) {
+                            Edit* e = best_path.mutable_mapping(best_path.mapping_size() - 1)->add_edit();
+                            e->set_from_length(0);
+                            e->set_to_length(intervening_sequence.size());
+                            e->set_sequence(intervening_sequence);
+                            best_score += get_regular_aligner()->score_gap(intervening_sequence.size());
                         }
                     } else {
-
-                        // Make a subgraph.
-                        // TODO: don't copy the path
-                        PathSubgraph subgraph(&gbwt_graph, path);
+                        dp_cells_left -= dp_area;
+                        
+                        TreeSubgraph forest(&gbwt_graph, std::move(to_and_forest.second));
                         
-                        // Do global alignment to the path subgraph
+                        // Do global alignment to the forest, whose leaves all end just before to
                         Alignment between_alignment;
                         between_alignment.set_sequence(intervening_sequence);
                         
 #ifdef debug
-                        cerr << "Align " << pb2json(between_alignment) << " global vs:" << endl;
-                        cerr << "Defining path: " << pb2json(path) << endl;
-                        subgraph.for_each_handle([&](const handle_t& here) {
-                            cerr << subgraph.get_id(here) << " len " << subgraph.get_length(here)
-                                << " (" << subgraph.get_sequence(here) << "): " << endl;
-                            subgraph.follow_edges(here, true, [&](const handle_t& there) {
-                                cerr << "\t" << subgraph.get_id(there) << " len " << subgraph.get_length(there)
-                                    << " (" << subgraph.get_sequence(there) << ") ->" << endl;
-                            });
-                            subgraph.follow_edges(here, false, [&](const handle_t& there) {
-                                cerr << "\t-> " << subgraph.get_id(there) << " len " << subgraph.get_length(there)
-                                    << " (" << subgraph.get_sequence(there) << ")" << endl;
-                            });
-                        });
+                        cerr << "Align " << pb2json(between_alignment) << " global vs " << forest.leaf_count() << " haplotypes" << endl;
 #endif
                         
-                        get_regular_aligner()->align_global_banded(between_alignment, subgraph, 5, true);
+                        get_regular_aligner()->align_global_banded(between_alignment, forest, 5, true);
                         
-                        if (between_alignment.score() > best_score) {
-                            // This is a new best alignment. Translate from subgraph into base graph and keep it
-                            best_path = subgraph.translate_down(between_alignment.path());
-#ifdef debug
-                            cerr << "\tNew best: " << pb2json(best_path) << endl;
-#endif
-                            
-                            best_score = between_alignment.score();
+                        // Translate from the forest into the base graph
+                        best_path = forest.translate_down(between_alignment.path());
+                        best_score = between_alignment.score();
+                    }
+                }
+                
+                if (direct) {
+                    // Consider going straight there, taking no graph.
+                    // We know the extended seeds we are between won't start/end with gaps, so we own the gap open.
+                    int64_t direct_score = intervening_sequence.empty() ? 0 : get_regular_aligner()->score_gap(intervening_sequence.size());
+                    if (best_path.mapping_size() == 0 || direct_score >= best_score) {
+                        // It is at least as good as any walk between the seeds
+                        best_path.clear_mapping();
+                        best_score = direct_score;
+                        if (!intervening_sequence.empty()) {
+                            // Consider the something to nothing alignment.
+                            // We can't use the normal code path because the BandedGlobalAligner 
+                            // wouldn't be able to generate a position form an empty graph.
+                            Mapping* m = best_path.add_mapping();
+                            Edit* e = m->add_edit();
+                            e->set_from_length(0);
+                            e->set_to_length(intervening_sequence.size());
+                            e->set_sequence(intervening_sequence);
+                            // We can copy the position of where we are going to, since we consume no graph.
+                            *m->mutable_position() = extended_seeds[to].starting_position(gbwt_graph);
                         }
                     }
-                    
                 }
                 
                 // We may have an empty path. That's fine.
@@ -1171,16 +1664,20 @@ void MinimizerMapper::chain_extended_seeds(const Alignment& aln, const vector<Ga
     set_annotation(out, "tail_path_counts", tail_path_counts);
     set_annotation(out, "tail_lengths", tail_lengths);
     set_annotation(out, "tail_dp_areas", tail_dp_areas);
+    set_annotation(out, "dp_budget_fallbacks", (double) dp_budget_fallbacks);
+    if (dp_budget_fallbacks != 0) {
+        budget.dp_limited = true;
+    }
 }
 
-unordered_map<size_t, unordered_map<size_t, vector<Path>>>
-MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_seeds, size_t read_length) const {
+unordered_map<size_t, unordered_map<size_t, vector<TreeSubgraph::TreeNode>>>
+MinimizerMapper::find_connecting_trees(const vector<GaplessExtension>& extended_seeds, size_t read_length,
+    WorkBudget& budget, unordered_map<size_t, unordered_set<size_t>>& direct_connections) const {
 
     // Now this will hold, for each extended seed, for each other
-    // reachable extended seed, the graph Paths that the
-    // intervening sequence needs to be aligned against in the
-    // graph.
-    unordered_map<size_t, unordered_map<size_t, vector<Path>>> to_return;
+    // reachable extended seed, the forest of haplotype-consistent walks that
+    // the intervening sequence needs to be aligned against in the graph.
+    unordered_map<size_t, unordered_map<size_t, vector<TreeSubgraph::TreeNode>>> to_return;
 
     // All the extended seeds are forward in the read. So we index them by start.
     // Maps from handle in the GBWT graph to offset on that orientation that an extension starts at and index of the extension.
@@ -1192,20 +1689,17 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
     for (size_t i = 0; i < extended_seeds.size(); i++) {
         // For each extension
         // Where does it start?
-        auto& pos = extended_seeds[i].path.mapping(0).position();
-
-        // Get the handle it is on
-        handle_t handle = gbwt_graph.get_handle(pos.node_id(), pos.is_reverse());
+        handle_t handle = extended_seeds[i].path.front();
 
         // Record that this extension starts at this offset along that handle
-        extensions_by_handle[handle].emplace_back(pos.offset(), i);
+        extensions_by_handle[handle].emplace_back(extended_seeds[i].offset, i);
 
         // Assume it is a source
         sources.insert(i);
 
 #ifdef debug
-        cerr << "Extended seed " << i << " starts on node " << pos.node_id() << " " << pos.is_reverse()
-            << " at offset " << pos.offset() << endl;
+        cerr << "Extended seed " << i << " starts on node " << gbwt_graph.get_id(handle) << " " << gbwt_graph.get_is_reverse(handle)
+            << " at offset " << extended_seeds[i].offset << endl;
 #endif
     }
 
@@ -1217,14 +1711,12 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
     }
 
     // For each seed in read order, walk out right in the haplotypes by the max length and see what other seeds we encounter.
-    // Remember the read bounds and graph Path we found, for later alignment.
+    // Remember the forests we found, for later alignment.
     for (size_t i = 0; i < extended_seeds.size(); i++) {
         // For each starting seed
 
         // Where do we cut the graph just after its end?
-        auto& last_mapping = extended_seeds[i].path.mapping(extended_seeds[i].path.mapping_size() - 1);
-        Position cut_pos_graph = last_mapping.position();
-        cut_pos_graph.set_offset(cut_pos_graph.offset() + mapping_from_length(last_mapping));
+        Position cut_pos_graph = extended_seeds[i].tail_position(gbwt_graph);
         // And the read?
         size_t cut_pos_read = extended_seeds[i].core_interval.second;
 
@@ -1247,36 +1739,18 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
             
             for (auto& next_offset_and_index : same_node_found->second) {
                 // Scan them in order.
-                // TODO: Skip to after ourselves.
                 
                 if (extended_seeds[next_offset_and_index.second].core_interval.first >= cut_pos_read &&
                     next_offset_and_index.first >= cut_pos_graph.offset()) { 
                     
-                    // As soon as we find one that starts after we end in both the read and the node
-
-                    // Emit a connecting Path 
-                    Path connecting;
-
+                    // As soon as we find one that starts after we end in both the read and the node,
+                    // connect to it with the intervening part of the node, if any.
+                    vector<TreeSubgraph::TreeNode>& connecting = to_return[i][next_offset_and_index.second];
                     if (next_offset_and_index.first > cut_pos_graph.offset()) {
-                        // There actually is intervening graph material
-                        Mapping* m = connecting.add_mapping();
-                        *m->mutable_position() = cut_pos_graph;
-                        Edit* e = m->add_edit();
-                        e->set_from_length(next_offset_and_index.first - m->position().offset());
-                        e->set_to_length(next_offset_and_index.first - m->position().offset());
+                        connecting.push_back({-1, start_handle, (size_t) cut_pos_graph.offset(),
+                            next_offset_and_index.first - cut_pos_graph.offset()});
                     }
 
-#ifdef debug
-                    cerr << "Found path on node between seed at "
-                    << pb2json(extended_seeds[i].path.mapping(extended_seeds[i].path.mapping_size() - 1).position())
-                    << " and seed at "
-                    << pb2json(extended_seeds[next_offset_and_index.second].path.mapping(0).position())
-                    << ":" << endl << "\t" << pb2json(connecting) <<  endl;
-#endif
-
-                    // Emit that connection
-                    to_return[i][next_offset_and_index.second].emplace_back(std::move(connecting));
-
                     // Record that the destination is not a source
                     sources.erase(next_offset_and_index.second);
 
@@ -1295,12 +1769,14 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
         // How long should we search? It should be the longest detectable gap plus the remaining sequence.
         size_t search_limit = get_regular_aligner()->longest_detectable_gap(cut_pos_read, read_length) + (read_length - cut_pos_read);
 
-        // Have we found a way to get to any other extended seeds yet?
-        bool reachable_extended_seeds = false;
+        // For each extended seed we reach, the forest nodes that end just before it, or -1
+        // if we reach it without taking any graph
+        unordered_map<size_t, vector<int64_t>> ends_by_destination;
 
         // Search everything in the GBWT graph right from the end of the start extended seed, up to the limit.
-        explore_gbwt(cut_pos_graph, search_limit, [&](const ImmutablePath& here_path, const handle_t& there_handle) -> bool {
-            // When we encounter a new handle visited by haplotypes extending off of the last node in a Path
+        vector<TreeSubgraph::TreeNode> forest = explore_gbwt(cut_pos_graph, search_limit, budget,
+            [&](vector<TreeSubgraph::TreeNode>& tree, int64_t parent, const handle_t& there_handle) -> bool {
+            // When we encounter a new handle visited by haplotypes extending off of a forest node
 
             // See if we hit any other extensions on this next node
             auto found = extensions_by_handle.find(there_handle);
@@ -1313,35 +1789,15 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
                     if (extended_seeds[next_offset_and_index.second].core_interval.first >= cut_pos_read) { 
                         // As soon as we find one that starts in the read after our start extended seed ended
 
-                        // Extend the Path to connect to it.
-                        // TODO: Make these shared tail lists for better algorithmics
-                        ImmutablePath extended = here_path;
-                        
                         if (next_offset_and_index.first > 0) {
                             // There is actual material on this new node before the extended seed we have to hit.
-                            Mapping m; 
-                            m.mutable_position()->set_node_id(gbwt_graph.get_id(there_handle));
-                            m.mutable_position()->set_is_reverse(gbwt_graph.get_is_reverse(there_handle));
-                            Edit* e = m.add_edit();
-                            // Make sure it runs through the last base *before* the extended seed we are going for
-                            e->set_from_length(next_offset_and_index.first);
-                            e->set_to_length(next_offset_and_index.first);
-                            
-                            extended = extended.push_front(m);
+                            tree.push_back({parent, there_handle, 0, next_offset_and_index.first});
+                            ends_by_destination[next_offset_and_index.second].push_back(tree.size() - 1);
+                        } else {
+                            // We get there right from the end of the parent
+                            ends_by_destination[next_offset_and_index.second].push_back(parent);
                         }
 
-#ifdef debug
-                        cerr << "Found graph path between seed at "
-                            << pb2json(extended_seeds[i].path.mapping(extended_seeds[i].path.mapping_size() - 1).position())
-                            << " and seed at "
-                            << pb2json(extended_seeds[next_offset_and_index.second].path.mapping(0).position())
-                            << ":" << endl << "\t" << pb2json(to_path(extended)) <<  endl;
-#endif
-
-                        // And emit that connection
-                        to_return[i][next_offset_and_index.second].emplace_back(to_path(extended));
-                        reachable_extended_seeds = true;
-
                         // Record that the destination is not a source
                         sources.erase(next_offset_and_index.second);
 
@@ -1354,30 +1810,26 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
 
             // Otherwise we didn't hit anything we can stop at. Keep extending.
             return true;
-        }, [&](const ImmutablePath& limit_path) {
-            // When we blow past the walk distance limit or hit a dead end
-            
-            if (cut_pos_read < read_length && !reachable_extended_seeds) {
-                // We have sequence to align and a way to escape and align it, and nowhere else we know of (yet) to go with it.
-                // Save that as a path.
-                to_return[i][numeric_limits<size_t>::max()].emplace_back(to_path(limit_path));
-                // If we end up with paths anywhere else after all, we will destroy it, so we
-                // will only keep it for sinks.
-            }
         });
         
-        if (reachable_extended_seeds) {
-            // Make sure that if we can go anywhere else we *don't* consider wandering off to nowhere.
-            auto found = to_return[i].find(numeric_limits<size_t>::max());
-            if (to_return[i].size() > 1 && found != to_return[i].end()) {
-                // We have a going-off-to-nothing path and also a path to somewhere else.
-                // Don't go off to nothing.
-                to_return[i].erase(found);
+        if (!ends_by_destination.empty()) {
+            // Align against just the walks that reach each destination.
+            // Since we can go somewhere else, we *don't* consider wandering off to nowhere.
+            for (auto& kv : ends_by_destination) {
+                to_return[i][kv.first] = walks_to(forest, kv.second);
+                if (!to_return[i][kv.first].empty() && std::find(kv.second.begin(), kv.second.end(), -1) != kv.second.end()) {
+                    // We can also get there without taking any graph, and that has to be tried separately
+                    direct_connections[i].insert(kv.first);
+                }
             }
+        } else if (cut_pos_read < read_length) {
+            // We have sequence to align and nowhere else we know of to go with it.
+            // Save the whole forest as a tail.
+            to_return[i][numeric_limits<size_t>::max()] = std::move(forest);
         }
     }
 
-    // Now we need the paths *from* numeric_limits<size_t>::max() to sources.
+    // Now we need the forests *from* numeric_limits<size_t>::max() to sources.
     // Luckily we know the sources.
     for (const size_t& i : sources) {
         // For each source
@@ -1387,56 +1839,25 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
 #endif
         
         if (extended_seeds[i].core_interval.first > 0) {
-#ifdef debug
-            cerr << "\tIt is not at the start of the read, so there is a left tail" << endl;
-#endif
+            // It is not at the start of the read, so there is a left tail
 
             // Find its start
-            Position start = extended_seeds[i].path.mapping(0).position();
+            Position start = extended_seeds[i].starting_position(gbwt_graph);
             
-#ifdef debug
-            cerr << "\tPosition read-forward to search left before: " << pb2json(start) << endl;
-#endif
-
             // Flip it around to face left
             start = reverse(start, gbwt_graph.get_length(gbwt_graph.get_handle(start.node_id())));
-            
-#ifdef debug
-            cerr << "\tPosition read-reverse to search right after: " << pb2json(start) << endl;
-#endif
 
             // Now the search limit is all the read *before* the seed, plus the detectable gap
             size_t search_limit = get_regular_aligner()->longest_detectable_gap(read_length, extended_seeds[i].core_interval.first) +
                 extended_seeds[i].core_interval.first;
 
             // Start another search, but going left.
-            explore_gbwt(start, search_limit, [&](const ImmutablePath& here_path, const handle_t& there_handle) -> bool {
-                // If we weren't reachable from anyone, nobody should be reachable from us going the other way.
-                // So always keep going.
+            // If we weren't reachable from anyone, nobody should be reachable from us going the other way.
+            // So always keep going.
+            to_return[numeric_limits<size_t>::max()][i] = explore_gbwt(start, search_limit, budget,
+                [&](vector<TreeSubgraph::TreeNode>& tree, int64_t parent, const handle_t& there_handle) -> bool {
                 return true;
-            }, [&](const ImmutablePath& limit_path) {
-                // We have this path going right from start and hitting the walk limit or the edge of the graph.
-
-                for (auto& mapping : limit_path) {
-                    // Make sure nothing has a negative offset before flipping.
-                    assert(mapping.position().offset() >= 0);
-                }
-
-                // Convert to Path and flip around
-                Path flipped = reverse_complement_path(to_path(limit_path), [&](id_t id) -> size_t {
-                    return gbwt_graph.get_length(gbwt_graph.get_handle(id));
-                });
-                
-                for (auto& mapping : flipped.mapping()) {
-                    // Make sure nothing has a negative offset after flipping.
-                    assert(mapping.position().offset() >= 0);
-                }
-
-                // Record that as a path from numeric_limits<size_t>::max() to i.
-                to_return[numeric_limits<size_t>::max()][i].emplace_back(std::move(flipped));
             });
-            
-            assert(to_return[numeric_limits<size_t>::max()][i].size() > 0);
         }
     }
     
@@ -1445,42 +1866,108 @@ MinimizerMapper::find_connecting_paths(const vector<GaplessExtension>& extended_
     
 }
 
-size_t MinimizerMapper::immutable_path_from_length(const ImmutablePath& path) {
-    size_t to_return = 0;
-    for (auto& m : path) {
-        // Sum up the from lengths of all the component Mappings
-        to_return += mapping_from_length(m);
+vector<TreeSubgraph::TreeNode> MinimizerMapper::walks_to(const vector<TreeSubgraph::TreeNode>& forest, const vector<int64_t>& ends) {
+    
+    // Mark the ends and everything on the way to them
+    vector<bool> is_end(forest.size(), false);
+    vector<bool> keep(forest.size(), false);
+    for (const int64_t& end : ends) {
+        if (end < 0) {
+            // We can get there without any graph at all, which the caller handles
+            continue;
+        }
+        is_end[end] = true;
+        for (int64_t here = end; here >= 0 && !keep[here]; here = forest[here].parent) {
+            keep[here] = true;
+        }
     }
-    return to_return;
+    
+    // Copy over the marked nodes. Parents come first, so we know their new indexes.
+    vector<TreeSubgraph::TreeNode> walks;
+    vector<int64_t> new_index(forest.size(), -1);
+    vector<bool> has_child(forest.size(), false);
+    for (size_t i = 0; i < forest.size(); i++) {
+        if (!keep[i]) {
+            continue;
+        }
+        int64_t parent = forest[i].parent;
+        walks.push_back(forest[i]);
+        walks.back().parent = parent < 0 ? -1 : new_index[parent];
+        new_index[i] = walks.size() - 1;
+        if (parent >= 0) {
+            has_child[parent] = true;
+        }
+    }
+    
+    // An end that we kept walks through to other ends isn't a leaf, and alignments
+    // can only finish at leaves. So give it a copy of its walk as its own tree.
+    for (size_t i = 0; i < forest.size(); i++) {
+        if (!is_end[i] || !has_child[i]) {
+            continue;
+        }
+        vector<size_t> walk;
+        for (int64_t here = i; here >= 0; here = forest[here].parent) {
+            walk.push_back(here);
+        }
+        int64_t parent = -1;
+        for (auto it = walk.rbegin(); it != walk.rend(); ++it) {
+            walks.push_back(forest[*it]);
+            walks.back().parent = parent;
+            parent = walks.size() - 1;
+        }
+    }
+    
+    return walks;
 }
 
-Path MinimizerMapper::to_path(const ImmutablePath& path) {
-    Path to_return;
-    for (auto& m : path) {
-        // Copy all the Mappings into the Path.
-        *to_return.add_mapping() = m;
+vector<TreeSubgraph::TreeNode> MinimizerMapper::shortest_walk(const vector<TreeSubgraph::TreeNode>& forest) {
+    
+    // Find the distance through the end of each node, and which nodes are leaves
+    vector<size_t> distance(forest.size(), 0);
+    vector<bool> is_leaf(forest.size(), true);
+    for (size_t i = 0; i < forest.size(); i++) {
+        const int64_t& parent = forest[i].parent;
+        distance[i] = (parent < 0 ? 0 : distance[parent]) + forest[i].length;
+        if (parent >= 0) {
+            is_leaf[parent] = false;
+        }
+    }
+    
+    // Find the closest leaf
+    int64_t closest = -1;
+    for (size_t i = 0; i < forest.size(); i++) {
+        if (is_leaf[i] && (closest < 0 || distance[i] < distance[closest])) {
+            closest = i;
+        }
     }
     
-    // Flip the order around to actual path order.
-    std::reverse(to_return.mutable_mapping()->begin(), to_return.mutable_mapping()->end());
+    // Trace back to the root and lay the walk out as a chain
+    vector<TreeSubgraph::TreeNode> walk;
+    for (int64_t here = closest; here >= 0; here = forest[here].parent) {
+        walk.push_back(forest[here]);
+    }
+    std::reverse(walk.begin(), walk.end());
+    for (size_t i = 0; i < walk.size(); i++) {
+        walk[i].parent = (int64_t) i - 1;
+    }
     
-    // Return the completed path
-    return to_return;
+    return walk;
 }
 
-void MinimizerMapper::explore_gbwt(const Position& from, size_t walk_distance,
-    const function<bool(const ImmutablePath&, const handle_t&)>& visit_callback,
-    const function<void(const ImmutablePath&)>& limit_callback) const {
+vector<TreeSubgraph::TreeNode> MinimizerMapper::explore_gbwt(const Position& from, size_t walk_distance, WorkBudget& budget,
+    const function<bool(vector<TreeSubgraph::TreeNode>&, int64_t, const handle_t&)>& visit_callback) const {
     
 #ifdef debug
     cerr << "Exploring GBWT out from " << pb2json(from) << " to distance " << walk_distance << endl;
 #endif
     
-    // Holds the gbwt::SearchState we are at, and the ImmutablePath (backward)
-    // from the end of the starting seed up through the end of the node we just
-    // searched. The from_length of the path tracks our consumption of distance
-    // limit.
-    using traversal_state_t = pair<gbwt::SearchState, ImmutablePath>;
+    // The forest of walks we have found
+    vector<TreeSubgraph::TreeNode> forest;
+    
+    // Holds the gbwt::SearchState we are at, the forest node that ends at the
+    // end of the node we just searched (or -1 if that is the cut we started
+    // at), and how much of the distance limit we have consumed.
+    using traversal_state_t = tuple<gbwt::SearchState, int64_t, size_t>;
     
     // Get a handle to the node the from position is on, in its forward orientation
     handle_t start_handle = gbwt_graph.get_handle(from.node_id(), from.is_reverse());
@@ -1489,127 +1976,79 @@ void MinimizerMapper::explore_gbwt(const Position& from, size_t walk_distance,
     gbwt::SearchState start_state = gbwt_graph.get_state(start_handle);
     
     if (start_state.empty()) {
-        // No haplotypes even visit the first node. Have a 0-mapping dead end.
-        limit_callback(ImmutablePath());
-        return;
+        // No haplotypes even visit the first node. Have an empty forest.
+        return forest;
     }
 
     // The search state represents searching through the end of the node, so we have to consume that much search limit.
 
-    // Tack on how much search limit distance we consume by going to the end of
-    // the node. Our start position is a cut *between* bases, and we take everything after it.
+    // Our start position is a cut *between* bases, and we take everything after it.
     // If the cut is at the offset of the whole length of the node, we take 0 bases.
-    // If it is at 0, wer take all the bases in the node.
+    // If it is at 0, we take all the bases in the node.
     size_t distance_to_node_end = gbwt_graph.get_length(start_handle) - from.offset();    
     
-    // And make a Path that represents the part of the node we're on that goes out to the end.
-    // This may be empty if the hit already stopped at the end of the node
-    ImmutablePath path_to_end;
+    // And make a root that represents the part of the node we're on that goes out to the end.
+    // If the hit already stopped at the end of the node, the walks start at the next nodes instead.
+    int64_t root = -1;
     if (distance_to_node_end != 0) {
-        // We didn't hit the end of the node already.
-
-        // Make a mapping that starts on the right side of the cut we started our search at.
-        Mapping m;
-        *m.mutable_position() = from;
-        m.mutable_position()->set_offset(m.position().offset());
-
-        // Make it the requested length of perfect match.
-        Edit* e = m.add_edit();
-        e->set_from_length(distance_to_node_end);
-        e->set_to_length(distance_to_node_end);
-        
-        // Put it in the list
-        path_to_end = path_to_end.push_front(m);
+        forest.push_back({-1, start_handle, (size_t) from.offset(), distance_to_node_end});
+        root = 0;
     }
-   
-#ifdef debug   
-    cerr << "Starting traversal with " << pb2json(path_to_end) << " from " << pb2json(from) << endl;
-#endif
     
-    // Glom these together into a traversal state and queue it up.
-
     // Holds a queue of search states to extend.
-    list<traversal_state_t> queue{{start_state, path_to_end}};
-    // Track queue size separately since getting it form the queue is O(n)
-    size_t queue_size = 1;
-    // Track queue high-water mark for debugging.
-    size_t queue_max = 1;
-    
+    deque<traversal_state_t> queue{traversal_state_t(start_state, root, distance_to_node_end)};
     
-    // Track how many times we hit the end/limit
-    size_t limit_hits = 0;
-    // And dead ends sweparately
-    size_t dead_ends = 0;
-
-    while (!queue.empty()) {
-        // While there are things in the queue
-        
-        // Record max size
-        queue_max = max(queue_max, queue_size);
-
+    while (!queue.empty() && !budget.gbwt_limited) {
         // Grab one
         traversal_state_t here(std::move(queue.front()));
         queue.pop_front();
-        queue_size--;
-        gbwt::SearchState& here_state = here.first;
-        const ImmutablePath& here_path = here.second;
+        const gbwt::SearchState& here_state = get<0>(here);
+        const int64_t& here_node = get<1>(here);
+        const size_t& here_distance = get<2>(here);
         
         // follow_paths on it
-        bool got_anywhere = false;
         gbwt_graph.follow_paths(here_state, [&](const gbwt::SearchState& there_state) -> bool {
             if (there_state.empty()) {
                 // Ignore places that no haplotypes go, and get the next place instead.
                 return true;
             }
             
+            if (budget.gbwt_states_left == 0) {
+                // We can't afford to look at any more places. Keep the forest we have.
+                budget.gbwt_limited = true;
+                return false;
+            }
+            budget.gbwt_states_left--;
+            
             // For each place it can go
             handle_t there_handle = gbwt_graph.node_to_handle(there_state.node);
-            
-            // Record that we got there
-            got_anywhere = true;
 
             // Say we can go from here to there. Should we?
-            bool continue_extending = visit_callback(here_path, there_handle);
-
-            if (continue_extending) {
-                // Generate the path we take if we take up all of that node.
-                Mapping m;
-                m.mutable_position()->set_node_id(gbwt_graph.get_id(there_handle));
-                m.mutable_position()->set_is_reverse(gbwt_graph.get_is_reverse(there_handle));
-                Edit* e = m.add_edit();
-                e->set_from_length(gbwt_graph.get_length(there_handle));
-                e->set_to_length(gbwt_graph.get_length(there_handle));
+            if (visit_callback(forest, here_node, there_handle)) {
+                size_t there_length = gbwt_graph.get_length(there_handle);
                 
-                ImmutablePath extended = here_path.push_front(m);
-
-                // See if we can get to the end of the node without going outside the search length.
-                if (immutable_path_from_length(here_path) + gbwt_graph.get_length(there_handle) <= walk_distance) {
-                    // If so, continue the search
-                    queue.emplace_back(there_state, extended);
-                    queue_size++;
-                } else {
-                    // Report that, with this extension, we hit the limit.
-                    limit_callback(extended);
-                    limit_hits++;
+                if (here_distance + there_length <= walk_distance) {
+                    // We can get to the end of the node without going outside the search length,
+                    // so take all of it and continue the search.
+                    forest.push_back({here_node, there_handle, 0, there_length});
+                    queue.emplace_back(there_state, forest.size() - 1, here_distance + there_length);
+                } else if (here_distance < walk_distance) {
+                    // Take only as much of it as we can reach.
+                    forest.push_back({here_node, there_handle, 0, walk_distance - here_distance});
                 }
             }
 
             // Look at other possible haplotypes from where we came from
             return true;
         });
-        
-        if (!got_anywhere) {
-            // We hit a dead end here. Report that.
-            limit_callback(here_path);
-            dead_ends++;
-        }
     }
     
 #ifdef debug
-    cerr << "Queue max: " << queue_max << " Limit hits: " << limit_hits << " Dead ends: " << dead_ends << endl;
+    cerr << "Found forest of " << forest.size() << " nodes" << endl;
 #endif
-}
 
+    return forest;
+}
 
 }
 
@@ -14,8 +14,10 @@
 #include "snarls.hpp"
 #include "distance.hpp"
 #include "seed_clusterer.hpp"
+#include "tree_subgraph.hpp"
+#include "funnel.hpp"
 
-#include <structures/immutable_list.hpp>
+#include <atomic>
 
 namespace vg {
 
@@ -29,12 +31,34 @@ public:
      */
     MinimizerMapper(const xg::XG* xg_index, const gbwt::GBWT* gbwt_index, const MinimizerIndex* minimizer_index,
         SnarlManager* snarl_manager, DistanceIndex* distance_index);
+    
+    /**
+     * Construct a new MinimizerMapper using a prebuilt GBWTGraph, which must
+     * already be connected to its GBWT, instead of building one from the XG.
+     */
+    MinimizerMapper(const xg::XG* xg_index, const GBWTGraph& gbwt_graph, const MinimizerIndex* minimizer_index,
+        SnarlManager* snarl_manager, DistanceIndex* distance_index);
 
     /**
      * Map the given read, and send output to the given AlignmentEmitter. May be run from any thread.
      * TODO: Can't be const because the clusterer's cluster_seeds isn't const.
      */
     void map(Alignment& aln, AlignmentEmitter& alignment_emitter);
+    
+    /**
+     * Map the given pair of reads, and send output to the given
+     * AlignmentEmitter as a pair. The mates are clustered jointly, so that
+     * alignments of both mates in the same fragment-scale cluster can be
+     * paired, and a mate with no alignment near a good alignment of the other
+     * mate is rescued in the surrounding graph. May be run from any thread.
+     */
+    void map_paired(Alignment& aln1, Alignment& aln2, AlignmentEmitter& alignment_emitter);
+    
+    /**
+     * Print how many of the reads mapped so far ran into each of the per-read
+     * work limits. May be called while mapping is ongoing.
+     */
+    void report_work_limits(ostream& out) const;
 
     // Mapping settings.
     // TODO: document each
@@ -45,6 +69,46 @@ public:
     size_t hit_cap = 10;
     size_t distance_limit = 1000;
     bool do_chaining = true;
+    /// How many DP matrix cells can we fill per read when aligning gaps and
+    /// tails against haplotypes? Once it runs out, tails are softclipped and
+    /// gaps are aligned against only the shortest haplotype. If even that
+    /// does not fit, the gap becomes a deletion of the shortest haplotype and
+    /// an insertion of the read sequence, so the limit is never exceeded.
+    size_t max_dp_cells = 16 * 1024 * 1024;
+    /// How many seed hits can we locate per read, or 0 for no limit? If the
+    /// minimizers under the hit cap have more hits than this, the ones with
+    /// the fewest hits are used first.
+    size_t max_seeds = 2048;
+    /// How many GBWT search states can we visit per read when looking for
+    /// haplotypes between and around extensions, or 0 for no limit? Once it
+    /// runs out, the forests found so far are used as is.
+    size_t max_gbwt_states = 64 * 1024;
+    /// After the first two, do not extend clusters whose read coverage is
+    /// less than this fraction of the best cluster's, or 0 to extend them all.
+    /// Skipped clusters can still hold secondary alignments, so this is off
+    /// by default.
+    double min_cluster_coverage_fraction = 0;
+    /// Stop aligning extension groups once an aligned one has won and the
+    /// remaining ones could not bring its MAPQ below the cap, even if they all
+    /// aligned with their estimated scores. Only applies to unpaired reads,
+    /// since pair MAPQ depends on both mates. Skipped groups can still hold
+    /// secondary alignments, so this is off by default.
+    bool stop_at_mapq_cap = false;
+    /// How far apart in the graph can the two mates of a pair be and still
+    /// be clustered and paired together? Also bounds the rescue search.
+    size_t fragment_distance_limit = 2000;
+    /// Mean of the fragment length distribution. Pairs are scored by the
+    /// likelihood of their fragment length under a normal distribution.
+    double fragment_length_mean = 500;
+    /// Standard deviation of the fragment length distribution.
+    double fragment_length_stdev = 150;
+    /// How many of each mate's best unpaired alignments should we try to
+    /// rescue the other mate from?
+    size_t max_rescue_attempts = 2;
+    /// Ignore minimizers with more than this many locations when rescuing.
+    /// Rescue only looks near the other mate, so it can afford more hits than
+    /// hit_cap.
+    size_t rescue_hit_cap = 100;
     string sample_name;
     string read_group;
 
@@ -57,8 +121,11 @@ protected:
     SnarlManager* snarl_manager;
     DistanceIndex* distance_index;
 
-    /// We have a GBWTGraph over the GBWT and the XG
-    GBWTGraph gbwt_graph;
+    /// The GBWTGraph we build over the GBWT and the XG, if we were not given one
+    unique_ptr<GBWTGraph> owned_gbwt_graph;
+    
+    /// We have a GBWTGraph over the GBWT
+    const GBWTGraph& gbwt_graph;
     
     /// We have a gapless extender to extend seed hits in haplotype space.
     GaplessExtender extender;
@@ -66,6 +133,109 @@ protected:
     /// We have a clusterer
     SnarlSeedClusterer clusterer;
     
+    /**
+     * The work we can still do for one read, and which limits we have run
+     * into. Made by start_budget() and reported by finish_budget().
+     */
+    struct WorkBudget {
+        size_t seeds_left;
+        size_t dp_cells_left;
+        size_t gbwt_states_left;
+        
+        bool seeds_limited = false;
+        bool dp_limited = false;
+        bool gbwt_limited = false;
+        bool clusters_limited = false;
+        bool stopped_at_mapq_cap = false;
+    };
+    
+    /// How many reads ran into each limit, over all threads
+    struct WorkLimitCounts {
+        atomic<size_t> reads {0};
+        atomic<size_t> seeds_limited {0};
+        atomic<size_t> dp_limited {0};
+        atomic<size_t> gbwt_limited {0};
+        atomic<size_t> clusters_limited {0};
+        atomic<size_t> stopped_at_mapq_cap {0};
+    };
+    mutable WorkLimitCounts work_limit_counts;
+    
+    /// Get a full budget for a new read.
+    WorkBudget start_budget() const;
+    
+    /// Count the limits the given read ran into, and annotate the read with them.
+    void finish_budget(const WorkBudget& budget, Alignment& out) const;
+    
+    /**
+     * Find the minimizers in the given read, and the seed hits in the graph
+     * for those that are not too frequent. seed_to_source is filled with the
+     * index of the minimizer each seed came from.
+     */
+    void find_seeds(const Alignment& aln, vector<MinimizerIndex::minimizer_type>& minimizers,
+        vector<pos_t>& seeds, vector<size_t>& seed_to_source, WorkBudget& budget, Funnel& funnel) const;
+    
+    /**
+     * Get the fraction of the read covered by the minimizers that produced
+     * the seeds in the given cluster.
+     */
+    double cluster_coverage(const Alignment& aln, const vector<size_t>& cluster,
+        const vector<MinimizerIndex::minimizer_type>& minimizers, const vector<size_t>& seed_to_source) const;
+    
+    /**
+     * Extend the best of the given clusters of seeds, and align the most
+     * promising groups of extensions. Clears any old alignment from aln.
+     * Returns the alignments in estimated score order, or a single unaligned
+     * Alignment if nothing could be aligned. Fills alignment_clusters with the
+     * cluster each alignment came from, or numeric_limits<size_t>::max() for
+     * the unaligned placeholder. Clusters with less than
+     * min_cluster_coverage_fraction of the best one's read coverage are not
+     * extended. If may_stop_at_mapq_cap is set, aligning stops once the MAPQ
+     * of this read alone is settled.
+     */
+    vector<Alignment> align_clusters(Alignment& aln, const vector<vector<size_t>>& clusters,
+        const vector<MinimizerIndex::minimizer_type>& minimizers, const vector<pos_t>& seeds, const vector<size_t>& seed_to_source,
+        bool may_stop_at_mapq_cap, WorkBudget& budget, Funnel& funnel, vector<size_t>& alignment_clusters) const;
+    
+    /**
+     * Turn a group of gapless extensions of the given read into an alignment
+     * in out, either directly for a single full-length extension or by
+     * chaining. score_estimate must come from estimate_extension_group_score().
+     */
+    void align_extensions(const Alignment& aln, vector<GaplessExtension>& extensions, int score_estimate,
+        Alignment& out, WorkBudget& budget, Funnel& funnel) const;
+    
+    /**
+     * Try to align the given mate near the given aligned anchor from the
+     * other mate, by gapless extension of the mate's seed hits that lie in a
+     * fragment of length up to fragment_distance_limit with the anchor.
+     * anchor_is_first says whether the anchor is mate 1. Minimizers are used
+     * up to rescue_hit_cap hits. Returns true and fills in out if an
+     * alignment was found.
+     */
+    bool rescue_mate(const Alignment& anchor, bool anchor_is_first, const Alignment& mate,
+        const vector<MinimizerIndex::minimizer_type>& mate_minimizers, Alignment& out, WorkBudget& budget, Funnel& funnel) const;
+    
+    /**
+     * Get the length of the fragment between the given start positions of
+     * mate 1 and mate 2, or -1 if they are not connected. Mates are expected
+     * to face each other, with mate 2 read from the other strand, so this
+     * takes a single oriented distance lookup.
+     */
+    int64_t fragment_length(const pos_t& mate1_start, const pos_t& mate2_start) const;
+    
+    /**
+     * Get the log likelihood of the given fragment length, up to a constant,
+     * under the fragment length distribution.
+     */
+    double fragment_length_log_likelihood(int64_t length) const;
+    
+    /**
+     * Score a pair of alignments of mate 1 and mate 2 by their alignment
+     * scores and the likelihood of their fragment length. Returns NaN if
+     * either is unaligned or they do not face each other.
+     */
+    double pair_score(const Alignment& aln1, const Alignment& aln2) const;
+    
     /**
      * Estimate the score it may be possible to achieve using the given group of GaplessExtensions.
      * Supports single full-length extensions and groups that need chaining.
@@ -80,16 +250,28 @@ protected:
      */
     bool score_is_significant(int score_estimate, int best_score, int second_best_score) const; 
     
+    /**
+     * Determine if one of the given alignments would win, with its MAPQ at
+     * the cap, even if the extension groups in the given range, which have
+     * not been aligned yet, all aligned with their estimated scores.
+     */
+    bool mapq_is_settled(const vector<Alignment>& alignments, const vector<int>& score_estimates,
+        vector<size_t>::const_iterator unaligned_begin, vector<size_t>::const_iterator unaligned_end) const;
+    
     /**
      * Operating on the given input alignment, chain together the given
      * extended perfect-match seeds and produce an alignment into the given
-     * output Alignment object.
+     * output Alignment object. DP cells and GBWT search states come out of
+     * the given budget.
      */
-    void chain_extended_seeds(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, Alignment& out) const; 
+    void chain_extended_seeds(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, Alignment& out,
+        WorkBudget& budget) const;
     
     /**
-     * Find for each pair of extended seeds all the haplotype-consistent graph
-     * paths against which the intervening read sequence needs to be aligned.
+     * Find for each pair of extended seeds the forest of haplotype-consistent
+     * walks in the GBWTGraph against which the intervening read sequence needs
+     * to be aligned. Walks that share a prefix share forest nodes, so the DP
+     * for the shared part is only done once.
      *
      * Limits walks from each extended seed end to the longest detectable gap
      * plus the remaining to-be-alinged sequence, both computed using the read
@@ -98,51 +280,61 @@ protected:
      * extended_seeds must be sorted by read start position. Any extended seeds
      * that overlap in the read will be precluded from connecting.
      *
-     * numeric_limits<size_t>::max() is used to store sufficiently long Paths
-     * ending before sources (which cannot be reached from other extended
-     * seeds) and starting after sinks (which cannot reach any other extended
-     * seeds). Only sources and sinks have these "tail" paths.
+     * An empty forest between two extended seeds means that they abut in the
+     * graph. If they abut and are also connected by longer walks, the forest
+     * holds the longer walks, and the destination is recorded under the
+     * source in direct_connections, so that both can be tried.
+     *
+     * numeric_limits<size_t>::max() is used to store sufficiently long
+     * forests ending before sources (which cannot be reached from other
+     * extended seeds) and starting after sinks (which cannot reach any other
+     * extended seeds). Only sources and sinks have these "tail" forests. The
+     * forests ending before sources are stored in the reverse orientation,
+     * going left from the source. An empty tail forest means that no
+     * haplotypes continue past the extended seed.
      */
-    unordered_map<size_t, unordered_map<size_t, vector<Path>>> find_connecting_paths(const vector<GaplessExtension>& extended_seeds,
-        size_t read_length) const;
-        
-    /// We define a type for shared-tail lists of Mappings, to avoid constantly
-    /// copying Path objects.
-    using ImmutablePath = structures::ImmutableList<Mapping>;
+    unordered_map<size_t, unordered_map<size_t, vector<TreeSubgraph::TreeNode>>> find_connecting_trees(const vector<GaplessExtension>& extended_seeds,
+        size_t read_length, WorkBudget& budget, unordered_map<size_t, unordered_set<size_t>>& direct_connections) const;
     
     /**
-     * Get the from length of an ImmutabelPath.
-     *
-     * Can't be called path_from_length or it will shadow the one for Paths
-     * instead of overloading.
+     * Given a forest and some of its nodes, get the forest of just the walks
+     * that end at those nodes, in which all of those nodes are leaves. Nodes
+     * past an end are kept if they lead to other ends, and the end then gets
+     * its own copy of the walk to it. Ends of -1, meaning that we can get
+     * there without taking any graph, are skipped; the caller has to consider
+     * that connection on its own.
      */
-    static size_t immutable_path_from_length(const ImmutablePath& path);
+    static vector<TreeSubgraph::TreeNode> walks_to(const vector<TreeSubgraph::TreeNode>& forest, const vector<int64_t>& ends);
     
     /**
-     * Convert an ImmutablePath to a Path.
+     * Get the shortest walk from a root to a leaf in a nonempty forest, as a
+     * forest of one chain.
      */
-    static Path to_path(const ImmutablePath& path);
+    static vector<TreeSubgraph::TreeNode> shortest_walk(const vector<TreeSubgraph::TreeNode>& forest);
 
     /**
      * Given a Position, explore the GBWT graph out to the given maximum walk
-     * distance.
+     * distance, and return the forest of haplotype-consistent walks.
      *
-     * Calls the visit callback with the list of Mappings being extended (in
-     * reverse order) and the handle it is being extended with.
+     * Calls the visit callback with the forest so far, the forest node being
+     * extended (or -1 if we are extending from the from Position itself), and
+     * the handle it is being extended with. The callback may add nodes to the
+     * forest.
      *
-     * Only considers paths that visit at least one node after the node the
+     * Only considers walks that visit at least one node after the node the
      * from Position is on. The from Position cuts immediately before the
-     * first included base.
+     * first included base, and the rest of its node is the root of the forest
+     * if it is not empty.
      *
      * If the callback returns false, that GBWT search state is not extended
-     * further.
+     * further. Otherwise the handle is added to the forest, cut short if it
+     * goes past the walk distance limit.
      *
-     * If the walk_distance limit is exceeded, or a dead end in the graph is
-     * hit, calls the limit callback with the list of Mappings (in reverse
-     * order) that passed the limit or hit the dead end.
+     * Each search state visited comes out of the budget, and the search stops
+     * when the budget runs out.
      */
-    void explore_gbwt(const Position& from, size_t walk_distance, const function<bool(const ImmutablePath&, const handle_t&)>& visit_callback,
-        const function<void(const ImmutablePath&)>& limit_callback) const;
+    vector<TreeSubgraph::TreeNode> explore_gbwt(const Position& from, size_t walk_distance, WorkBudget& budget,
+        const function<bool(vector<TreeSubgraph::TreeNode>&, int64_t, const handle_t&)>& visit_callback) const;
      
 };
 
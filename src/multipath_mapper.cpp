@@ -131,9 +131,9 @@ namespace vg {
             }
         }
         
-        // clean up the cluster graphs
+        // return the cluster graphs to the pool
         for (auto cluster_graph : cluster_graphs) {
-            delete get<0>(cluster_graph);
+            release_cluster_graph(get<0>(cluster_graph));
         }
 #ifdef debug_pretty_print_alignments
         cerr << "final alignments being returned:" << endl;
@@ -446,7 +446,7 @@ namespace vg {
         }
         
         // pull out the graph around the position(s) we jumped to
-        HashGraph rescue_graph;
+        SubHandleGraph rescue_graph(xindex);
         vector<size_t> backward_dist(jump_positions.size(), 6 * fragment_length_distr.stdev());
         vector<size_t> forward_dist(jump_positions.size(), 6 * fragment_length_distr.stdev() + other_aln.sequence().size());
         algorithms::extract_containing_graph(xindex, &rescue_graph, jump_positions, backward_dist, forward_dist,
@@ -1725,12 +1725,12 @@ namespace vg {
             set_annotation(&multipath_aln_pair.second, "fragment_length_distribution", distribution);
         }
         
-        // clean up the graph objects on the heap
+        // return the cluster graphs to the pool
         for (auto cluster_graph : cluster_graphs1) {
-            delete get<0>(cluster_graph);
+            release_cluster_graph(get<0>(cluster_graph));
         }
         for (auto cluster_graph : cluster_graphs2) {
-            delete get<0>(cluster_graph);
+            release_cluster_graph(get<0>(cluster_graph));
         }
         
 #ifdef debug_pretty_print_alignments
@@ -2477,7 +2477,7 @@ namespace vg {
             auto prev_1 = previous_multipath_alns_1.find(cluster_pair.first.first);
             if (prev_1 == previous_multipath_alns_1.end()) {
                 // we haven't done this alignment yet, so we have to complete it for the first time
-                HashGraph* graph1 = get<0>(cluster_graphs1[cluster_pair.first.first]);
+                auto graph1 = get<0>(cluster_graphs1[cluster_pair.first.first]);
                 memcluster_t& graph_mems1 = get<1>(cluster_graphs1[cluster_pair.first.first]);
                 
 #ifdef debug_multipath_mapper
@@ -2579,7 +2579,7 @@ namespace vg {
         unordered_map<id_t, size_t> node_id_to_cluster;
         
         // to hold the clusters as they are (possibly) merged
-        unordered_map<size_t, HashGraph*> cluster_graphs;
+        unordered_map<size_t, SubHandleGraph*> cluster_graphs;
         
         // to keep track of which clusters have been merged
         UnionFind union_find(clusters.size());
@@ -2621,7 +2621,7 @@ namespace vg {
             
             // extract the subgraph within the search distance
             
-            auto cluster_graph = new HashGraph();
+            auto cluster_graph = get_cluster_graph();
             algorithms::extract_containing_graph(xindex, cluster_graph, positions, forward_max_dist, backward_max_dist,
                                                  num_alt_alns > 1 ? reversing_walk_length : 0);
                                                  
@@ -2676,7 +2676,7 @@ namespace vg {
                 cerr << "merging as cluster " << remaining_idx << endl;
 #endif
                 
-                HashGraph* merging_graph;
+                SubHandleGraph* merging_graph;
                 if (remaining_idx == i) {
                     // the new graph was chosen to remain, so add it to the record
                     cluster_graphs[i] = cluster_graph;
@@ -2685,16 +2685,20 @@ namespace vg {
                 else {
                     // the new graph will be merged into an existing graph
                     merging_graph = cluster_graphs[remaining_idx];
-                    algorithms::extend(cluster_graph, merging_graph);
-                    delete cluster_graph;
+                    cluster_graph->for_each_handle([&](const handle_t& handle) {
+                        merging_graph->add_handle(handle);
+                    });
+                    release_cluster_graph(cluster_graph);
                 }
                 
                 // merge any other chained graphs into the remaining graph
                 for (size_t j : overlapping_graphs) {
                     if (j != remaining_idx) {
                         auto removing_graph = cluster_graphs[j];
-                        algorithms::extend(removing_graph, merging_graph);
-                        delete removing_graph;
+                        removing_graph->for_each_handle([&](const handle_t& handle) {
+                            merging_graph->add_handle(handle);
+                        });
+                        release_cluster_graph(removing_graph);
                         cluster_graphs.erase(j);
                     }
                 }
@@ -2738,44 +2742,21 @@ namespace vg {
             }
 #endif
             
+            // divvy up the nodes (the edges come along with them, since they're induced from the xg)
             for (size_t i = 0; i < multicomponent_graph.second.size(); i++) {
-                cluster_graphs[max_graph_idx + i] = new HashGraph();
-            }
-            
-            // divvy up the nodes
-            auto joined_graph = cluster_graphs[multicomponent_graph.first];
-            joined_graph->for_each_handle([&](const handle_t& handle) {
-                for (size_t j = 0; j < multicomponent_graph.second.size(); j++) {
-                    if (multicomponent_graph.second[j].count(joined_graph->get_id(handle))) {
-                        cluster_graphs[max_graph_idx + j]->create_handle(joined_graph->get_sequence(handle),
-                                                                         joined_graph->get_id(handle));
-                        // if we're suppressing cluster merging, we don't maintain this index
-                        if (!suppress_cluster_merging) {
-                            node_id_to_cluster[joined_graph->get_id(handle)] = max_graph_idx + j;
-                        }
-                        break;
-                    }
-                }
-                return true;
-            });
-            
-            // divvy up the edges
-            joined_graph->for_each_edge([&](const edge_t& edge) {
-                for (size_t j = 0; j < multicomponent_graph.second.size(); j++) {
-                    if (multicomponent_graph.second[j].count(joined_graph->get_id(edge.first))) {
-                        auto comp_graph = cluster_graphs[max_graph_idx + j];
-                        comp_graph->create_edge(comp_graph->get_handle(joined_graph->get_id(edge.first),
-                                                                       joined_graph->get_is_reverse(edge.first)),
-                                                comp_graph->get_handle(joined_graph->get_id(edge.second),
-                                                                       joined_graph->get_is_reverse(edge.second)));
-                        break;
+                auto comp_graph = get_cluster_graph();
+                for (id_t node_id : multicomponent_graph.second[i]) {
+                    comp_graph->add_handle(xindex->get_handle(node_id));
+                    // if we're suppressing cluster merging, we don't maintain this index
+                    if (!suppress_cluster_merging) {
+                        node_id_to_cluster[node_id] = max_graph_idx + i;
                     }
                 }
-                return true;
-            });
+                cluster_graphs[max_graph_idx + i] = comp_graph;
+            }
             
             // remove the old graph
-            delete cluster_graphs[multicomponent_graph.first];
+            release_cluster_graph(cluster_graphs[multicomponent_graph.first]);
             cluster_graphs.erase(multicomponent_graph.first);
             
             if (suppress_cluster_merging) {
@@ -2891,7 +2872,7 @@ namespace vg {
             
         // find the node ID range for the cluster graphs to help set up a stable, system-independent ordering
         // note: technically this is not quite a total ordering, but it should be close to one
-        unordered_map<HashGraph*, pair<id_t, id_t>> node_range;
+        unordered_map<SubHandleGraph*, pair<id_t, id_t>> node_range;
         node_range.reserve(cluster_graphs_out.size());
         for (const auto& cluster_graph : cluster_graphs_out) {
             node_range[get<0>(cluster_graph)] = make_pair(get<0>(cluster_graph)->min_node_id(),
@@ -2912,7 +2893,7 @@ namespace vg {
         
     }
     
-    void MultipathMapper::multipath_align(const Alignment& alignment, const HashGraph* graph,
+    void MultipathMapper::multipath_align(const Alignment& alignment, const HandleGraph* graph,
                                           memcluster_t& graph_mems,
                                           MultipathAlignment& multipath_aln_out) const {
 
@@ -2951,8 +2932,7 @@ namespace vg {
             else {
                 // if we are using only the forward strand of the current graph, a make trivial node translation so
                 // the later code's expectations are met
-                // TODO: can we do this without the copy constructor?
-                align_graph = *graph;
+                algorithms::extend(graph, &align_graph);
                 node_trans.reserve(graph->node_size());
                 graph->for_each_handle([&](const handle_t& handle) {
                     node_trans[graph->get_id(handle)] = make_pair(graph->get_id(handle), false);
@@ -3918,6 +3898,22 @@ namespace vg {
             
     // make the memos live in this .o file
     thread_local unordered_map<pair<double, size_t>, haploMath::RRMemo> MultipathMapper::rr_memos;
+    thread_local vector<unique_ptr<SubHandleGraph>> MultipathMapper::cluster_graph_pool;
+    
+    SubHandleGraph* MultipathMapper::get_cluster_graph() const {
+        if (cluster_graph_pool.empty()) {
+            return new SubHandleGraph(xindex);
+        }
+        SubHandleGraph* cluster_graph = cluster_graph_pool.back().release();
+        cluster_graph_pool.pop_back();
+        // the pool is shared by all mappers on this thread
+        cluster_graph->reset(xindex);
+        return cluster_graph;
+    }
+    
+    void MultipathMapper::release_cluster_graph(SubHandleGraph* cluster_graph) const {
+        cluster_graph_pool.emplace_back(cluster_graph);
+    }
     
     haploMath::RRMemo& MultipathMapper::get_rr_memo(double recombination_penalty, size_t population_size) const {
         auto iter = rr_memos.find(make_pair(recombination_penalty, population_size));
@@ -23,6 +23,7 @@
 #include "distance.hpp"
 #include "utility.hpp"
 #include "hash_graph.hpp"
+#include "subgraph.hpp"
 #include "annotation.hpp"
 
 #include "algorithms/topological_sort.hpp"
@@ -157,10 +158,11 @@ namespace vg {
         using memcluster_t = vector<pair<const MaximalExactMatch*, pos_t>>;
         
         /// This represents a graph for a cluster, and holds a pointer to the
-        /// actual extracted graph, a list of assigned MEMs, and the number of
-        /// bases of read coverage that that MEM cluster provides (which serves
-        /// as a priority).
-        using clustergraph_t = tuple<HashGraph*, memcluster_t, size_t>;
+        /// extracted graph, a list of assigned MEMs, and the number of bases
+        /// of read coverage that that MEM cluster provides (which serves as a
+        /// priority). The graph is a view over the xg index that comes from
+        /// get_cluster_graph().
+        using clustergraph_t = tuple<SubHandleGraph*, memcluster_t, size_t>;
         
     protected:
         
@@ -266,7 +268,7 @@ namespace vg {
         /// are merged into one subgraph. Returns a vector of all the merged
         /// cluster subgraphs, their MEMs assigned from the mems vector
         /// according to the MEMs' hits, and their read coverages in bp. The
-        /// caller must delete the VG objects produced!
+        /// caller must return the graphs with release_cluster_graph()!
         vector<clustergraph_t> query_cluster_graphs(const Alignment& alignment,
                                                     const vector<MaximalExactMatch>& mems,
                                                     const vector<memcluster_t>& clusters);
@@ -290,7 +292,7 @@ namespace vg {
         /// Make a multipath alignment of the read against the indicated graph and add it to
         /// the list of multimappings.
         /// Does NOT necessarily produce a MultipathAlignment in topological order.
-        void multipath_align(const Alignment& alignment, const HashGraph* graph,
+        void multipath_align(const Alignment& alignment, const HandleGraph* graph,
                              memcluster_t& graph_mems,
                              MultipathAlignment& multipath_aln_out) const;
         
@@ -386,6 +388,13 @@ namespace vg {
         /// Generates a distance measurer to be used for a mapping problem
         unique_ptr<OrientedDistanceMeasurer> create_distance_measurer();
         
+        /// Get an empty subgraph of the xg index from the thread_local pool, allocating
+        /// a new one only if the pool is empty
+        SubHandleGraph* get_cluster_graph() const;
+        
+        /// Return a subgraph from get_cluster_graph() to the thread_local pool
+        void release_cluster_graph(SubHandleGraph* cluster_graph) const;
+        
         /// Get a thread_local RRMemo with these parameters
         haploMath::RRMemo& get_rr_memo(double recombination_penalty, size_t population_size) const;;
         
@@ -400,6 +409,10 @@ namespace vg {
         /// Memos used by population model
         static thread_local unordered_map<pair<double, size_t>, haploMath::RRMemo> rr_memos;
         
+        /// Cluster subgraphs kept for reuse, so that their node sets don't need to be
+        /// reallocated for every read
+        static thread_local vector<unique_ptr<SubHandleGraph>> cluster_graph_pool;
+        
         // a memo for the transcendental p-value function (thread local to maintain threadsafety)
         static thread_local unordered_map<pair<size_t, size_t>, double> p_value_memo;
         
@@ -34,6 +34,13 @@ void Sampler::set_source_paths(const vector<string>& source_paths,
 }
     
 
+uint32_t derive_stream_seed(uint32_t master_seed, size_t stream) {
+    size_t hashed = wang_hash_64((size_t(master_seed) << 32) | (stream & 0xFFFFFFFF));
+    uint32_t derived = uint32_t(hashed ^ (hashed >> 32));
+    // 0 means "seed from the clock" to the samplers
+    return derived ? derived : 1;
+}
+
 /// We have a helper function to convert path positions and orientations to
 /// pos_t values.
 pos_t position_at(xg::XG* xgidx, const string& path_name, const size_t& path_offset, bool is_reverse) {
@@ -329,7 +336,7 @@ vector<Alignment> Sampler::alignment_pair(size_t read_length, size_t fragment_le
         string data;
         aln1.SerializeToString(&data);
         aln2.SerializeToString(&data);
-        int n;
+        int64_t n;
 #pragma omp critical(nonce)
         n = nonce++;
         data += std::to_string(n);
@@ -411,7 +418,7 @@ Alignment Sampler::alignment_to_path(const string& source_path, size_t length) {
     { // name the alignment
         string data;
         aln.SerializeToString(&data);
-        int n;
+        int64_t n;
 #pragma omp critical(nonce)
         n = nonce++;
         data += std::to_string(n);
@@ -464,7 +471,7 @@ Alignment Sampler::alignment_to_graph(size_t length) {
     { // name the alignment
         string data;
         aln.SerializeToString(&data);
-        int n;
+        int64_t n;
 #pragma omp critical(nonce)
         n = nonce++;
         data += std::to_string(n);
@@ -521,15 +528,15 @@ Alignment Sampler::alignment_with_error(size_t length,
 }
 
 size_t Sampler::node_length(id_t id) {
-    return xg_cached_node_length(id, xgidx, node_cache);
+    return xg_node_length(id, xgidx);
 }
 
 char Sampler::pos_char(pos_t pos) {
-    return xg_cached_pos_char(pos, xgidx, node_cache);
+    return xg_pos_char(pos, xgidx);
 }
 
 map<pos_t, char> Sampler::next_pos_chars(pos_t pos) {
-    return xg_cached_next_pos_chars(pos, xgidx, node_cache, edge_cache);
+    return xg_next_pos_chars(pos, xgidx);
 }
 
 bool Sampler::is_valid(const Alignment& aln) {
@@ -578,8 +585,6 @@ NGSSimulator::NGSSimulator(xg::XG& xg_index,
                            bool retry_on_Ns,
                            size_t seed) :
       xg_index(xg_index)
-    , node_cache(100)
-    , edge_cache(100)
     , sub_poly_rate(substition_polymorphism_rate)
     , indel_poly_rate(indel_polymorphism_rate)
     , indel_error_prop(indel_error_proportion)
@@ -718,6 +723,41 @@ NGSSimulator::NGSSimulator(xg::XG& xg_index,
 #endif
 }
 
+NGSSimulator::NGSSimulator(const NGSSimulator& other, size_t stream_seed) :
+      mutation_alphabets(other.mutation_alphabets)
+    , phred_prob(other.phred_prob)
+    , transition_distrs_1(other.transition_distrs_1)
+    , transition_distrs_2(other.transition_distrs_2)
+    , joint_initial_distr(other.joint_initial_distr)
+    , xg_index(other.xg_index)
+    , prng(stream_seed)
+    , path_sampler(other.path_sampler)
+    , start_pos_samplers(other.start_pos_samplers)
+    , strand_sampler(other.strand_sampler)
+    , background_sampler(other.background_sampler)
+    , mut_sampler(other.mut_sampler)
+    , prob_sampler(other.prob_sampler)
+    , insert_sampler(other.insert_sampler)
+    , sub_poly_rate(other.sub_poly_rate)
+    , indel_poly_rate(other.indel_poly_rate)
+    , indel_error_prop(other.indel_error_prop)
+    , insert_mean(other.insert_mean)
+    , insert_sd(other.insert_sd)
+    , seed(stream_seed)
+    , retry_on_Ns(other.retry_on_Ns)
+    , source_paths(other.source_paths)
+{
+    // the trained quality distributions keep their own generators, so reseed
+    // them the same way the training constructor seeds them
+    joint_initial_distr.reseed(stream_seed - 1);
+    for (size_t i = 0; i < transition_distrs_1.size(); i++) {
+        transition_distrs_1[i].reseed(stream_seed + i + 1);
+    }
+    for (size_t i = 0; i < transition_distrs_2.size(); i++) {
+        transition_distrs_2[i].reseed(stream_seed + i + 1);
+    }
+}
+
 Alignment NGSSimulator::sample_read() {
     
     
@@ -882,13 +922,13 @@ void NGSSimulator::sample_read_internal(Alignment& aln, size_t& offset, bool& is
                                         const string& source_path) {
    
     // Make sure we are starting inside the node
-    auto first_node_length = xg_cached_node_length(id(curr_pos), &xg_index, node_cache);
+    auto first_node_length = xg_node_length(id(curr_pos), &xg_index);
     assert(vg::offset(curr_pos) < first_node_length);
    
     aln.clear_path();
     aln.clear_sequence();
     
-    char graph_char = xg_cached_pos_char(curr_pos, &xg_index, node_cache);
+    char graph_char = xg_pos_char(curr_pos, &xg_index);
     bool hit_end = false;
     
     // walk a path and generate a read sequence at the same time
@@ -1000,10 +1040,7 @@ bool NGSSimulator::advance(size_t& offset, bool& is_reverse, pos_t& pos, char& g
 bool NGSSimulator::advance_on_graph(pos_t& pos, char& graph_char) {
     
     // choose a next position at random
-    map<pos_t, char> next_pos_chars = xg_cached_next_pos_chars(pos,
-                                                               &xg_index,
-                                                               node_cache,
-                                                               edge_cache);
+    map<pos_t, char> next_pos_chars = xg_next_pos_chars(pos, &xg_index);
     if (next_pos_chars.empty()) {
         return true;
     }
@@ -1042,7 +1079,7 @@ bool NGSSimulator::advance_on_path(size_t& offset, bool& is_reverse, pos_t& pos,
     pos = position_at(&xg_index, source_path, offset, is_reverse);
     
     // And look up the character
-    graph_char = xg_cached_pos_char(pos, &xg_index, node_cache);
+    graph_char = xg_pos_char(pos, &xg_index);
     
     return false;
 }
@@ -1175,7 +1212,7 @@ pos_t NGSSimulator::walk_backwards(const Path& path, size_t distance) {
     }
     
     // Get the length of the node we landed on
-    auto node_length = xg_cached_node_length(mapping_pos.node_id(), &xg_index, node_cache);
+    auto node_length = xg_node_length(mapping_pos.node_id(), &xg_index);
     // The position we pick should not be past the end of the node.
     if (offset >= node_length) {
         cerr << pb2json(path) << endl;
@@ -1464,6 +1501,11 @@ NGSSimulator::MarkovDistribution<From, To>::MarkovDistribution(size_t seed) : pr
     // nothing to do
 }
 
+template<class From, class To>
+void NGSSimulator::MarkovDistribution<From, To>::reseed(size_t seed) {
+    prng.seed(seed);
+}
+
 template<class From, class To>
 void NGSSimulator::MarkovDistribution<From, To>::record_transition(From from, To to) {
     if (!cond_distrs.count(from)) {
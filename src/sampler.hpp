@@ -30,6 +30,10 @@ using namespace std;
 /// forward version of the path.
 pos_t position_at(xg::XG* xgidx, const string& path_name, const size_t& path_offset, bool is_reverse);
 
+/// Derive the seed for one of several independent random streams from a
+/// master seed, so that simulating in parallel is reproducible. Never returns 0.
+uint32_t derive_stream_seed(uint32_t master_seed, size_t stream);
+
 /**
  * Generate Alignments (with or without mutations, and in pairs or alone) from
  * an XG index.
@@ -39,10 +43,6 @@ class Sampler {
 public:
 
     xg::XG* xgidx;
-    // We need this so we don't re-load the node for every character we visit in
-    // it.
-    LRUCache<id_t, Node> node_cache;
-    LRUCache<id_t, vector<Edge> > edge_cache;
     mt19937 rng;
     int64_t nonce;
     // If set, only sample positions/start reads on the forward strands of their
@@ -60,8 +60,6 @@ public:
             const vector<string>& source_paths = {},
             const vector<pair<string, double>>& transcript_expressions = {})
         : xgidx(x),
-          node_cache(100),
-          edge_cache(100),
           forward_only(forward_only),
           no_Ns(!allow_Ns),
           nonce(0),
@@ -157,6 +155,12 @@ public:
                  bool retry_on_Ns = true,
                  size_t seed = 0);
     
+    /// Make a copy of a trained simulator that draws from its own random
+    /// stream with the given (nonzero) seed, so that several threads can
+    /// simulate at once without retraining. Read names are drawn from the new
+    /// seed as well, so they do not clash between streams.
+    NGSSimulator(const NGSSimulator& other, size_t stream_seed);
+    
     /// Sample an individual read and alignment
     Alignment sample_read();
     
@@ -169,6 +173,9 @@ private:
     public:
         MarkovDistribution(size_t seed);
         
+        /// restart the random number generator with a new seed
+        void reseed(size_t seed);
+        
         /// record a transition from the input data
         void record_transition(From from, To to);
         /// indicate that there is no more data and prepare for sampling
@@ -277,9 +284,6 @@ private:
     
     xg::XG& xg_index;
     
-    LRUCache<id_t, Node> node_cache;
-    LRUCache<id_t, vector<Edge> > edge_cache;
-    
     default_random_engine prng;
     vg::discrete_distribution<> path_sampler;
     vector<vg::uniform_int_distribution<size_t>> start_pos_samplers;
@@ -0,0 +1,356 @@
+/**
+ * \file snarl_tree_index.cpp: contains the implementation of SnarlTreeIndex
+ */
+
+#include "snarl_tree_index.hpp"
+
+#include <sstream>
+
+#include <sdsl/util.hpp>
+#include <vg/io/vpkg.hpp>
+
+#include "utility.hpp"
+
+namespace vg {
+
+using namespace std;
+
+    const size_t SnarlTreeIndex::no_snarl;
+
+    SnarlTreeIndex::SnarlTreeIndex() {
+        // nothing to do
+    }
+
+    SnarlTreeIndex::SnarlTreeIndex(istream& in) {
+        load(in);
+    }
+
+    SnarlTreeIndex::SnarlTreeIndex(const SnarlManager& manager) {
+
+        // number the snarls in preorder, and record their subtree ends as we finish them
+        unordered_map<const Snarl*, size_t> number;
+        vector<const Snarl*> preorder;
+        vector<size_t> ends_of_subtrees;
+        function<void(const Snarl*)> number_subtree = [&](const Snarl* snarl) {
+            size_t here = preorder.size();
+            number[snarl] = here;
+            preorder.push_back(snarl);
+            ends_of_subtrees.push_back(0);
+            for (const Snarl* child : manager.children_of(snarl)) {
+                number_subtree(child);
+            }
+            ends_of_subtrees[here] = preorder.size();
+        };
+        for (const Snarl* root : manager.top_level_snarls()) {
+            number_subtree(root);
+        }
+
+        size_t num_snarls = preorder.size();
+        starts = sdsl::int_vector<>(num_snarls);
+        ends = sdsl::int_vector<>(num_snarls);
+        types = sdsl::int_vector<>(num_snarls);
+        flags = sdsl::int_vector<>(num_snarls);
+        parents = sdsl::int_vector<>(num_snarls);
+        subtree_ends = sdsl::int_vector<>(num_snarls);
+        chains = sdsl::int_vector<>(num_snarls);
+        chain_ranks = sdsl::int_vector<>(num_snarls);
+
+        // number the chains in order of their first snarl, and lay out their members
+        unordered_map<const Chain*, size_t> chain_number;
+        vector<size_t> offsets;
+        vector<uint64_t> members;
+
+        // collect the node sides that point into each snarl
+        vector<pair<uint64_t, size_t>> boundaries;
+        boundaries.reserve(2 * num_snarls);
+
+        for (size_t i = 0; i < num_snarls; i++) {
+            const Snarl* snarl = preorder[i];
+
+            starts[i] = pack(snarl->start().node_id(), snarl->start().backward());
+            ends[i] = pack(snarl->end().node_id(), snarl->end().backward());
+            types[i] = snarl->type();
+            flags[i] = ((snarl->start_self_reachable() ? START_SELF_REACHABLE : 0) |
+                        (snarl->end_self_reachable() ? END_SELF_REACHABLE : 0) |
+                        (snarl->start_end_reachable() ? START_END_REACHABLE : 0) |
+                        (snarl->directed_acyclic_net_graph() ? DIRECTED_ACYCLIC_NET_GRAPH : 0));
+
+            const Snarl* parent = manager.parent_of(snarl);
+            parents[i] = parent == nullptr ? 0 : number.at(parent) + 1;
+            subtree_ends[i] = ends_of_subtrees[i];
+
+            const Chain* chain = manager.chain_of(snarl);
+            if (chain == nullptr) {
+                // treat the snarl as a chain of its own
+                chains[i] = offsets.size();
+                chain_ranks[i] = 0;
+                offsets.push_back(members.size());
+                members.push_back(((i + 1) << 1));
+            }
+            else {
+                auto found = chain_number.find(chain);
+                if (found == chain_number.end()) {
+                    found = chain_number.emplace(chain, offsets.size()).first;
+                    offsets.push_back(members.size());
+                    for (auto& chain_snarl : *chain) {
+                        members.push_back(((number.at(chain_snarl.first) + 1) << 1) | (chain_snarl.second ? 1 : 0));
+                    }
+                }
+                chains[i] = found->second;
+                chain_ranks[i] = manager.chain_rank_of(snarl);
+            }
+
+            boundaries.emplace_back(pack(snarl->start().node_id(), snarl->start().backward()), i);
+            boundaries.emplace_back(pack(snarl->end().node_id(), !snarl->end().backward()), i);
+        }
+        offsets.push_back(members.size());
+
+        chain_offsets = sdsl::int_vector<>(offsets.size());
+        for (size_t i = 0; i < offsets.size(); i++) {
+            chain_offsets[i] = offsets[i];
+        }
+        chain_members = sdsl::int_vector<>(members.size());
+        for (size_t i = 0; i < members.size(); i++) {
+            chain_members[i] = members[i];
+        }
+
+        // lay out the node sides in bit order, letting the later snarl win if two snarls
+        // claim the same node side, as in the SnarlManager's index
+        stable_sort(boundaries.begin(), boundaries.end(), [](const pair<uint64_t, size_t>& a,
+                                                             const pair<uint64_t, size_t>& b) {
+            return a.first < b.first;
+        });
+        size_t num_boundaries = 0;
+        for (size_t i = 0; i < boundaries.size(); i++) {
+            if (num_boundaries > 0 && boundaries[num_boundaries - 1].first == boundaries[i].first) {
+                boundaries[num_boundaries - 1] = boundaries[i];
+            }
+            else {
+                boundaries[num_boundaries++] = boundaries[i];
+            }
+        }
+        boundaries.resize(num_boundaries);
+
+        min_id = boundaries.empty() ? 0 : (id_t) (boundaries.front().first >> 1);
+        size_t num_bits = boundaries.empty() ? 0 : boundaries.back().first - pack(min_id, false) + 1;
+        boundary_bits = sdsl::bit_vector(num_bits, 0);
+        boundary_snarls = sdsl::int_vector<>(boundaries.size());
+        for (size_t i = 0; i < boundaries.size(); i++) {
+            boundary_bits[boundaries[i].first - pack(min_id, false)] = 1;
+            boundary_snarls[i] = boundaries[i].second;
+        }
+        sdsl::util::init_support(boundary_rank, &boundary_bits);
+
+        for (sdsl::int_vector<>* vec : {&starts, &ends, &types, &flags, &parents, &subtree_ends, &chains,
+                                        &chain_ranks, &chain_offsets, &chain_members, &boundary_snarls}) {
+            sdsl::util::bit_compress(*vec);
+        }
+    }
+
+    void SnarlTreeIndex::serialize(ostream& out) const {
+        sdsl::int_vector<64> header(1);
+        header[0] = min_id;
+        header.serialize(out, nullptr, "header");
+        starts.serialize(out, nullptr, "starts");
+        ends.serialize(out, nullptr, "ends");
+        types.serialize(out, nullptr, "types");
+        flags.serialize(out, nullptr, "flags");
+        parents.serialize(out, nullptr, "parents");
+        subtree_ends.serialize(out, nullptr, "subtree_ends");
+        chains.serialize(out, nullptr, "chains");
+        chain_ranks.serialize(out, nullptr, "chain_ranks");
+        chain_offsets.serialize(out, nullptr, "chain_offsets");
+        chain_members.serialize(out, nullptr, "chain_members");
+        boundary_bits.serialize(out, nullptr, "boundary_bits");
+        boundary_snarls.serialize(out, nullptr, "boundary_snarls");
+    }
+
+    void SnarlTreeIndex::load(istream& in) {
+        sdsl::int_vector<64> header;
+        header.load(in);
+        if (!in || header.size() != 1) {
+            cerr << "error[SnarlTreeIndex]: could not read snarl tree index" << endl;
+            exit(1);
+        }
+        min_id = header[0];
+        starts.load(in);
+        ends.load(in);
+        types.load(in);
+        flags.load(in);
+        parents.load(in);
+        subtree_ends.load(in);
+        chains.load(in);
+        chain_ranks.load(in);
+        chain_offsets.load(in);
+        chain_members.load(in);
+        boundary_bits.load(in);
+        boundary_snarls.load(in);
+        if (!in) {
+            cerr << "error[SnarlTreeIndex]: snarl tree index is truncated" << endl;
+            exit(1);
+        }
+        sdsl::util::init_support(boundary_rank, &boundary_bits);
+    }
+
+    size_t SnarlTreeIndex::snarl_count() const {
+        return starts.size();
+    }
+
+    inline size_t SnarlTreeIndex::boundary_bit(id_t id, bool reverse) const {
+        if (id < min_id) {
+            return boundary_bits.size();
+        }
+        size_t bit = pack(id, reverse) - pack(min_id, false);
+        return bit < boundary_bits.size() ? bit : boundary_bits.size();
+    }
+
+    size_t SnarlTreeIndex::into_which_snarl(id_t id, bool reverse) const {
+        size_t bit = boundary_bit(id, reverse);
+        if (bit == boundary_bits.size() || !boundary_bits[bit]) {
+            return no_snarl;
+        }
+        return boundary_snarls[boundary_rank(bit)];
+    }
+
+    size_t SnarlTreeIndex::into_which_snarl(const Visit& visit) const {
+        if (visit.has_snarl()) {
+            // a snarl is identified by its start, which points into it
+            return into_which_snarl(visit.snarl().start().node_id(), visit.snarl().start().backward());
+        }
+        return into_which_snarl(visit.node_id(), visit.backward());
+    }
+
+    Visit SnarlTreeIndex::start_of(size_t snarl) const {
+        return unpack(starts[snarl]);
+    }
+
+    Visit SnarlTreeIndex::end_of(size_t snarl) const {
+        return unpack(ends[snarl]);
+    }
+
+    SnarlType SnarlTreeIndex::type_of(size_t snarl) const {
+        return (SnarlType) types[snarl];
+    }
+
+    Snarl SnarlTreeIndex::snarl(size_t snarl) const {
+        Snarl to_return;
+        *to_return.mutable_start() = start_of(snarl);
+        *to_return.mutable_end() = end_of(snarl);
+        to_return.set_type(type_of(snarl));
+        uint64_t snarl_flags = flags[snarl];
+        to_return.set_start_self_reachable(snarl_flags & START_SELF_REACHABLE);
+        to_return.set_end_self_reachable(snarl_flags & END_SELF_REACHABLE);
+        to_return.set_start_end_reachable(snarl_flags & START_END_REACHABLE);
+        to_return.set_directed_acyclic_net_graph(snarl_flags & DIRECTED_ACYCLIC_NET_GRAPH);
+        size_t parent = parent_of(snarl);
+        if (parent != no_snarl) {
+            *to_return.mutable_parent()->mutable_start() = start_of(parent);
+            *to_return.mutable_parent()->mutable_end() = end_of(parent);
+        }
+        return to_return;
+    }
+
+    size_t SnarlTreeIndex::parent_of(size_t snarl) const {
+        size_t parent = parents[snarl];
+        return parent == 0 ? no_snarl : parent - 1;
+    }
+
+    bool SnarlTreeIndex::is_root(size_t snarl) const {
+        return parents[snarl] == 0;
+    }
+
+    bool SnarlTreeIndex::is_leaf(size_t snarl) const {
+        return subtree_ends[snarl] == snarl + 1;
+    }
+
+    size_t SnarlTreeIndex::subtree_end(size_t snarl) const {
+        return subtree_ends[snarl];
+    }
+
+    void SnarlTreeIndex::for_each_child(size_t snarl, const function<void(size_t)>& lambda) const {
+        // children are the snarls that come right after the subtree of the previous child
+        size_t child = snarl == no_snarl ? 0 : snarl + 1;
+        size_t end = snarl == no_snarl ? snarl_count() : (size_t) subtree_ends[snarl];
+        while (child < end) {
+            lambda(child);
+            child = subtree_ends[child];
+        }
+    }
+
+    void SnarlTreeIndex::for_each_top_level_snarl(const function<void(size_t)>& lambda) const {
+        for_each_child(no_snarl, lambda);
+    }
+
+    size_t SnarlTreeIndex::chain_count() const {
+        return chain_offsets.empty() ? 0 : chain_offsets.size() - 1;
+    }
+
+    size_t SnarlTreeIndex::chain_of(size_t snarl) const {
+        return chains[snarl];
+    }
+
+    size_t SnarlTreeIndex::chain_rank_of(size_t snarl) const {
+        return chain_ranks[snarl];
+    }
+
+    bool SnarlTreeIndex::chain_orientation_of(size_t snarl) const {
+        return chain_member(chain_of(snarl), chain_rank_of(snarl)).second;
+    }
+
+    bool SnarlTreeIndex::in_nontrivial_chain(size_t snarl) const {
+        return chain_size(chain_of(snarl)) > 1;
+    }
+
+    size_t SnarlTreeIndex::chain_size(size_t chain) const {
+        return chain_offsets[chain + 1] - chain_offsets[chain];
+    }
+
+    pair<size_t, bool> SnarlTreeIndex::chain_member(size_t chain, size_t rank) const {
+        uint64_t member = chain_members[chain_offsets[chain] + rank];
+        return make_pair((size_t) (member >> 1) - 1, (bool) (member & 1));
+    }
+
+    unique_ptr<SnarlManager> SnarlTreeIndex::to_snarl_manager() const {
+        // snarls are numbered in preorder, so parents are added before their children
+        return unique_ptr<SnarlManager>(new SnarlManager([&](const function<void(Snarl&)>& consume_snarl) {
+            for (size_t i = 0; i < snarl_count(); i++) {
+                Snarl rebuilt = snarl(i);
+                consume_snarl(rebuilt);
+            }
+        }));
+    }
+
+    unique_ptr<SnarlManager> load_snarl_manager(istream& in) {
+        // We may have to go back and read the stream again as Snarls. If it
+        // can't seek, like a pipe, read it into memory so that we can.
+        unique_ptr<stringstream> buffered;
+        istream* source = &in;
+        streampos start = in.tellg();
+        if (start == streampos(-1)) {
+            in.clear();
+            buffered.reset(new stringstream());
+            *buffered << in.rdbuf();
+            buffered->clear();
+            source = buffered.get();
+            start = 0;
+        }
+        
+        unique_ptr<SnarlTreeIndex> tree_index = vg::io::VPKG::try_load_one<SnarlTreeIndex>(*source);
+        if (tree_index.get() != nullptr) {
+            return tree_index->to_snarl_manager();
+        }
+        // otherwise it should be Snarls, so go back and read them
+        source->clear();
+        source->seekg(start);
+        return vg::io::VPKG::load_one<SnarlManager>(*source);
+    }
+
+    unique_ptr<SnarlManager> load_snarl_manager(const string& filename) {
+        unique_ptr<SnarlManager> manager;
+        // "-" is standard input, as for VPKG::load_one
+        get_input_file(filename, [&](istream& in) {
+            manager = load_snarl_manager(in);
+        });
+        return manager;
+    }
+}
@@ -0,0 +1,214 @@
+#ifndef VG_SNARL_TREE_INDEX_HPP_INCLUDED
+#define VG_SNARL_TREE_INDEX_HPP_INCLUDED
+
+/** \file
+ * snarl_tree_index.hpp: defines a compact, serializable index of the snarl tree
+ */
+
+#include <iostream>
+#include <functional>
+#include <limits>
+#include <memory>
+
+#include <sdsl/int_vector.hpp>
+#include <sdsl/rank_support_v.hpp>
+
+#include "snarls.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A read-only index of the snarls in a SnarlManager and the tree and chain
+ * relationships between them, stored in integer arrays instead of Snarl
+ * objects and hash tables, so that it is small and quick to save and load.
+ *
+ * Snarls are identified by their number in a preorder traversal of the snarl
+ * tree, so the descendants of a snarl are the snarls numbered after it, up to
+ * its subtree end. Chains are numbered in the order their first snarl appears
+ * in the preorder. Node sides pointing into snarls are found through a rank
+ * over a bit vector with one bit per node side in the ID range of the snarl
+ * boundaries.
+ *
+ * The DistanceIndex and the seed clusterer still work on Snarl pointers, so
+ * the tools that use them rebuild a full SnarlManager from this index when
+ * they load it (see load_snarl_manager()). For them the index is only a
+ * smaller file, not a faster or smaller in-memory representation.
+ */
+class SnarlTreeIndex {
+public:
+
+    /// The value used for a missing snarl or chain
+    static const size_t no_snarl = numeric_limits<size_t>::max();
+
+    /// Index the snarls in a finished SnarlManager
+    SnarlTreeIndex(const SnarlManager& manager);
+
+    /// Load a serialized index from a stream
+    SnarlTreeIndex(istream& in);
+
+    /// Make an empty index. Call load() to fill it in.
+    SnarlTreeIndex();
+
+    /// The rank support points into the bit vector, so we can't be copied or moved
+    SnarlTreeIndex(const SnarlTreeIndex& other) = delete;
+    SnarlTreeIndex& operator=(const SnarlTreeIndex& other) = delete;
+
+    /// Write the index to a stream
+    void serialize(ostream& out) const;
+
+    /// Rebuild a SnarlManager with all the indexed snarls, for code that
+    /// needs Snarl pointers, such as the DistanceIndex
+    unique_ptr<SnarlManager> to_snarl_manager() const;
+
+    /// Replace the contents of the index with the serialized index in a stream
+    void load(istream& in);
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Snarls
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Get the number of snarls
+    size_t snarl_count() const;
+
+    /// Get the snarl that the given node traversal points into, or no_snarl if
+    /// it points into none. As with SnarlManager, end boundaries must be
+    /// reversed to query them.
+    size_t into_which_snarl(id_t id, bool reverse) const;
+
+    /// Get the snarl that a Visit points into, or the snarl that it visits
+    /// if it is a visit to a snarl.
+    size_t into_which_snarl(const Visit& visit) const;
+
+    /// Get the start Visit of a snarl
+    Visit start_of(size_t snarl) const;
+
+    /// Get the end Visit of a snarl
+    Visit end_of(size_t snarl) const;
+
+    /// Get the type of a snarl
+    SnarlType type_of(size_t snarl) const;
+
+    /// Rebuild the Snarl object for a snarl, with its boundaries, type and
+    /// connectivity, and its parent's boundaries if it has a parent
+    Snarl snarl(size_t snarl) const;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Tree
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Get the parent of a snarl, or no_snarl if it is a root
+    size_t parent_of(size_t snarl) const;
+
+    /// Returns true if a snarl has no parent
+    bool is_root(size_t snarl) const;
+
+    /// Returns true if a snarl has no children
+    bool is_leaf(size_t snarl) const;
+
+    /// Get the number of the snarl after the last descendant of a snarl
+    size_t subtree_end(size_t snarl) const;
+
+    /// Execute a function on each child of a snarl, in order. If given
+    /// no_snarl, executes it on the roots of the snarl trees.
+    void for_each_child(size_t snarl, const function<void(size_t)>& lambda) const;
+
+    /// Execute a function on each root snarl, in order
+    void for_each_top_level_snarl(const function<void(size_t)>& lambda) const;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Chains
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Get the number of chains, including trivial single-snarl chains
+    size_t chain_count() const;
+
+    /// Get the chain a snarl participates in
+    size_t chain_of(size_t snarl) const;
+
+    /// Get the rank of a snarl in its chain
+    size_t chain_rank_of(size_t snarl) const;
+
+    /// Returns true if the snarl is backward in its chain
+    bool chain_orientation_of(size_t snarl) const;
+
+    /// Returns true if a snarl is in a chain of more than one snarl
+    bool in_nontrivial_chain(size_t snarl) const;
+
+    /// Get the number of snarls in a chain
+    size_t chain_size(size_t chain) const;
+
+    /// Get the snarl at the given rank in a chain, and whether it is
+    /// backward in the chain
+    pair<size_t, bool> chain_member(size_t chain, size_t rank) const;
+
+private:
+
+    /// Convert an oriented node to the packed representation used in the arrays
+    inline static uint64_t pack(id_t id, bool reverse) {
+        return ((uint64_t) id << 1) | (reverse ? 1 : 0);
+    }
+
+    /// Convert a packed oriented node back into a Visit
+    inline static Visit unpack(uint64_t packed) {
+        return to_visit((id_t) (packed >> 1), packed & 1);
+    }
+
+    /// Get the bit of a node side in the boundary bit vector, or the size of
+    /// the vector if the node side is out of range
+    inline size_t boundary_bit(id_t id, bool reverse) const;
+
+    /// Bit flags in snarl_flags
+    static const uint64_t START_SELF_REACHABLE = 1;
+    static const uint64_t END_SELF_REACHABLE = 2;
+    static const uint64_t START_END_REACHABLE = 4;
+    static const uint64_t DIRECTED_ACYCLIC_NET_GRAPH = 8;
+
+    /// The packed start Visit of each snarl
+    sdsl::int_vector<> starts;
+    /// The packed end Visit of each snarl
+    sdsl::int_vector<> ends;
+    /// The type of each snarl
+    sdsl::int_vector<> types;
+    /// The connectivity flags of each snarl
+    sdsl::int_vector<> flags;
+
+    /// The parent of each snarl, plus one, or 0 for roots
+    sdsl::int_vector<> parents;
+    /// The number after the last descendant of each snarl
+    sdsl::int_vector<> subtree_ends;
+
+    /// The chain of each snarl
+    sdsl::int_vector<> chains;
+    /// The rank of each snarl in its chain
+    sdsl::int_vector<> chain_ranks;
+    /// The start of each chain in chain_members, with a past-the-end sentinel
+    sdsl::int_vector<> chain_offsets;
+    /// The snarls of all the chains, each shifted up by one with the
+    /// orientation in the low bit
+    sdsl::int_vector<> chain_members;
+
+    /// The smallest node ID used as a snarl boundary
+    id_t min_id = 0;
+    /// A bit for each side of each node from min_id, set if it points into a snarl
+    sdsl::bit_vector boundary_bits;
+    /// Rank support to find the entries for the set bits
+    sdsl::rank_support_v<1> boundary_rank;
+    /// The snarl that each set bit points into, in bit order
+    sdsl::int_vector<> boundary_snarls;
+};
+
+/// Load a SnarlManager from a stream holding either serialized Snarls or a
+/// SnarlTreeIndex, as written by vg snarls -I. A SnarlTreeIndex is converted
+/// back into a SnarlManager, which takes longer than loading the Snarls. A
+/// stream that can't seek is read into memory first.
+unique_ptr<SnarlManager> load_snarl_manager(istream& in);
+
+/// Load a SnarlManager from a file holding either serialized Snarls or a
+/// SnarlTreeIndex. The file name "-" means standard input.
+unique_ptr<SnarlManager> load_snarl_manager(const string& filename);
+
+}
+
+#endif
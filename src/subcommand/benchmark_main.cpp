@@ -17,6 +17,8 @@
 #include "../vg.hpp"
 #include "../xg.hpp"
 #include "../indexed_vg.hpp"
+#include "../xg_position.hpp"
+#include "../aligner.hpp"
 #include "../algorithms/extract_connecting_graph.hpp"
 #include "../algorithms/topological_sort.hpp"
 #include "../algorithms/weakly_connected_components.hpp"
@@ -40,6 +42,8 @@ int main_benchmark(int argc, char** argv) {
     // Which experiments should we run?
     bool sort_and_order_experiment = false;
     bool get_sequence_experiment = true;
+    bool position_experiment = true;
+    bool banded_alignment_experiment = true;
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -176,6 +180,131 @@ int main_benchmark(int argc, char** argv) {
         
     }
     
+    if (position_experiment) {
+    
+        // This is what the position helpers used to do for every node they visited
+        results.push_back(run_benchmark("XG::node/edges_of next positions", 1000, [&]() {
+            for (id_t i = 1; i < 101; i++) {
+                Node node = xg_index.node(i);
+                set<pos_t> nexts;
+                for (auto& edge : xg_index.edges_of(i)) {
+                    if (edge.from() == i && !edge.from_start()) {
+                        nexts.insert(make_pos_t(edge.to(), edge.to_end(), 0));
+                    } else if (edge.to() == i && edge.to_end()) {
+                        nexts.insert(make_pos_t(edge.from(), !edge.from_start(), 0));
+                    }
+                }
+                assert(node.sequence().size() == 8);
+            }
+        }));
+        
+        results.push_back(run_benchmark("xg_next_pos", 1000, [&]() {
+            for (size_t i = 1; i < 101; i++) {
+                set<pos_t> nexts = xg_next_pos(make_pos_t(i, false, 7), false, &xg_index);
+            }
+        }));
+        
+        results.push_back(run_benchmark("XG::node pos_char", 1000, [&]() {
+            for (size_t i = 1; i < 101; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    char c = xg_index.node(i).sequence().at(j);
+                    assert(c != 'N');
+                }
+            }
+        }));
+        
+        results.push_back(run_benchmark("xg_pos_char", 1000, [&]() {
+            for (size_t i = 1; i < 101; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    char c = xg_pos_char(make_pos_t(i, false, j), &xg_index);
+                    assert(c != 'N');
+                }
+            }
+        }));
+        
+        results.push_back(run_benchmark("xg_next_pos_chars", 1000, [&]() {
+            for (size_t i = 1; i < 101; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    map<pos_t, char> nexts = xg_next_pos_chars(make_pos_t(i, false, j), &xg_index);
+                }
+            }
+        }));
+        
+        results.push_back(run_benchmark("graph_next_pos_chars on VG", 1000, [&]() {
+            for (size_t i = 1; i < 101; i++) {
+                for (size_t j = 0; j < 8; j++) {
+                    map<pos_t, char> nexts = graph_next_pos_chars(make_pos_t(i, false, j), &vg);
+                }
+            }
+        }));
+        
+    }
+    
+    if (banded_alignment_experiment) {
+        
+        // Make a chain of SNP bubbles, like the graphs between anchors in mpmap, and a read that
+        // follows the reference alleles with a few mismatches
+        const string bases = "ACGT";
+        size_t state = 1;
+        auto next_base = [&]() {
+            state = state * 1103515245 + 12345;
+            return bases[(state >> 16) % 4];
+        };
+        auto make_bubble_chain = [&](VG& graph, size_t num_bubbles) {
+            string ref_seq;
+            vector<Node*> tips;
+            for (size_t i = 0; i < num_bubbles; i++) {
+                string seq;
+                for (size_t j = 0; j < 8; j++) {
+                    seq.push_back(next_base());
+                }
+                Node* node = graph.create_node(seq);
+                for (Node* tip : tips) {
+                    graph.create_edge(tip, node);
+                }
+                ref_seq += seq;
+                
+                char ref_base = next_base();
+                char alt_base = bases[(bases.find(ref_base) + 1) % 4];
+                Node* ref = graph.create_node(string(1, ref_base));
+                Node* alt = graph.create_node(string(1, alt_base));
+                graph.create_edge(node, ref);
+                graph.create_edge(node, alt);
+                ref_seq.push_back(ref_base);
+                tips = {ref, alt};
+            }
+            for (size_t i = 7; i < ref_seq.size(); i += 23) {
+                ref_seq[i] = bases[(bases.find(ref_seq[i]) + 2) % 4];
+            }
+            return ref_seq;
+        };
+        
+        Aligner aligner;
+        
+        // small enough for 8-bit scores
+        VG small_graph;
+        string small_read = make_bubble_chain(small_graph, 2);
+        
+        // needs 16-bit scores
+        VG large_graph;
+        string large_read = make_bubble_chain(large_graph, 20);
+        
+        results.push_back(run_benchmark("BandedGlobalAligner 18 bp, 8-bit", 1000, [&]() {
+            Alignment aln;
+            aln.set_sequence(small_read);
+            aligner.align_global_banded(aln, small_graph, 1, true);
+        }));
+        
+        for (int32_t band_padding : {8, 32}) {
+            results.push_back(run_benchmark("BandedGlobalAligner 180 bp, 16-bit, padding " + to_string(band_padding), 1000, [&]() {
+                Alignment aln;
+                aln.set_sequence(large_read);
+                aligner.align_global_banded(aln, large_graph, band_padding, true);
+            }));
+        }
+        
+    }
+    
     // Do the control against itself
     results.push_back(run_benchmark("control", 1000, benchmark_control));
 
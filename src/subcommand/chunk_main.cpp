@@ -9,12 +9,16 @@
 #include <string>
 #include <vector>
 #include <regex>
+#include <tuple>
+#include <algorithm>
+#include <limits>
 
 #include "subcommand.hpp"
 
 #include "../vg.hpp"
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
+#include <vg/io/protobuf_emitter.hpp>
 #include "../utility.hpp"
 #include "../chunker.hpp"
 #include "../stream_index.hpp"
@@ -30,6 +34,8 @@ using namespace xg;
 static string chunk_name(const string& out_chunk_prefix, int i, const Region& region, string ext, int gi = 0);
 static int split_gam(istream& gam_stream, size_t chunk_size, const string& out_prefix,
                      size_t gam_buffer_size = 100);
+static int stream_gam_to_chunks(istream& gam_stream, const vector<vector<pair<vg::id_t, vg::id_t>>>& chunk_id_ranges,
+                                const function<string(size_t)>& chunk_gam_name, bool fully_contained);
 
 void help_chunk(char** argv) {
     cerr << "usage: " << argv[0] << " chunk [options] > [chunk.vg]" << endl
@@ -68,6 +74,9 @@ void help_chunk(char** argv) {
          << "    -T, --trace              trace haplotype threads in chunks (and only expand forward from input coordinates)." << endl
          << "                             Produces a .annotate.txt file with haplotype frequencies for each chunk." << endl 
          << "    -f, --fully-contained    only return GAM alignments that are fully contained within chunk" << endl
+         << "    -B, --batch N            sort the regions and extract runs of up to N adjacent or overlapping path regions" << endl
+         << "                             together, sharing their context expansion. GAMs (-a) are streamed once, in sorted" << endl
+         << "                             order, instead of being queried through their index for each chunk" << endl
          << "    -t, --threads N          for tasks that can be done in parallel, use this many threads [1]" << endl
          << "    -h, --help" << endl;
 }
@@ -100,6 +109,7 @@ int main_chunk(int argc, char** argv) {
     bool fully_contained = false;
     int n_chunks = 0;
     size_t gam_split_size = 0;
+    size_t batch_size = 0;
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -127,11 +137,12 @@ int main_chunk(int argc, char** argv) {
             {"n-chunks", required_argument, 0, 'n'},
             {"context-length", required_argument, 0, 'l'},
             {"gam-split-size", required_argument, 0, 'm'},
+            {"batch", required_argument, 0, 'B'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:G:a:gp:P:s:o:e:E:b:c:r:R:Tft:n:l:m:",
+        c = getopt_long (argc, argv, "hx:G:a:gp:P:s:o:e:E:b:c:r:R:Tft:n:l:m:B:",
                 long_options, &option_index);
 
 
@@ -214,6 +225,17 @@ int main_chunk(int argc, char** argv) {
             gam_split_size = parse<int>(optarg);
             break;
 
+        case 'B':
+            {
+                int parsed_batch_size = parse<int>(optarg);
+                if (parsed_batch_size <= 0) {
+                    cerr << "error:[vg chunk] batch size (-B) must be a positive number" << endl;
+                    return 1;
+                }
+                batch_size = parsed_batch_size;
+            }
+            break;
+
         case 'T':
             trace = true;
             break;
@@ -304,9 +326,9 @@ int main_chunk(int argc, char** argv) {
     }
 
     
-    // We need an index on the GAM to chunk it
+    // We need an index on the GAM to chunk it, unless we are streaming through it in batch mode
     vector<unique_ptr<GAMIndex>> gam_indexes;
-    if (chunk_gam) {
+    if (chunk_gam && batch_size == 0) {
         for (auto gam_file : gam_files) {
             get_input_file(gam_file + ".gai", [&](istream& index_stream) {
                     gam_indexes.push_back(unique_ptr<GAMIndex>(new GAMIndex()));
@@ -474,10 +496,11 @@ int main_chunk(int argc, char** argv) {
     // When chunking GAMs, every thread gets its own cursor to seek into the input GAM.
     // Todo: when operating on multiple gams, we make |threads| X |gams| cursors, even though
     // we only ever use |threads| threads.
+    // In batch mode, we don't seek at all, and instead stream each GAM once at the end.
     vector<list<ifstream>> gam_streams_vec(gam_files.size());
     vector<vector<GAMIndex::cursor_t>> cursors_vec(gam_files.size());
     
-    if (chunk_gam) {
+    if (chunk_gam && batch_size == 0) {
         for (size_t gam_i = 0; gam_i < gam_streams_vec.size(); ++gam_i) {
             auto& gam_file = gam_files[gam_i];
             auto& gam_streams = gam_streams_vec[gam_i];
@@ -496,31 +519,15 @@ int main_chunk(int argc, char** argv) {
         }
     }
 
-    // extract chunks in parallel
-#pragma omp parallel for
-    for (int i = 0; i < num_regions; ++i) {
+    // In batch mode, remember the ID ranges of each chunk for the GAM pass
+    vector<vector<pair<vg::id_t, vg::id_t>>> chunk_id_ranges(chunk_gam && batch_size > 0 ? num_regions : 0);
+
+    // trace haplotypes and write out the graph, gam and annotations for a chunk whose
+    // subgraph (if any) has been extracted and whose output region has been set
+    auto write_chunk = [&](int i, VG* subgraph) {
         int tid = omp_get_thread_num();
         Region& region = regions[i];
-        PathChunker& chunker = chunkers[tid];
-        VG* subgraph = NULL;
         map<string, int> trace_thread_frequencies;
-        if (id_range == false) {
-            subgraph = new VG();
-            chunker.extract_subgraph(region, context_steps, context_length,
-                                     trace, *subgraph, output_regions[i]);
-        } else {
-            if (chunk_graph || context_steps > 0) {
-                subgraph = new VG();
-                output_regions[i].seq = region.seq;
-                chunker.extract_id_range(region.start, region.end,
-                                         context_steps, context_length, trace,
-                                         *subgraph, output_regions[i]);
-            } else {
-                // in this case, there's no need to actually build the subgraph, so we don't
-                // in order to save time.
-                output_regions[i] = region;
-            }
-        }
 
         // optionally trace our haplotypes
         if (trace && subgraph) {
@@ -569,29 +576,34 @@ int main_chunk(int argc, char** argv) {
         
         // optional gam chunking
         if (chunk_gam) {
-            for (size_t gi = 0; gi < gam_indexes.size(); ++gi) {
-                auto& gam_index = gam_indexes[gi];
-                assert(gam_index.get() != nullptr);
-                GAMIndex::cursor_t& cursor = cursors_vec[gi][tid];
+            // Work out the ID ranges to look up
+            vector<pair<vg::id_t, vg::id_t>> region_id_ranges;
+            if (subgraph != NULL) {
+                // Use the regions from the graph
+                region_id_ranges = vg::algorithms::sorted_id_ranges(subgraph);
+            } else {
+                // Use the region we were asked for
+                region_id_ranges = {{region.start, region.end}};
+            }
             
-                string gam_name = chunk_name(out_chunk_prefix, i, output_regions[i], ".gam", gi);
-                ofstream out_gam_file(gam_name);
-                if (!out_gam_file) {
-                    cerr << "error[vg chunk]: can't open output gam file " << gam_name << endl;
-                    exit(1);
-                }
+            if (batch_size > 0) {
+                // Save them for when we stream the GAMs
+                chunk_id_ranges[i] = std::move(region_id_ranges);
+            } else {
+                for (size_t gi = 0; gi < gam_indexes.size(); ++gi) {
+                    auto& gam_index = gam_indexes[gi];
+                    assert(gam_index.get() != nullptr);
+                    GAMIndex::cursor_t& cursor = cursors_vec[gi][tid];
             
-                // Work out the ID ranges to look up
-                vector<pair<vg::id_t, vg::id_t>> region_id_ranges;
-                if (subgraph != NULL) {
-                    // Use the regions from the graph
-                    region_id_ranges = vg::algorithms::sorted_id_ranges(subgraph);
-                } else {
-                    // Use the region we were asked for
-                    region_id_ranges = {{region.start, region.end}};
-                }
+                    string gam_name = chunk_name(out_chunk_prefix, i, output_regions[i], ".gam", gi);
+                    ofstream out_gam_file(gam_name);
+                    if (!out_gam_file) {
+                        cerr << "error[vg chunk]: can't open output gam file " << gam_name << endl;
+                        exit(1);
+                    }
             
-                gam_index->find(cursor, region_id_ranges, vg::io::emit_to<Alignment>(out_gam_file), fully_contained);
+                    gam_index->find(cursor, region_id_ranges, vg::io::emit_to<Alignment>(out_gam_file), fully_contained);
+                }
             }
         }
 
@@ -609,8 +621,102 @@ int main_chunk(int argc, char** argv) {
                 out_annot_file << tf.first << "\t" << tf.second << endl;
             }
         }
+    };
+
+    // extract a single chunk on its own and write it out
+    auto extract_chunk = [&](int i) {
+        Region& region = regions[i];
+        PathChunker& chunker = chunkers[omp_get_thread_num()];
+        VG* subgraph = NULL;
+        if (id_range == false) {
+            subgraph = new VG();
+            chunker.extract_subgraph(region, context_steps, context_length,
+                                     trace, *subgraph, output_regions[i]);
+        } else {
+            if (chunk_graph || context_steps > 0) {
+                subgraph = new VG();
+                output_regions[i].seq = region.seq;
+                chunker.extract_id_range(region.start, region.end,
+                                         context_steps, context_length, trace,
+                                         *subgraph, output_regions[i]);
+            } else {
+                // in this case, there's no need to actually build the subgraph, so we don't
+                // in order to save time.
+                output_regions[i] = region;
+            }
+        }
+
+        write_chunk(i, subgraph);
 
         delete subgraph;
+    };
+
+    if (batch_size > 0) {
+        // sort the regions, and group runs of overlapping or abutting regions on the
+        // same path into batches that share their context expansion
+        vector<int> order(num_regions);
+        for (int i = 0; i < num_regions; ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+                return make_tuple(regions[a].seq, regions[a].start, regions[a].end) <
+                    make_tuple(regions[b].seq, regions[b].start, regions[b].end);
+            });
+        vector<vector<int>> batches;
+        int64_t batch_end = 0;
+        for (int i : order) {
+            if (batches.empty() || batches.back().size() >= batch_size ||
+                regions[i].seq != regions[batches.back().back()].seq || regions[i].start > batch_end + 1) {
+                batches.emplace_back();
+                batch_end = regions[i].end;
+            }
+            batches.back().push_back(i);
+            batch_end = max(batch_end, regions[i].end);
+        }
+
+        // only path regions expanded by steps in both directions can share their context
+        bool share_context = !id_range && !trace && context_length == 0;
+
+        // extract batches in parallel
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t b = 0; b < batches.size(); ++b) {
+            auto& batch = batches[b];
+            if (share_context) {
+                vector<Region> batch_regions;
+                for (int i : batch) {
+                    batch_regions.push_back(regions[i]);
+                }
+                chunkers[omp_get_thread_num()].extract_subgraph_batch(batch_regions, context_steps,
+                                                                      [&](size_t j, VG& subgraph, const Region& out_region) {
+                        output_regions[batch[j]] = out_region;
+                        write_chunk(batch[j], &subgraph);
+                    });
+            } else {
+                for (int i : batch) {
+                    extract_chunk(i);
+                }
+            }
+        }
+
+        // stream each GAM once, sending its reads to all the chunks they touch
+        if (chunk_gam) {
+            for (size_t gi = 0; gi < gam_files.size(); ++gi) {
+                ifstream gam_stream(gam_files[gi]);
+                if (!gam_stream) {
+                    cerr << "error[vg chunk]: unable to open GAM file " << gam_files[gi] << endl;
+                    return 1;
+                }
+                stream_gam_to_chunks(gam_stream, chunk_id_ranges, [&](size_t i) {
+                        return chunk_name(out_chunk_prefix, i, output_regions[i], ".gam", gi);
+                    }, fully_contained);
+            }
+        }
+    } else {
+        // extract chunks in parallel
+#pragma omp parallel for
+        for (int i = 0; i < num_regions; ++i) {
+            extract_chunk(i);
+        }
     }
         
     // write a bed file if asked giving a more explicit linking of chunks to files
@@ -677,3 +783,123 @@ int split_gam(istream& gam_stream, size_t chunk_size, const string& out_prefix,
     return 0;
 }
 
+// Stream through a sorted GAM once, writing each read to every chunk whose ID ranges it touches
+int stream_gam_to_chunks(istream& gam_stream, const vector<vector<pair<vg::id_t, vg::id_t>>>& chunk_id_ranges,
+                         const function<string(size_t)>& chunk_gam_name, bool fully_contained) {
+    size_t num_chunks = chunk_id_ranges.size();
+
+    // Cut the ID space at every range boundary, and record which chunks cover each of the
+    // resulting intervals [bounds[k], bounds[k + 1])
+    vector<vg::id_t> bounds;
+    vector<vg::id_t> chunk_max_id(num_chunks, 0);
+    for (size_t i = 0; i < num_chunks; ++i) {
+        for (auto& range : chunk_id_ranges[i]) {
+            bounds.push_back(range.first);
+            bounds.push_back(range.second + 1);
+            chunk_max_id[i] = max(chunk_max_id[i], range.second);
+        }
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+    vector<vector<size_t>> covering(bounds.empty() ? 0 : bounds.size() - 1);
+    for (size_t i = 0; i < num_chunks; ++i) {
+        for (auto& range : chunk_id_ranges[i]) {
+            for (size_t k = std::lower_bound(bounds.begin(), bounds.end(), range.first) - bounds.begin();
+                 bounds[k] <= range.second; ++k) {
+                covering[k].push_back(i);
+            }
+        }
+    }
+
+    // Chunks get opened when they get their first read, and closed once the reads
+    // (which are sorted by their minimum ID) have moved past their maximum ID, so we
+    // only hold the files open for the chunks we are in the middle of.
+    vector<unique_ptr<ofstream>> chunk_files(num_chunks);
+    vector<unique_ptr<vg::io::ProtobufEmitter<Alignment>>> chunk_emitters(num_chunks);
+    vector<bool> chunk_closed(num_chunks, false);
+    vector<size_t> close_order(num_chunks);
+    for (size_t i = 0; i < num_chunks; ++i) {
+        close_order[i] = i;
+    }
+    std::sort(close_order.begin(), close_order.end(), [&](size_t a, size_t b) {
+            return chunk_max_id[a] < chunk_max_id[b];
+        });
+    size_t next_to_close = 0;
+
+    auto open_chunk = [&](size_t i) {
+        string gam_name = chunk_gam_name(i);
+        chunk_files[i] = unique_ptr<ofstream>(new ofstream(gam_name));
+        if (!*chunk_files[i]) {
+            cerr << "error[vg chunk]: can't open output gam file " << gam_name << endl;
+            exit(1);
+        }
+        chunk_emitters[i] = unique_ptr<vg::io::ProtobufEmitter<Alignment>>(new vg::io::ProtobufEmitter<Alignment>(*chunk_files[i]));
+    };
+
+    auto close_chunks_before = [&](vg::id_t id) {
+        while (next_to_close < num_chunks && chunk_max_id[close_order[next_to_close]] < id) {
+            size_t i = close_order[next_to_close++];
+            if (!chunk_emitters[i]) {
+                // Make sure even chunks with no reads get a file
+                open_chunk(i);
+            }
+            // Flush the emitter before the file goes away
+            chunk_emitters[i].reset();
+            chunk_files[i].reset();
+            chunk_closed[i] = true;
+        }
+    };
+
+    vector<vg::id_t> ids;
+    vector<size_t> hits;
+    vg::io::for_each<Alignment>(gam_stream, [&](Alignment& alignment) {
+            ids.clear();
+            IDScanner<Alignment>::scan(alignment, [&](const vg::id_t& id) {
+                    ids.push_back(id);
+                    return true;
+                });
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+            if (ids.empty() || ids.front() == 0) {
+                // Unplaced reads never belong to any chunk
+                return;
+            }
+
+            close_chunks_before(ids.front());
+
+            // Find every chunk that covers each of the read's nodes
+            hits.clear();
+            for (auto& id : ids) {
+                size_t k = std::upper_bound(bounds.begin(), bounds.end(), id) - bounds.begin();
+                if (k > 0 && k < bounds.size()) {
+                    hits.insert(hits.end(), covering[k - 1].begin(), covering[k - 1].end());
+                }
+            }
+            std::sort(hits.begin(), hits.end());
+
+            for (size_t j = 0; j < hits.size();) {
+                size_t i = hits[j];
+                size_t count = 0;
+                for (; j < hits.size() && hits[j] == i; ++j) {
+                    ++count;
+                }
+                if (fully_contained && count != ids.size()) {
+                    // Some of the read's nodes are not in this chunk
+                    continue;
+                }
+                if (chunk_closed[i]) {
+                    cerr << "error[vg chunk]: input GAM must be sorted to stream it into chunks with -B" << endl;
+                    exit(1);
+                }
+                if (!chunk_emitters[i]) {
+                    open_chunk(i);
+                }
+                chunk_emitters[i]->write_copy(alignment);
+            }
+        });
+
+    // Close out all the remaining chunks
+    close_chunks_before(numeric_limits<vg::id_t>::max());
+    
+    return 0;
+}
@@ -17,6 +17,7 @@
 #include "../mapper.hpp"
 #include "../annotation.hpp"
 #include "../minimizer.hpp"
+#include "../snarl_tree_index.hpp"
 #include <vg/io/vpkg.hpp>
 #include <vg/io/stream.hpp>
 #include <vg/io/protobuf_emitter.hpp>
@@ -40,7 +41,7 @@ void help_cluster(char** argv) {
     << "  -x, --xg-name FILE            use this xg index (required)" << endl
     << "  -g, --gcsa-name FILE          use this GCSA2/LCP index pair (both FILE and FILE.lcp)" << endl
     << "  -m, --minimizer-name FILE     use this minimizer index" << endl
-    << "  -s, --snarls FILE             cluster using these snarls (required)" << endl
+    << "  -s, --snarls FILE             cluster using these snarls, or a snarl tree index from vg snarls -I (required)" << endl
     << "  -d, --dist-name FILE          cluster using this distance index (required)" << endl
     << "  -c, --hit-cap INT             ignore minimizers with more than this many locations [10]" << endl
     << "computational parameters:" << endl
@@ -188,7 +189,7 @@ int main_cluster(int argc, char** argv) {
     if (!minimizer_name.empty()) {
         minimizer_index = vg::io::VPKG::load_one<MinimizerIndex>(minimizer_name);
     }
-    unique_ptr<SnarlManager> snarl_manager = vg::io::VPKG::load_one<SnarlManager>(snarls_name);
+    unique_ptr<SnarlManager> snarl_manager = load_snarl_manager(snarls_name);
     unique_ptr<DistanceIndex> distance_index = vg::io::VPKG::load_one<DistanceIndex>(distance_name);
     
     // Connect the DistanceIndex to the other things it needs to work.
@@ -254,16 +255,13 @@ int main_cluster(int argc, char** argv) {
                 
                 for (size_t i = 0; i < minimizers.size(); i++) {
                     // For each minimizer
-                    if (hit_cap != 0 && minimizer_index->count(minimizers[i]) <= hit_cap) {
-                        // The minimizer is infrequent enough to be informative, so feed it into clustering
-                        
-                        // Locate it in the graph. We do not have to reverse the hits for a
-                        // reverse minimizers, as the clusterer only cares about node ids.
-                        for (auto& hit : minimizer_index->find(minimizers[i])) {
-                            // For each position, remember it and what minimizer it came from
-                            seeds.push_back(hit);
-                            seed_to_source.push_back(i);
-                        }
+                    // If the minimizer is infrequent enough to be informative, locate it in the
+                    // graph and feed it into clustering. We do not have to reverse the hits for
+                    // a reverse minimizers, as the clusterer only cares about node ids.
+                    if (hit_cap != 0) {
+                        minimizer_index->append_occurrences(minimizers[i], seeds, hit_cap);
+                        // Remember what minimizer each new position came from
+                        seed_to_source.resize(seeds.size(), i);
                     }
                 }
                 
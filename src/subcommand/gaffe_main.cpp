@@ -22,6 +22,8 @@
 #include "../alignment_emitter.hpp"
 #include "../gapless_extender.hpp"
 #include "../minimizer_mapper.hpp"
+#include "../index_loader.hpp"
+#include "../snarl_tree_index.hpp"
 
 //#define USE_CALLGRIND
 
@@ -36,25 +38,40 @@ using namespace vg::subcommand;
 void help_gaffe(char** argv) {
     cerr
     << "usage: " << argv[0] << " gaffe [options] > output.gam" << endl
-    << "Map unpaired reads using minimizers and gapless extension." << endl
+    << "Map unpaired or paired reads using minimizers and gapless extension." << endl
     << endl
     << "basic options:" << endl
     << "  -x, --xg-name FILE            use this xg index (required)" << endl
     << "  -H, --gbwt-name FILE          use this GBWT index (required)" << endl
+    << "  -g, --graph-name FILE         use this GBWTGraph instead of building it from the xg and GBWT" << endl
     << "  -m, --minimizer-name FILE     use this minimizer index (required)" << endl
-    << "  -s, --snarls FILE             cluster using these snarls (required)" << endl
+    << "  -s, --snarls FILE             cluster using these snarls, or a snarl tree index from vg snarls -I (required)" << endl
     << "  -d, --dist-name FILE          cluster using this distance index (required)" << endl
     << "  -c, --hit-cap INT             ignore minimizers with more than this many locations [10]" << endl
     << "input options:" << endl
     << "  -G, --gam-in FILE             read and realign GAM-format reads from FILE (may repeat)" << endl
     << "  -f, --fastq-in FILE           read and align FASTQ-format reads from FILE (may repeat)" << endl
+    << "  -i, --interleaved             GAM and FASTQ inputs are interleaved read pairs" << endl
+    << "  -p, --paired                  two -f FASTQ files hold the first and second mates of read pairs" << endl
     << "output options:" << endl
-    << "  -M, --max-multimaps INT       produce up to INT alignments for each read [1]"
+    << "  -M, --max-multimaps INT       produce up to INT alignments for each read [1]" << endl
+    << "  -o, --output-format NAME      output the alignments in NAME format (GAM / GAF / JSON) [GAM]" << endl
     << "  -N, --sample NAME             add this sample name" << endl
     << "  -R, --read-group NAME         add this read group" << endl
     << "computational parameters:" << endl
     << "  -C, --no-chaining             disable seed chaining and all gapped alignment" << endl
-    << "  -t, --threads INT             number of compute threads to use" << endl;
+    << "  -D, --max-dp-cells INT        fill at most INT DP cells per read aligning gaps and tails [16777216]" << endl
+    << "      --max-seeds INT           locate at most INT seed hits per read, preferring rarer minimizers (0 = no limit) [2048]" << endl
+    << "      --max-gbwt-states INT     visit at most INT GBWT search states per read when chaining (0 = no limit) [65536]" << endl
+    << "      --cluster-coverage FLOAT  after the first two, skip clusters covering less than FLOAT times the read coverage of the best (0 = off) [0]" << endl
+    << "      --stop-at-mapq-cap        stop aligning unpaired reads once the best alignment's MAPQ is settled at the cap" << endl
+    << "  -F, --fragment-distance INT   pair and rescue mates up to INT bp apart in the graph [2000]" << endl
+    << "      --fragment-mean FLOAT     score pairs assuming this mean fragment length [500]" << endl
+    << "      --fragment-stdev FLOAT    score pairs assuming this fragment length standard deviation [150]" << endl
+    << "  -t, --threads INT             number of compute threads to use" << endl
+    << "      --single-strand-graph     store GBWTGraph sequences in forward orientation only, to save memory" << endl
+    << "      --report-loading          report how long each index took to load" << endl
+    << "      --report-work-limits      report how many reads ran into each per-read work limit" << endl;
 }
 
 int main_gaffe(int argc, char** argv) {
@@ -67,6 +84,7 @@ int main_gaffe(int argc, char** argv) {
     // initialize parameters with their default options
     string xg_name;
     string gbwt_name;
+    string graph_name;
     string minimizer_name;
     string snarls_name;
     string distance_name;
@@ -75,20 +93,58 @@ int main_gaffe(int argc, char** argv) {
     size_t hit_cap = 10;
     // Should we try chaining or just give up if we can't find a full length gapless alignment?
     bool do_chaining = true;
+    // How much DP can we do per read for gaps and tails?
+    size_t max_dp_cells = 16 * 1024 * 1024;
+    // How many seed hits can we locate per read?
+    size_t max_seeds = 2048;
+    // How many GBWT search states can we visit per read?
+    size_t max_gbwt_states = 64 * 1024;
+    // What fraction of the best cluster's coverage must later clusters have?
+    double min_cluster_coverage_fraction = 0;
+    // Should we stop aligning once the MAPQ can't change?
+    bool stop_at_mapq_cap = false;
     // What GAMs should we realign?
     vector<string> gam_filenames;
     // What FASTQs should we align.
-    // Note: multiple FASTQs are not interpreted as paired.
+    // Note: multiple FASTQs are only interpreted as paired with --paired.
     vector<string> fastq_filenames;
+    // Are the GAM and FASTQ inputs interleaved pairs?
+    bool interleaved = false;
+    // Are two FASTQ inputs the two mates of pairs?
+    bool paired_files = false;
+    // How far apart can mates be?
+    size_t fragment_distance_limit = 2000;
+    // What fragment length distribution should pairs be scored against?
+    double fragment_length_mean = 500;
+    double fragment_length_stdev = 150;
     // How many mappings per read can we emit?
     size_t max_multimaps = 1;
     // How many extended clusters should we align, max?
     size_t max_alignments = 48;
+    // What format should we output in?
+    string output_format = "GAM";
     // What sample name if any should we apply?
     string sample_name;
     // What read group if any should we apply?
     string read_group;
     
+    // Should we keep only the forward strand of the GBWTGraph sequences?
+    bool single_strand_graph = false;
+    // Should we say how long loading took?
+    bool report_loading = false;
+    // Should we say how often reads ran out of work budget?
+    bool report_work_limits = false;
+    
+    #define OPT_REPORT_LOADING 1000
+    #define OPT_REPORT_WORK_LIMITS 1001
+    #define OPT_MAX_SEEDS 1002
+    #define OPT_MAX_GBWT_STATES 1003
+    #define OPT_SINGLE_STRAND_GRAPH 1004
+    #define OPT_FRAGMENT_MEAN 1005
+    #define OPT_FRAGMENT_STDEV 1006
+    #define OPT_MIN_CLUSTER_COVERAGE 1007
+    #define OPT_STOP_AT_MAPQ_CAP 1008
+    
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
@@ -97,22 +153,37 @@ int main_gaffe(int argc, char** argv) {
             {"help", no_argument, 0, 'h'},
             {"xg-name", required_argument, 0, 'x'},
             {"gbwt-name", required_argument, 0, 'H'},
+            {"graph-name", required_argument, 0, 'g'},
             {"minimizer-name", required_argument, 0, 'm'},
             {"snarls", required_argument, 0, 's'},
             {"dist-name", required_argument, 0, 'd'},
             {"hit-cap", required_argument, 0, 'c'},
             {"gam-in", required_argument, 0, 'G'},
             {"fastq-in", required_argument, 0, 'f'},
+            {"interleaved", no_argument, 0, 'i'},
+            {"paired", no_argument, 0, 'p'},
             {"max-multimaps", required_argument, 0, 'M'},
+            {"output-format", required_argument, 0, 'o'},
             {"sample", required_argument, 0, 'N'},
             {"read-group", required_argument, 0, 'R'},
             {"no-chaining", no_argument, 0, 'C'},
+            {"max-dp-cells", required_argument, 0, 'D'},
+            {"fragment-distance", required_argument, 0, 'F'},
+            {"fragment-mean", required_argument, 0, OPT_FRAGMENT_MEAN},
+            {"fragment-stdev", required_argument, 0, OPT_FRAGMENT_STDEV},
             {"threads", required_argument, 0, 't'},
+            {"max-seeds", required_argument, 0, OPT_MAX_SEEDS},
+            {"max-gbwt-states", required_argument, 0, OPT_MAX_GBWT_STATES},
+            {"cluster-coverage", required_argument, 0, OPT_MIN_CLUSTER_COVERAGE},
+            {"stop-at-mapq-cap", no_argument, 0, OPT_STOP_AT_MAPQ_CAP},
+            {"single-strand-graph", no_argument, 0, OPT_SINGLE_STRAND_GRAPH},
+            {"report-loading", no_argument, 0, OPT_REPORT_LOADING},
+            {"report-work-limits", no_argument, 0, OPT_REPORT_WORK_LIMITS},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:H:m:s:d:c:G:f:M:Ct:",
+        c = getopt_long (argc, argv, "hx:H:g:m:s:d:c:G:f:ipM:o:CD:F:t:",
                          long_options, &option_index);
 
 
@@ -138,6 +209,14 @@ int main_gaffe(int argc, char** argv) {
                 }
                 break;
                 
+            case 'g':
+                graph_name = optarg;
+                if (graph_name.empty()) {
+                    cerr << "error:[vg gaffe] Must provide GBWTGraph file with -g." << endl;
+                    exit(1);
+                }
+                break;
+                
             case 'm':
                 minimizer_name = optarg;
                 if (minimizer_name.empty()) {
@@ -174,10 +253,26 @@ int main_gaffe(int argc, char** argv) {
                 fastq_filenames.push_back(optarg);
                 break;
                 
+            case 'i':
+                interleaved = true;
+                break;
+                
+            case 'p':
+                paired_files = true;
+                break;
+                
             case 'M':
                 max_multimaps = parse<size_t>(optarg);
                 break;
             
+            case 'o':
+                output_format = optarg;
+                if (output_format != "GAM" && output_format != "GAF" && output_format != "JSON") {
+                    cerr << "error:[vg gaffe] Output format (-o) must be GAM, GAF, or JSON" << endl;
+                    exit(1);
+                }
+                break;
+            
             case 'N':
                 sample_name = optarg;
                 break;
@@ -190,6 +285,26 @@ int main_gaffe(int argc, char** argv) {
                 do_chaining = false;
                 break;
                 
+            case 'D':
+                max_dp_cells = parse<size_t>(optarg);
+                break;
+                
+            case 'F':
+                fragment_distance_limit = parse<size_t>(optarg);
+                break;
+                
+            case OPT_FRAGMENT_MEAN:
+                fragment_length_mean = parse<double>(optarg);
+                break;
+                
+            case OPT_FRAGMENT_STDEV:
+                fragment_length_stdev = parse<double>(optarg);
+                if (fragment_length_stdev <= 0) {
+                    cerr << "error:[vg gaffe] Fragment length standard deviation (--fragment-stdev) must be positive" << endl;
+                    exit(1);
+                }
+                break;
+                
             case 't':
             {
                 int num_threads = parse<int>(optarg);
@@ -201,6 +316,38 @@ int main_gaffe(int argc, char** argv) {
             }
                 break;
                 
+            case OPT_MAX_SEEDS:
+                max_seeds = parse<size_t>(optarg);
+                break;
+                
+            case OPT_MAX_GBWT_STATES:
+                max_gbwt_states = parse<size_t>(optarg);
+                break;
+                
+            case OPT_MIN_CLUSTER_COVERAGE:
+                min_cluster_coverage_fraction = parse<double>(optarg);
+                if (min_cluster_coverage_fraction < 0 || min_cluster_coverage_fraction > 1) {
+                    cerr << "error:[vg gaffe] Minimum cluster coverage (--cluster-coverage) must be between 0 and 1" << endl;
+                    exit(1);
+                }
+                break;
+                
+            case OPT_STOP_AT_MAPQ_CAP:
+                stop_at_mapq_cap = true;
+                break;
+                
+            case OPT_SINGLE_STRAND_GRAPH:
+                single_strand_graph = true;
+                break;
+                
+            case OPT_REPORT_LOADING:
+                report_loading = true;
+                break;
+                
+            case OPT_REPORT_WORK_LIMITS:
+                report_work_limits = true;
+                break;
+                
             case 'h':
             case '?':
             default:
@@ -236,30 +383,88 @@ int main_gaffe(int argc, char** argv) {
         exit(1);
     }
     
-    // create in-memory objects
-    unique_ptr<xg::XG> xg_index = vg::io::VPKG::load_one<xg::XG>(xg_name);
-    unique_ptr<gbwt::GBWT> gbwt_index = vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_name);
-    unique_ptr<MinimizerIndex> minimizer_index = vg::io::VPKG::load_one<MinimizerIndex>(minimizer_name);
-    unique_ptr<SnarlManager> snarl_manager = vg::io::VPKG::load_one<SnarlManager>(snarls_name);
-    unique_ptr<DistanceIndex> distance_index = vg::io::VPKG::load_one<DistanceIndex>(distance_name);
+    if (paired_files && fastq_filenames.size() != 2) {
+        cerr << "error:[vg gaffe] Paired mapping with -p requires exactly two FASTQ files (-f)" << endl;
+        exit(1);
+    }
+    
+    if (paired_files && interleaved) {
+        cerr << "error:[vg gaffe] Cannot take both interleaved (-i) and separate (-p) paired input" << endl;
+        exit(1);
+    }
+    
+    // create in-memory objects, loading all the indexes at once
+    unique_ptr<xg::XG> xg_index;
+    unique_ptr<gbwt::GBWT> gbwt_index;
+    unique_ptr<GBWTGraph> gbwt_graph;
+    unique_ptr<MinimizerIndex> minimizer_index;
+    unique_ptr<SnarlManager> snarl_manager;
+    unique_ptr<DistanceIndex> distance_index;
+    
+    IndexLoader loader;
+    loader.add(xg_name, xg_index, [&]() { return vg::io::VPKG::load_one<xg::XG>(xg_name); });
+    loader.add(gbwt_name, gbwt_index, [&]() { return vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_name); });
+    if (!graph_name.empty()) {
+        loader.add(graph_name, gbwt_graph, [&]() { return vg::io::VPKG::load_one<GBWTGraph>(graph_name); });
+    }
+    loader.add(minimizer_name, minimizer_index, [&]() { return vg::io::VPKG::load_one<MinimizerIndex>(minimizer_name); });
+    loader.add(snarls_name, snarl_manager, [&]() { return load_snarl_manager(snarls_name); });
+    loader.add(distance_name, distance_index, [&]() { return vg::io::VPKG::load_one<DistanceIndex>(distance_name); });
+    loader.run();
+    
+    if (report_loading) {
+        loader.report(cerr);
+    }
+    
+    if (gbwt_graph && !gbwt_graph->set_gbwt(*gbwt_index)) {
+        cerr << "error:[vg gaffe] GBWTGraph " << graph_name << " was not built from GBWT " << gbwt_name << endl;
+        exit(1);
+    }
+    
+    if (single_strand_graph) {
+        // Drop the reverse complements, or build the graph without them.
+        if (gbwt_graph) {
+            gbwt_graph->set_single_strand(true);
+        } else {
+            gbwt_graph.reset(new GBWTGraph(*gbwt_index, *xg_index, true));
+        }
+    }
+    
+    if (report_loading && gbwt_graph) {
+        cerr << "GBWTGraph sequences: " << gbwt::inMegabytes(gbwt_graph->sequence_bytes()) << " MiB" << endl;
+    }
     
     // Connect the DistanceIndex to the other things it needs to work.
     distance_index->setGraph(xg_index.get());
     distance_index->setSnarlManager(snarl_manager.get());
 
-    // Set up the mapper
-    MinimizerMapper minimizer_mapper(xg_index.get(), gbwt_index.get(), minimizer_index.get(), snarl_manager.get(), distance_index.get());
+    // Set up the mapper, building the GBWTGraph from the xg if we weren't given one
+    unique_ptr<MinimizerMapper> mapper_ptr;
+    if (gbwt_graph) {
+        mapper_ptr.reset(new MinimizerMapper(xg_index.get(), *gbwt_graph, minimizer_index.get(), snarl_manager.get(), distance_index.get()));
+    } else {
+        mapper_ptr.reset(new MinimizerMapper(xg_index.get(), gbwt_index.get(), minimizer_index.get(), snarl_manager.get(), distance_index.get()));
+    }
+    MinimizerMapper& minimizer_mapper = *mapper_ptr;
 
     minimizer_mapper.max_alignments = max_alignments;
     minimizer_mapper.max_multimaps = max_multimaps;
     minimizer_mapper.hit_cap = hit_cap;
     minimizer_mapper.distance_limit = distance_limit;
     minimizer_mapper.do_chaining = do_chaining;
+    minimizer_mapper.max_dp_cells = max_dp_cells;
+    minimizer_mapper.max_seeds = max_seeds;
+    minimizer_mapper.max_gbwt_states = max_gbwt_states;
+    minimizer_mapper.min_cluster_coverage_fraction = min_cluster_coverage_fraction;
+    minimizer_mapper.stop_at_mapq_cap = stop_at_mapq_cap;
+    minimizer_mapper.fragment_distance_limit = fragment_distance_limit;
+    minimizer_mapper.fragment_length_mean = fragment_length_mean;
+    minimizer_mapper.fragment_length_stdev = fragment_length_stdev;
     minimizer_mapper.sample_name = sample_name;
     minimizer_mapper.read_group = read_group;
     
     // Set up output to an emitter that will handle serialization
-    unique_ptr<AlignmentEmitter> alignment_emitter = get_alignment_emitter("-", "GAM", {});
+    unique_ptr<AlignmentEmitter> alignment_emitter = get_alignment_emitter("-", output_format, {}, xg_index.get());
 
 #ifdef USE_CALLGRIND
     // We want to profile the alignment, not the loading.
@@ -272,17 +477,40 @@ int main_gaffe(int argc, char** argv) {
         minimizer_mapper.map(aln, *alignment_emitter);
     };
         
+    // Define how to align and output a read pair, in a thread.
+    auto map_read_pair = [&](Alignment& aln1, Alignment& aln2) {
+        // Map the pair with the MinimizerMapper
+        minimizer_mapper.map_paired(aln1, aln2, *alignment_emitter);
+    };
+        
     for (auto& gam_name : gam_filenames) {
         // For every GAM file to remap
         get_input_file(gam_name, [&](istream& in) {
-            // Open it and map all the reads in parallel.
-            vg::io::for_each_parallel<Alignment>(in, map_read);
+            // Open it and map all the reads or pairs in parallel.
+            if (interleaved) {
+                vg::io::for_each_interleaved_pair_parallel(in, map_read_pair);
+            } else {
+                vg::io::for_each_parallel<Alignment>(in, map_read);
+            }
         });
     }
     
-    for (auto& fastq_name : fastq_filenames) {
-        // For every FASTQ file to map, map all its reads in parallel.
-        fastq_unpaired_for_each_parallel(fastq_name, map_read);
+    if (paired_files) {
+        // Map the pairs from the two FASTQ files in parallel.
+        fastq_paired_two_files_for_each_parallel(fastq_filenames[0], fastq_filenames[1], map_read_pair);
+    } else {
+        for (auto& fastq_name : fastq_filenames) {
+            // For every FASTQ file to map, map all its reads or pairs in parallel.
+            if (interleaved) {
+                fastq_paired_interleaved_for_each_parallel(fastq_name, map_read_pair);
+            } else {
+                fastq_unpaired_for_each_parallel(fastq_name, map_read);
+            }
+        }
+    }
+    
+    if (report_work_limits) {
+        minimizer_mapper.report_work_limits(cerr);
     }
         
     return 0;
@@ -20,8 +20,10 @@
 #include "../region.hpp"
 #include "../snarls.hpp"
 #include "../distance.hpp"
+#include "../snarl_tree_index.hpp"
 #include "../source_sink_overlay.hpp"
 #include "../gbwt_helper.hpp"
+#include "../gcsa_range_table.hpp"
 
 #include <gcsa/gcsa.h>
 #include <gcsa/algorithms.h>
@@ -66,6 +68,7 @@ void help_index(char** argv) {
          << "    -X, --doubling-steps N use this number of doubling steps for GCSA2 construction (default " << gcsa::ConstructionParameters::DOUBLING_STEPS << ")" << endl
          << "    -Z, --size-limit N     limit temporary disk space usage to N gigabytes (default " << gcsa::ConstructionParameters::SIZE_LIMIT << ")" << endl
          << "    -V, --verify-index     validate the GCSA2 index using the input kmers (important for testing)" << endl
+         << "    --range-table N        also store the GCSA2 ranges of all N-mers in FILE" << GCSARangeTable::EXTENSION << " (N <= " << GCSARangeTable::KMER_MAX_LENGTH << ")" << endl
          << "gam indexing options:" << endl
          << "    -l, --index-sorted-gam input is sorted .gam format alignments, store a GAI index of the sorted GAM in INPUT.gam.gai" << endl
          << "vg in-place indexing options:" << endl
@@ -80,7 +83,7 @@ void help_index(char** argv) {
          << "    -D, --dump             print the contents of the db to stdout" << endl
          << "    -C, --compact          compact the index into a single level (improves performance)" << endl
          << "snarl distance index options" << endl
-         << "    -s  --snarl-name FILE  load snarls from FILE" << endl
+         << "    -s  --snarl-name FILE  load snarls from FILE (or a snarl tree index from vg snarls -I)" << endl
          << "    -j  --dist-name FILE   use this file to store a snarl-based distance index" << endl
          << "    -w  --max_dist N   cap beyond which the maximum distance is no longer accurate" << endl;
 }
@@ -133,6 +136,7 @@ int main_index(int argc, char** argv) {
     }
 
     #define OPT_BUILD_VGI_INDEX 1000
+    #define OPT_RANGE_TABLE 1001
 
     // Which indexes to build.
     bool build_xg = false, build_gbwt = false, write_threads = false, build_gcsa = false, build_rocksdb = false, build_dist = false;
@@ -167,6 +171,7 @@ int main_index(int argc, char** argv) {
     gcsa::size_type kmer_size = gcsa::Key::MAX_LENGTH;
     gcsa::ConstructionParameters params;
     bool verify_gcsa = false;
+    size_t range_table_k = 0;
     
     // Gam index (GAI)
     bool build_gai_index = false;
@@ -227,6 +232,7 @@ int main_index(int argc, char** argv) {
             {"doubling-steps", required_argument, 0, 'X'},
             {"size-limit", required_argument, 0, 'Z'},
             {"verify-index", no_argument, 0, 'V'},
+            {"range-table", required_argument, 0, OPT_RANGE_TABLE},
             
             // GAM index (GAI)
             {"index-sorted-gam", no_argument, 0, 'l'},
@@ -394,6 +400,13 @@ int main_index(int argc, char** argv) {
         case 'V':
             verify_gcsa = true;
             break;
+        case OPT_RANGE_TABLE:
+            range_table_k = parse<size_t>(optarg);
+            if (range_table_k == 0 || range_table_k > GCSARangeTable::KMER_MAX_LENGTH) {
+                cerr << "error: [vg index] range table kmer length must be between 1 and " << GCSARangeTable::KMER_MAX_LENGTH << endl;
+                exit(1);
+            }
+            break;
             
         // Gam index (GAI)
         case 'l':
@@ -1049,6 +1062,15 @@ int main_index(int argc, char** argv) {
         vg::io::VPKG::save(gcsa_index, gcsa_name);
         vg::io::VPKG::save(lcp_array, gcsa_name + ".lcp");
 
+        // Build the range table for jump-starting backward searches
+        if (range_table_k > 0) {
+            if (show_progress) {
+                cerr << "Building the range table for " << range_table_k << "-mers..." << endl;
+            }
+            GCSARangeTable range_table(gcsa_index, range_table_k);
+            vg::io::VPKG::save(range_table, gcsa_name + GCSARangeTable::EXTENSION);
+        }
+
         // Verify the index
         if (verify_gcsa) {
             if (show_progress) {
@@ -1218,7 +1240,7 @@ int main_index(int argc, char** argv) {
                 cerr << "error: [vg index] cannot open Snarls file" << endl;
                 exit(1);
             }
-            SnarlManager* snarl_manager = new SnarlManager(snarl_stream);
+            SnarlManager* snarl_manager = load_snarl_manager(snarl_stream).release();
             snarl_stream.close();
 
             // Create the DistanceIndex
@@ -4,6 +4,7 @@
 #include "../mapper.hpp"
 #include "../surjector.hpp"
 #include "../alignment_emitter.hpp"
+#include "../index_loader.hpp"
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
 
@@ -51,6 +52,9 @@ void help_map(char** argv) {
          << "    --frag-calc INT               update the fragment model every INT perfect pairs [10]" << endl
          << "    --fragment-x FLOAT            calculate max fragment size as frag_mean+frag_sd*FLOAT [10]" << endl
          << "    --mate-rescues INT            attempt up to INT mate rescues per pair [64]" << endl
+         << "    --rescue-cache INT            keep INT rescue neighborhoods per thread, for position-sorted input [0]" << endl
+         << "    --rescue-kmer INT             skip rescues where the mate shares too few INT-mers with the graph (0 to disable) [0]" << endl
+         << "    --rescue-kmer-hits INT        the number of shared kmers a rescue needs with {--rescue-kmer} [1]" << endl
          << "    -S, --unpaired-cost INT       penalty for an unpaired read pair [17]" << endl
          << "    --no-patch-aln                do not patch banded alignments by locally aligning unaligned regions" << endl
          << "    --xdrop-alignment             use X-drop heuristic (much faster for long-read alignment)" << endl
@@ -102,6 +106,9 @@ int main_map(int argc, char** argv) {
     #define OPT_SCORE_MATRIX 1000
     #define OPT_RECOMBINATION_PENALTY 1001
     #define OPT_EXCLUDE_UNALIGNED 1002
+    #define OPT_RESCUE_CACHE 1003
+    #define OPT_RESCUE_KMER 1004
+    #define OPT_RESCUE_KMER_HITS 1005
     string matrix_file_name;
     string seq;
     string qual;
@@ -169,6 +176,9 @@ int main_map(int argc, char** argv) {
     int kmer_stride = 0;
     int pair_window = 64; // unused
     int mate_rescues = 64;
+    int rescue_cache_size = 0;
+    int rescue_kmer_size = 0;
+    int rescue_min_kmer_hits = 1;
     bool fixed_fragment_model = false;
     bool print_fragment_model = false;
     int fragment_model_update = 10;
@@ -242,6 +252,9 @@ int main_map(int argc, char** argv) {
                 {"try-at-least", required_argument, 0, 'l'},
                 {"mq-max", required_argument, 0, 'Q'},
                 {"mate-rescues", required_argument, 0, '0'},
+                {"rescue-cache", required_argument, 0, OPT_RESCUE_CACHE},
+                {"rescue-kmer", required_argument, 0, OPT_RESCUE_KMER},
+                {"rescue-kmer-hits", required_argument, 0, OPT_RESCUE_KMER_HITS},
                 {"approx-mq-cap", required_argument, 0, 'E'},
                 {"fixed-frag-model", no_argument, 0, 'U'},
                 {"print-frag-model", no_argument, 0, 'p'},
@@ -538,6 +551,18 @@ int main_map(int argc, char** argv) {
             mate_rescues = parse<int>(optarg);
             break;
 
+        case OPT_RESCUE_CACHE:
+            rescue_cache_size = parse<int>(optarg);
+            break;
+
+        case OPT_RESCUE_KMER:
+            rescue_kmer_size = parse<int>(optarg);
+            break;
+
+        case OPT_RESCUE_KMER_HITS:
+            rescue_min_kmer_hits = parse<int>(optarg);
+            break;
+
         case 'U':
             fixed_fragment_model = true;
             break;
@@ -580,6 +605,21 @@ int main_map(int argc, char** argv) {
         return 1;
     }
 
+    if (rescue_cache_size < 0) {
+        cerr << "error:[vg map] Rescue cache size (--rescue-cache) cannot be negative." << endl;
+        return 1;
+    }
+
+    if (rescue_kmer_size < 0 || rescue_kmer_size > 32) {
+        cerr << "error:[vg map] Rescue kmer size (--rescue-kmer) must be between 0 and 32." << endl;
+        return 1;
+    }
+
+    if (rescue_min_kmer_hits < 0) {
+        cerr << "error:[vg map] Rescue kmer hits (--rescue-kmer-hits) cannot be negative." << endl;
+        return 1;
+    }
+
     if (qual_adjust_alignments && ((fastq1.empty() && hts_file.empty() && qual.empty() && gam_input.empty()) // must have some quality input
                                    || (!seq.empty() && qual.empty())                                         // can't provide sequence without quality
                                    || !read_file.empty()))                                                   // can't provide sequence list without qualities
@@ -628,14 +668,17 @@ int main_map(int argc, char** argv) {
     unique_ptr<xg::XG> xgidx;
     unique_ptr<gcsa::GCSA> gcsa;
     unique_ptr<gcsa::LCPArray> lcp;
+    unique_ptr<GCSARangeTable> range_table;
     unique_ptr<gbwt::GBWT> gbwt;
     
     // One of them may be used to provide haplotype scores
     haplo::ScoreProvider* haplo_score_provider = nullptr;
 
-    // We try opening the file, and then see if it worked
+    // We try opening each file, and then see if it worked. All the indexes
+    // we find are loaded at once.
+    IndexLoader loader;
+    
     ifstream xg_stream(xg_name);
-
     if(xg_stream) {
         // We have an xg index!
         
@@ -644,7 +687,7 @@ int main_map(int argc, char** argv) {
         if(debug) {
             cerr << "Loading xg index " << xg_name << "..." << endl;
         }
-        xgidx = vg::io::VPKG::load_one<xg::XG>(xg_stream);
+        loader.add(xg_name, xgidx, [&]() { return vg::io::VPKG::load_one<xg::XG>(xg_stream); });
     }
 
     ifstream gcsa_stream(gcsa_name);
@@ -653,7 +696,7 @@ int main_map(int argc, char** argv) {
         if(debug) {
             cerr << "Loading GCSA2 index " << gcsa_name << "..." << endl;
         }
-        gcsa = vg::io::VPKG::load_one<gcsa::GCSA>(gcsa_stream);
+        loader.add(gcsa_name, gcsa, [&]() { return vg::io::VPKG::load_one<gcsa::GCSA>(gcsa_stream); });
     }
 
     string lcp_name = gcsa_name + ".lcp";
@@ -662,7 +705,17 @@ int main_map(int argc, char** argv) {
         if(debug) {
             cerr << "Loading LCP index " << lcp_name << "..." << endl;
         }
-        lcp = vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_stream);
+        loader.add(lcp_name, lcp, [&]() { return vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_stream); });
+    }
+    
+    // The range table is optional and only speeds up MEM finding
+    string range_table_name = gcsa_name + GCSARangeTable::EXTENSION;
+    ifstream range_table_stream(range_table_name);
+    if (range_table_stream) {
+        if(debug) {
+            cerr << "Loading GCSA2 range table " << range_table_name << "..." << endl;
+        }
+        loader.add(range_table_name, range_table, [&]() { return vg::io::VPKG::load_one<GCSARangeTable>(range_table_stream); });
     }
     
     ifstream gbwt_stream(gbwt_name);
@@ -671,10 +724,16 @@ int main_map(int argc, char** argv) {
         if(debug) {
             cerr << "Loading GBWT haplotype index " << gbwt_name << "..." << endl;
         }
-        
-        gbwt = vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_stream);
-        
-        // We want to use this for haplotype scoring
+        loader.add(gbwt_name, gbwt, [&]() { return vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_stream); });
+    }
+    
+    loader.run();
+    if(debug) {
+        loader.report(cerr);
+    }
+    
+    if(gbwt) {
+        // We want to use the GBWT for haplotype scoring
         haplo_score_provider = new haplo::GBWTScoreProvider<gbwt::GBWT>(*gbwt);
     }
 
@@ -778,6 +837,9 @@ int main_map(int argc, char** argv) {
             // Can't continue with null
             throw runtime_error("Need XG, GCSA, and LCP to create a Mapper");
         }
+        if (range_table.get() != nullptr) {
+            m->set_range_table(range_table.get());
+        }
         m->hit_max = hit_max;
         m->max_multimaps = max_multimaps;
         m->min_multimaps = max(min_multimaps, max_multimaps);
@@ -823,6 +885,9 @@ int main_map(int argc, char** argv) {
         m->frag_stats.fragment_model_update_interval = fragment_model_update;
         m->max_mapping_quality = max_mapping_quality;
         m->mate_rescues = mate_rescues;
+        m->rescue_cache_size = rescue_cache_size;
+        m->rescue_kmer_size = rescue_kmer_size;
+        m->rescue_min_kmer_hits = rescue_min_kmer_hits;
         m->max_band_jump = max_band_jump;
         m->identity_weight = identity_weight;
         m->assume_acyclic = acyclic_graph;
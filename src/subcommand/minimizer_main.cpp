@@ -10,6 +10,9 @@
  * By default, the index contains all minimizers in the graph. Option
  * --max-occs can be used to specify the maximum number of occurrences for
  * a kmer. Kmers more frequent than that will be removed from the index.
+ * Option --syncmer-length down-samples the minimizers by only considering
+ * kmers that are closed syncmers. The reads are sampled in the same way
+ * when they are queried against the index.
  *
  * The index contains either all minimizers or haplotype-consistent minimizers
  * (option --gbwt-name). Indexing all minimizers from complex graph regions
@@ -51,10 +54,13 @@ void help_minimizer(char** argv) {
     std::cerr << "    -k, --kmer-length N    length of the kmers in the index (default: " << MinimizerIndex::KMER_LENGTH << ")" << std::endl;
     std::cerr << "    -w, --window-length N  index the smallest kmer in a window of N kmers (default: " << MinimizerIndex::WINDOW_LENGTH << ")" << std::endl;
     std::cerr << "    -m, --max-occs N       do not index minimizers with more than N occurrences" << std::endl;
+    std::cerr << "    -s, --syncmer-length N only index kmers that are closed syncmers with N-mers (0 = all kmers; default: 0)" << std::endl;
     std::cerr << "    -i, --index-name X     store the index to file X (required)" << std::endl;
     std::cerr << "    -l, --load-index X     load the index from file X and insert the new kmers into it" << std::endl;
-    std::cerr << "                           (overrides --kmer-length, --window-length, and --max-occs)" << std::endl;
+    std::cerr << "                           (overrides --kmer-length, --window-length, --max-occs, and --syncmer-length)" << std::endl;
     std::cerr << "    -g, --gbwt-name X      index only haplotype-consistent kmers using the GBWT index in file X" << std::endl;
+    std::cerr << "    -o, --graph-out X      also store the GBWT-backed graph to file X (requires -g)" << std::endl;
+    std::cerr << "    -S, --single-strand    store the GBWT-backed graph sequences in forward orientation only" << std::endl;
     std::cerr << "    -p, --progress         show progress information" << std::endl;
     std::cerr << "    -t, --threads N        use N threads for index construction (default: " << omp_get_max_threads() << ")" << std::endl;
     std::cerr << "benchmark options:" << std::endl;
@@ -81,9 +87,10 @@ int main_minimizer(int argc, char** argv) {
     size_t kmer_length = MinimizerIndex::KMER_LENGTH;
     size_t window_length = MinimizerIndex::WINDOW_LENGTH;
     size_t max_occs = MinimizerIndex::MAX_OCCS;
+    size_t syncmer_length = 0;
     size_t max_errors = 0, min_hits = 1;
-    std::string index_name, load_index, gbwt_name, xg_name, reads_name, gcsa_name;
-    bool progress = false, locate = false, gapless_extend = false;
+    std::string index_name, load_index, gbwt_name, graph_out, xg_name, reads_name, gcsa_name;
+    bool progress = false, locate = false, gapless_extend = false, single_strand = false;
     int threads = omp_get_max_threads();
 
     int c;
@@ -94,9 +101,12 @@ int main_minimizer(int argc, char** argv) {
             { "kmer-length", required_argument, 0, 'k' },
             { "window-length", required_argument, 0, 'w' },
             { "max-occs", required_argument, 0, 'm' },
+            { "syncmer-length", required_argument, 0, 's' },
             { "index-name", required_argument, 0, 'i' },
             { "load-index", required_argument, 0, 'l' },
             { "gbwt-name", required_argument, 0, 'g' },
+            { "graph-out", required_argument, 0, 'o' },
+            { "single-strand", no_argument, 0, 'S' },
             { "progress", no_argument, 0, 'p' },
             { "threads", required_argument, 0, 't' },
             { "benchmark", required_argument, 0, 'b' },
@@ -108,7 +118,7 @@ int main_minimizer(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long(argc, argv, "k:w:m:i:l:g:pt:hb:G:Le:M:", long_options, &option_index);
+        c = getopt_long(argc, argv, "k:w:m:s:i:l:g:o:Spt:hb:G:Le:M:", long_options, &option_index);
         if (c == -1) { break; } // End of options.
 
         switch (c)
@@ -122,6 +132,9 @@ int main_minimizer(int argc, char** argv) {
         case 'm':
             max_occs = parse<size_t>(optarg);
             break;
+        case 's':
+            syncmer_length = parse<size_t>(optarg);
+            break;
         case 'i':
             index_name = optarg;
             break;
@@ -131,6 +144,12 @@ int main_minimizer(int argc, char** argv) {
         case 'g':
             gbwt_name = optarg;
             break;
+        case 'o':
+            graph_out = optarg;
+            break;
+        case 'S':
+            single_strand = true;
+            break;
         case 'p':
             progress = true;
             break;
@@ -173,6 +192,14 @@ int main_minimizer(int argc, char** argv) {
         std::cerr << "[vg minimizer]: option --extend requires --gbwt-name and --locate" << std::endl;
         return 1;
     }
+    if (syncmer_length > 0 && syncmer_length >= kmer_length) {
+        std::cerr << "[vg minimizer]: option --syncmer-length must be less than --kmer-length" << std::endl;
+        return 1;
+    }
+    if (!graph_out.empty() && gbwt_name.empty()) {
+        std::cerr << "[vg minimizer]: option --graph-out requires --gbwt-name" << std::endl;
+        return 1;
+    }
     if (!reads_name.empty()) {
         load_index = index_name;
     }
@@ -192,7 +219,7 @@ int main_minimizer(int argc, char** argv) {
     xg_index = vg::io::VPKG::load_one<xg::XG>(xg_name);
 
     // Minimizer index.
-    std::unique_ptr<MinimizerIndex> index(new MinimizerIndex(kmer_length, window_length, max_occs));
+    std::unique_ptr<MinimizerIndex> index(new MinimizerIndex(kmer_length, window_length, max_occs, syncmer_length));
     if (!load_index.empty()) {
         if (progress) {
             std::cerr << "Loading minimizer index " << load_index << std::endl;
@@ -211,8 +238,14 @@ int main_minimizer(int argc, char** argv) {
         if (progress) {
             std::cerr << "Building GBWT-backed graph" << std::endl;
         }
-        gbwt_graph.reset(new GBWTGraph(*gbwt_index, *xg_index));
+        gbwt_graph.reset(new GBWTGraph(*gbwt_index, *xg_index, single_strand));
         xg_index.reset(nullptr); // The XG index is no longer needed.
+        if (!graph_out.empty()) {
+            if (progress) {
+                std::cerr << "Writing GBWT-backed graph to " << graph_out << std::endl;
+            }
+            vg::io::VPKG::save(*gbwt_graph, graph_out);
+        }
     }
 
     // Run the benchmarks and return.
@@ -350,6 +383,16 @@ int query_benchmarks(const std::unique_ptr<MinimizerIndex>& index, const std::un
         std::cerr << std::endl;
     }
 
+    // Index size, for comparing sampling schemes against their sensitivity.
+    std::cerr << "Minimizer index: k = " << index->k() << ", w = " << index->w() << ", s = " << index->s() << std::endl;
+    std::cerr << index->size() << " keys with " << index->values() << " occurrences" << std::endl;
+    if (gbwt_graph) {
+        // Sequence storage, for comparing the storage modes against their extension throughput.
+        std::cerr << "GBWT-backed graph sequences: " << gbwt::inMegabytes(gbwt_graph->sequence_bytes()) << " MiB ("
+                  << (gbwt_graph->single_strand ? "single strand" : "both strands") << ")" << std::endl;
+    }
+    std::cerr << std::endl;
+
     // Minimizers.
     {
         double phase_start = gbwt::readTimer();
@@ -360,6 +403,7 @@ int query_benchmarks(const std::unique_ptr<MinimizerIndex>& index, const std::un
         }
         std::vector<size_t> min_counts(threads, 0);
         std::vector<size_t> occ_counts(threads, 0);
+        std::vector<size_t> hit_read_counts(threads, 0);
         std::vector<size_t> extend_counts(threads, 0);
         std::vector<size_t> seed_counts(threads, 0);
         std::vector<size_t> success_counts(threads, 0);
@@ -389,6 +433,9 @@ int query_benchmarks(const std::unique_ptr<MinimizerIndex>& index, const std::un
                     }
                 }
                 occ_counts[thread] += hits.size();
+                if (!hits.empty()) {
+                    hit_read_counts[thread]++;
+                }
                 if (gapless_extend && hits.size() >= min_hits) {
                     extend_counts[thread]++;
                     seed_counts[thread] += hits.size();
@@ -407,17 +454,23 @@ int query_benchmarks(const std::unique_ptr<MinimizerIndex>& index, const std::un
                     }
                 }
             } else {
+                size_t read_occs = 0;
                 for (auto minimizer : result) {
-                    occ_counts[thread] += index->count(minimizer);
+                    read_occs += index->count(minimizer);
+                }
+                occ_counts[thread] += read_occs;
+                if (read_occs > 0) {
+                    hit_read_counts[thread]++;
                 }
             }
         }
-        size_t min_count = 0, occ_count = 0;
+        size_t min_count = 0, occ_count = 0, hit_read_count = 0;
         size_t extend_count = 0, seed_count = 0, success_count = 0, success_seed_count = 0, partial_match_count = 0;
         size_t core_length = 0, flanked_length = 0;
         for (size_t i = 0; i < threads; i++) {
             min_count += min_counts[i];
             occ_count += occ_counts[i];
+            hit_read_count += hit_read_counts[i];
             extend_count += extend_counts[i];
             seed_count += seed_counts[i];
             success_count += success_counts[i];
@@ -437,6 +490,7 @@ int query_benchmarks(const std::unique_ptr<MinimizerIndex>& index, const std::un
         }
         std::cerr << "Minimizers (" << query_type << "): " << phase_seconds << " seconds (" << (reads.size() / phase_seconds) << " reads/second)" << std::endl;
         std::cerr << min_count << " minimizers with " << occ_count << " occurrences" << std::endl;
+        std::cerr << hit_read_count << " reads (" << (100.0 * hit_read_count / reads.size()) << "%) with at least one occurrence" << std::endl;
         if (gapless_extend) {
             std::cerr << extend_count << " reads with " << seed_count << " seeds: " << success_count << " full-length alignments with up to " << max_errors << " mismatches" << std::endl;
             size_t partial_count = extend_count - success_count, partial_seed_count = seed_count - success_seed_count;
@@ -12,6 +12,8 @@
 #include "../multipath_mapper.hpp"
 #include "../path.hpp"
 #include "../watchdog.hpp"
+#include "../index_loader.hpp"
+#include "../snarl_tree_index.hpp"
 
 //#define record_read_run_times
 
@@ -47,7 +49,7 @@ void help_mpmap(char** argv) {
     << "  -e, --same-strand             read pairs are from the same strand of the DNA molecule" << endl
     << "algorithm:" << endl
     << "  -S, --single-path-mode        produce single-path alignments (GAM) instead of multipath alignments (GAMP) (ignores -sua)" << endl
-    << "  -s, --snarls FILE             align to alternate paths in these snarls" << endl
+    << "  -s, --snarls FILE             align to alternate paths in these snarls (or snarl tree index from vg snarls -I)" << endl
     << "scoring:" << endl
     << "  -A, --no-qual-adjust          do not perform base quality adjusted alignments (required if input does not have base qualities)" << endl
     << "  -E, --long-read-scoring       set alignment scores to long-read defaults: -q1 -z1 -o1 -y1 -L0 (can be overridden)" << endl
@@ -92,7 +94,8 @@ void help_mpmap(char** argv) {
     << "  -m, --remove-bonuses          remove full length alignment bonuses in reported scores" << endl
     << "computational parameters:" << endl
     << "  -t, --threads INT             number of compute threads to use" << endl
-    << "  -Z, --buffer-size INT         buffer this many alignments together (per compute thread) before outputting to stdout [100]" << endl;
+    << "  -Z, --buffer-size INT         buffer this many alignments together (per compute thread) before outputting to stdout [100]" << endl
+    << "      --report-loading          report how long each index took to load" << endl;
     
 }
 
@@ -112,6 +115,7 @@ int main_mpmap(int argc, char** argv) {
     #define OPT_SUPPRESS_TAIL_ANCHORS 1005
     #define OPT_TOP_TRACEBACKS 1006
     #define OPT_MIN_DIST_CLUSTER 1007
+    #define OPT_REPORT_LOADING 1008
     string matrix_file_name;
     string xg_name;
     string gcsa_name;
@@ -202,6 +206,7 @@ int main_mpmap(int argc, char** argv) {
     int gap_extension_score_arg = std::numeric_limits<int>::min();
     int full_length_bonus_arg = std::numeric_limits<int>::min();
     int reversing_walk_length = 1;
+    bool report_loading = false;
     
     
     int c;
@@ -263,6 +268,7 @@ int main_mpmap(int argc, char** argv) {
             {"no-qual-adjust", no_argument, 0, 'A'},
             {"threads", required_argument, 0, 't'},
             {"buffer-size", required_argument, 0, 'Z'},
+            {"report-loading", no_argument, 0, OPT_REPORT_LOADING},
             {0, 0, 0, 0}
         };
 
@@ -553,6 +559,10 @@ int main_mpmap(int argc, char** argv) {
                 buffer_size = parse<int>(optarg);
                 break;
                 
+            case OPT_REPORT_LOADING:
+                report_loading = true;
+                break;
+                
             case 'h':
             case '?':
             default:
@@ -856,6 +866,10 @@ int main_mpmap(int argc, char** argv) {
         cerr << "error:[vg mpmap] Cannot open LCP file " << lcp_name << endl;
         exit(1);
     }
+    
+    // the range table is optional
+    string range_table_name = gcsa_name + GCSARangeTable::EXTENSION;
+    ifstream range_table_stream(range_table_name);
 
     ifstream matrix_stream;
     if (!matrix_file_name.empty()) {
@@ -908,22 +922,51 @@ int main_mpmap(int argc, char** argv) {
     // Configure its temp directory to the system temp directory
     gcsa::TempFile::setDirectory(temp_file::get_dir());
     
-    // Load required indexes
-    
-    unique_ptr<xg::XG> xg_index = vg::io::VPKG::load_one<xg::XG>(xg_stream);
-    unique_ptr<gcsa::GCSA> gcsa_index = vg::io::VPKG::load_one<gcsa::GCSA>(gcsa_stream);
-    unique_ptr<gcsa::LCPArray> lcp_array = vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_stream);
+    if (!distance_index_name.empty() && snarls_name.empty()) {
+        // We want a distance index, but we do not have a snarl manager.
+        cerr << "error:[vg mpmap] distance index requires snarls (-s)" << endl;
+        exit(1);
+    }
     
-    // Load optional indexes
+    // Load all the indexes from files at once
     
+    unique_ptr<xg::XG> xg_index;
+    unique_ptr<gcsa::GCSA> gcsa_index;
+    unique_ptr<gcsa::LCPArray> lcp_array;
+    unique_ptr<GCSARangeTable> range_table;
     unique_ptr<gbwt::GBWT> gbwt;
+    unique_ptr<SnarlManager> snarl_manager;
+    unique_ptr<DistanceIndex> distance_index;
+    
+    IndexLoader loader;
+    loader.add(xg_name, xg_index, [&]() { return vg::io::VPKG::load_one<xg::XG>(xg_stream); });
+    loader.add(gcsa_name, gcsa_index, [&]() { return vg::io::VPKG::load_one<gcsa::GCSA>(gcsa_stream); });
+    loader.add(lcp_name, lcp_array, [&]() { return vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_stream); });
+    if (range_table_stream) {
+        loader.add(range_table_name, range_table, [&]() { return vg::io::VPKG::load_one<GCSARangeTable>(range_table_stream); });
+    }
+    if (!gbwt_name.empty()) {
+        // Load the GBWT from its container
+        loader.add(gbwt_name, gbwt, [&]() { return vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_stream); });
+    }
+    if (!snarls_name.empty()) {
+        loader.add(snarls_name, snarl_manager, [&]() { return load_snarl_manager(snarl_stream); });
+    }
+    if (!distance_index_name.empty()) {
+        loader.add(distance_index_name, distance_index, [&]() { return vg::io::VPKG::load_one<DistanceIndex>(distance_index_stream); });
+    }
+    loader.run();
+    
+    if (report_loading) {
+        loader.report(cerr);
+    }
+    
+    // Set up optional haplotype scoring
+    
     haplo::linear_haplo_structure* sublinearLS = nullptr;
     haplo::ScoreProvider* haplo_score_provider = nullptr;
     if (!gbwt_name.empty()) {
         
-        // Load the GBWT from its container
-        gbwt = vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_stream);
-
         if (gbwt.get() == nullptr) {
           // Complain if we couldn't.
           cerr << "error:[vg mpmap] unable to load gbwt index file" << endl;
@@ -945,31 +988,17 @@ int main_mpmap(int argc, char** argv) {
     }
     // TODO: Allow using haplo::XGScoreProvider?
     
-    unique_ptr<SnarlManager> snarl_manager;
-    if (!snarls_name.empty()) {
-        snarl_manager = vg::io::VPKG::load_one<SnarlManager>(snarl_stream);
-    }
-    
-    unique_ptr<DistanceIndex> distance_index;
-    if (!distance_index_name.empty()) {
-        // We want a diatance index.
-        // We know we have an XG already.
-        // But we don't know that we have a snarl manager.
-        if (!snarl_manager) {
-            cerr << "error:[vg mpmap] distance index requires snarls (-s)" << endl;
-            exit(1);
-        }
-        
-        // Load the index
-        distance_index = vg::io::VPKG::load_one<DistanceIndex>(distance_index_stream);
-        
-        // Hook it up
+    if (distance_index) {
+        // Hook up the distance index now that everything it needs is loaded
         distance_index->setGraph(xg_index.get());
         distance_index->setSnarlManager(snarl_manager.get());
     }
     
     MultipathMapper multipath_mapper(xg_index.get(), gcsa_index.get(), lcp_array.get(), haplo_score_provider,
         snarl_manager.get(), distance_index.get());
+    if (range_table) {
+        multipath_mapper.set_range_table(range_table.get());
+    }
     
     // set alignment parameters
     multipath_mapper.set_alignment_scores(match_score, mismatch_score, gap_open_score, gap_extension_score, full_length_bonus);
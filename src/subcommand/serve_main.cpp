@@ -0,0 +1,509 @@
+/** \file serve_main.cpp
+ *
+ * Defines the "vg serve" subcommand, which loads mapping indexes once and
+ * then runs mapping jobs sent to it over a Unix socket.
+ *
+ * Each job is a normal vg map, mpmap or gaffe command line. The server forks
+ * a process for every job, so the indexes are shared with the jobs through
+ * copy-on-write memory, and a job that fails or exits can't take the server
+ * down with it. The job takes the indexes through IndexLoader, which hands out
+ * the resident copy for any index file the server has loaded.
+ *
+ * The server never runs OpenMP code itself, since the GNU OpenMP runtime does
+ * not survive a fork once it has started its threads.
+ *
+ * A client (vg serve with a command) sends NUL-terminated strings: its working
+ * directory, the output file, and then the job's argv, ending with an empty
+ * string. The job's standard error comes back over the socket, followed by a
+ * NUL and the job's exit status.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "subcommand.hpp"
+
+#include "../index_loader.hpp"
+#include "../gcsa_range_table.hpp"
+#include "../gbwt_helper.hpp"
+#include "../minimizer.hpp"
+#include "../snarls.hpp"
+#include "../snarl_tree_index.hpp"
+#include "../distance.hpp"
+#include "../xg.hpp"
+
+#include <vg/io/vpkg.hpp>
+#include <gcsa/gcsa.h>
+#include <gcsa/lcp.h>
+
+using namespace std;
+using namespace vg;
+using namespace vg::subcommand;
+
+void help_serve(char** argv) {
+    cerr << "usage: " << argv[0] << " serve [options] -S FILE" << endl
+         << "       " << argv[0] << " serve -S FILE -o FILE <map|mpmap|gaffe> [mapping options]" << endl
+         << "Keep mapping indexes loaded, and run mapping jobs against them." << endl
+         << "Jobs use the loaded copy of any index file given to the server, and load the rest." << endl
+         << endl
+         << "options:" << endl
+         << "    -S, --socket FILE      listen for jobs on (or send a job to) the Unix socket FILE (required)" << endl
+         << "server options:" << endl
+         << "    -x, --xg-name FILE     load the XG index in FILE" << endl
+         << "    -g, --gcsa-name FILE   load the GCSA2 index in FILE, with its LCP array and range table" << endl
+         << "    -H, --gbwt-name FILE   load the GBWT index in FILE" << endl
+         << "    -G, --gbwt-graph FILE  load the GBWTGraph in FILE" << endl
+         << "    -m, --minimizer-name FILE" << endl
+         << "                           load the minimizer index in FILE" << endl
+         << "    -s, --snarls FILE      load the snarls (or snarl tree index) in FILE" << endl
+         << "    -d, --dist-name FILE   load the distance index in FILE" << endl
+         << "    -p, --progress         report index loading and jobs on stderr" << endl
+         << "client options:" << endl
+         << "    -o, --output FILE      write the job's standard output to FILE (required)" << endl;
+}
+
+// The commands jobs are allowed to run
+static const set<string> SERVED_COMMANDS { "map", "mpmap", "gaffe" };
+
+// Read a NUL-terminated string from the file descriptor. Returns false at EOF
+// or on error.
+static bool read_string(int fd, string& out) {
+    out.clear();
+    char c;
+    while (true) {
+        ssize_t got = read(fd, &c, 1);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        if (c == '\0') {
+            return true;
+        }
+        out.push_back(c);
+    }
+}
+
+// Write the whole buffer to the file descriptor. Returns false on error.
+static bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+// Fill in a Unix socket address for the path, or exit if it is too long.
+static sockaddr_un socket_address(const string& socket_name) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_name.size() >= sizeof(address.sun_path)) {
+        cerr << "error:[vg serve] socket name " << socket_name << " is too long" << endl;
+        exit(1);
+    }
+    strcpy(address.sun_path, socket_name.c_str());
+    return address;
+}
+
+// Run a job on a connection in the current process, which is a fresh fork of
+// the server, and exit with its status.
+static void run_job(int connection, const string& working_dir, const string& output_name, vector<string>& args) {
+    if (chdir(working_dir.c_str()) != 0) {
+        cerr << "error:[vg serve] cannot change to directory " << working_dir << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+
+    int output = open(output_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (output < 0) {
+        cerr << "error:[vg serve] cannot open output file " << output_name << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+    int input = open("/dev/null", O_RDONLY);
+    dup2(input, STDIN_FILENO);
+    dup2(output, STDOUT_FILENO);
+    close(input);
+    close(output);
+    close(connection);
+
+    vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    // getopt keeps its state in globals, and we already parsed our own options
+    optind = 1;
+
+    const Subcommand* subcommand = Subcommand::get(args.size(), argv.data());
+    int status = (*subcommand)(args.size(), argv.data());
+    
+    // Skip tearing down the indexes we didn't use, which could take a while
+    cout.flush();
+    cerr.flush();
+    fflush(nullptr);
+    _exit(status);
+}
+
+// Read a job from the connection, run it in its own process, and report how
+// it went. Runs in a process forked off from the server for the connection.
+static void handle_connection(int connection) {
+    // Let waitpid() see our job, even though the server ignores its children
+    signal(SIGCHLD, SIG_DFL);
+
+    // Job stderr goes back to the client
+    dup2(connection, STDERR_FILENO);
+
+    string working_dir, output_name, arg;
+    vector<string> args;
+    bool ok = read_string(connection, working_dir) && read_string(connection, output_name);
+    while (ok) {
+        ok = read_string(connection, arg);
+        if (!ok || arg.empty()) {
+            break;
+        }
+        args.push_back(arg);
+    }
+
+    int status = 1;
+    if (!ok || args.size() < 2) {
+        cerr << "error:[vg serve] malformed job request" << endl;
+    } else if (!SERVED_COMMANDS.count(args[1])) {
+        cerr << "error:[vg serve] cannot run " << args[1] << " jobs, only map, mpmap and gaffe" << endl;
+    } else {
+        pid_t job = fork();
+        if (job < 0) {
+            cerr << "error:[vg serve] cannot fork job: " << strerror(errno) << endl;
+        } else if (job == 0) {
+            run_job(connection, working_dir, output_name, args);
+        } else {
+            int wait_status;
+            while (waitpid(job, &wait_status, 0) < 0 && errno == EINTR) {
+                // Keep waiting
+            }
+            if (WIFEXITED(wait_status)) {
+                status = WEXITSTATUS(wait_status);
+            } else {
+                cerr << "error:[vg serve] job was killed by signal " << WTERMSIG(wait_status) << endl;
+                status = 128 + WTERMSIG(wait_status);
+            }
+        }
+    }
+
+    // Send a NUL and the status
+    string trailer = string(1, '\0') + to_string(status);
+    write_all(connection, trailer.data(), trailer.size());
+    close(connection);
+    _exit(0);
+}
+
+// Send a job to the server and relay its standard error. Returns the job's exit status.
+static int submit_job(const string& socket_name, const string& output_name, int argc, char** argv, int first_arg) {
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = socket_address(socket_name);
+    if (connection < 0 || connect(connection, (sockaddr*) &address, sizeof(address)) != 0) {
+        cerr << "error:[vg serve] cannot connect to server at " << socket_name << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    char working_dir[PATH_MAX];
+    if (getcwd(working_dir, sizeof(working_dir)) == nullptr) {
+        cerr << "error:[vg serve] cannot get working directory: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    string request;
+    request.append(working_dir).push_back('\0');
+    request.append(output_name).push_back('\0');
+    request.append(argv[0]).push_back('\0');
+    for (int i = first_arg; i < argc; i++) {
+        request.append(argv[i]).push_back('\0');
+    }
+    request.push_back('\0');
+    if (!write_all(connection, request.data(), request.size())) {
+        cerr << "error:[vg serve] cannot send job to server: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    // Relay everything up to the NUL, and then read the status after it
+    string status_text;
+    bool in_status = false;
+    char buffer[4096];
+    ssize_t got;
+    while ((got = read(connection, buffer, sizeof(buffer))) != 0) {
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        size_t relay = got;
+        if (!in_status) {
+            char* end = (char*) memchr(buffer, '\0', got);
+            if (end != nullptr) {
+                relay = end - buffer;
+                status_text.append(end + 1, buffer + got);
+                in_status = true;
+            }
+            cerr.write(buffer, relay);
+        } else {
+            status_text.append(buffer, got);
+        }
+    }
+    close(connection);
+    cerr.flush();
+
+    if (!in_status) {
+        cerr << "error:[vg serve] server closed the connection before the job finished" << endl;
+        return 1;
+    }
+    return stoi(status_text);
+}
+
+int main_serve(int argc, char** argv) {
+
+    if (argc == 2) {
+        help_serve(argv);
+        return 1;
+    }
+
+    string socket_name;
+    string output_name;
+    string xg_name;
+    string gcsa_name;
+    string gbwt_name;
+    string gbwt_graph_name;
+    string minimizer_name;
+    string snarls_name;
+    string distance_name;
+    bool progress = false;
+
+    int c;
+    optind = 2; // force optind past command positional argument
+    while (true) {
+        static struct option long_options[] =
+        {
+            {"socket", required_argument, 0, 'S'},
+            {"output", required_argument, 0, 'o'},
+            {"xg-name", required_argument, 0, 'x'},
+            {"gcsa-name", required_argument, 0, 'g'},
+            {"gbwt-name", required_argument, 0, 'H'},
+            {"gbwt-graph", required_argument, 0, 'G'},
+            {"minimizer-name", required_argument, 0, 'm'},
+            {"snarls", required_argument, 0, 's'},
+            {"dist-name", required_argument, 0, 'd'},
+            {"progress", no_argument, 0, 'p'},
+            {"help", no_argument, 0, 'h'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        // Stop at the job's command, so its options are left alone
+        c = getopt_long (argc, argv, "+S:o:x:g:H:G:m:s:d:ph",
+                long_options, &option_index);
+
+        // Detect the end of the options.
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+            case 'S':
+                socket_name = optarg;
+                break;
+            case 'o':
+                output_name = optarg;
+                break;
+            case 'x':
+                xg_name = optarg;
+                break;
+            case 'g':
+                gcsa_name = optarg;
+                break;
+            case 'H':
+                gbwt_name = optarg;
+                break;
+            case 'G':
+                gbwt_graph_name = optarg;
+                break;
+            case 'm':
+                minimizer_name = optarg;
+                break;
+            case 's':
+                snarls_name = optarg;
+                break;
+            case 'd':
+                distance_name = optarg;
+                break;
+            case 'p':
+                progress = true;
+                break;
+
+            case 'h':
+            case '?':
+                help_serve(argv);
+                exit(1);
+                break;
+
+            default:
+                abort ();
+        }
+    }
+
+    if (socket_name.empty()) {
+        cerr << "error:[vg serve] a socket (-S) is required" << endl;
+        return 1;
+    }
+
+    if (optind < argc) {
+        // We are a client with a job to run
+        if (output_name.empty()) {
+            cerr << "error:[vg serve] jobs need an output file (-o)" << endl;
+            return 1;
+        }
+        return submit_job(socket_name, output_name, argc, argv, optind);
+    }
+    if (!output_name.empty()) {
+        cerr << "error:[vg serve] an output file (-o) needs a job to run" << endl;
+        return 1;
+    }
+
+    // Load all the indexes at once, and then make them resident
+    unique_ptr<xg::XG> xg_index;
+    unique_ptr<gcsa::GCSA> gcsa_index;
+    unique_ptr<gcsa::LCPArray> lcp_array;
+    unique_ptr<GCSARangeTable> range_table;
+    unique_ptr<gbwt::GBWT> gbwt_index;
+    unique_ptr<GBWTGraph> gbwt_graph;
+    unique_ptr<MinimizerIndex> minimizer_index;
+    unique_ptr<SnarlManager> snarl_manager;
+    unique_ptr<DistanceIndex> distance_index;
+
+    string lcp_name = gcsa_name + ".lcp";
+    string range_table_name = gcsa_name + GCSARangeTable::EXTENSION;
+
+    IndexLoader loader;
+    if (!xg_name.empty()) {
+        loader.add(xg_name, xg_index, [&]() { return vg::io::VPKG::load_one<xg::XG>(xg_name); });
+    }
+    if (!gcsa_name.empty()) {
+        gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+        loader.add(gcsa_name, gcsa_index, [&]() { return vg::io::VPKG::load_one<gcsa::GCSA>(gcsa_name); });
+        loader.add(lcp_name, lcp_array, [&]() { return vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_name); });
+        if (ifstream(range_table_name)) {
+            loader.add(range_table_name, range_table, [&]() { return vg::io::VPKG::load_one<GCSARangeTable>(range_table_name); });
+        }
+    }
+    if (!gbwt_name.empty()) {
+        loader.add(gbwt_name, gbwt_index, [&]() { return vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_name); });
+    }
+    if (!gbwt_graph_name.empty()) {
+        loader.add(gbwt_graph_name, gbwt_graph, [&]() { return vg::io::VPKG::load_one<GBWTGraph>(gbwt_graph_name); });
+    }
+    if (!minimizer_name.empty()) {
+        loader.add(minimizer_name, minimizer_index, [&]() { return vg::io::VPKG::load_one<MinimizerIndex>(minimizer_name); });
+    }
+    if (!snarls_name.empty()) {
+        loader.add(snarls_name, snarl_manager, [&]() { return load_snarl_manager(snarls_name); });
+    }
+    if (!distance_name.empty()) {
+        loader.add(distance_name, distance_index, [&]() { return vg::io::VPKG::load_one<DistanceIndex>(distance_name); });
+    }
+    loader.run();
+    if (progress) {
+        loader.report(cerr);
+    }
+
+    if (xg_index) {
+        IndexLoader::make_resident(xg_name, std::move(xg_index));
+    }
+    if (gcsa_index) {
+        IndexLoader::make_resident(gcsa_name, std::move(gcsa_index));
+        IndexLoader::make_resident(lcp_name, std::move(lcp_array));
+    }
+    if (range_table) {
+        IndexLoader::make_resident(range_table_name, std::move(range_table));
+    }
+    if (gbwt_index) {
+        IndexLoader::make_resident(gbwt_name, std::move(gbwt_index));
+    }
+    if (gbwt_graph) {
+        IndexLoader::make_resident(gbwt_graph_name, std::move(gbwt_graph));
+    }
+    if (minimizer_index) {
+        IndexLoader::make_resident(minimizer_name, std::move(minimizer_index));
+    }
+    if (snarl_manager) {
+        IndexLoader::make_resident(snarls_name, std::move(snarl_manager));
+    }
+    if (distance_index) {
+        IndexLoader::make_resident(distance_name, std::move(distance_index));
+    }
+
+    // Listen on the socket, replacing any left over from an old server
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = socket_address(socket_name);
+    unlink(socket_name.c_str());
+    if (listener < 0 || ::bind(listener, (sockaddr*) &address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        cerr << "error:[vg serve] cannot listen on " << socket_name << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    if (progress) {
+        cerr << "Listening for jobs on " << socket_name << endl;
+    }
+
+    // We don't wait for the processes handling connections, so have the
+    // system clean them up
+    signal(SIGCHLD, SIG_IGN);
+
+    while (true) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            cerr << "error:[vg serve] cannot accept connection: " << strerror(errno) << endl;
+            return 1;
+        }
+
+        pid_t handler = fork();
+        if (handler < 0) {
+            cerr << "error:[vg serve] cannot fork: " << strerror(errno) << endl;
+        } else if (handler == 0) {
+            close(listener);
+            handle_connection(connection);
+        } else if (progress) {
+            cerr << "Started job handler " << handler << endl;
+        }
+        close(connection);
+    }
+
+    return 0;
+}
+
+// Register subcommand
+static Subcommand vg_serve("serve", "run mapping jobs against indexes kept in memory", main_serve);
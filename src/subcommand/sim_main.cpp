@@ -70,7 +70,9 @@ void help_sim(char** argv) {
          << "    -v, --frag-std-dev FLOAT    use this standard deviation for fragment length estimation" << endl
          << "    -N, --allow-Ns              allow reads to be sampled from the graph with Ns in them" << endl
          << "    -a, --align-out             generate true alignments on stdout rather than reads" << endl
-         << "    -J, --json-out              write alignments in json" << endl;
+         << "    -J, --json-out              write alignments in json" << endl
+         << "    -t, --threads N             number of threads to simulate with; output is reproducible for a" << endl
+         << "                                given seed and thread count (default: 1)" << endl;
 }
 
 int main_sim(int argc, char** argv) {
@@ -82,7 +84,8 @@ int main_sim(int argc, char** argv) {
 
     int read_length = 100;
     int num_reads = 1;
-    int seed_val = time(NULL);
+    // 0 means no seed was given
+    int seed_val = 0;
     double base_error = 0;
     double indel_error = 0;
     bool forward_only = false;
@@ -102,6 +105,7 @@ int main_sim(int argc, char** argv) {
     // Alternatively, which transcripts with how much expression?
     string rsem_file_name;
     vector<pair<string, double>> transcript_expressions;
+    int thread_count = 1;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -127,11 +131,12 @@ int main_sim(int argc, char** argv) {
             {"scale-err", required_argument, 0, 'S'},
             {"frag-len", required_argument, 0, 'p'},
             {"frag-std-dev", required_argument, 0, 'v'},
+            {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hl:n:s:e:i:fax:Jp:v:Nd:F:P:T:S:I",
+        c = getopt_long (argc, argv, "hl:n:s:e:i:fax:Jp:v:Nd:F:P:T:S:It:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -219,6 +224,14 @@ int main_sim(int argc, char** argv) {
             fragment_std_dev = parse<double>(optarg);
             break;
             
+        case 't':
+            thread_count = parse<int>(optarg);
+            if (thread_count <= 0) {
+                cerr << "error[vg sim]: thread count must be positive" << endl;
+                exit(1);
+            }
+            break;
+            
         case 'h':
         case '?':
             help_sim(argv);
@@ -235,6 +248,13 @@ int main_sim(int argc, char** argv) {
         return 1;
     }
     
+    if (seed_val == 0) {
+        // Pick a master seed at random. The stream seeds are all derived from
+        // it, so every run differs no matter how many threads we use.
+        random_device seed_source;
+        seed_val = uniform_int_distribution<int>(1, numeric_limits<int>::max())(seed_source);
+    }
+    
     if (!rsem_file_name.empty()) {
         ifstream rsem_in(rsem_file_name);
         if (!rsem_in) {
@@ -269,19 +289,100 @@ int main_sim(int argc, char** argv) {
         aln_emitter = unique_ptr<vg::io::ProtobufEmitter<Alignment>>(new vg::io::ProtobufEmitter<Alignment>(cout));
     }
 
-    // Make a Mapper to score reads, with the default parameters
-    Mapper rescorer(xgidx.get(), nullptr, nullptr);
-    // We define a function to score a generated alignment under the mapper
-    auto rescore = [&] (Alignment& aln) {
-        // Score using exact distance.
-        aln.set_score(rescorer.score_alignment(aln, false));
+    // Write out a read or read pair in the requested format, either as text
+    // to the given stream or by moving the alignments into the given buffer
+    // for the emitter
+    auto format_reads = [&](vector<Alignment>& alns, ostream& text_out, vector<Alignment>& gam_out) {
+        if (align_out) {
+            if (json_out) {
+                for (auto& aln : alns) {
+                    text_out << pb2json(aln) << "\n";
+                }
+            } else {
+                for (auto& aln : alns) {
+                    gam_out.emplace_back(std::move(aln));
+                }
+            }
+        } else if (alns.size() == 2) {
+            text_out << alns.front().sequence() << "\t" << alns.back().sequence() << "\n";
+        } else {
+            text_out << alns.front().sequence() << "\n";
+        }
+    };
+    
+    // Simulate the reads, using the given function to sample each read or read
+    // pair from the given stream. If we have multiple threads, each thread
+    // works on its own stream in batches, and the batches are written out in
+    // stream order, so the output only depends on the seed and the thread
+    // count.
+    auto simulate = [&](const function<void(size_t, vector<Alignment>&)>& sample) {
+        
+        vector<Alignment> alns;
+        vector<Alignment> gam_buffer;
+        
+        if (thread_count == 1) {
+            // Just write reads out as we go
+            for (size_t i = 0; i < num_reads; i++) {
+                alns.clear();
+                sample(0, alns);
+                format_reads(alns, cout, gam_buffer);
+                if (!gam_buffer.empty()) {
+                    aln_emitter->write_many(std::move(gam_buffer));
+                    gam_buffer.clear();
+                }
+            }
+            return;
+        }
+        
+        // How many reads each stream makes before we write them out
+        const size_t batch_size = 1000;
+        
+        vector<stringstream> text_buffers(thread_count);
+        vector<vector<Alignment>> gam_buffers(thread_count);
+        
+        for (size_t round_start = 0; round_start < num_reads; round_start += batch_size * thread_count) {
+            size_t round_end = min<size_t>(num_reads, round_start + batch_size * thread_count);
+            
+#pragma omp parallel for schedule(static, 1) num_threads(thread_count)
+            for (size_t stream = 0; stream < thread_count; stream++) {
+                // Each stream makes a fixed slice of the reads in this round
+                size_t batch_start = min(round_end, round_start + stream * batch_size);
+                size_t batch_end = min(round_end, batch_start + batch_size);
+                
+                vector<Alignment> stream_alns;
+                for (size_t i = batch_start; i < batch_end; i++) {
+                    stream_alns.clear();
+                    sample(stream, stream_alns);
+                    format_reads(stream_alns, text_buffers[stream], gam_buffers[stream]);
+                }
+            }
+            
+            // Write the batches out in order
+            for (size_t stream = 0; stream < thread_count; stream++) {
+                if (align_out && !json_out) {
+                    aln_emitter->write_many(std::move(gam_buffers[stream]));
+                    gam_buffers[stream].clear();
+                } else {
+                    cout << text_buffers[stream].str();
+                    text_buffers[stream].str("");
+                }
+            }
+        }
     };
     
     if (fastq_name.empty()) {
         // Use the fixed error rate sampler
         
-        // Make a sample to sample reads with
-        Sampler sampler(xgidx.get(), seed_val, forward_only, reads_may_contain_Ns, path_names, transcript_expressions);
+        // Make a sampler to sample reads with for each stream. If we only have
+        // one, it uses the seed directly so that results don't change.
+        vector<unique_ptr<Sampler>> samplers;
+        for (size_t stream = 0; stream < thread_count; stream++) {
+            int stream_seed = thread_count == 1 ? seed_val : derive_stream_seed(seed_val, stream);
+            samplers.emplace_back(new Sampler(xgidx.get(), stream_seed, forward_only, reads_may_contain_Ns,
+                                              path_names, transcript_expressions));
+            // Keep the names that the samplers hash from their nonces apart
+            samplers.back()->nonce = int64_t(stream) << 32;
+        }
         
         // Make a Mapper to score reads, with the default parameters
         Mapper rescorer(xgidx.get(), nullptr, nullptr);
@@ -297,13 +398,14 @@ int main_sim(int argc, char** argv) {
         };
         
         size_t max_iter = 1000;
-        int nonce = 1;
-        for (int i = 0; i < num_reads; ++i) {
+        
+        simulate([&](size_t stream, vector<Alignment>& alns) {
             // For each read we are going to generate
+            Sampler& sampler = *samplers[stream];
             
             if (fragment_length) {
                 // fragment_lenght is nonzero so make it two paired reads
-                auto alns = sampler.alignment_pair(read_length, fragment_length, fragment_std_dev, base_error, indel_error);
+                alns = sampler.alignment_pair(read_length, fragment_length, fragment_std_dev, base_error, indel_error);
                 
                 size_t iter = 0;
                 while (iter++ < max_iter) {
@@ -314,25 +416,6 @@ int main_sim(int argc, char** argv) {
                         alns = sampler.alignment_pair(read_length, fragment_length, fragment_std_dev, base_error, indel_error);
                     }
                 }
-                
-                // write the alignment or its string
-                if (align_out) {
-                    // write it out as requested
-                    
-                    // We will need scores
-                    rescore(alns.front());
-                    rescore(alns.back());
-                    
-                    if (json_out) {
-                        cout << pb2json(alns.front()) << endl;
-                        cout << pb2json(alns.back()) << endl;
-                    } else {
-                        aln_emitter->write_copy(alns.front());
-                        aln_emitter->write_copy(alns.back());
-                    }
-                } else {
-                    cout << alns.front().sequence() << "\t" << alns.back().sequence() << endl;
-                }
             } else {
                 // Do single-end reads
                 auto aln = sampler.alignment_with_error(read_length, base_error, indel_error);
@@ -349,24 +432,16 @@ int main_sim(int argc, char** argv) {
                         }
                     }
                 }
-                
-                // write the alignment or its string
-                if (align_out) {
-                    // write it out as requested
-                    
-                    // We will need scores
+                alns.emplace_back(std::move(aln));
+            }
+            
+            if (align_out) {
+                // We will need scores
+                for (auto& aln : alns) {
                     rescore(aln);
-                    
-                    if (json_out) {
-                        cout << pb2json(aln) << endl;
-                    } else {
-                        aln_emitter->write_copy(aln);
-                    }
-                } else {
-                    cout << aln.sequence() << endl;
                 }
             }
-        }
+        });
         
     }
     else {
@@ -374,59 +449,45 @@ int main_sim(int argc, char** argv) {
         
         Aligner aligner(default_match, default_mismatch, default_gap_open, default_gap_extension, 5);
         
-        NGSSimulator sampler(*xgidx,
-                             fastq_name,
-                             interleaved,
-                             path_names,
-                             transcript_expressions,
-                             base_error,
-                             indel_error,
-                             indel_prop,
-                             fragment_length ? fragment_length : std::numeric_limits<double>::max(), // suppresses warnings about fragment length
-                             fragment_std_dev ? fragment_std_dev : 0.000001, // eliminates errors from having 0 as stddev without substantial difference
-                             error_scale_factor,
-                             !reads_may_contain_Ns,
-                             seed_val);
+        // Train the simulator once
+        NGSSimulator trained_sampler(*xgidx,
+                                     fastq_name,
+                                     interleaved,
+                                     path_names,
+                                     transcript_expressions,
+                                     base_error,
+                                     indel_error,
+                                     indel_prop,
+                                     fragment_length ? fragment_length : std::numeric_limits<double>::max(), // suppresses warnings about fragment length
+                                     fragment_std_dev ? fragment_std_dev : 0.000001, // eliminates errors from having 0 as stddev without substantial difference
+                                     error_scale_factor,
+                                     !reads_may_contain_Ns,
+                                     seed_val);
         
-        if (fragment_length) {
-            for (size_t i = 0; i < num_reads; i++) {
-                pair<Alignment, Alignment> read_pair = sampler.sample_read_pair();
-                read_pair.first.set_score(aligner.score_ungapped_alignment(read_pair.first, strip_bonuses));
-                read_pair.second.set_score(aligner.score_ungapped_alignment(read_pair.second, strip_bonuses));
-                
-                if (align_out) {
-                    if (json_out) {
-                        cout << pb2json(read_pair.first) << endl;
-                        cout << pb2json(read_pair.second) << endl;
-                    }
-                    else {
-                        aln_emitter->write_copy(read_pair.first);
-                        aln_emitter->write_copy(read_pair.second);
-                    }
-                }
-                else {
-                    cout << read_pair.first.sequence() << "\t" << read_pair.second.sequence() << endl;
-                }
+        // And then give each additional stream a copy with its own seed
+        vector<unique_ptr<NGSSimulator>> stream_samplers;
+        if (thread_count > 1) {
+            for (size_t stream = 0; stream < thread_count; stream++) {
+                stream_samplers.emplace_back(new NGSSimulator(trained_sampler, derive_stream_seed(seed_val, stream)));
             }
         }
-        else {
-            for (size_t i = 0; i < num_reads; i++) {
-                Alignment read = sampler.sample_read();
-                read.set_score(aligner.score_ungapped_alignment(read, strip_bonuses));
-                
-                if (align_out) {
-                    if (json_out) {
-                        cout << pb2json(read) << endl;
-                    }
-                    else {
-                        aln_emitter->write_copy(read);
-                    }
-                }
-                else {
-                    cout << read.sequence() << endl;
-                }
+        
+        simulate([&](size_t stream, vector<Alignment>& alns) {
+            NGSSimulator& sampler = stream_samplers.empty() ? trained_sampler : *stream_samplers[stream];
+            
+            if (fragment_length) {
+                pair<Alignment, Alignment> read_pair = sampler.sample_read_pair();
+                alns.emplace_back(std::move(read_pair.first));
+                alns.emplace_back(std::move(read_pair.second));
             }
-        }
+            else {
+                alns.emplace_back(sampler.sample_read());
+            }
+            
+            for (auto& aln : alns) {
+                aln.set_score(aligner.score_ungapped_alignment(aln, strip_bonuses));
+            }
+        });
     }
     
     return 0;
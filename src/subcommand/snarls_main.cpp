@@ -13,7 +13,9 @@
 #include "../vg.hpp"
 #include <vg/vg.pb.h>
 #include "../traversal_finder.hpp"
+#include "../snarl_tree_index.hpp"
 #include <vg/io/stream.hpp>
+#include <vg/io/vpkg.hpp>
 
 //#define debug
 
@@ -35,7 +37,9 @@ void help_snarl(char** argv) {
          << "    -s, --sort-snarls      return snarls in sorted order by node ID (for topologically ordered graphs)" << endl
          << "    -v, --vcf FILE         use vcf-based instead of exhaustive traversal finder with -r" << endl
          << "    -f  --fasta FILE       reference in FASTA format (required for SVs by -v)" << endl
-         << "    -i  --ins-fasta FILE   insertion sequences in FASTA format (required for SVs by -v)" << endl;
+         << "    -i  --ins-fasta FILE   insertion sequences in FASTA format (required for SVs by -v)" << endl
+         << "    -I, --tree-index FILE  also write a compact snarl tree index of all the snarls to FILE" << endl
+         << "                           (smaller on disk; tools rebuild the full snarls from it when loading)" << endl;
 }
 
 int main_snarl(int argc, char** argv) {
@@ -58,6 +62,7 @@ int main_snarl(int argc, char** argv) {
     string vcf_filename;
     string ref_fasta_filename;
     string ins_fasta_filename;
+    string tree_index_filename;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -75,12 +80,13 @@ int main_snarl(int argc, char** argv) {
                 {"vcf", required_argument, 0, 'v'},
                 {"fasta", required_argument, 0, 'f'},
                 {"ins-fasta", required_argument, 0, 'i'},
+                {"tree-index", required_argument, 0, 'I'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
 
-        c = getopt_long (argc, argv, "sr:latopm:v:f:i:h?",
+        c = getopt_long (argc, argv, "sr:latopm:v:f:i:I:h?",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -129,6 +135,9 @@ int main_snarl(int argc, char** argv) {
         case 'i':
             ins_fasta_filename = optarg;
             break;
+        case 'I':
+            tree_index_filename = optarg;
+            break;
             
         case 'h':
         case '?':
@@ -219,6 +228,11 @@ int main_snarl(int argc, char** argv) {
     // Load up all the snarls
     SnarlManager snarl_manager = snarl_finder->find_snarls();
     vector<const Snarl*> snarl_roots = snarl_manager.top_level_snarls();
+    if (!tree_index_filename.empty()) {
+        // Save the whole snarl tree in compact form
+        SnarlTreeIndex tree_index(snarl_manager);
+        vg::io::VPKG::save(tree_index, tree_index_filename);
+    }
     if (fill_path_names){
       trav_finder = new PathBasedTraversalFinder(*graph, snarl_manager);
         for (const Snarl* snarl : snarl_roots ){
@@ -137,7 +137,7 @@ int main_sort(int argc, char *argv[]) {
         if (gfa_input) {
             // Read as GFA
             graph.reset(new VG());
-            if (!gfa_to_graph(in, graph.get())) {
+            if (!gfa_to_handle_graph(in, graph.get())) {
                 // GFA loading has failed because the file is invalid
                 exit(1);
             }
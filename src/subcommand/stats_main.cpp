@@ -439,7 +439,7 @@ int main_stats(int argc, char** argv) {
             size_t total_gapless = 0; // Number of reads with no indels relative to their paths
 
             // These are for tracking which nodes are covered and which are not
-            map<vg::id_t, size_t> node_visit_counts;
+            unordered_map<vg::id_t, size_t> node_visit_counts;
 
             // And for counting indels
             // Inserted bases also counts softclips
@@ -507,13 +507,17 @@ int main_stats(int argc, char** argv) {
         // Before we go over the reads, we need to make a map that tells us what
         // nodes are unique to what allele paths. Stores site and allele parts
         // separately.
-        map<vg::id_t, pair<string, string>> allele_path_for_node;
+        unordered_map<vg::id_t, pair<string, string>> allele_path_for_node;
 
         // Create a combined ReadStats accumulator. We need to pre-populate its
         // reads_on_allele with 0s when we look at the alleles so we know which
         // sites actually have 2 alleles and which only have 1 in the graph.
         ReadStats combined;
 
+        // Every thread accumulates into its own storage, and we combine them
+        // at the end of each pass.
+        size_t thread_count = get_thread_count();
+
         if (graph.get() != nullptr) {
             // We have a graph to work on
 
@@ -522,13 +526,12 @@ int main_stats(int argc, char** argv) {
             // is statistically significant. For this, we need to track how many
             // reads overlap the distinct parts of allele paths.
 
-            graph->for_each_node_parallel([&](Node* node) {
-                // For every node
-
+            // This gets the allele path that a node is uniquely on, or an empty string.
+            auto unique_allele_path = [&](Node* node) -> string {
                 if(!graph->paths.has_node_mapping(node)) {
                     // No paths to go over. If we try and get them we'll be
                     // modifying the paths in parallel, which will explode.
-                    return;
+                    return "";
                 }
 
                 // We want an allele path on it
@@ -543,34 +546,42 @@ int main_stats(int argc, char** argv) {
                         } else {
                             // It's a subsequent one. This node is not uniquely part
                             // of any allele path.
-                            return;
+                            return "";
                         }
                     }
                 }
+                return allele_path;
+            };
 
+            vector<vector<pair<vg::id_t, string>>> allele_paths_found(thread_count);
+            size_t node_count = graph->graph.node_size();
+            #pragma omp parallel for schedule(dynamic, 1024)
+            for (size_t i = 0; i < node_count; i++) {
+                // For every node
+                Node* node = graph->graph.mutable_node(i);
+                string allele_path = unique_allele_path(node);
                 if(!allele_path.empty()) {
                     // We found an allele path for this node
+                    allele_paths_found[omp_get_thread_num()].emplace_back(node->id(), std::move(allele_path));
+                }
+            }
 
+            for (auto& found : allele_paths_found) {
+                for (auto& id_and_path : found) {
                     // Get its site and allele so we can count it as a biallelic
                     // site. Note that sites where an allele has no unique nodes
                     // (pure indels, for example) can't be handled and will be
                     // ignored.
-                    auto site = path_name_to_site(allele_path);
-                    auto allele = path_name_to_allele(allele_path);
-
-
-                    #pragma omp critical (allele_path_for_node)
-                    allele_path_for_node[node->id()] = make_pair(site, allele);
+                    auto site = path_name_to_site(id_and_path.second);
+                    auto allele = path_name_to_allele(id_and_path.second);
 
-                    #pragma omp critical (reads_on_allele)
+                    allele_path_for_node[id_and_path.first] = make_pair(site, allele);
                     combined.reads_on_allele[site][allele] = 0;
                 }
-            });
-            
+            }
         }
 
         // Allocate per-thread storage for stats
-        size_t thread_count = get_thread_count();
         vector<ReadStats> read_stats;
         read_stats.resize(thread_count); 
 
@@ -609,11 +620,12 @@ int main_stats(int argc, char** argv) {
                     auto& mapping = aln.path().mapping(i);
                     vg::id_t node_id = mapping.position().node_id();
 
-                    if(allele_path_for_node.count(node_id)) {
+                    auto allele_path = allele_path_for_node.find(node_id);
+                    if(allele_path != allele_path_for_node.end()) {
                         // We hit a unique node for this allele. Add it to the set,
                         // in case we hit another unique node for it later in the
                         // read.
-                        alleles_supported.insert(allele_path_for_node.at(node_id));
+                        alleles_supported.insert(allele_path->second);
                     }
 
                     // Record that there was a visit to this node.
@@ -697,10 +709,20 @@ int main_stats(int argc, char** argv) {
         // Actually go through all the reads and count stuff up.
         vg::io::for_each_parallel(alignment_stream, lambda);
         
-        // Now combine into a single ReadStats object (for which we pre-populated reads_on_allele with 0s).
-        for (auto& per_thread : read_stats) {
-            combined += per_thread;
+        // Now combine into a single ReadStats object (for which we pre-populated
+        // reads_on_allele with 0s). Merge pairs of threads in parallel, in a
+        // tree that keeps the verbose edit lists in thread order.
+        for (size_t stride = 1; stride < read_stats.size(); stride *= 2) {
+            size_t merge_end = read_stats.size() - stride;
+            #pragma omp parallel for
+            for (size_t i = 0; i < merge_end; i += 2 * stride) {
+                read_stats[i] += read_stats[i + stride];
+                read_stats[i + stride] = ReadStats();
+            }
         }
+        // The pre-populated stats are the small ones, so merge them in instead of the other way around
+        std::swap(combined, read_stats.front());
+        combined += read_stats.front();
         read_stats.clear();
 
         // Go through all the nodes again and sum up unvisited nodes
@@ -767,30 +789,37 @@ int main_stats(int argc, char** argv) {
                 }
             }
 
-            graph->for_each_node_parallel([&](Node* node) {
+            // In verbose mode each thread collects its own IDs
+            vector<vector<vg::id_t>> thread_unvisited_ids(verbose ? thread_count : 0);
+            vector<vector<vg::id_t>> thread_single_visited_ids(verbose ? thread_count : 0);
+            size_t node_count = graph->graph.node_size();
+            #pragma omp parallel for schedule(dynamic, 1024) reduction(+:unvisited_nodes, unvisited_node_bases, single_visited_nodes, single_visited_node_bases)
+            for (size_t i = 0; i < node_count; i++) {
                 // For every node
-                if(!combined.node_visit_counts.count(node->id()) || combined.node_visit_counts.at(node->id()) == 0) {
+                const Node& node = graph->graph.node(i);
+                auto visits = combined.node_visit_counts.find(node.id());
+                if(visits == combined.node_visit_counts.end() || visits->second == 0) {
                     // If we never visited it with a read, count it.
-                    #pragma omp critical (unvisited_nodes)
                     unvisited_nodes++;
-                    #pragma omp critical (unvisited_node_bases)
-                    unvisited_node_bases += node->sequence().size();
+                    unvisited_node_bases += node.sequence().size();
                     if(verbose) {
-                        #pragma omp critical (unvisited_ids)
-                        unvisited_ids.insert(node->id());
+                        thread_unvisited_ids[omp_get_thread_num()].push_back(node.id());
                     }
-                } else if(combined.node_visit_counts.at(node->id()) == 1) {
+                } else if(visits->second == 1) {
                     // If we visited it with only one read, count it.
-                    #pragma omp critical (single_visited_nodes)
                     single_visited_nodes++;
-                    #pragma omp critical (single_visited_node_bases)
-                    single_visited_node_bases += node->sequence().size();
+                    single_visited_node_bases += node.sequence().size();
                     if(verbose) {
-                        #pragma omp critical (single_visited_ids)
-                        single_visited_ids.insert(node->id());
+                        thread_single_visited_ids[omp_get_thread_num()].push_back(node.id());
                     }
                 }
-            });
+            }
+            for (auto& ids : thread_unvisited_ids) {
+                unvisited_ids.insert(ids.begin(), ids.end());
+            }
+            for (auto& ids : thread_single_visited_ids) {
+                single_visited_ids.insert(ids.begin(), ids.end());
+            }
             
         }
 
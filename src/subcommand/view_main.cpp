@@ -82,7 +82,7 @@ void help_view(char** argv) {
          << "    -k, --multipath            output VG MultipathAlignment format (GAMP)" << endl
          << "    -D, --expect-duplicates    don't warn if encountering the same node or edge multiple times" << endl
          << "    -x, --extract-tag TAG      extract and concatenate messages with the given tag" << endl
-         << "    --threads N                for parallel operations use this many threads [1]" << endl;
+         << "    --threads N                for parallel operations (like JSON conversion) use this many threads [1]" << endl;
     
     // TODO: Can we regularize the option names for input and output types?
 
@@ -462,10 +462,19 @@ int main_view(int argc, char** argv) {
     
     if (input_type == "vg") {
         if (output_type == "stream") {
-            function<void(Graph&)> lambda = [&](Graph& g) { cout << pb2json(g) << endl; };
+            vg::io::OrderedParallelConverter<Graph, string> converter([](Graph& g, string& json) {
+                json = pb2json(g);
+            }, [](vector<string>& lines) {
+                for (auto& line : lines) {
+                    cout << line << "\n";
+                }
+            }, 16);
+            function<void(Graph&)> lambda = [&](Graph& g) { converter.push(std::move(g)); };
             get_input_file(file_name, [&](istream& in) {
                 vg::io::for_each(in, lambda);
             });
+            converter.flush();
+            cout.flush();
             return 0;
         } else {
             get_input_file(file_name, [&](istream& in) {
@@ -476,7 +485,7 @@ int main_view(int argc, char** argv) {
     } else if (input_type == "gfa") {
         get_input_file(file_name, [&](istream& in) {
             graph = new VG;
-            if (!gfa_to_graph(in, graph)) {
+            if (!gfa_to_handle_graph(in, graph)) {
                 // GFA loading has failed because the file is invalid
                 exit(1);
             }
@@ -485,13 +494,9 @@ int main_view(int argc, char** argv) {
     } else if(input_type == "json") {
         assert(input_json);
         vg::io::JSONStreamHelper<Graph> json_helper(file_name);
-        function<bool(Graph&)> get_next_graph = json_helper.get_read_fn();
-        // TODO: This is less inversion of control and more putting control in the middle.
+        // Parse the chunks in parallel, but add them to the graph in order.
         graph = new VG([&](const function<void(Graph&)> use_graph) {
-            Graph g;
-            while (get_next_graph(g)) {
-                use_graph(g);
-            }
+            json_helper.for_each_ordered(use_graph);
         }, false, !expect_duplicates);
     } else if(input_type == "turtle-in") {
         graph = new VG;
@@ -504,19 +509,26 @@ int main_view(int argc, char** argv) {
     } else if (input_type == "gam") {
         if (!input_json) {
             if (output_type == "json") {
-                // convert values to printable ones
-                function<void(Alignment&)> lambda = [](Alignment& a) {
+                // Serialize chunks of alignments in parallel and write them in order
+                vg::io::OrderedParallelConverter<Alignment, string> converter([](Alignment& a, string& json) {
+                    // convert values to printable ones
                     if(std::isnan(a.identity())) {
                         // Fix up NAN identities that can't be serialized in
                         // JSON. We shouldn't generate these any more, and they
                         // are out of spec, but they can be in files.
                         a.set_identity(0);
                     }
-                    cout << pb2json(a) << "\n";
-                };
+                    json = pb2json(a);
+                }, [](vector<string>& lines) {
+                    for (auto& line : lines) {
+                        cout << line << "\n";
+                    }
+                });
+                function<void(Alignment&)> lambda = [&](Alignment& a) { converter.push(std::move(a)); };
                 get_input_file(file_name, [&](istream& in) {
                     vg::io::for_each(in, lambda);
                 });
+                converter.flush();
             } else if (output_type == "fastq") {
                 function<void(Alignment&)> lambda = [](Alignment& a) {
                     cout << "@" << a.name() << endl
@@ -556,12 +568,11 @@ int main_view(int argc, char** argv) {
             }
             else if (output_type == "multipath") {
                 vector<MultipathAlignment> buf;
-                Alignment aln;
-                while (json_helper.get_read_fn()(aln)) {
+                json_helper.for_each_ordered([&](Alignment& aln) {
                     buf.emplace_back();
                     to_multipath_alignment(aln, buf.back());
                     vg::io::write_buffered(std::cout, buf, 1000);
-                }
+                });
                 vg::io::write_buffered(cout, buf, 0);
             }
             else {
@@ -609,12 +620,11 @@ int main_view(int argc, char** argv) {
             }
             else if (output_type == "gam") {
                 vector<Alignment> buf;
-                MultipathAlignment mp_aln;
-                while (json_helper.get_read_fn()(mp_aln)) {
+                json_helper.for_each_ordered([&](MultipathAlignment& mp_aln) {
                     buf.emplace_back();
                     optimal_alignment(mp_aln, buf.back());
                     vg::io::write_buffered(std::cout, buf, 1000);
-                }
+                });
                 vg::io::write_buffered(cout, buf, 0);
             }
             else if (output_type == "json") {
@@ -666,12 +676,19 @@ int main_view(int argc, char** argv) {
                 vg::io::write_buffered(std::cout, buf, 0);
             }
             else if (output_type == "json") {
-                function<void(MultipathAlignment&)> lambda = [&](MultipathAlignment& mp_aln) {
-                    cout << pb2json(mp_aln) << endl;
-                };
+                vg::io::OrderedParallelConverter<MultipathAlignment, string> converter([](MultipathAlignment& mp_aln, string& json) {
+                    json = pb2json(mp_aln);
+                }, [](vector<string>& lines) {
+                    for (auto& line : lines) {
+                        cout << line << "\n";
+                    }
+                });
+                function<void(MultipathAlignment&)> lambda = [&](MultipathAlignment& mp_aln) { converter.push(std::move(mp_aln)); };
                 get_input_file(file_name, [&](istream& in) {
                     vg::io::for_each(in, lambda);
                 });
+                converter.flush();
+                cout.flush();
             }
             else {
                 cerr << "[vg view] error: Unrecognized output format for MultipathAlignment (GAMP)" << endl;
@@ -25,6 +25,14 @@ using namespace std;
         contents.insert(node_id);
     }
     
+    void SubHandleGraph::reset(const HandleGraph* new_super) {
+        super = new_super;
+        // clear() keeps the bucket array around
+        contents.clear();
+        min_id = numeric_limits<id_t>::max();
+        max_id = numeric_limits<id_t>::min();
+    }
+    
     bool SubHandleGraph::has_node(id_t node_id) const {
         return contents.count(node_id);
     }
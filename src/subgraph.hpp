@@ -34,6 +34,10 @@ using namespace std;
         /// Generally invalidates the results of any previous algorithms.
         void add_handle(const handle_t& handle);
         
+        /// Remove all nodes and make this an empty subgraph of the given super graph.
+        /// Keeps the allocated storage so that the subgraph can be refilled cheaply.
+        void reset(const HandleGraph* new_super);
+        
         //////////////////////////
         /// HandleGraph interface
         //////////////////////////
@@ -17,6 +17,9 @@ using namespace std;
         if (!xindex) {
             cerr << "error:[Surjector] Failed to provide an XG index to the Surjector" << endl;
         }
+        
+        // make a path segment cache for each thread
+        segment_caches.resize(omp_get_max_threads(), LinearizedPathSegmentCache(SEGMENT_CACHE_SIZE));
     }
     
     Alignment Surjector::surject(const Alignment& source, const set<string>& path_names,
@@ -111,18 +114,14 @@ using namespace std;
             cerr << "final path interval is " << ref_path_interval.first << ":" << ref_path_interval.second << endl;
 #endif
             
-            // get the path graph corresponding to this interval
-            unordered_map<id_t, pair<id_t, bool>> path_trans;
-            VG path_graph = extract_linearized_path_graph(ref_path_interval.first, ref_path_interval.second, xpath, path_trans);
-            
-            // split it into a forward and reverse strand
-            VG split_path_graph;
-            unordered_map<id_t, pair<id_t, bool>> split_trans = algorithms::split_strands(&path_graph, &split_path_graph);
+            // get the path graph corresponding to this interval, already split into a forward and reverse strand
+            LinearizedPathGraph split_path_graph = extract_linearized_path_graph(ref_path_interval.first, ref_path_interval.second,
+                                                                                 path_record.first, xpath);
             
-            auto node_trans = split_path_graph.overlay_node_translations(split_trans, path_trans);
+            auto node_trans = split_path_graph.node_translation();
             
 #ifdef debug_anchored_surject
-            cerr << "made split, linearized path graph " << pb2json(split_path_graph.graph) << endl;
+            cerr << "made split, linearized path graph with " << split_path_graph.node_size() << " nodes" << endl;
 #endif
             
             // compute the connectivity between the path chunks
@@ -389,42 +388,28 @@ using namespace std;
         return interval;
     }
     
-    VG Surjector::extract_linearized_path_graph(size_t first, size_t last, const xg::XGPath& xpath,
-                                                unordered_map<id_t, pair<id_t, bool>>& node_trans) const {
+    LinearizedPathGraph Surjector::extract_linearized_path_graph(size_t first, size_t last, size_t path_rank,
+                                                                 const xg::XGPath& xpath) const {
         
 #ifdef debug_anchored_surject
         cerr << "extracting path graph for position interval " << first << ":" << last << " in path of length " << xpath.positions[xpath.positions.size() - 1] + xindex->node_length(xpath.node(xpath.ids.size() - 1)) << endl;
 #endif
         
-        VG path_graph;
-        
         size_t begin = xpath.offset_at_position(first);
         size_t end = min<size_t>(xpath.positions.size(), xpath.offset_at_position(last) + 1);
         
-        Node* prev_node = nullptr;
-        for (size_t i = begin; i < end; i++) {
-            
-            id_t node_id = xpath.node(i);
-            string seq = xindex->node_sequence(node_id);
-            bool rev = xpath.directions[i];
-            
-            Node* node;
-            if (rev) {
-                node = path_graph.create_node(reverse_complement(seq));
-            }
-            else {
-                node = path_graph.create_node(seq);
-            }
-            
-            if (prev_node) {
-                path_graph.create_edge(prev_node, node);
-            }
-            prev_node = node;
-            
-            node_trans[node->id()] = make_pair(node_id, rev);
+        shared_ptr<const LinearizedPathSegment> segment;
+        size_t thread_num = omp_get_thread_num();
+        if (thread_num < segment_caches.size()) {
+            // we can reuse a segment that a recent read on this thread already extracted
+            segment = segment_caches[thread_num].get(xindex, path_rank, xpath, begin, end, path_segment_padding);
+        }
+        else {
+            // there are more threads than we made caches for
+            segment = make_shared<const LinearizedPathSegment>(xindex, path_rank, xpath, begin, end);
         }
         
-        return path_graph;
+        return LinearizedPathGraph(segment, begin, end);
     }
     
     void Surjector::set_path_position(const Alignment& surjected, size_t best_path_rank, const xg::XGPath& xpath,
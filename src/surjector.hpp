@@ -15,9 +15,9 @@
 #include "translator.hpp"
 #include <vg/vg.pb.h>
 #include "multipath_alignment_graph.hpp"
+#include "linearized_path_graph.hpp"
 
 #include "algorithms/topological_sort.hpp"
-#include "algorithms/split_strands.hpp"
 
 namespace vg {
 
@@ -61,6 +61,10 @@ using namespace std;
         /// a local type that represents a read interval matched to a portion of the alignment path
         using path_chunk_t = pair<pair<string::const_iterator, string::const_iterator>, Path>;
         
+        /// the number of bases of path sequence to extract on either side of a path interval
+        /// so that reads nearby can reuse it
+        size_t path_segment_padding = 1024;
+        
     private:
         
         /// get the chunks of the alignment path that follow the given reference paths
@@ -74,9 +78,10 @@ using namespace std;
         compute_path_interval(const Alignment& source, size_t path_rank, const xg::XGPath& xpath, const vector<path_chunk_t>& path_chunks,
                               unordered_map<pair<int64_t, size_t>, vector<pair<size_t, bool>>>* oriented_occurrences_memo = nullptr) const;
         
-        /// make a linear graph that corresponds to a path interval, possibly duplicating nodes in case of cycles
-        VG extract_linearized_path_graph(size_t first, size_t last, const xg::XGPath& xpath,
-                                         unordered_map<id_t, pair<id_t, bool>>& node_trans) const;
+        /// make a strand-split linear graph that corresponds to a path interval, possibly duplicating
+        /// nodes in case of cycles
+        LinearizedPathGraph extract_linearized_path_graph(size_t first, size_t last, size_t path_rank,
+                                                          const xg::XGPath& xpath) const;
         
         
         /// associate a path position and strand to a surjected alignment against this path
@@ -88,6 +93,12 @@ using namespace std;
         static Alignment make_null_alignment(const Alignment& source);
         
         const xg::XG* xindex;
+        
+        /// the most recently used path segments for each thread
+        mutable vector<LinearizedPathSegmentCache> segment_caches;
+        
+        /// how many path segments each thread keeps
+        static const size_t SEGMENT_CACHE_SIZE = 16;
     };
 }
 
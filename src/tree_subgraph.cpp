@@ -0,0 +1,160 @@
+/**
+ * \file tree_subgraph.cpp: contains the implementation of TreeSubgraph
+ */
+
+
+#include "tree_subgraph.hpp"
+#include "utility.hpp"
+#include <handlegraph/util.hpp>
+#include <iostream>
+
+namespace vg {
+
+using namespace std;
+
+    TreeSubgraph::TreeSubgraph(const HandleGraph* base, vector<TreeNode>&& tree) : super(base), tree(std::move(tree)),
+        children(this->tree.size()) {
+
+        for (size_t i = 0; i < this->tree.size(); i++) {
+            // Check our input
+            assert(this->tree[i].length > 0);
+            assert(this->tree[i].parent < (int64_t) i);
+
+            if (this->tree[i].parent < 0) {
+                roots.push_back(i);
+            } else {
+                children[this->tree[i].parent].push_back(i);
+            }
+        }
+    }
+
+    bool TreeSubgraph::has_node(id_t node_id) const {
+        return (node_id > 0 && node_id <= tree.size());
+    }
+
+    handle_t TreeSubgraph::get_handle(const id_t& node_id, bool is_reverse) const {
+        assert(node_id >= 1 && node_id <= tree.size());
+        return handlegraph::number_bool_packing::pack(node_id, is_reverse);
+    }
+
+    id_t TreeSubgraph::get_id(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::unpack_number(handle);
+    }
+
+    bool TreeSubgraph::get_is_reverse(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::unpack_bit(handle);
+    }
+
+    handle_t TreeSubgraph::flip(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::toggle_bit(handle);
+    }
+
+    size_t TreeSubgraph::get_length(const handle_t& handle) const {
+        return tree[get_id(handle) - 1].length;
+    }
+
+    string TreeSubgraph::get_sequence(const handle_t& handle) const {
+        const TreeNode& node = tree[get_id(handle) - 1];
+
+        // Take our range of the backing node in the orientation the walks visit it
+        string sequence = super->get_sequence(node.handle).substr(node.offset, node.length);
+
+        if (get_is_reverse(handle)) {
+            sequence = reverse_complement(sequence);
+        }
+        return sequence;
+    }
+
+    bool TreeSubgraph::follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const {
+        size_t index = (size_t)get_id(handle) - 1;
+        bool backward = get_is_reverse(handle);
+
+        if (go_left != backward) {
+            // Going toward the root
+            if (tree[index].parent < 0) {
+                return true;
+            }
+            return iteratee(get_handle(tree[index].parent + 1, backward));
+        } else {
+            // Going toward the leaves
+            for (const size_t& child : children[index]) {
+                if (!iteratee(get_handle(child + 1, backward))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    bool TreeSubgraph::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+        // Trees should be small so we don't bother with parallel mode
+        for (size_t i = 0; i < tree.size(); i++) {
+            if (!iteratee(get_handle(i + 1, false))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t TreeSubgraph::node_size() const {
+        return tree.size();
+    }
+
+    id_t TreeSubgraph::min_node_id() const {
+        return 1;
+    }
+
+    id_t TreeSubgraph::max_node_id() const {
+        return tree.size();
+    }
+
+    Path TreeSubgraph::translate_down(const Path& path_against_subgraph) const {
+        Path translated;
+
+        for (auto& subgraph_mapping : path_against_subgraph.mapping()) {
+            // Translate each mapping
+            Mapping* translated_mapping = translated.add_mapping();
+
+            const TreeNode& node = tree[subgraph_mapping.position().node_id() - 1];
+            bool backing_reverse = super->get_is_reverse(node.handle);
+
+            translated_mapping->mutable_position()->set_node_id(super->get_id(node.handle));
+            if (!subgraph_mapping.position().is_reverse()) {
+                // We agree with the walk, so our range starts at the node offset
+                translated_mapping->mutable_position()->set_is_reverse(backing_reverse);
+                translated_mapping->mutable_position()->set_offset(node.offset + subgraph_mapping.position().offset());
+            } else {
+                // We go against the walk, so our range starts after the bases the walk leaves at the end of the node
+                size_t shortness = super->get_length(node.handle) - node.offset - node.length;
+                translated_mapping->mutable_position()->set_is_reverse(!backing_reverse);
+                translated_mapping->mutable_position()->set_offset(shortness + subgraph_mapping.position().offset());
+            }
+
+            // The edits always stay the same
+            for (auto& edit : subgraph_mapping.edit()) {
+                *translated_mapping->add_edit() = edit;
+            }
+        }
+
+        return translated;
+    }
+
+    size_t TreeSubgraph::total_length() const {
+        size_t total = 0;
+        for (auto& node : tree) {
+            total += node.length;
+        }
+        return total;
+    }
+
+    size_t TreeSubgraph::leaf_count() const {
+        size_t leaves = 0;
+        for (auto& node_children : children) {
+            if (node_children.empty()) {
+                leaves++;
+            }
+        }
+        return leaves;
+    }
+
+}
@@ -0,0 +1,126 @@
+#ifndef VG_TREE_SUBGRAPH_HPP_INCLUDED
+#define VG_TREE_SUBGRAPH_HPP_INCLUDED
+
+/** \file
+ * tree_subgraph.hpp: represents a forest of walks out from a point in another graph.
+ */
+
+#include "handle.hpp"
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+    /**
+     * A HandleGraph implementation that represents a forest of walks in another
+     * HandleGraph, such as the haplotype-consistent walks out from a point in a
+     * GBWTGraph. Walks that share a prefix share the nodes for it, so aligning
+     * against the forest does the work for the shared prefixes only once.
+     *
+     * Each node of the forest is a range of bases on an oriented node of the
+     * backing graph, and has an edge from the end of its parent, if any, to its
+     * start. Nodes are numbered 1 to n in the order they were given, which puts
+     * parents before children, so the numbering is a topological order.
+     */
+    class TreeSubgraph : public HandleGraph {
+    public:
+
+        /// A node of the forest: a range of bases on an oriented backing node,
+        /// attached to the end of its parent.
+        struct TreeNode {
+            /// The index of the parent node, or -1 if this is a root
+            int64_t parent;
+            /// The backing node, in the orientation the walks visit it
+            handle_t handle;
+            /// The first base of the backing node used, in that orientation
+            size_t offset;
+            /// The number of bases used
+            size_t length;
+        };
+
+        /// Create a TreeSubgraph over the given graph from the given nodes.
+        /// Every parent must come before its children, and every node must
+        /// have a nonzero length.
+        TreeSubgraph(const HandleGraph* base, vector<TreeNode>&& tree);
+
+        /// Default constructor -- not actually functional
+        TreeSubgraph() = default;
+
+        //////////////////////////
+        /// HandleGraph interface
+        //////////////////////////
+
+        /// Method to check if a node exists by ID
+        virtual bool has_node(id_t node_id) const;
+
+        /// Look up the handle for the node with the given ID in the given orientation
+        virtual handle_t get_handle(const id_t& node_id, bool is_reverse = false) const;
+
+        /// Get the ID from a handle
+        virtual id_t get_id(const handle_t& handle) const;
+
+        /// Get the orientation of a handle
+        virtual bool get_is_reverse(const handle_t& handle) const;
+
+        /// Invert the orientation of a handle (potentially without getting its ID)
+        virtual handle_t flip(const handle_t& handle) const;
+
+        /// Get the length of a node
+        virtual size_t get_length(const handle_t& handle) const;
+
+        /// Get the sequence of a node, presented in the handle's local forward
+        /// orientation.
+        virtual string get_sequence(const handle_t& handle) const;
+
+    protected:
+        /// Loop over all the handles to next/previous (right/left) nodes. Passes
+        /// them to a callback which returns false to stop iterating and true to
+        /// continue. Returns true if we finished and false if we stopped early.
+        virtual bool follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+
+        /// Loop over all the nodes in the graph in their local forward
+        /// orientations, in their internal stored order. Stop if the iteratee
+        /// returns false. Can be told to run in parallel, in which case stopping
+        /// after a false return value is on a best-effort basis and iteration
+        /// order is not defined.
+        virtual bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+
+    public:
+        /// Return the number of nodes in the graph
+        /// TODO: can't be node_count because XG has a field named node_count.
+        virtual size_t node_size() const;
+
+        /// Return the smallest ID in the graph, or some smaller number if the
+        /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+        virtual id_t min_node_id() const;
+
+        /// Return the largest ID in the graph, or some larger number if the
+        /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+        virtual id_t max_node_id() const;
+
+        //////////////////////////
+        /// Additional Interface
+        //////////////////////////
+
+        /// Translate a Path against us to a Path against the base graph
+        Path translate_down(const Path& path_against_subgraph) const;
+
+        /// Get the total number of bases in the forest
+        size_t total_length() const;
+
+        /// Get the number of leaves in the forest, which is the number of
+        /// distinct walks it represents
+        size_t leaf_count() const;
+
+    private:
+        const HandleGraph* super = nullptr;
+        vector<TreeNode> tree;
+        /// The children of each node, in order
+        vector<vector<size_t>> children;
+        /// The roots of the forest, in order
+        vector<size_t> roots;
+    };
+}
+
+#endif
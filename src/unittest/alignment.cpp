@@ -5,11 +5,18 @@
 
 #include <iostream>
 #include <string>
+#include <fstream>
+#include <algorithm>
 #include "../json2pb.h"
 #include <vg/vg.pb.h>
 #include "../alignment.hpp"
+#include "../alignment_emitter.hpp"
+#include "../vg.hpp"
+#include "../utility.hpp"
 #include "catch.hpp"
 
+#include <omp.h>
+
 namespace vg {
 namespace unittest {
 using namespace std;
@@ -137,5 +144,202 @@ TEST_CASE("Alignment normalization behaves as expected","[alignment]") {
     }
 }
 
+
+TEST_CASE("GAF conversion round-trips alignments", "[alignment][gaf]") {
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "GATTACA"},
+            {"id": 2, "sequence": "CATTAG"},
+            {"id": 3, "sequence": "TACAT"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 2, "to": 3, "to_end": true}
+        ]
+    })";
+    
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    VG graph;
+    graph.extend(proto_graph);
+    
+    // Softclips on both ends, a substitution, a deletion, and an insertion
+    // over three nodes, one of them backward.
+    string alignment_string = R"(
+    {"name":"read","sequence":"ACTTGCACATAGCATGG","mapping_quality":60,"score":10,"path":{"mapping":[
+        {"position":{"node_id":"1","offset":"2"},"edit":[{"to_length":"2","sequence":"AC"},{"from_length":"2","to_length":"2"},{"from_length":"1","to_length":"1","sequence":"G"},{"from_length":"2","to_length":"2"}]},
+        {"position":{"node_id":"2"},"edit":[{"from_length":"3","to_length":"3"},{"from_length":"1"},{"from_length":"2","to_length":"2"}]},
+        {"position":{"node_id":"3","is_reverse":true},"edit":[{"to_length":"1","sequence":"C"},{"from_length":"2","to_length":"2"},{"to_length":"2","sequence":"GG"}]}
+    ]}}
+    )";
+    
+    Alignment aln;
+    json2pb(aln, alignment_string.c_str(), alignment_string.size());
+    
+    string line = alignment_to_gaf(graph, aln);
+    REQUIRE(line == "read\t17\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tAS:i:10\ttp:A:P\tcs:Z::2*ag:5-t:2+c:2");
+    
+    Alignment parsed;
+    REQUIRE(gaf_to_alignment(graph, line, parsed));
+    
+    SECTION("Parsing recovers the alignment except for softclipped bases") {
+        REQUIRE(parsed.name() == "read");
+        REQUIRE(parsed.sequence() == "NNTTGCACATAGCATNN");
+        REQUIRE(parsed.mapping_quality() == 60);
+        REQUIRE(parsed.score() == 10);
+        REQUIRE(!parsed.is_secondary());
+        REQUIRE(parsed.path().mapping_size() == 3);
+        for (size_t i = 0; i < 3; i++) {
+            REQUIRE(parsed.path().mapping(i).position().node_id() == aln.path().mapping(i).position().node_id());
+            REQUIRE(parsed.path().mapping(i).position().is_reverse() == aln.path().mapping(i).position().is_reverse());
+            REQUIRE(parsed.path().mapping(i).position().offset() == aln.path().mapping(i).position().offset());
+        }
+        REQUIRE(path_from_length(parsed.path()) == path_from_length(aln.path()));
+        REQUIRE(path_to_length(parsed.path()) == path_to_length(aln.path()));
+    }
+    
+    SECTION("Parsed alignments convert back to the same line") {
+        REQUIRE(alignment_to_gaf(graph, parsed) == line);
+    }
+    
+    SECTION("Unaligned reads use placeholders") {
+        Alignment unaligned;
+        unaligned.set_name("unaligned");
+        unaligned.set_sequence("GATTACA");
+        string unaligned_line = alignment_to_gaf(graph, unaligned);
+        REQUIRE(unaligned_line == "unaligned\t7\t*\t*\t*\t*\t*\t*\t*\t0\t0\t255");
+        
+        REQUIRE(gaf_to_alignment(graph, unaligned_line, parsed));
+        REQUIRE(parsed.name() == "unaligned");
+        REQUIRE(parsed.sequence() == "NNNNNNN");
+        REQUIRE(parsed.path().mapping_size() == 0);
+    }
+    
+    SECTION("Paths that run off the graph are rejected") {
+        REQUIRE(!gaf_to_alignment(graph, "read\t4\t0\t4\t+\t>3\t5\t2\t6\t4\t4\t60\tcs:Z::4", parsed));
+        REQUIRE(!gaf_to_alignment(graph, "read\t4\t0\t4\t+\t>4\t5\t0\t4\t4\t4\t60\tcs:Z::4", parsed));
+    }
+    
+    SECTION("Malformed lines are rejected without throwing") {
+        vector<string> malformed {
+            // Numeric fields that are not numbers
+            "read\tx\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>1>2<3\t18\t-2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\thigh\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tAS:i:ten\tcs:Z::2*ag:5-t:2+c:2",
+            "read\tx\t*\t*\t*\t*\t*\t*\t*\t0\t0\t255",
+            // Numbers too big for their fields
+            "read\t99999999999999999999999\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t9999999999\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>99999999999999999999>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            // Bad node IDs and difference strings
+            "read\t17\t2\t15\t+\t>>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*a",
+            // Ranges that do not fit the read or the node
+            "read\t17\t15\t2\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t10\t2\t15\t+\t>1>2<3\t18\t2\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            "read\t17\t2\t15\t+\t>1>2<3\t18\t20\t15\t11\t14\t60\tcs:Z::2*ag:5-t:2+c:2",
+            // Too few fields
+            "read\t17\t2\t15\t+\t>1>2<3"
+        };
+        for (auto& malformed_line : malformed) {
+            bool result = true;
+            REQUIRE_NOTHROW(result = gaf_to_alignment(graph, malformed_line, parsed));
+            REQUIRE(!result);
+        }
+    }
+    
+    SECTION("GAF files can be read back in parallel") {
+        Alignment unaligned;
+        unaligned.set_name("unaligned");
+        unaligned.set_sequence("GATTACA");
+        vector<string> lines {line, alignment_to_gaf(graph, unaligned)};
+        
+        string filename = temp_file::create();
+        {
+            ofstream out(filename);
+            for (auto& gaf_line : lines) {
+                out << gaf_line << endl;
+            }
+        }
+        
+        vector<string> reread;
+        size_t count = gaf_unpaired_for_each_parallel(graph, filename, [&](Alignment& read) {
+#pragma omp critical (reread)
+            reread.push_back(alignment_to_gaf(graph, read));
+        });
+        temp_file::remove(filename);
+        
+        REQUIRE(count == lines.size());
+        sort(reread.begin(), reread.end());
+        sort(lines.begin(), lines.end());
+        REQUIRE(reread == lines);
+    }
+}
+
+TEST_CASE("GAF emitter keeps mates together when writing from many threads", "[alignment][gaf]") {
+    VG graph;
+    string filename = temp_file::create();
+    
+    // Make one alignment for each mate of each pair, with a name that says
+    // which pair and mate it is.
+    auto make_mate = [](const string& name) {
+        Alignment aln;
+        aln.set_name(name);
+        aln.set_sequence("GATTACA");
+        return aln;
+    };
+    
+    size_t pair_count = 1000;
+    {
+        // With a tiny limit, a thread writes its buffer after every call, so
+        // any write between the mates of a pair would let other threads in.
+        GAFAlignmentEmitter emitter(filename, graph, 1);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < pair_count; i++) {
+            string prefix = "pair" + to_string(i);
+            if (i % 2 == 0) {
+                emitter.emit_pair(make_mate(prefix + "_1"), make_mate(prefix + "_2"));
+            } else {
+                emitter.emit_mapped_pair({make_mate(prefix + "_1a"), make_mate(prefix + "_1b")},
+                                         {make_mate(prefix + "_2a"), make_mate(prefix + "_2b")});
+            }
+        }
+    }
+    
+    vector<string> names;
+    {
+        ifstream in(filename);
+        string line;
+        while (getline(in, line)) {
+            names.push_back(line.substr(0, line.find('\t')));
+        }
+    }
+    temp_file::remove(filename);
+    
+    REQUIRE(names.size() == 3 * pair_count);
+    size_t seen_pairs = 0;
+    for (size_t i = 0; i < names.size(); seen_pairs++) {
+        string prefix = names[i].substr(0, names[i].find('_'));
+        size_t pair_number = stoull(prefix.substr(4));
+        if (pair_number % 2 == 0) {
+            REQUIRE(i + 2 <= names.size());
+            REQUIRE(names[i] == prefix + "_1");
+            REQUIRE(names[i + 1] == prefix + "_2");
+            i += 2;
+        } else {
+            REQUIRE(i + 4 <= names.size());
+            REQUIRE(names[i] == prefix + "_1a");
+            REQUIRE(names[i + 1] == prefix + "_2a");
+            REQUIRE(names[i + 2] == prefix + "_1b");
+            REQUIRE(names[i + 3] == prefix + "_2b");
+            i += 4;
+        }
+    }
+    REQUIRE(seen_pairs == pair_count);
+}
+
 }
 }
@@ -3439,6 +3439,113 @@ namespace vg {
                 }
             }
         }
+        
+        TEST_CASE( "Banded global aligner produces the same alignments with every score width",
+                  "[alignment][banded][mapping]" ) {
+            
+            VG graph;
+            
+            Aligner aligner;
+            
+            Node* n0 = graph.create_node("AGTGCTA");
+            Node* n1 = graph.create_node("C");
+            Node* n2 = graph.create_node("A");
+            Node* n3 = graph.create_node("TGAAGTCA");
+            Node* n4 = graph.create_node("G");
+            Node* n5 = graph.create_node("GTCA");
+            
+            graph.create_edge(n0, n1);
+            graph.create_edge(n0, n2);
+            graph.create_edge(n1, n3);
+            graph.create_edge(n2, n3);
+            graph.create_edge(n3, n4);
+            graph.create_edge(n3, n5);
+            graph.create_edge(n4, n5);
+            
+            // a mismatch, an insertion, and a deletion, with a band tall enough for the column
+            // interiors to span several SIMD blocks
+            string read = "AGTGGTACTGAATTGTCAGTA";
+            int64_t band_padding = 20;
+            int64_t max_alt_alns = 5;
+            
+            Alignment aln8, aln16, aln32, aln64;
+            vector<Alignment> alts8, alts16, alts32, alts64;
+            for (Alignment* aln : {&aln8, &aln16, &aln32, &aln64}) {
+                aln->set_sequence(read);
+            }
+            
+            BandedGlobalAligner<int8_t> aligner8(aln8, graph, alts8, max_alt_alns, band_padding, true);
+            aligner8.align(aligner.score_matrix, aligner.nt_table, aligner.gap_open, aligner.gap_extension);
+            BandedGlobalAligner<int16_t> aligner16(aln16, graph, alts16, max_alt_alns, band_padding, true);
+            aligner16.align(aligner.score_matrix, aligner.nt_table, aligner.gap_open, aligner.gap_extension);
+            BandedGlobalAligner<int32_t> aligner32(aln32, graph, alts32, max_alt_alns, band_padding, true);
+            aligner32.align(aligner.score_matrix, aligner.nt_table, aligner.gap_open, aligner.gap_extension);
+            BandedGlobalAligner<int64_t> aligner64(aln64, graph, alts64, max_alt_alns, band_padding, true);
+            aligner64.align(aligner.score_matrix, aligner.nt_table, aligner.gap_open, aligner.gap_extension);
+            
+            REQUIRE(pb2json(aln8) == pb2json(aln64));
+            REQUIRE(pb2json(aln16) == pb2json(aln64));
+            REQUIRE(pb2json(aln32) == pb2json(aln64));
+            
+            REQUIRE(alts8.size() == alts64.size());
+            REQUIRE(alts16.size() == alts64.size());
+            REQUIRE(alts32.size() == alts64.size());
+            for (size_t i = 0; i < alts64.size(); i++) {
+                REQUIRE(pb2json(alts8[i]) == pb2json(alts64[i]));
+                REQUIRE(pb2json(alts16[i]) == pb2json(alts64[i]));
+                REQUIRE(pb2json(alts32[i]) == pb2json(alts64[i]));
+            }
+        }
+        
+        TEST_CASE( "Banded alignment arena reuses memory in stack order", "[alignment][banded]" ) {
+            
+            BandedAlignmentArena& arena = BandedAlignmentArena::get_thread_arena();
+            BandedAlignmentArena::Mark start = arena.mark();
+            
+            int16_t* first = arena.allocate<int16_t>(100);
+            for (size_t i = 0; i < 100; i++) {
+                first[i] = i;
+            }
+            
+            SECTION( "Allocations are aligned and don't overlap, even across blocks" ) {
+                vector<int8_t*> blocks;
+                for (size_t i = 0; i < 10; i++) {
+                    int8_t* block = arena.allocate<int8_t>(50000);
+                    REQUIRE(reinterpret_cast<uintptr_t>(block) % 16 == 0);
+                    memset(block, i, 50000);
+                    blocks.push_back(block);
+                }
+                for (size_t i = 0; i < blocks.size(); i++) {
+                    REQUIRE(blocks[i][0] == (int8_t) i);
+                    REQUIRE(blocks[i][49999] == (int8_t) i);
+                }
+                for (size_t i = 0; i < 100; i++) {
+                    REQUIRE(first[i] == i);
+                }
+            }
+            
+            SECTION( "Releasing to a mark makes its memory available again" ) {
+                BandedAlignmentArena::Mark middle = arena.mark();
+                int32_t* second = arena.allocate<int32_t>(10);
+                arena.release(middle);
+                int32_t* third = arena.allocate<int32_t>(10);
+                REQUIRE(third == second);
+                for (size_t i = 0; i < 100; i++) {
+                    REQUIRE(first[i] == i);
+                }
+            }
+            
+            SECTION( "Only the newest live mark may allocate or release" ) {
+                REQUIRE(arena.is_newest(start));
+                BandedAlignmentArena::Mark middle = arena.mark();
+                REQUIRE(arena.is_newest(middle));
+                REQUIRE(!arena.is_newest(start));
+                arena.release(middle);
+                REQUIRE(arena.is_newest(start));
+            }
+            
+            arena.release(start);
+        }
     }
 }
 
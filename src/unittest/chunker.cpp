@@ -190,6 +190,33 @@ TEST_CASE("basic graph chunking", "[chunk]") {
         
     }
 
+    SECTION("Batched extraction matches extracting each region on its own") {
+
+        vector<Region> regions = {{"x", 0, 10}, {"x", 6, 18}, {"x", 19, 31}};
+
+        for (int context : {0, 1, 2}) {
+            vector<size_t> seen;
+            chunker.extract_subgraph_batch(regions, context, [&](size_t i, VG& batch_subgraph, const Region& batch_region) {
+                    seen.push_back(i);
+
+                    VG subgraph;
+                    Region out_region;
+                    chunker.extract_subgraph(regions[i], context, 0, false, subgraph, out_region);
+
+                    REQUIRE(batch_subgraph.node_count() == subgraph.node_count());
+                    REQUIRE(batch_subgraph.edge_count() == subgraph.edge_count());
+                    subgraph.for_each_node([&](Node* node) {
+                            REQUIRE(batch_subgraph.has_node(node->id()));
+                        });
+                    REQUIRE(batch_region.seq == out_region.seq);
+                    REQUIRE(batch_region.start == out_region.start);
+                    REQUIRE(batch_region.end == out_region.end);
+                    REQUIRE(batch_subgraph.paths.size() == subgraph.paths.size());
+                });
+            REQUIRE(seen == vector<size_t>({0, 1, 2}));
+        }
+    }
+
 }
 
 
@@ -285,6 +285,83 @@ namespace unittest {
             }
         }
     }//End test case
+
+    TEST_CASE( "MEMChainModel chains hits without copying their MEMs",
+                   "[cluster][mem]" ) {
+        string read = "GATTACACATTAGGCCATGA";
+        
+        // the first MEM has a hit that fits with the second and a decoy
+        MaximalExactMatch first(read.begin(), read.begin() + 10, gcsa::range_type(0, 1), 2);
+        first.nodes.push_back(gcsa::Node::encode(1, 0, false));
+        first.nodes.push_back(gcsa::Node::encode(5, 0, false));
+        MaximalExactMatch second(read.begin() + 10, read.end(), gcsa::range_type(0, 0), 1);
+        second.nodes.push_back(gcsa::Node::encode(2, 0, false));
+        vector<vector<MaximalExactMatch> > matches = { { first, second } };
+        
+        // node 1 is at 0, node 2 at 10 and node 5 at 500 along path x
+        auto path_offset = [](pos_t pos) {
+            return id(pos) == 5 ? 500 : (id(pos) - 1) * 10 + offset(pos);
+        };
+        size_t position_calls = 0;
+        auto path_position = [&](pos_t pos) {
+            ++position_calls;
+            map<string, vector<pair<size_t, bool> > > positions;
+            positions["x"].push_back(make_pair(path_offset(pos), is_rev(pos)));
+            return positions;
+        };
+        auto transition_weight = [&](const MEMChainModelVertex& v1, const MEMChainModelVertex& v2) {
+            int64_t dist_fwd = v1.min_oriented_distances(v2).first;
+            if (dist_fwd > (int64_t) read.size()) {
+                return -std::numeric_limits<double>::max();
+            }
+            return -(double) abs((v2.mem->begin - v1.mem->begin) - dist_fwd);
+        };
+        
+        MEMChainModel chainer({ read.size() }, matches,
+                              [&](pos_t pos) -> int64_t { return path_offset(pos); },
+                              path_position, transition_weight, read.size());
+        
+        SECTION( "Each hit is a vertex referring back to its MEM" ) {
+            REQUIRE(chainer.model.size() == 3);
+            REQUIRE(position_calls == 3);
+            REQUIRE(chainer.model[0].mem == &matches[0][0]);
+            REQUIRE(chainer.model[1].mem == &matches[0][0]);
+            REQUIRE(chainer.model[2].mem == &matches[0][1]);
+            REQUIRE(chainer.model[1].node == gcsa::Node::encode(5, 0, false));
+            REQUIRE(chainer.model[2].fragment == 1);
+            // a path position and an approximate position for each hit
+            REQUIRE(chainer.hit_positions.size() == 6);
+            for (auto& vertex : chainer.model) {
+                REQUIRE(vertex.positions_end - vertex.positions_begin == 2);
+            }
+        }
+        
+        SECTION( "Distances are measured along shared paths" ) {
+            auto distances = chainer.model[0].min_oriented_distances(chainer.model[2]);
+            REQUIRE(distances.first == 10);
+            REQUIRE(distances.second == std::numeric_limits<int64_t>::max());
+        }
+        
+        SECTION( "Traceback makes MEMs for just the hits in each chain" ) {
+            auto traces = chainer.traceback(2, false, false);
+            REQUIRE(traces.size() == 2);
+            
+            REQUIRE(traces[0].size() == 2);
+            REQUIRE(traces[0][0].begin == read.begin());
+            REQUIRE(traces[0][0].nodes == vector<gcsa::node_type>{ gcsa::Node::encode(1, 0, false) });
+            REQUIRE(traces[0][0].positions["x"] == vector<pair<size_t, bool> >{ make_pair(0, false) });
+            REQUIRE(traces[0][0].fragment == 1);
+            REQUIRE(traces[0][1].begin == read.begin() + 10);
+            REQUIRE(traces[0][1].nodes == vector<gcsa::node_type>{ gcsa::Node::encode(2, 0, false) });
+            REQUIRE(traces[0][1].positions["x"] == vector<pair<size_t, bool> >{ make_pair(10, false) });
+            REQUIRE(traces[0][1].positions[""] == vector<pair<size_t, bool> >{ make_pair(10, false) });
+            
+            // the decoy is left over on its own
+            REQUIRE(traces[1].size() == 1);
+            REQUIRE(traces[1][0].nodes == vector<gcsa::node_type>{ gcsa::Node::encode(5, 0, false) });
+            REQUIRE(traces[1][0].positions["x"] == vector<pair<size_t, bool> >{ make_pair(500, false) });
+        }
+    }
 }
 
 }
@@ -157,7 +157,7 @@ TEST_CASE("Haplotype-aware gapless extension works correctly", "[gapless_extende
         REQUIRE(!result.empty());
         REQUIRE(result.full());
         REQUIRE(result.mismatches() <= error_bound);
-        alignment_matches(result.path, correct_alignment);
+        alignment_matches(result.to_path(gbwt_graph, read), correct_alignment);
     }
 
     SECTION("read matches with errors") {
@@ -178,7 +178,7 @@ TEST_CASE("Haplotype-aware gapless extension works correctly", "[gapless_extende
         REQUIRE(!result.empty());
         REQUIRE(result.full());
         REQUIRE(result.mismatches() <= error_bound);
-        alignment_matches(result.path, correct_alignment);
+        alignment_matches(result.to_path(gbwt_graph, read), correct_alignment);
     }
 
     SECTION("false seeds do not matter") {
@@ -200,7 +200,7 @@ TEST_CASE("Haplotype-aware gapless extension works correctly", "[gapless_extende
         REQUIRE(!result.empty());
         REQUIRE(result.full());
         REQUIRE(result.mismatches() <= error_bound);
-        alignment_matches(result.path, correct_alignment);
+        alignment_matches(result.to_path(gbwt_graph, read), correct_alignment);
     }
 
     SECTION("read matches reverse complement and ends within a node") {
@@ -220,7 +220,7 @@ TEST_CASE("Haplotype-aware gapless extension works correctly", "[gapless_extende
         REQUIRE(!result.empty());
         REQUIRE(result.full());
         REQUIRE(result.mismatches() <= error_bound);
-        alignment_matches(result.path, correct_alignment);
+        alignment_matches(result.to_path(gbwt_graph, read), correct_alignment);
     }
 
     SECTION("a non-matching read cannot be extended") {
@@ -278,7 +278,7 @@ TEST_CASE("Haplotype-aware unambiguous extension works correctly", "[gapless_ext
             REQUIRE(!(result[i].empty()));
             REQUIRE(!(result[i].full()));
             REQUIRE(result[i].core_interval.first == correct_offsets[i]);
-            alignment_matches(result[i].path, correct_extensions[i]);
+            alignment_matches(result[i].to_path(gbwt_graph, read), correct_extensions[i]);
         }
     }
 
@@ -315,7 +315,7 @@ TEST_CASE("Haplotype-aware unambiguous extension works correctly", "[gapless_ext
             REQUIRE(!(result[i].empty()));
             REQUIRE(!(result[i].full()));
             REQUIRE(result[i].core_interval.first == correct_offsets[i]);
-            alignment_matches(result[i].path, correct_extensions[i]);
+            alignment_matches(result[i].to_path(gbwt_graph, read), correct_extensions[i]);
         }
     }
 
@@ -359,7 +359,7 @@ TEST_CASE("Haplotype-aware unambiguous extension works correctly", "[gapless_ext
             REQUIRE(!(result[i].empty()));
             REQUIRE(!(result[i].full()));
             REQUIRE(result[i].core_interval.first == correct_offsets[i]);
-            alignment_matches(result[i].path, correct_extensions[i]);
+            alignment_matches(result[i].to_path(gbwt_graph, read), correct_extensions[i]);
         }
     }
 
@@ -388,7 +388,7 @@ TEST_CASE("Haplotype-aware unambiguous extension works correctly", "[gapless_ext
             REQUIRE(!(result[i].empty()));
             REQUIRE(result[i].full());
             REQUIRE(result[i].core_interval.first == correct_offsets[i]);
-            alignment_matches(result[i].path, correct_extensions[i]);
+            alignment_matches(result[i].to_path(gbwt_graph, read), correct_extensions[i]);
         }
     }
 }
@@ -555,5 +555,123 @@ TEST_CASE("Haplotype-aware flank extension works correctly", "[gapless_extender]
 
 //------------------------------------------------------------------------------
 
+TEST_CASE("Gapless extension works over long nodes", "[gapless_extender]") {
+
+    // Two long nodes, so that sequence comparisons can be done many characters at a time.
+    std::string first_sequence = "ACGTACGTTGCAACGTACGTTGCAACGTACGTTGCAACGT";
+    std::string second_sequence = "GGCATTACGGCATTACGGCATTACGGCATT";
+    Graph graph;
+    Node* first_node = graph.add_node();
+    first_node->set_id(1);
+    first_node->set_sequence(first_sequence);
+    Node* second_node = graph.add_node();
+    second_node->set_id(2);
+    second_node->set_sequence(second_sequence);
+    Edge* edge = graph.add_edge();
+    edge->set_from(1);
+    edge->set_to(2);
+    xg::XG xg_index(graph);
+
+    std::vector<gbwt::vector_type> gbwt_threads {
+        {
+            static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(1, false)),
+            static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(2, false))
+        }
+    };
+    gbwt::GBWT gbwt_index = get_gbwt(gbwt_threads);
+    GBWTGraph gbwt_graph(gbwt_index, xg_index);
+    GaplessExtender extender(gbwt_graph);
+
+    // The read covers the last 30 bases of node 1 and the first 20 bases of node 2,
+    // with a mismatch at read position 25.
+    std::string read = first_sequence.substr(10) + second_sequence.substr(0, 20);
+    read[25] = (read[25] == 'A' ? 'C' : 'A');
+    handle_t first_handle = gbwt_graph.get_handle(1, false);
+    handle_t second_handle = gbwt_graph.get_handle(2, false);
+
+    SECTION("full-length extension finds the mismatch") {
+        std::vector<std::pair<size_t, pos_t>> cluster {
+            { 0, make_pos_t(1, false, 10) }
+        };
+        auto result = extender.extend_seeds(cluster, read, 1);
+        REQUIRE(result.full());
+        REQUIRE(result.mismatch_positions == std::vector<size_t>({ 25 }));
+        REQUIRE(result.path == std::vector<handle_t>({ first_handle, second_handle }));
+        REQUIRE(result.offset == 10);
+        REQUIRE(result.tail_offset(gbwt_graph) == 20);
+
+        Path path = result.to_path(gbwt_graph, read);
+        REQUIRE(path.mapping_size() == 2);
+        REQUIRE(path.mapping(0).edit_size() == 3);
+        REQUIRE(path.mapping(0).edit(0).from_length() == 25);
+        REQUIRE(path.mapping(0).edit(1).sequence() == read.substr(25, 1));
+        REQUIRE(path.mapping(0).edit(2).from_length() == 4);
+        REQUIRE(path.mapping(1).position().offset() == 0);
+        REQUIRE(path.mapping(1).edit_size() == 1);
+        REQUIRE(path.mapping(1).edit(0).from_length() == 20);
+    }
+
+    SECTION("maximal extensions stop at the mismatch in both directions") {
+        std::vector<std::pair<size_t, pos_t>> cluster {
+            { 0, make_pos_t(1, false, 10) },
+            { 40, make_pos_t(2, false, 10) }
+        };
+        auto result = extender.maximal_extensions(cluster, read);
+        REQUIRE(result.size() == 2);
+
+        REQUIRE(result[0].core_interval == std::make_pair(static_cast<size_t>(0), static_cast<size_t>(25)));
+        REQUIRE(result[0].path == std::vector<handle_t>({ first_handle }));
+        REQUIRE(result[0].offset == 10);
+        REQUIRE(result[0].tail_offset(gbwt_graph) == 35);
+
+        REQUIRE(result[1].core_interval == std::make_pair(static_cast<size_t>(26), static_cast<size_t>(50)));
+        REQUIRE(result[1].path == std::vector<handle_t>({ first_handle, second_handle }));
+        REQUIRE(result[1].offset == 36);
+        REQUIRE(result[1].tail_offset(gbwt_graph) == 20);
+
+        extender.extend_flanks(result, read, 1);
+        std::vector<size_t> mismatches { 25 };
+        for (auto& extension : result) {
+            REQUIRE(extension.flanked_interval == std::make_pair(static_cast<size_t>(0), static_cast<size_t>(50)));
+            REQUIRE(extension.mismatch_positions == mismatches);
+        }
+    }
+
+    SECTION("single-strand graph gives the same extensions in reverse orientation") {
+        GBWTGraph single_strand(gbwt_index, xg_index, true);
+        GaplessExtender single_extender(single_strand);
+
+        // The reverse complement starts at offset 10 of node 2 in reverse orientation
+        // and reaches offset 20 of node 1 at read position 40.
+        std::string rc_read = reverse_complement(read);
+        std::vector<std::pair<size_t, pos_t>> cluster {
+            { 0, make_pos_t(2, true, 10) },
+            { 40, make_pos_t(1, true, 20) }
+        };
+
+        auto expected = extender.extend_seeds(cluster, rc_read, 1);
+        auto result = single_extender.extend_seeds(cluster, rc_read, 1);
+        REQUIRE(result.full());
+        REQUIRE(result.path == expected.path);
+        REQUIRE(result.offset == expected.offset);
+        REQUIRE(result.mismatch_positions == std::vector<size_t>({ 24 }));
+
+        auto expected_maximal = extender.maximal_extensions(cluster, rc_read);
+        auto maximal = single_extender.maximal_extensions(cluster, rc_read);
+        extender.extend_flanks(expected_maximal, rc_read, 1);
+        single_extender.extend_flanks(maximal, rc_read, 1);
+        REQUIRE(maximal.size() == expected_maximal.size());
+        for (size_t i = 0; i < maximal.size(); i++) {
+            REQUIRE(maximal[i].path == expected_maximal[i].path);
+            REQUIRE(maximal[i].offset == expected_maximal[i].offset);
+            REQUIRE(maximal[i].core_interval == expected_maximal[i].core_interval);
+            REQUIRE(maximal[i].flanked_interval == expected_maximal[i].flanked_interval);
+            REQUIRE(maximal[i].mismatch_positions == expected_maximal[i].mismatch_positions);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
 }
 }
@@ -5,10 +5,12 @@
 
 #include "../gbwt_helper.hpp"
 #include "../json2pb.h"
+#include "../utility.hpp"
 
 #include "catch.hpp"
 
 #include <set>
+#include <sstream>
 #include <vector>
 
 #include <omp.h>
@@ -324,6 +326,183 @@ TEST_CASE("GBWTGraph works correctly", "[gbwt_helper]") {
     }
 }
 
+TEST_CASE("GBWTGraph can be serialized and loaded", "[gbwt_helper]") {
+
+    // Build an XG index with a base other than ACGT in one of the nodes.
+    Graph graph;
+    json2pb(graph, gbwt_helper_graph.c_str(), gbwt_helper_graph.size());
+    graph.mutable_node(3)->set_sequence("GNG");
+    xg::XG xg_index(graph);
+
+    // Build a GBWT with three threads including a duplicate.
+    gbwt::GBWT gbwt_index = build_gbwt_index();
+
+    // Build a GBWT-backed graph and serialize it.
+    GBWTGraph original(gbwt_index, xg_index);
+    std::stringstream buffer;
+    std::pair<size_t, bool> result = original.serialize(buffer);
+    REQUIRE(result.second);
+    REQUIRE(result.first == buffer.str().size());
+
+    // Load it without the XG index.
+    GBWTGraph loaded;
+    REQUIRE(loaded.load(buffer));
+
+    SECTION("loaded graph requires the correct GBWT index") {
+        std::vector<gbwt::vector_type> other_threads {
+            {
+                static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(1, false)),
+                static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(2, false))
+            }
+        };
+        gbwt::GBWT other_index = get_gbwt(other_threads);
+        REQUIRE(!loaded.set_gbwt(other_index));
+        REQUIRE(loaded.set_gbwt(gbwt_index));
+    }
+
+    SECTION("loaded graph rejects a GBWT index with the same node range but different nodes") {
+        // The alternate path alone spans nodes 1 to 9 but does not visit node 7.
+        std::vector<gbwt::vector_type> other_threads { alt_path };
+        gbwt::GBWT other_index = get_gbwt(other_threads);
+        REQUIRE(other_index.firstNode() == gbwt_index.firstNode());
+        REQUIRE(other_index.sigma() == gbwt_index.sigma());
+        REQUIRE(!loaded.set_gbwt(other_index));
+        REQUIRE(loaded.set_gbwt(gbwt_index));
+    }
+
+    SECTION("loaded graph rejects a unidirectional GBWT index") {
+        std::vector<gbwt::vector_type> threads { short_path, alt_path, short_path };
+        gbwt::size_type node_width = gbwt::bit_length(gbwt::Node::encode(9, true));
+        gbwt::GBWTBuilder builder(node_width, 64);
+        for (auto& path : threads) {
+            builder.insert(path, false);
+        }
+        builder.finish();
+        std::string filename = temp_file::create("gbwt");
+        sdsl::store_to_file(builder.index, filename);
+        gbwt::GBWT forward_index;
+        sdsl::load_from_file(forward_index, filename);
+        temp_file::remove(filename);
+        REQUIRE(!forward_index.bidirectional());
+        REQUIRE(!loaded.set_gbwt(forward_index));
+        REQUIRE(loaded.set_gbwt(gbwt_index));
+    }
+
+    SECTION("loaded graph has the same nodes and sequences") {
+        REQUIRE(loaded.set_gbwt(gbwt_index));
+        REQUIRE(loaded.node_size() == original.node_size());
+        REQUIRE(loaded.min_node_id() == original.min_node_id());
+        REQUIRE(loaded.max_node_id() == original.max_node_id());
+        REQUIRE(loaded.real_nodes == original.real_nodes);
+        REQUIRE(loaded.sequences == original.sequences);
+        REQUIRE(loaded.offsets.size() == original.offsets.size());
+        for (size_t i = 0; i < original.offsets.size(); i++) {
+            REQUIRE(loaded.offsets[i] == original.offsets[i]);
+        }
+        for (id_t id = original.min_node_id(); id <= original.max_node_id(); id++) {
+            REQUIRE(loaded.has_node(id) == original.has_node(id));
+            if (!original.has_node(id)) {
+                continue;
+            }
+            for (bool orientation : { false, true }) {
+                handle_t handle = loaded.get_handle(id, orientation);
+                REQUIRE(loaded.get_sequence(handle) == xg_index.get_sequence(xg_index.get_handle(id, orientation)));
+            }
+        }
+    }
+
+    SECTION("loaded graph has the same edges") {
+        REQUIRE(loaded.set_gbwt(gbwt_index));
+        for (id_t id = original.min_node_id(); id <= original.max_node_id(); id++) {
+            if (!original.has_node(id)) {
+                continue;
+            }
+            for (bool orientation : { false, true }) {
+                for (bool go_left : { false, true }) {
+                    std::set<handle_t> original_edges, loaded_edges;
+                    original.follow_edges(original.get_handle(id, orientation), go_left, [&](const handle_t& handle) {
+                        original_edges.insert(handle);
+                    });
+                    loaded.follow_edges(loaded.get_handle(id, orientation), go_left, [&](const handle_t& handle) {
+                        loaded_edges.insert(handle);
+                    });
+                    REQUIRE(loaded_edges == original_edges);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("GBWTGraph works in single-strand mode", "[gbwt_helper]") {
+
+    // Build an XG index.
+    Graph graph;
+    json2pb(graph, gbwt_helper_graph.c_str(), gbwt_helper_graph.size());
+    xg::XG xg_index(graph);
+
+    // Build a GBWT with three threads including a duplicate.
+    gbwt::GBWT gbwt_index = build_gbwt_index();
+
+    // Build GBWT-backed graphs in both storage modes.
+    GBWTGraph double_strand(gbwt_index, xg_index);
+    GBWTGraph single_strand(gbwt_index, xg_index, true);
+
+    SECTION("only forward sequences are stored") {
+        REQUIRE(single_strand.single_strand);
+        REQUIRE(2 * single_strand.sequences.size() == double_strand.sequences.size());
+        REQUIRE(single_strand.sequence_bytes() < double_strand.sequence_bytes());
+    }
+
+    SECTION("sequences and views are the same in both orientations") {
+        for (id_t id = double_strand.min_node_id(); id <= double_strand.max_node_id(); id++) {
+            REQUIRE(single_strand.has_node(id) == double_strand.has_node(id));
+            if (!double_strand.has_node(id)) {
+                continue;
+            }
+            for (bool orientation : { false, true }) {
+                handle_t handle = double_strand.get_handle(id, orientation);
+                std::string sequence = double_strand.get_sequence(handle);
+                REQUIRE(single_strand.get_length(handle) == sequence.length());
+                REQUIRE(single_strand.get_sequence(handle) == sequence);
+                GBWTGraph::strand_view view = single_strand.get_strand_view(handle);
+                REQUIRE(view.reverse == orientation);
+                std::string view_sequence;
+                for (size_t i = 0; i < view.size(); i++) {
+                    view_sequence.push_back(view[i]);
+                }
+                REQUIRE(view_sequence == sequence);
+                REQUIRE(single_strand.starts_with(handle, sequence.front()));
+                REQUIRE(single_strand.ends_with(handle, sequence.back()));
+            }
+        }
+    }
+
+    SECTION("storage mode can be changed") {
+        GBWTGraph converted(double_strand);
+        converted.set_single_strand(true);
+        REQUIRE(converted.sequences == single_strand.sequences);
+        converted.set_single_strand(false);
+        REQUIRE(converted.sequences == double_strand.sequences);
+        REQUIRE(converted.offsets.size() == double_strand.offsets.size());
+        for (size_t i = 0; i < double_strand.offsets.size(); i++) {
+            REQUIRE(converted.offsets[i] == double_strand.offsets[i]);
+        }
+    }
+
+    SECTION("serialization does not depend on the storage mode") {
+        std::stringstream double_buffer, single_buffer;
+        double_strand.serialize(double_buffer);
+        single_strand.serialize(single_buffer);
+        REQUIRE(single_buffer.str() == double_buffer.str());
+
+        GBWTGraph loaded;
+        loaded.set_single_strand(true);
+        REQUIRE(loaded.load(single_buffer));
+        REQUIRE(loaded.single_strand);
+        REQUIRE(loaded.sequences == single_strand.sequences);
+    }
+}
+
 TEST_CASE("for_each_window() finds the correct windows with GBWT", "[gbwt_helper]") {
 
     // Build an XG index.
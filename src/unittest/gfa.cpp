@@ -2,6 +2,7 @@
 #include "../vg.hpp"
 #include "../xg.hpp"
 #include "../gfa.hpp"
+#include "../hash_graph.hpp"
 
 namespace vg {
 namespace unittest {
@@ -596,5 +597,163 @@ P	2	ref	2	+	3M)";
 
 
         
+
+TEST_CASE("Can stream a blunt GFA directly into a HashGraph", "[gfa]") {
+    const string graph_gfa = R"(H	VN:Z:1.0
+L	1	+	x	-	0M
+S	1	GATT
+S	x	ACA
+S	3	CA
+L	x	-	3	+	*
+P	path1	1+,x-,3+	*)";
+
+    HashGraph graph;
+    stringstream in(graph_gfa);
+    REQUIRE(gfa_to_handle_graph(in, &graph));
+    
+    REQUIRE(graph.node_size() == 3);
+    REQUIRE(graph.has_node(1));
+    REQUIRE(graph.has_node(3));
+    
+    // The segment with the non-numeric name gets a fresh ID
+    id_t x_id = 0;
+    graph.follow_edges(graph.get_handle(1), false, [&](const handle_t& next) {
+        REQUIRE(graph.get_is_reverse(next));
+        x_id = graph.get_id(next);
+    });
+    REQUIRE(x_id != 0);
+    REQUIRE(x_id != 1);
+    REQUIRE(x_id != 3);
+    REQUIRE(graph.get_sequence(graph.get_handle(x_id)) == "ACA");
+    
+    REQUIRE(graph.has_path("path1"));
+    path_handle_t path = graph.get_path_handle("path1");
+    REQUIRE(graph.get_step_count(path) == 3);
+    step_handle_t step = graph.path_begin(path);
+    REQUIRE(graph.get_handle_of_step(step) == graph.get_handle(1, false));
+    step = graph.get_next_step(step);
+    REQUIRE(graph.get_handle_of_step(step) == graph.get_handle(x_id, true));
+    step = graph.get_next_step(step);
+    REQUIRE(graph.get_handle_of_step(step) == graph.get_handle(3, false));
+}
+
+TEST_CASE("Streaming GFA import falls back to the pinch graph for overlaps", "[gfa]") {
+    const string graph_gfa = R"(H	VN:Z:0.1
+S	1	GATT
+S	2	TTACA
+L	1	+	2	+	2M
+P	1	ref	1	+	4M
+P	2	ref	2	+	5M)";
+
+    SECTION("Into a VG") {
+        VG vg;
+        stringstream in(graph_gfa);
+        REQUIRE(gfa_to_handle_graph(in, &vg));
+        REQUIRE(vg.is_valid());
+        REQUIRE(vg.length() == 7);
+    }
+    
+    SECTION("Into a HashGraph") {
+        HashGraph graph;
+        stringstream in(graph_gfa);
+        REQUIRE(gfa_to_handle_graph(in, &graph));
+        
+        size_t total_length = 0;
+        graph.for_each_handle([&](const handle_t& h) {
+            total_length += graph.get_length(h);
+        });
+        REQUIRE(total_length == 7);
+        REQUIRE(graph.has_path("ref"));
+    }
+}
+
+TEST_CASE("Streaming GFA import matches the pinch graph importer on blunt graphs", "[gfa]") {
+    const string graph_gfa = R"(H	VN:Z:0.1
+S	1	G
+L	1	+	2	+	0M
+L	1	+	4	+	0M
+S	2	T
+L	2	+	3	+	0M
+S	3	G
+S	4	C
+L	4	+	2	+	0M
+P	1	ref	1	+	1M
+P	2	ref	2	+	1M
+P	3	ref	3	+	1M)";
+
+    VG pinched;
+    stringstream in1(graph_gfa);
+    REQUIRE(gfa_to_graph(in1, &pinched));
+    
+    VG streamed;
+    stringstream in2(graph_gfa);
+    REQUIRE(gfa_to_handle_graph(in2, &streamed));
+    
+    REQUIRE(streamed.is_valid());
+    REQUIRE(streamed.node_count() == pinched.node_count());
+    REQUIRE(streamed.edge_count() == pinched.edge_count());
+    REQUIRE(streamed.length() == pinched.length());
+    REQUIRE(streamed.paths.has_path("ref"));
+    REQUIRE(streamed.paths.get_path("ref").size() == 3);
+}
+
+TEST_CASE("Streaming GFA import rejects paths that cross missing links", "[gfa]") {
+    const string graph_gfa = R"(H	VN:Z:1.0
+S	1	GATT
+S	2	ACA
+S	3	CA
+L	1	+	2	+	0M
+P	path1	1+,2+,3+	*
+P	path2	1+,2+	*)";
+
+    SECTION("A missing link makes the GFA invalid") {
+        HashGraph graph;
+        stringstream in(graph_gfa);
+        REQUIRE(!gfa_to_handle_graph(in, &graph));
+    }
+    
+    SECTION("A link that comes after the path is fine") {
+        HashGraph graph;
+        stringstream in(graph_gfa + "\nL\t2\t+\t3\t+\t0M\n");
+        REQUIRE(gfa_to_handle_graph(in, &graph));
+        REQUIRE(graph.has_path("path1"));
+        REQUIRE(graph.get_step_count(graph.get_path_handle("path1")) == 3);
+    }
+    
+    SECTION("Only paths that cross missing links are dropped when only taking perfect matches") {
+        HashGraph graph;
+        stringstream in(graph_gfa);
+        REQUIRE(gfa_to_handle_graph(in, &graph, true));
+        REQUIRE(!graph.has_path("path1"));
+        REQUIRE(graph.has_path("path2"));
+    }
+}
+
+
+TEST_CASE("Streaming GFA import keeps numeric names distinct by spelling", "[gfa]") {
+    const string graph_gfa = R"(H	VN:Z:1.0
+S	5	GATT
+S	05	ACA
+S	123456789012345678901234567890	CA
+L	5	+	05	+	0M
+L	05	+	123456789012345678901234567890	+	0M
+P	path1	5+,05+,123456789012345678901234567890+	*)";
+
+    HashGraph graph;
+    stringstream in(graph_gfa);
+    REQUIRE(gfa_to_handle_graph(in, &graph));
+    
+    // "05" doesn't get merged into node 5, and the name too long to be an ID gets a fresh one
+    REQUIRE(graph.node_size() == 3);
+    REQUIRE(graph.get_sequence(graph.get_handle(5)) == "GATT");
+    
+    REQUIRE(graph.has_path("path1"));
+    path_handle_t path = graph.get_path_handle("path1");
+    vector<string> visited;
+    graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+        visited.push_back(graph.get_sequence(graph.get_handle_of_step(step)));
+    });
+    REQUIRE(visited == vector<string>{"GATT", "ACA", "CA"});
+}
 }
 }
@@ -0,0 +1,122 @@
+/** \file
+ *
+ * Unit tests for IndexLoader, which loads several indexes at once.
+ */
+
+#include "../index_loader.hpp"
+#include "../utility.hpp"
+
+#include "catch.hpp"
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace vg {
+namespace unittest {
+
+TEST_CASE("IndexLoader runs all its jobs", "[index_loader]") {
+    IndexLoader loader;
+    
+    unique_ptr<int> first;
+    unique_ptr<string> second;
+    loader.add("first", [&]() { first.reset(new int(5)); });
+    loader.add("second", [&]() { second.reset(new string("loaded")); });
+    loader.run();
+    
+    REQUIRE(first);
+    REQUIRE(*first == 5);
+    REQUIRE(second);
+    REQUIRE(*second == "loaded");
+    REQUIRE(loader.seconds() >= 0);
+    
+    SECTION("the report names every index") {
+        stringstream report;
+        loader.report(report);
+        REQUIRE(report.str().find("Loaded first in") != string::npos);
+        REQUIRE(report.str().find("Loaded second in") != string::npos);
+        REQUIRE(report.str().find("Loaded 2 indexes in") != string::npos);
+    }
+    
+    SECTION("jobs are not run again") {
+        size_t runs = 0;
+        loader.add("third", [&]() { runs++; });
+        loader.run();
+        loader.run();
+        REQUIRE(runs == 1);
+    }
+}
+
+TEST_CASE("IndexLoader passes on failures after all jobs finish", "[index_loader]") {
+    IndexLoader loader;
+    
+    bool finished = false;
+    loader.add("broken", [&]() { throw runtime_error("cannot load"); });
+    loader.add("working", [&]() { finished = true; });
+    REQUIRE_THROWS_AS(loader.run(), runtime_error);
+    REQUIRE(finished);
+}
+
+TEST_CASE("IndexLoader hands out resident indexes", "[index_loader]") {
+    string file_name = temp_file::create();
+    {
+        ofstream out(file_name);
+        out << "index";
+    }
+    IndexLoader::make_resident(file_name, unique_ptr<int>(new int(5)));
+    
+    IndexLoader loader;
+    size_t loads = 0;
+    auto load = [&]() {
+        loads++;
+        return unique_ptr<int>(new int(10));
+    };
+    
+    SECTION("the resident copy is used instead of loading") {
+        unique_ptr<int> first;
+        loader.add(file_name, first, load);
+        REQUIRE(first);
+        REQUIRE(*first == 5);
+        
+        // It can only be taken once
+        unique_ptr<int> second;
+        loader.add(file_name, second, load);
+        loader.run();
+        REQUIRE(second);
+        REQUIRE(*second == 10);
+        REQUIRE(loads == 1);
+        
+        stringstream report;
+        loader.report(report);
+        REQUIRE(report.str().find("(resident)") != string::npos);
+    }
+    
+    SECTION("an index of another type is loaded") {
+        unique_ptr<string> other;
+        loader.add(file_name, other, [&]() {
+            loads++;
+            return unique_ptr<string>(new string("loaded"));
+        });
+        loader.run();
+        REQUIRE(*other == "loaded");
+        REQUIRE(loads == 1);
+    }
+    
+    SECTION("a changed file is loaded again") {
+        {
+            ofstream out(file_name, ios::app);
+            out << " that changed";
+        }
+        unique_ptr<int> changed;
+        loader.add(file_name, changed, load);
+        loader.run();
+        REQUIRE(*changed == 10);
+        REQUIRE(loads == 1);
+    }
+    
+    temp_file::remove(file_name);
+}
+
+}
+}
@@ -0,0 +1,109 @@
+/// \file json_stream_helper.cpp
+///
+/// Unit tests for converting between JSON and Protobuf streams
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <omp.h>
+#include "json2pb.h"
+#include <vg/vg.pb.h>
+#include <vg/io/stream.hpp>
+#include "../io/json_stream_helper.hpp"
+#include "../utility.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+
+TEST_CASE("JSON streams are converted in order on multiple threads", "[json][stream]") {
+
+    // Make some alignments that are easy to tell apart
+    vector<Alignment> alns;
+    for (size_t i = 0; i < 2500; i++) {
+        alns.emplace_back();
+        alns.back().set_name("read" + to_string(i));
+        alns.back().set_sequence(string(i % 20 + 1, "ACGT"[i % 4]));
+        alns.back().set_score(i);
+    }
+
+    string filename = temp_file::create();
+    {
+        ofstream out(filename);
+        for (auto& aln : alns) {
+            // Records can be separated by any whitespace
+            out << pb2json(aln) << (aln.score() % 2 ? " " : "\n");
+        }
+    }
+
+    int old_thread_count = omp_get_max_threads();
+    omp_set_num_threads(4);
+
+    SECTION("JSON can be read in order") {
+        vg::io::JSONStreamHelper<Alignment> json_helper(filename);
+        size_t seen = 0;
+        int64_t total = json_helper.for_each_ordered([&](Alignment& aln) {
+            REQUIRE(seen < alns.size());
+            REQUIRE(aln.name() == alns[seen].name());
+            REQUIRE(aln.sequence() == alns[seen].sequence());
+            REQUIRE(aln.score() == alns[seen].score());
+            seen++;
+        });
+        REQUIRE(seen == alns.size());
+        REQUIRE(total == alns.size());
+    }
+
+    SECTION("JSON can be converted to Protobuf in order") {
+        vg::io::JSONStreamHelper<Alignment> json_helper(filename);
+        stringstream converted;
+        REQUIRE(json_helper.write(converted, false, 100) == alns.size());
+
+        size_t seen = 0;
+        vg::io::for_each<Alignment>(converted, [&](Alignment& aln) {
+            REQUIRE(seen < alns.size());
+            REQUIRE(aln.name() == alns[seen].name());
+            REQUIRE(aln.score() == alns[seen].score());
+            seen++;
+        });
+        REQUIRE(seen == alns.size());
+    }
+
+    SECTION("JSON can be converted to JSON in order") {
+        vg::io::JSONStreamHelper<Alignment> json_helper(filename);
+        stringstream converted;
+        REQUIRE(json_helper.write(converted, true) == alns.size());
+
+        stringstream expected;
+        for (auto& aln : alns) {
+            expected << pb2json(aln);
+        }
+        REQUIRE(converted.str() == expected.str());
+    }
+
+    SECTION("Protobuf can be converted to JSON in order") {
+        stringstream converted;
+        vg::io::OrderedParallelConverter<Alignment, string> converter([](Alignment& aln, string& json) {
+            json = pb2json(aln);
+        }, [&](vector<string>& lines) {
+            for (auto& line : lines) {
+                converted << line << "\n";
+            }
+        }, 7);
+        for (auto aln : alns) {
+            converter.push(std::move(aln));
+        }
+        converter.flush();
+
+        stringstream expected;
+        for (auto& aln : alns) {
+            expected << pb2json(aln) << "\n";
+        }
+        REQUIRE(converted.str() == expected.str());
+    }
+
+    omp_set_num_threads(old_thread_count);
+    temp_file::remove(filename);
+}
+
+}
+}
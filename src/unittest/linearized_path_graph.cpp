@@ -0,0 +1,107 @@
+/// \file linearized_path_graph.cpp
+///
+/// Unit tests for the LinearizedPathGraph class and its segment cache.
+///
+
+#include <iostream>
+#include <string>
+#include "../json2pb.h"
+#include <vg/vg.pb.h>
+#include "../linearized_path_graph.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+    TEST_CASE("LinearizedPathGraph presents a strand-split view of a path interval", "[surject][handle]") {
+
+        string graph_json = R"(
+        {"node":[{"id":1,"sequence":"GATT"},
+                 {"id":2,"sequence":"ACA"},
+                 {"id":3,"sequence":"CG"},
+                 {"id":4,"sequence":"TTAG"}],
+         "edge":[{"from":1,"to":2},
+                 {"from":2,"to":3,"to_end":true},
+                 {"from":3,"to":4,"from_start":true}],
+         "path":[{"name":"ref","mapping":[
+                    {"position":{"node_id":1},"rank":1},
+                    {"position":{"node_id":2},"rank":2},
+                    {"position":{"node_id":3,"is_reverse":true},"rank":3},
+                    {"position":{"node_id":4},"rank":4}]}]}
+        )";
+
+        Graph proto_graph;
+        json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+        xg::XG xg_index(proto_graph);
+
+        size_t path_rank = xg_index.path_rank("ref");
+        const xg::XGPath& xpath = xg_index.get_path("ref");
+
+        auto segment = make_shared<const LinearizedPathSegment>(&xg_index, path_rank, xpath, 0, 4);
+
+        SECTION("The segment holds the path sequence in path orientation") {
+            REQUIRE(segment->sequence == "GATTACACGTTAG");
+            REQUIRE(segment->reverse_sequence == "CTAACGTGTAATC");
+            REQUIRE(segment->step_starts == vector<size_t>({0, 4, 7, 9, 13}));
+        }
+
+        SECTION("A view of an interval has a forward and a reverse chain") {
+
+            LinearizedPathGraph graph(segment, 1, 3);
+
+            REQUIRE(graph.node_size() == 4);
+            REQUIRE(graph.get_sequence(graph.get_handle(1)) == "ACA");
+            REQUIRE(graph.get_sequence(graph.get_handle(2)) == "CG");
+            REQUIRE(graph.get_sequence(graph.get_handle(3)) == "CG");
+            REQUIRE(graph.get_sequence(graph.get_handle(4)) == "TGT");
+            REQUIRE(graph.get_sequence(graph.get_handle(1, true)) == "TGT");
+            REQUIRE(graph.get_length(graph.get_handle(4)) == 3);
+
+            vector<handle_t> next;
+            graph.follow_edges(graph.get_handle(1), false, [&](const handle_t& h) {
+                next.push_back(h);
+            });
+            REQUIRE(next == vector<handle_t>{graph.get_handle(2)});
+
+            next.clear();
+            graph.follow_edges(graph.get_handle(2), false, [&](const handle_t& h) {
+                next.push_back(h);
+            });
+            REQUIRE(next.empty());
+
+            next.clear();
+            graph.follow_edges(graph.get_handle(4, true), false, [&](const handle_t& h) {
+                next.push_back(h);
+            });
+            REQUIRE(next == vector<handle_t>{graph.get_handle(3, true)});
+
+            auto node_trans = graph.node_translation();
+            REQUIRE(node_trans.size() == 4);
+            REQUIRE(node_trans[1] == make_pair<id_t, bool>(2, false));
+            REQUIRE(node_trans[2] == make_pair<id_t, bool>(3, true));
+            REQUIRE(node_trans[3] == make_pair<id_t, bool>(3, false));
+            REQUIRE(node_trans[4] == make_pair<id_t, bool>(2, true));
+        }
+
+        SECTION("The cache reuses segments that contain a requested interval") {
+
+            LinearizedPathSegmentCache cache(2);
+
+            auto first = cache.get(&xg_index, path_rank, xpath, 1, 2, 0);
+            REQUIRE(first->first_step == 1);
+            REQUIRE(first->last_step == 2);
+            REQUIRE(cache.misses == 1);
+
+            auto padded = cache.get(&xg_index, path_rank, xpath, 2, 3, 4);
+            REQUIRE(padded->first_step == 0);
+            REQUIRE(padded->last_step == 4);
+            REQUIRE(cache.misses == 2);
+
+            auto reused = cache.get(&xg_index, path_rank, xpath, 0, 4, 0);
+            REQUIRE(reused == padded);
+            REQUIRE(cache.hits == 1);
+        }
+    }
+}
+}
@@ -7,6 +7,7 @@
 #include <vg/vg.pb.h>
 #include "../mapper.hpp"
 #include "../build_index.hpp"
+#include "../gcsa_range_table.hpp"
 #include "catch.hpp"
 
 namespace vg {
@@ -297,6 +298,286 @@ TEST_CASE( "Mapper finds optimal mapping for read starting with node-border MEM"
     
 }
 
+TEST_CASE( "GCSA range table does not change the MEMs", "[mapping][mapper]" ) {
+    
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "GATTACAGATTACACCTGGGCAACAGAACGAG"},
+            {"id": 2, "sequence": "A"},
+            {"id": 3, "sequence": "T"},
+            {"id": 4, "sequence": "TGCTGTCACAACAACAACAACAAGATTACAGG"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 1, "to": 3},
+            {"from": 2, "to": 4},
+            {"from": 3, "to": 4}
+        ]
+    })";
+    
+    // Load the JSON
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    
+    // Make it into a VG
+    VG graph;
+    graph.extend(proto_graph);
+    
+    // Configure GCSA temp directory to the system temp directory
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    // And make it quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    // Make pointers to fill in
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    
+    // Build the GCSA index
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 3);
+    
+    // Build the xg index
+    xg::XG xg_index(proto_graph);
+    
+    // Reads with mismatches, Ns, and repeats
+    vector<string> reads {
+        "GATTACAGATTACACCTGGGCAACAGAACGAGATGCTGTCACAACAACAACAACAAGATTACAGG",
+        "CCTGGGCAACAGTACGAGTTGCTGTCACAACAACAACAACAAGA",
+        "GATTACANATTACACCTGGGCAACAGAACGAGTTGCTGTCACAAC",
+        "ACAACAACAACAACAACAACAACAAGATTACAGATTACA",
+        "TTTTTTTTGATTACAGG"
+    };
+    
+    for (size_t k : {4, 8}) {
+        
+        GCSARangeTable range_table(*gcsaidx, k);
+        REQUIRE(range_table.k() == k);
+        REQUIRE(range_table.size() == (size_t(1) << (2 * k)));
+        REQUIRE(range_table.compatible(*gcsaidx));
+        
+        SECTION( "range table for k = " + to_string(k) + " matches backward search" ) {
+            string kmer(k, 'A');
+            for (size_t key = 0; key < range_table.size(); key++) {
+                gcsa::range_type range(0, gcsaidx->size() - 1);
+                for (size_t i = 0; i < k; i++) {
+                    kmer[i] = "ACGT"[(key >> (2 * i)) & 3];
+                }
+                for (size_t i = k; i > 0 && !gcsa::Range::empty(range); i--) {
+                    range = gcsaidx->LF(range, gcsaidx->alpha.char2comp[kmer[i - 1]]);
+                }
+                gcsa::range_type found;
+                REQUIRE(range_table.find(kmer.begin(), found));
+                REQUIRE(gcsa::Range::empty(found) == gcsa::Range::empty(range));
+                if (!gcsa::Range::empty(range)) {
+                    REQUIRE(found == range);
+                }
+            }
+        }
+        
+        SECTION( "range table for k = " + to_string(k) + " can be serialized and loaded" ) {
+            stringstream buffer;
+            REQUIRE(range_table.serialize(buffer).second);
+            GCSARangeTable loaded;
+            REQUIRE(loaded.load(buffer));
+            REQUIRE(loaded.k() == range_table.k());
+            REQUIRE(loaded.compatible(*gcsaidx));
+            for (size_t key = 0; key < range_table.size(); key++) {
+                REQUIRE(loaded[key] == range_table[key]);
+            }
+        }
+        
+        SECTION( "MEMs for k = " + to_string(k) + " are the same with and without the range table" ) {
+            for (bool fast_reseed : {false, true}) {
+                Mapper without_table(&xg_index, gcsaidx, lcpidx);
+                Mapper with_table(&xg_index, gcsaidx, lcpidx);
+                with_table.set_range_table(&range_table);
+                without_table.fast_reseed = with_table.fast_reseed = fast_reseed;
+                without_table.sub_mem_thinning_burn_in = with_table.sub_mem_thinning_burn_in = k;
+                
+                for (const string& read : reads) {
+                    double lcp_avg_1 = 0.0, lcp_avg_2 = 0.0;
+                    double filtered_1 = 0.0, filtered_2 = 0.0;
+                    auto mems_1 = without_table.find_mems_deep(read.begin(), read.end(), lcp_avg_1, filtered_1, 0, 1, 8);
+                    auto mems_2 = with_table.find_mems_deep(read.begin(), read.end(), lcp_avg_2, filtered_2, 0, 1, 8);
+                    REQUIRE(mems_1.size() == mems_2.size());
+                    for (size_t i = 0; i < mems_1.size(); i++) {
+                        REQUIRE(mems_1[i] == mems_2[i]);
+                        REQUIRE(mems_1[i].range == mems_2[i].range);
+                        REQUIRE(mems_1[i].match_count == mems_2[i].match_count);
+                    }
+                    
+                    auto simple_1 = without_table.find_mems_simple(read.begin(), read.end(), 0, 1);
+                    auto simple_2 = with_table.find_mems_simple(read.begin(), read.end(), 0, 1);
+                    REQUIRE(simple_1.size() == simple_2.size());
+                    for (size_t i = 0; i < simple_1.size(); i++) {
+                        REQUIRE(simple_1[i] == simple_2[i]);
+                        REQUIRE(simple_1[i].range == simple_2[i].range);
+                    }
+                }
+            }
+        }
+    }
+    
+    // Clean up the GCSA/LCP index
+    delete gcsaidx;
+    delete lcpidx;
+    
+}
+
+TEST_CASE( "Canonical kmers are the same on both strands", "[mapper][rescue]" ) {
+    
+    auto kmers_of = [](const string& sequence, int kmer_size) {
+        vector<uint64_t> kmers;
+        for_each_canonical_kmer(sequence, kmer_size, [&](uint64_t kmer) {
+            kmers.push_back(kmer);
+        });
+        return kmers;
+    };
+    
+    SECTION( "Kmers are encoded as the smaller strand" ) {
+        // ACG is smaller than CGT, and GTA is smaller than TAC
+        REQUIRE(kmers_of("ACGTA", 3) == vector<uint64_t>{6, 6, 44});
+        REQUIRE(kmers_of("acgta", 3) == vector<uint64_t>{6, 6, 44});
+    }
+    
+    SECTION( "A sequence and its reverse complement have the same kmers" ) {
+        string sequence = "GATTACAGATTACAGATTACAGATTACAGATTACAGGC";
+        for (int kmer_size : {1, 5, 31, 32}) {
+            auto forward = kmers_of(sequence, kmer_size);
+            auto reverse = kmers_of(reverse_complement(sequence), kmer_size);
+            REQUIRE(forward.size() == sequence.size() - kmer_size + 1);
+            sort(forward.begin(), forward.end());
+            sort(reverse.begin(), reverse.end());
+            REQUIRE(forward == reverse);
+        }
+    }
+    
+    SECTION( "Kmers containing Ns are skipped" ) {
+        REQUIRE(kmers_of("ACNGTA", 3) == vector<uint64_t>{44});
+        REQUIRE(kmers_of("NNNNN", 3).empty());
+        REQUIRE(kmers_of("AC", 3).empty());
+    }
+}
+
+TEST_CASE( "Mapper cuts rescue contexts out of cached neighborhoods", "[mapper][rescue]" ) {
+    
+    string graph_json = R"({
+        "node": [
+            {"id": 1, "sequence": "GATTACA"},
+            {"id": 2, "sequence": "C"},
+            {"id": 3, "sequence": "T"},
+            {"id": 4, "sequence": "AGGCATT"},
+            {"id": 5, "sequence": "AAAAA"},
+            {"id": 6, "sequence": "CCCCC"}
+        ],
+        "edge": [
+            {"from": 1, "to": 2},
+            {"from": 1, "to": 3},
+            {"from": 2, "to": 4},
+            {"from": 3, "to": 4},
+            {"from": 4, "to": 5},
+            {"from": 5, "to": 6}
+        ]
+    })";
+    
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    xg::XG xg_index(proto_graph);
+    
+    // rescue doesn't need the MEM indexes
+    Mapper mapper(&xg_index, nullptr, nullptr);
+    
+    SECTION( "The kmer pre-filter and the cache are off by default" ) {
+        REQUIRE(mapper.rescue_cache_size == 0);
+        REQUIRE(mapper.rescue_kmer_size == 0);
+        REQUIRE(mapper.rescue_neighborhood(6, 10)->kmers.empty());
+        REQUIRE(mapper.rescue_prefilter("GTGTGT", {mapper.rescue_neighborhood(6, 10)}));
+    }
+    
+    SECTION( "Neighborhoods are reused until the mapper's configuration changes" ) {
+        mapper.rescue_cache_size = 256;
+        auto neighborhood = mapper.rescue_neighborhood(4, 10);
+        REQUIRE(mapper.rescue_neighborhood(4, 10) == neighborhood);
+        
+        // another mapper doesn't share them
+        Mapper other(&xg_index, nullptr, nullptr);
+        other.rescue_cache_size = 256;
+        REQUIRE(other.rescue_neighborhood(4, 10) != neighborhood);
+        neighborhood = mapper.rescue_neighborhood(4, 10);
+        
+        mapper.rescue_kmer_size = 3;
+        REQUIRE(mapper.rescue_neighborhood(4, 10) != neighborhood);
+        neighborhood = mapper.rescue_neighborhood(4, 10);
+        
+        // rescue asking for a different context length
+        REQUIRE(mapper.rescue_neighborhood(4, 20) != neighborhood);
+        
+        mapper.rescue_cache_size = 0;
+        REQUIRE(mapper.rescue_neighborhood(4, 20) != mapper.rescue_neighborhood(4, 20));
+    }
+    
+    SECTION( "Contexts cut out of neighborhoods match the index" ) {
+        for (id_t node_id = 1; node_id <= 6; node_id++) {
+            auto neighborhood = mapper.rescue_neighborhood(node_id, 10);
+            size_t node_length = xg_index.node_length(node_id);
+            for (size_t offset = 0; offset < node_length; offset++) {
+                for (bool is_reverse : {false, true}) {
+                    for (int64_t length : {0, 3, 10}) {
+                        pos_t pos = make_pos_t(node_id, is_reverse, offset);
+                        Graph from_index = xg_index.graph_context_id(pos, length);
+                        sort_by_id_dedup_and_clean(from_index);
+                        
+                        Graph cut;
+                        REQUIRE(neighborhood->extract_context(pos, length, cut));
+                        sort_by_id_dedup_and_clean(cut);
+                        REQUIRE(pb2json(cut) == pb2json(from_index));
+                    }
+                }
+            }
+        }
+    }
+    
+    SECTION( "Contexts reaching past the neighborhood are refused" ) {
+        // only nodes 1, 2 and 3 are within the node's length of the start of node 1
+        auto neighborhood = mapper.rescue_neighborhood(1, 0);
+        REQUIRE(neighborhood->node_index.size() == 3);
+        
+        Graph cut;
+        REQUIRE(!neighborhood->extract_context(make_pos_t(1, false, 0), 100, cut));
+        REQUIRE(cut.node_size() == 0);
+        REQUIRE(neighborhood->extract_context(make_pos_t(1, false, 0), 0, cut));
+        REQUIRE(cut.node_size() == 1);
+    }
+    
+    SECTION( "Neighborhood kmers include the ones crossing edges" ) {
+        mapper.rescue_kmer_size = 3;
+        // nodes 4, 5 and 6
+        auto& kmers = mapper.rescue_neighborhood(6, 10)->kmers;
+        REQUIRE(std::is_sorted(kmers.begin(), kmers.end()));
+        // AAC and ACC only occur across the edge from node 5 to node 6
+        REQUIRE(std::binary_search(kmers.begin(), kmers.end(), 1));
+        REQUIRE(std::binary_search(kmers.begin(), kmers.end(), 5));
+        // ACG doesn't occur at all
+        REQUIRE(!std::binary_search(kmers.begin(), kmers.end(), 6));
+    }
+    
+    SECTION( "The pre-filter passes mates sharing enough kmers with the neighborhoods" ) {
+        mapper.rescue_kmer_size = 3;
+        mapper.rescue_min_kmer_hits = 2;
+        vector<shared_ptr<Mapper::RescueNeighborhood>> neighborhoods{mapper.rescue_neighborhood(6, 10)};
+        
+        REQUIRE(mapper.rescue_prefilter("AAACCC", neighborhoods));
+        REQUIRE(!mapper.rescue_prefilter("GTGTGT", neighborhoods));
+        REQUIRE(!mapper.rescue_prefilter("NNNNNN", neighborhoods));
+        // only AAA is shared
+        REQUIRE(!mapper.rescue_prefilter("AAAGTG", neighborhoods));
+        mapper.rescue_min_kmer_hits = 1;
+        REQUIRE(mapper.rescue_prefilter("AAAGTG", neighborhoods));
+        
+        mapper.rescue_kmer_size = 0;
+        REQUIRE(mapper.rescue_prefilter("GTGTGT", neighborhoods));
+    }
+}
+
 TEST_CASE( "Mapper can annotate positions correctly on both strands", "[mapper][annotation]" ) {
     
     // This node is 73 bp long
@@ -13,6 +13,7 @@
 #include "catch.hpp"
 
 #include <map>
+#include <random>
 #include <set>
 #include <vector>
 
@@ -25,6 +26,22 @@ MinimizerIndex::minimizer_type get_minimizer(MinimizerIndex::key_type key, Minim
     return { key, wang_hash_64(key), offset, orientation };
 }
 
+// Is the kmer a closed syncmer with the given s-mer length?
+bool is_closed_syncmer(const std::string& kmer, size_t s) {
+    std::vector<size_t> hashes;
+    for (size_t i = 0; i + s <= kmer.length(); i++) {
+        std::string forward = kmer.substr(i, s), reverse = reverse_complement(forward);
+        MinimizerIndex::key_type forward_key = 0, reverse_key = 0;
+        for (size_t j = 0; j < s; j++) {
+            forward_key = (forward_key << MinimizerIndex::PACK_WIDTH) | MinimizerIndex::CHAR_TO_PACK[forward[j]];
+            reverse_key = (reverse_key << MinimizerIndex::PACK_WIDTH) | MinimizerIndex::CHAR_TO_PACK[reverse[j]];
+        }
+        hashes.push_back(std::min(wang_hash_64(forward_key), wang_hash_64(reverse_key)));
+    }
+    size_t smallest = *std::min_element(hashes.begin(), hashes.end());
+    return (hashes.front() == smallest || hashes.back() == smallest);
+}
+
 }
 
 TEST_CASE("MinimizerIndex construction, assignment, and serialization", "[minimizer_index][indexing]") {
@@ -407,5 +424,126 @@ TEST_CASE("Setting max_values works", "[minimizer_index][indexing]") {
     }
 }
 
+TEST_CASE("Single-probe lookups agree with find() and count()", "[minimizer_index][indexing]") {
+    constexpr size_t TOTAL_KEYS = 16;
+
+    // Keys 1, 5, 9, 13 become frequent, odd keys have 2 occurrences, and even keys have 1.
+    MinimizerIndex index(MinimizerIndex::KMER_LENGTH, MinimizerIndex::WINDOW_LENGTH, 2);
+    for (size_t i = 1; i <= TOTAL_KEYS; i++) {
+        index.insert(get_minimizer(i), make_pos_t(i, i & 1, i & MinimizerIndex::OFF_MASK));
+    }
+    for (size_t i = 1; i <= TOTAL_KEYS; i += 2) {
+        index.insert(get_minimizer(i), make_pos_t(i + 1, i & 1, (i + 1) & MinimizerIndex::OFF_MASK));
+    }
+    for (size_t i = 1; i <= TOTAL_KEYS; i += 4) {
+        index.insert(get_minimizer(i), make_pos_t(i + 2, i & 1, (i + 2) & MinimizerIndex::OFF_MASK));
+    }
+
+    SECTION("occurrence views match find() and count()") {
+        for (size_t i = 1; i <= 2 * TOTAL_KEYS; i++) {
+            MinimizerIndex::occurrence_view occs = index.occurrences(get_minimizer(i));
+            REQUIRE(occs.size() == index.count(get_minimizer(i)));
+            std::vector<pos_t> decoded;
+            for (MinimizerIndex::code_type code : occs) {
+                decoded.push_back(MinimizerIndex::decode(code));
+            }
+            if (occs.empty() && i <= TOTAL_KEYS) {
+                // Frequent keys are reported by find() as an empty position.
+                REQUIRE(index.find(get_minimizer(i)).size() == 1);
+            } else {
+                REQUIRE(decoded == index.find(get_minimizer(i)));
+            }
+        }
+    }
+
+    SECTION("appending respects the hit cap") {
+        std::vector<pos_t> output;
+        REQUIRE(index.append_occurrences(get_minimizer(3), output, 1) == 2);
+        REQUIRE(output.empty());
+        REQUIRE(index.append_occurrences(get_minimizer(3), output, 2) == 2);
+        REQUIRE(output == index.find(get_minimizer(3)));
+        REQUIRE(index.append_occurrences(get_minimizer(2), output) == 1);
+        REQUIRE(output.size() == 3);
+        REQUIRE(output.back() == index.find(get_minimizer(2)).front());
+        REQUIRE(index.append_occurrences(get_minimizer(1), output) == 0);
+        REQUIRE(output.size() == 3);
+    }
+}
+
+
+TEST_CASE("Syncmer sampling works correctly", "[minimizer_index][indexing]") {
+    size_t k = 15, w = 8, s = 6;
+    std::mt19937 rng(0xBEEF);
+    std::string str;
+    for (size_t i = 0; i < 500; i++) {
+        str += MinimizerIndex::PACK_TO_CHAR[rng() & MinimizerIndex::PACK_MASK];
+    }
+    std::string rev = reverse_complement(str);
+
+    MinimizerIndex full_index(k, w);
+    MinimizerIndex sampled_index(k, w, MinimizerIndex::MAX_OCCS, s);
+    std::vector<MinimizerIndex::minimizer_type> full = full_index.minimizers(str);
+    std::vector<MinimizerIndex::minimizer_type> sampled = sampled_index.minimizers(str);
+
+    SECTION("sampled minimizers are closed syncmers") {
+        for (auto& minimizer : sampled) {
+            size_t start = (minimizer.is_reverse ? minimizer.offset + 1 - k : minimizer.offset);
+            REQUIRE(is_closed_syncmer(str.substr(start, k), s));
+        }
+    }
+
+    SECTION("sampling reduces the number of minimizers") {
+        REQUIRE(!sampled.empty());
+        REQUIRE(sampled.size() < full.size());
+    }
+
+    SECTION("every window with a syncmer has a minimizer") {
+        std::vector<bool> is_start(str.length(), false);
+        for (auto& minimizer : sampled) {
+            is_start[minimizer.is_reverse ? minimizer.offset + 1 - k : minimizer.offset] = true;
+        }
+        for (size_t window_start = 0; window_start + k + w - 1 <= str.length(); window_start++) {
+            bool has_syncmer = false, has_minimizer = false;
+            for (size_t i = window_start; i < window_start + w; i++) {
+                has_syncmer |= is_closed_syncmer(str.substr(i, k), s);
+                has_minimizer |= is_start[i];
+            }
+            REQUIRE(has_minimizer == has_syncmer);
+        }
+    }
+
+    SECTION("both orientations have the same minimizers") {
+        std::vector<MinimizerIndex::minimizer_type> reverse_minimizers = sampled_index.minimizers(rev);
+        REQUIRE(sampled.size() == reverse_minimizers.size());
+        for (size_t i = 0; i < sampled.size(); i++) {
+            MinimizerIndex::minimizer_type& f = sampled[i];
+            MinimizerIndex::minimizer_type& r = reverse_minimizers[sampled.size() - 1 - i];
+            REQUIRE(f.key == r.key);
+            REQUIRE(f.offset == str.length() - 1 - r.offset);
+            REQUIRE(f.is_reverse != r.is_reverse);
+        }
+    }
+
+    SECTION("syncmer length is sanitized and serialized") {
+        MinimizerIndex short_index(5, 3, MinimizerIndex::MAX_OCCS, 7);
+        REQUIRE(short_index.s() == 4);
+
+        std::string filename = temp_file::create("minimizer");
+        std::ofstream out(filename, std::ios_base::binary);
+        sampled_index.serialize(out);
+        out.close();
+
+        MinimizerIndex copy;
+        std::ifstream in(filename, std::ios_base::binary);
+        copy.load(in);
+        in.close();
+        temp_file::remove(filename);
+
+        REQUIRE(copy.s() == s);
+        REQUIRE(copy == sampled_index);
+        REQUIRE(copy != full_index);
+    }
+}
+
 }
 }
@@ -0,0 +1,619 @@
+/// \file minimizer_mapper.cpp
+///
+/// Unit tests for the MinimizerMapper, which maps reads using minimizers and a GBWT
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "json2pb.h"
+#include <vg/vg.pb.h>
+#include "../minimizer_mapper.hpp"
+#include "../gbwt_helper.hpp"
+#include "../xg.hpp"
+#include "../vg.hpp"
+#include "../snarls.hpp"
+#include "../distance.hpp"
+#include "../funnel.hpp"
+#include "../utility.hpp"
+#include "../annotation.hpp"
+#include "../alignment_emitter.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+
+// We define a child class to expose all the protected stuff for testing
+class TestMinimizerMapper : public MinimizerMapper {
+public:
+    using MinimizerMapper::MinimizerMapper;
+    using MinimizerMapper::WorkBudget;
+    using MinimizerMapper::start_budget;
+    using MinimizerMapper::chain_extended_seeds;
+    using MinimizerMapper::walks_to;
+    using MinimizerMapper::rescue_mate;
+    using MinimizerMapper::fragment_length;
+    using MinimizerMapper::pair_score;
+    using MinimizerMapper::mapq_is_settled;
+};
+
+/// An AlignmentEmitter that just keeps everything emitted
+class CollectingEmitter : public AlignmentEmitter {
+public:
+    vector<Alignment> alignments;
+    
+    void emit_single(Alignment&& aln) {
+        alignments.emplace_back(std::move(aln));
+    }
+    void emit_mapped_single(vector<Alignment>&& alns) {
+        for (auto& aln : alns) {
+            alignments.emplace_back(std::move(aln));
+        }
+    }
+    void emit_pair(Alignment&& aln1, Alignment&& aln2, int64_t tlen_limit = 0) {
+        alignments.emplace_back(std::move(aln1));
+        alignments.emplace_back(std::move(aln2));
+    }
+    void emit_mapped_pair(vector<Alignment>&& alns1, vector<Alignment>&& alns2, int64_t tlen_limit = 0) {
+        emit_mapped_single(std::move(alns1));
+        emit_mapped_single(std::move(alns2));
+    }
+};
+
+namespace {
+
+/*
+ * A deletion bubble: CATGACTA(TTGC)GACCTAGA
+ */
+const string deletion_bubble_graph = R"(
+{
+    "node": [
+        {"id": 1, "sequence": "CATGACTA"},
+        {"id": 2, "sequence": "TTGC"},
+        {"id": 3, "sequence": "GACCTAGA"}
+    ],
+    "edge": [
+        {"from": 1, "to": 2},
+        {"from": 2, "to": 3},
+        {"from": 1, "to": 3}
+    ]
+}
+)";
+
+gbwt::vector_type bubble_path(const vector<id_t>& ids) {
+    gbwt::vector_type path;
+    for (id_t id : ids) {
+        path.push_back(static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(id, false)));
+    }
+    return path;
+}
+
+/// Make an extension that exactly covers the given read interval with a whole node
+GaplessExtension whole_node_extension(const HandleGraph& graph, id_t id, size_t read_start) {
+    handle_t handle = graph.get_handle(id, false);
+    size_t length = graph.get_length(handle);
+    return GaplessExtension {
+        { handle }, 0, gbwt::BidirectionalState(),
+        { read_start, read_start + length }, false,
+        { read_start, read_start + length }, {}
+    };
+}
+
+/*
+ * A SNP: GATTACACTGCAGTCCTAGGTCAAGCTTGACCATGGTACC(A/G)TGCATCGATCCGGAAGTTCACAGTTGCAAGCTCGGATACG
+ */
+const string snp_graph = R"(
+{
+    "node": [
+        {"id": 1, "sequence": "GATTACACTGCAGTCCTAGGTCAAGCTTGACCATGGTACC"},
+        {"id": 2, "sequence": "A"},
+        {"id": 3, "sequence": "G"},
+        {"id": 4, "sequence": "TGCATCGATCCGGAAGTTCACAGTTGCAAGCTCGGATACG"}
+    ],
+    "edge": [
+        {"from": 1, "to": 2},
+        {"from": 1, "to": 3},
+        {"from": 2, "to": 4},
+        {"from": 3, "to": 4}
+    ]
+}
+)";
+
+/// Index the minimizers of a haplotype that visits the given nodes forward
+void index_haplotype(MinimizerIndex& index, const HandleGraph& graph, const vector<id_t>& ids) {
+    vector<handle_t> traversal;
+    string sequence;
+    for (id_t id : ids) {
+        traversal.push_back(graph.get_handle(id, false));
+        sequence += graph.get_sequence(traversal.back());
+    }
+    for (auto& minimizer : index.minimizers(sequence)) {
+        if (minimizer.empty()) {
+            continue;
+        }
+        // Find the node covering the minimizer's starting position
+        auto iter = traversal.begin();
+        size_t node_start = 0;
+        while (node_start + graph.get_length(*iter) <= minimizer.offset) {
+            node_start += graph.get_length(*iter);
+            ++iter;
+        }
+        pos_t pos {graph.get_id(*iter), false, minimizer.offset - node_start};
+        if (minimizer.is_reverse) {
+            pos = reverse_base_pos(pos, graph.get_length(*iter));
+        }
+        index.insert(minimizer, pos);
+    }
+}
+
+/*
+ * Three SNP bubbles in separate components. The first is snp_graph, and the
+ * others each share a piece of its sequence.
+ */
+const string three_component_graph = R"(
+{
+    "node": [
+        {"id": 1, "sequence": "GATTACACTGCAGTCCTAGGTCAAGCTTGACCATGGTACC"},
+        {"id": 2, "sequence": "A"},
+        {"id": 3, "sequence": "G"},
+        {"id": 4, "sequence": "TGCATCGATCCGGAAGTTCACAGTTGCAAGCTCGGATACG"},
+        {"id": 11, "sequence": "GATTACACTGCAGTCCTAGGTCAAG"},
+        {"id": 12, "sequence": "T"},
+        {"id": 13, "sequence": "C"},
+        {"id": 14, "sequence": "GCTAAAGACAATTACATAACATACA"},
+        {"id": 21, "sequence": "CGTCAGCACGAAACTTGTTG"},
+        {"id": 22, "sequence": "A"},
+        {"id": 23, "sequence": "C"},
+        {"id": 24, "sequence": "TCGATCCGGAAGTTCACAGTTGCAA"}
+    ],
+    "edge": [
+        {"from": 1, "to": 2},
+        {"from": 1, "to": 3},
+        {"from": 2, "to": 4},
+        {"from": 3, "to": 4},
+        {"from": 11, "to": 12},
+        {"from": 11, "to": 13},
+        {"from": 12, "to": 14},
+        {"from": 13, "to": 14},
+        {"from": 21, "to": 22},
+        {"from": 21, "to": 23},
+        {"from": 22, "to": 24},
+        {"from": 23, "to": 24}
+    ]
+}
+)";
+
+/// Get the non-empty minimizers of a read
+vector<MinimizerIndex::minimizer_type> read_minimizers(const MinimizerIndex& index, const string& sequence) {
+    vector<MinimizerIndex::minimizer_type> result;
+    for (auto& minimizer : index.minimizers(sequence)) {
+        if (!minimizer.empty()) {
+            result.push_back(minimizer);
+        }
+    }
+    return result;
+}
+
+/// Make an alignment that starts at the given position with the given score
+Alignment alignment_at(const pos_t& pos, int score) {
+    Alignment aln;
+    *aln.mutable_path()->add_mapping()->mutable_position() = make_position(pos);
+    aln.set_score(score);
+    return aln;
+}
+
+/// Map a read and return its primary alignment
+Alignment map_read(MinimizerMapper& mapper, const string& sequence) {
+    Alignment aln;
+    aln.set_name("read");
+    aln.set_sequence(sequence);
+    CollectingEmitter emitter;
+    mapper.map(aln, emitter);
+    REQUIRE(!emitter.alignments.empty());
+    return emitter.alignments.front();
+}
+
+/// Check that an alignment is a real alignment of all of the given read
+void require_aligned(const Alignment& aln, const string& sequence) {
+    REQUIRE(aln.sequence() == sequence);
+    REQUIRE(aln.path().mapping_size() > 0);
+    REQUIRE(aln.score() > 0);
+    REQUIRE(path_to_length(aln.path()) == sequence.size());
+}
+
+/// Get the node IDs an alignment visits, in order
+vector<id_t> visited_ids(const Alignment& aln) {
+    vector<id_t> ids;
+    for (auto& mapping : aln.path().mapping()) {
+        if (ids.empty() || ids.back() != mapping.position().node_id()) {
+            ids.push_back(mapping.position().node_id());
+        }
+    }
+    return ids;
+}
+
+}
+
+TEST_CASE("MinimizerMapper::walks_to keeps walks that continue past an end", "[minimizer_mapper][mapping]") {
+
+    // A chain of three nodes from an arbitrary graph
+    handle_t a = as_handle(2), b = as_handle(4), c = as_handle(6);
+    vector<TreeSubgraph::TreeNode> forest {
+        {-1, a, 0, 3},
+        {0, b, 0, 2},
+        {1, c, 0, 1},
+        // And a branch that goes nowhere useful
+        {0, c, 0, 1}
+    };
+
+    SECTION("Walks to leaves are kept and dead branches are dropped") {
+        auto walks = TestMinimizerMapper::walks_to(forest, {2});
+        REQUIRE(walks.size() == 3);
+        REQUIRE(walks[2].parent == 1);
+        REQUIRE(walks[2].handle == c);
+    }
+
+    SECTION("A direct connection does not discard the walks") {
+        auto walks = TestMinimizerMapper::walks_to(forest, {-1, 2});
+        REQUIRE(walks.size() == 3);
+    }
+
+    SECTION("An end that other ends are reached through gets its own walk") {
+        auto walks = TestMinimizerMapper::walks_to(forest, {0, 2});
+        REQUIRE(walks.size() == 4);
+        // The walk through the first end is still there
+        REQUIRE(walks[1].parent == 0);
+        REQUIRE(walks[2].parent == 1);
+        // And the first end is a leaf of its own
+        REQUIRE(walks[3].parent == -1);
+        REQUIRE(walks[3].handle == a);
+
+        // So the forest has two walks
+        size_t leaves = 0;
+        for (size_t i = 0; i < walks.size(); i++) {
+            bool is_leaf = true;
+            for (auto& other : walks) {
+                if (other.parent == (int64_t) i) {
+                    is_leaf = false;
+                }
+            }
+            leaves += is_leaf;
+        }
+        REQUIRE(leaves == 2);
+    }
+}
+
+TEST_CASE("MinimizerMapper aligns gaps across deletion bubbles", "[minimizer_mapper][mapping]") {
+
+    Graph graph;
+    json2pb(graph, deletion_bubble_graph.c_str(), deletion_bubble_graph.size());
+    xg::XG xg_index(graph);
+
+    SECTION("With haplotypes that take and skip the bubble") {
+        gbwt::GBWT gbwt_index = get_gbwt({bubble_path({1, 2, 3}), bubble_path({1, 3})});
+        GBWTGraph gbwt_graph(gbwt_index, xg_index);
+        TestMinimizerMapper mapper(&xg_index, gbwt_graph, nullptr, nullptr, nullptr);
+
+        SECTION("A read with the long allele goes through the bubble, not directly across") {
+            Alignment aln;
+            aln.set_sequence("CATGACTATTGCGACCTAGA");
+            vector<GaplessExtension> extensions {
+                whole_node_extension(gbwt_graph, 1, 0),
+                whole_node_extension(gbwt_graph, 3, 12)
+            };
+
+            Alignment out;
+            auto budget = mapper.start_budget();
+            mapper.chain_extended_seeds(aln, extensions, out, budget);
+
+            REQUIRE(visited_ids(out) == vector<id_t>({1, 2, 3}));
+            REQUIRE(out.identity() == 1.0);
+            REQUIRE(!budget.dp_limited);
+        }
+
+        SECTION("A read with the deletion goes directly across") {
+            Alignment aln;
+            aln.set_sequence("CATGACTAGACCTAGA");
+            vector<GaplessExtension> extensions {
+                whole_node_extension(gbwt_graph, 1, 0),
+                whole_node_extension(gbwt_graph, 3, 8)
+            };
+
+            Alignment out;
+            auto budget = mapper.start_budget();
+            mapper.chain_extended_seeds(aln, extensions, out, budget);
+
+            REQUIRE(visited_ids(out) == vector<id_t>({1, 3}));
+            REQUIRE(out.identity() == 1.0);
+        }
+
+        SECTION("Without any DP budget, the read goes directly across") {
+            mapper.max_dp_cells = 0;
+
+            Alignment aln;
+            aln.set_sequence("CATGACTATTGCGACCTAGA");
+            vector<GaplessExtension> extensions {
+                whole_node_extension(gbwt_graph, 1, 0),
+                whole_node_extension(gbwt_graph, 3, 12)
+            };
+
+            Alignment out;
+            auto budget = mapper.start_budget();
+            mapper.chain_extended_seeds(aln, extensions, out, budget);
+
+            REQUIRE(visited_ids(out) == vector<id_t>({1, 3}));
+            REQUIRE(out.sequence() == aln.sequence());
+            REQUIRE(budget.dp_limited);
+            REQUIRE(budget.dp_cells_left == 0);
+        }
+    }
+
+    SECTION("With only haplotypes that take the bubble") {
+        gbwt::GBWT gbwt_index = get_gbwt({bubble_path({1, 2, 3})});
+        GBWTGraph gbwt_graph(gbwt_index, xg_index);
+        TestMinimizerMapper mapper(&xg_index, gbwt_graph, nullptr, nullptr, nullptr);
+
+        SECTION("Without any DP budget, the haplotype is deleted and the read sequence inserted") {
+            mapper.max_dp_cells = 0;
+
+            Alignment aln;
+            aln.set_sequence("CATGACTATTGCGACCTAGA");
+            vector<GaplessExtension> extensions {
+                whole_node_extension(gbwt_graph, 1, 0),
+                whole_node_extension(gbwt_graph, 3, 12)
+            };
+
+            Alignment out;
+            auto budget = mapper.start_budget();
+            mapper.chain_extended_seeds(aln, extensions, out, budget);
+
+            REQUIRE(visited_ids(out) == vector<id_t>({1, 2, 3}));
+            REQUIRE(out.sequence() == aln.sequence());
+            REQUIRE(out.identity() < 1.0);
+            REQUIRE(budget.dp_limited);
+            REQUIRE(budget.dp_cells_left == 0);
+        }
+    }
+}
+
+TEST_CASE("MinimizerMapper pairs and rescues mates that face each other", "[minimizer_mapper][mapping]") {
+
+    Graph graph;
+    json2pb(graph, snp_graph.c_str(), snp_graph.size());
+    xg::XG xg_index(graph);
+    VG vg_graph(graph);
+    
+    CactusSnarlFinder bubble_finder(vg_graph);
+    SnarlManager snarl_manager = bubble_finder.find_snarls();
+    DistanceIndex distance_index(&xg_index, &snarl_manager, 20);
+    
+    gbwt::GBWT gbwt_index = get_gbwt({bubble_path({1, 2, 4}), bubble_path({1, 3, 4})});
+    GBWTGraph gbwt_graph(gbwt_index, xg_index);
+    
+    MinimizerIndex minimizer_index(11, 3);
+    index_haplotype(minimizer_index, gbwt_graph, {1, 2, 4});
+    
+    TestMinimizerMapper mapper(&xg_index, gbwt_graph, &minimizer_index, &snarl_manager, &distance_index);
+    
+    // The reference haplotype, and a fragment spanning most of it
+    string reference = "GATTACACTGCAGTCCTAGGTCAAGCTTGACCATGGTACCATGCATCGATCCGGAAGTTCACAGTTGCAAGCTCGGATACG";
+    string mate1_sequence = reference.substr(0, 30);
+    string mate2_sequence = reverse_complement(reference.substr(50, 30));
+    
+    SECTION("Fragment length takes mate 2 on the other strand") {
+        pos_t mate1_start = make_pos_t(1, false, 0);
+        int64_t length = mapper.fragment_length(mate1_start, make_pos_t(4, true, 0));
+        REQUIRE(length != -1);
+        // Moving mate 2 along its strand shortens the fragment
+        REQUIRE(mapper.fragment_length(mate1_start, make_pos_t(4, true, 10)) == length - 10);
+        // Mates on the same strand do not make a fragment
+        REQUIRE(mapper.fragment_length(mate1_start, make_pos_t(4, false, 0)) == -1);
+        // And neither do mates that face away from each other
+        REQUIRE(mapper.fragment_length(make_pos_t(4, true, 0), make_pos_t(1, false, 0)) == -1);
+    }
+    
+    SECTION("Pairs are scored by how likely their fragment length is") {
+        Alignment aln1 = alignment_at(make_pos_t(1, false, 0), 30);
+        Alignment expected = alignment_at(make_pos_t(4, true, 0), 30);
+        Alignment short_fragment = alignment_at(make_pos_t(4, true, 20), 30);
+        mapper.fragment_length_mean = mapper.fragment_length(make_pos_t(1, false, 0), make_pos_t(4, true, 0));
+        mapper.fragment_length_stdev = 5;
+        
+        REQUIRE(mapper.pair_score(aln1, expected) == 60);
+        REQUIRE(mapper.pair_score(aln1, short_fragment) < 60);
+        
+        // A pair on the same strand or with an unaligned mate is not a pair
+        REQUIRE(std::isnan(mapper.pair_score(aln1, alignment_at(make_pos_t(4, false, 0), 30))));
+        REQUIRE(std::isnan(mapper.pair_score(aln1, Alignment())));
+    }
+    
+    SECTION("Mate 2 is rescued on the other strand from mate 1") {
+        Alignment anchor = alignment_at(make_pos_t(1, false, 0), 30);
+        Alignment mate;
+        mate.set_sequence(mate2_sequence);
+        
+        Alignment rescued = mate;
+        Funnel funnel;
+        funnel.start(mate.name());
+        auto budget = mapper.start_budget();
+        REQUIRE(mapper.rescue_mate(anchor, true, mate, read_minimizers(minimizer_index, mate.sequence()), rescued, budget, funnel));
+        REQUIRE(rescued.score() > 0);
+        REQUIRE(rescued.path().mapping(0).position().node_id() == 4);
+        REQUIRE(rescued.path().mapping(0).position().is_reverse());
+        REQUIRE(!std::isnan(mapper.pair_score(anchor, rescued)));
+    }
+    
+    SECTION("Mate 1 is rescued on the other strand from mate 2") {
+        Alignment anchor = alignment_at(make_pos_t(4, true, 1), 30);
+        Alignment mate;
+        mate.set_sequence(mate1_sequence);
+        
+        Alignment rescued = mate;
+        Funnel funnel;
+        funnel.start(mate.name());
+        auto budget = mapper.start_budget();
+        REQUIRE(mapper.rescue_mate(anchor, false, mate, read_minimizers(minimizer_index, mate.sequence()), rescued, budget, funnel));
+        REQUIRE(rescued.score() > 0);
+        REQUIRE(rescued.path().mapping(0).position().node_id() == 1);
+        REQUIRE(!rescued.path().mapping(0).position().is_reverse());
+    }
+    
+    SECTION("A mate on the same strand as the anchor is not rescued") {
+        Alignment anchor = alignment_at(make_pos_t(1, false, 0), 30);
+        Alignment mate;
+        mate.set_sequence(reference.substr(50, 30));
+        
+        Alignment rescued = mate;
+        Funnel funnel;
+        funnel.start(mate.name());
+        auto budget = mapper.start_budget();
+        REQUIRE(!mapper.rescue_mate(anchor, true, mate, read_minimizers(minimizer_index, mate.sequence()), rescued, budget, funnel));
+    }
+    
+    SECTION("A mate too far from the anchor is not rescued") {
+        mapper.fragment_distance_limit = 40;
+        Alignment anchor = alignment_at(make_pos_t(1, false, 0), 30);
+        Alignment mate;
+        mate.set_sequence(mate2_sequence);
+        
+        Alignment rescued = mate;
+        Funnel funnel;
+        funnel.start(mate.name());
+        auto budget = mapper.start_budget();
+        REQUIRE(!mapper.rescue_mate(anchor, true, mate, read_minimizers(minimizer_index, mate.sequence()), rescued, budget, funnel));
+    }
+}
+
+TEST_CASE("MinimizerMapper only settles MAPQ on an aligned winner", "[minimizer_mapper][mapping]") {
+
+    Graph graph;
+    json2pb(graph, deletion_bubble_graph.c_str(), deletion_bubble_graph.size());
+    xg::XG xg_index(graph);
+    gbwt::GBWT gbwt_index = get_gbwt({bubble_path({1, 2, 3})});
+    GBWTGraph gbwt_graph(gbwt_index, xg_index);
+    TestMinimizerMapper mapper(&xg_index, gbwt_graph, nullptr, nullptr, nullptr);
+    
+    vector<Alignment> alignments(2);
+    alignments[0].set_score(100);
+    alignments[1].set_score(5);
+    vector<size_t> unaligned {0, 1};
+    
+    SECTION("A far better aligned alignment settles the MAPQ") {
+        vector<int> score_estimates {5, 5};
+        REQUIRE(mapper.mapq_is_settled(alignments, score_estimates, unaligned.begin(), unaligned.end()));
+    }
+    
+    SECTION("An unaligned group that could win does not settle the MAPQ") {
+        alignments[0].set_score(5);
+        vector<int> score_estimates {100, 5};
+        REQUIRE(!mapper.mapq_is_settled(alignments, score_estimates, unaligned.begin(), unaligned.end()));
+    }
+    
+    SECTION("Close alignments do not settle the MAPQ") {
+        vector<int> score_estimates {100, 5};
+        REQUIRE(!mapper.mapq_is_settled(alignments, score_estimates, unaligned.begin(), unaligned.end()));
+    }
+}
+
+TEST_CASE("MinimizerMapper work limits stop work and still align the read", "[minimizer_mapper][mapping]") {
+
+    Graph graph;
+    json2pb(graph, snp_graph.c_str(), snp_graph.size());
+    xg::XG xg_index(graph);
+    VG vg_graph(graph);
+    
+    CactusSnarlFinder bubble_finder(vg_graph);
+    SnarlManager snarl_manager = bubble_finder.find_snarls();
+    DistanceIndex distance_index(&xg_index, &snarl_manager, 20);
+    
+    gbwt::GBWT gbwt_index = get_gbwt({bubble_path({1, 2, 4}), bubble_path({1, 3, 4})});
+    GBWTGraph gbwt_graph(gbwt_index, xg_index);
+    
+    MinimizerIndex minimizer_index(11, 3);
+    index_haplotype(minimizer_index, gbwt_graph, {1, 2, 4});
+    
+    TestMinimizerMapper mapper(&xg_index, gbwt_graph, &minimizer_index, &snarl_manager, &distance_index);
+    
+    string reference = "GATTACACTGCAGTCCTAGGTCAAGCTTGACCATGGTACCATGCATCGATCCGGAAGTTCACAGTTGCAAGCTCGGATACG";
+    
+    // A read with a run of substitutions around the SNP, so it has to be
+    // chained through the bubble
+    string substituted = reference;
+    for (size_t i = 36; i < 46; i++) {
+        substituted[i] = reverse_complement(substituted[i]);
+    }
+    
+    SECTION("Without limits, nothing is limited") {
+        Alignment aln = map_read(mapper, substituted);
+        require_aligned(aln, substituted);
+        REQUIRE(!get_annotation<bool>(aln, "seed_budget_limited"));
+        REQUIRE(!get_annotation<bool>(aln, "gbwt_budget_limited"));
+        REQUIRE(!get_annotation<bool>(aln, "dp_budget_limited"));
+    }
+    
+    SECTION("A read limited to one seed is still aligned from it") {
+        mapper.max_seeds = 1;
+        string read = reference.substr(0, 60);
+        Alignment aln = map_read(mapper, read);
+        require_aligned(aln, read);
+        REQUIRE(get_annotation<bool>(aln, "seed_budget_limited"));
+        REQUIRE(aln.identity() == 1.0);
+    }
+    
+    SECTION("A read limited to one GBWT search state is still aligned") {
+        mapper.max_gbwt_states = 1;
+        Alignment aln = map_read(mapper, substituted);
+        require_aligned(aln, substituted);
+        REQUIRE(get_annotation<bool>(aln, "gbwt_budget_limited"));
+    }
+    
+    SECTION("A read without any DP budget is still aligned") {
+        mapper.max_dp_cells = 0;
+        Alignment aln = map_read(mapper, substituted);
+        require_aligned(aln, substituted);
+        REQUIRE(get_annotation<bool>(aln, "dp_budget_limited"));
+    }
+}
+
+TEST_CASE("MinimizerMapper can stop aligning once the MAPQ is settled", "[minimizer_mapper][mapping]") {
+
+    Graph graph;
+    json2pb(graph, three_component_graph.c_str(), three_component_graph.size());
+    xg::XG xg_index(graph);
+    VG vg_graph(graph);
+    
+    CactusSnarlFinder bubble_finder(vg_graph);
+    SnarlManager snarl_manager = bubble_finder.find_snarls();
+    DistanceIndex distance_index(&xg_index, &snarl_manager, 20);
+    
+    gbwt::GBWT gbwt_index = get_gbwt({bubble_path({1, 2, 4}), bubble_path({11, 12, 14}), bubble_path({21, 22, 24})});
+    GBWTGraph gbwt_graph(gbwt_index, xg_index);
+    
+    MinimizerIndex minimizer_index(11, 3);
+    index_haplotype(minimizer_index, gbwt_graph, {1, 2, 4});
+    index_haplotype(minimizer_index, gbwt_graph, {11, 12, 14});
+    index_haplotype(minimizer_index, gbwt_graph, {21, 22, 24});
+    
+    TestMinimizerMapper mapper(&xg_index, gbwt_graph, &minimizer_index, &snarl_manager, &distance_index);
+    
+    // The read matches all of the first component, and pieces of the others
+    string read = "GATTACACTGCAGTCCTAGGTCAAGCTTGACCATGGTACCATGCATCGATCCGGAAGTTCACAGTTGCAA";
+    
+    SECTION("By default all the extension groups are considered") {
+        Alignment aln = map_read(mapper, read);
+        require_aligned(aln, read);
+        REQUIRE(visited_ids(aln) == vector<id_t>({1, 2, 4}));
+        REQUIRE(!get_annotation<bool>(aln, "stopped_at_mapq_cap"));
+    }
+    
+    SECTION("With stop_at_mapq_cap, aligning stops after the first two groups") {
+        mapper.stop_at_mapq_cap = true;
+        Alignment aln = map_read(mapper, read);
+        require_aligned(aln, read);
+        REQUIRE(visited_ids(aln) == vector<id_t>({1, 2, 4}));
+        REQUIRE(aln.mapping_quality() == 60);
+        REQUIRE(get_annotation<bool>(aln, "stopped_at_mapq_cap"));
+    }
+}
+
+}
+}
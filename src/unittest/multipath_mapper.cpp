@@ -22,6 +22,7 @@ public:
     using MultipathMapper::align_to_cluster_graph_pairs;
     using MultipathMapper::query_cluster_graphs;
     using MultipathMapper::multipath_align;
+    using MultipathMapper::release_cluster_graph;
     using MultipathMapper::strip_full_length_bonuses;
     using MultipathMapper::sort_and_compute_mapping_quality;
     using MultipathMapper::read_coverage;
@@ -156,7 +157,7 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
 
     // Remember the important types:
     // vector<clustergraph_t>
-    // using clustergraph_t = tuple<VG*, memcluster_t, size_t>;
+    // using clustergraph_t = tuple<SubHandleGraph*, memcluster_t, size_t>;
     // using memcluster_t = vector<pair<const MaximalExactMatch*, pos_t>>;
     
     SECTION("no MEMs produce no graphs") {
@@ -166,8 +167,8 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
         REQUIRE(results.size() == 0);
         
         for (auto cluster_graph : results) {
-            // Clean up all those vg graphs
-            delete get<0>(cluster_graph);
+            // Give the cluster graphs back to the pool
+            mapper.release_cluster_graph(get<0>(cluster_graph));
         }
     
     }
@@ -203,8 +204,8 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
         REQUIRE(get<2>(results[0]) == 3);
         
         for (auto cluster_graph : results) {
-            // Clean up all those vg graphs
-            delete get<0>(cluster_graph);
+            // Give the cluster graphs back to the pool
+            mapper.release_cluster_graph(get<0>(cluster_graph));
         }
     
     }
@@ -239,8 +240,8 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
         REQUIRE(get<2>(results[0]) == 7);
         
         for (auto cluster_graph : results) {
-            // Clean up all those vg graphs
-            delete get<0>(cluster_graph);
+            // Give the cluster graphs back to the pool
+            mapper.release_cluster_graph(get<0>(cluster_graph));
         }
     
     }
@@ -276,8 +277,8 @@ TEST_CASE( "MultipathMapper::query_cluster_graphs works", "[multipath][mapping][
         REQUIRE(get<2>(results[0]) == 7);
         
         for (auto cluster_graph : results) {
-            // Clean up all those vg graphs
-            delete get<0>(cluster_graph);
+            // Give the cluster graphs back to the pool
+            mapper.release_cluster_graph(get<0>(cluster_graph));
         }
     
     }
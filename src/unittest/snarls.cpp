@@ -13,6 +13,8 @@
 #include "catch.hpp"
 #include "snarls.hpp"
 #include "genotypekit.hpp"
+#include "snarl_tree_index.hpp"
+#include "distance.hpp"
 #include <vg/io/protobuf_emitter.hpp>
 #include <vg/io/vpkg.hpp>
 
@@ -3584,5 +3586,203 @@ namespace vg {
             
         }
         
+        TEST_CASE("SnarlTreeIndex answers the same queries as the SnarlManager", "[snarls]") {
+            
+            // A chain of three snarls, with a nested snarl in the middle one:
+            //
+            //    2      6     9
+            //  1   4  5   7 8   11
+            //    3      10    12
+            //
+            const string graph_json = R"(
+            
+            {
+                "node": [
+                    {"id": 1, "sequence": "A"},
+                    {"id": 2, "sequence": "A"},
+                    {"id": 3, "sequence": "A"},
+                    {"id": 4, "sequence": "A"},
+                    {"id": 5, "sequence": "A"},
+                    {"id": 6, "sequence": "A"},
+                    {"id": 7, "sequence": "A"},
+                    {"id": 8, "sequence": "A"},
+                    {"id": 9, "sequence": "A"},
+                    {"id": 10, "sequence": "A"},
+                    {"id": 11, "sequence": "A"},
+                    {"id": 12, "sequence": "A"}
+                ],
+                "edge": [
+                    {"from": 1, "to": 2},
+                    {"from": 1, "to": 3},
+                    {"from": 2, "to": 4},
+                    {"from": 3, "to": 4},
+                    {"from": 4, "to": 5},
+                    {"from": 4, "to": 10},
+                    {"from": 5, "to": 6},
+                    {"from": 6, "to": 7},
+                    {"from": 5, "to": 7},
+                    {"from": 7, "to": 8},
+                    {"from": 10, "to": 8},
+                    {"from": 8, "to": 9},
+                    {"from": 8, "to": 12},
+                    {"from": 9, "to": 11},
+                    {"from": 12, "to": 11}
+                ]
+            }
+            
+            )";
+            
+            VG graph;
+            Graph chunk;
+            json2pb(chunk, graph_json.c_str(), graph_json.size());
+            graph.extend(chunk);
+            
+            SnarlManager snarl_manager = CactusSnarlFinder(graph).find_snarls();
+            
+            // Number the managed snarls in preorder
+            vector<const Snarl*> preorder;
+            snarl_manager.for_each_snarl_preorder([&](const Snarl* snarl) {
+                preorder.push_back(snarl);
+            });
+            auto number_of = [&](const Snarl* snarl) -> size_t {
+                if (snarl == nullptr) {
+                    return SnarlTreeIndex::no_snarl;
+                }
+                return find(preorder.begin(), preorder.end(), snarl) - preorder.begin();
+            };
+            
+            auto check_index = [&](const SnarlTreeIndex& index) {
+                REQUIRE(index.snarl_count() == preorder.size());
+                
+                for (size_t i = 0; i < preorder.size(); i++) {
+                    const Snarl* snarl = preorder[i];
+                    REQUIRE(index.start_of(i) == snarl->start());
+                    REQUIRE(index.end_of(i) == snarl->end());
+                    REQUIRE(index.type_of(i) == snarl->type());
+                    REQUIRE(index.parent_of(i) == number_of(snarl_manager.parent_of(snarl)));
+                    REQUIRE(index.is_leaf(i) == snarl_manager.is_leaf(snarl));
+                    REQUIRE(index.is_root(i) == snarl_manager.is_root(snarl));
+                    REQUIRE(index.in_nontrivial_chain(i) == snarl_manager.in_nontrivial_chain(snarl));
+                    REQUIRE(index.chain_rank_of(i) == snarl_manager.chain_rank_of(snarl));
+                    REQUIRE(index.chain_orientation_of(i) == snarl_manager.chain_orientation_of(snarl));
+                    REQUIRE(index.chain_member(index.chain_of(i), index.chain_rank_of(i)).first == i);
+                    
+                    vector<size_t> children;
+                    index.for_each_child(i, [&](size_t child) {
+                        children.push_back(child);
+                    });
+                    vector<size_t> expected_children;
+                    for (const Snarl* child : snarl_manager.children_of(snarl)) {
+                        expected_children.push_back(number_of(child));
+                    }
+                    REQUIRE(children == expected_children);
+                    
+                    REQUIRE(index.into_which_snarl(to_visit(*snarl)) == i);
+                }
+                
+                for (id_t id = 0; id <= 13; id++) {
+                    for (bool reverse : {false, true}) {
+                        REQUIRE(index.into_which_snarl(id, reverse) == number_of(snarl_manager.into_which_snarl(id, reverse)));
+                    }
+                }
+            };
+            
+            SECTION("The index matches the SnarlManager") {
+                SnarlTreeIndex index(snarl_manager);
+                check_index(index);
+            }
+            
+            SECTION("The index can be saved and loaded") {
+                SnarlTreeIndex index(snarl_manager);
+                stringstream buff;
+                index.serialize(buff);
+                
+                SnarlTreeIndex loaded(buff);
+                check_index(loaded);
+            }
+            
+            SECTION("A SnarlManager loaded from the index gives the same answers") {
+                SnarlTreeIndex index(snarl_manager);
+                stringstream buff;
+                vg::io::VPKG::save(index, buff);
+                
+                unique_ptr<SnarlManager> loaded = load_snarl_manager(buff);
+                REQUIRE(loaded.get() != nullptr);
+                
+                // Snarls in the loaded manager must correspond to the original ones in preorder
+                vector<const Snarl*> loaded_preorder;
+                loaded->for_each_snarl_preorder([&](const Snarl* snarl) {
+                    loaded_preorder.push_back(snarl);
+                });
+                REQUIRE(loaded_preorder.size() == preorder.size());
+                auto original_of = [&](const Snarl* snarl) -> const Snarl* {
+                    if (snarl == nullptr) {
+                        return nullptr;
+                    }
+                    return preorder.at(find(loaded_preorder.begin(), loaded_preorder.end(), snarl) - loaded_preorder.begin());
+                };
+                for (size_t i = 0; i < preorder.size(); i++) {
+                    REQUIRE(loaded_preorder[i]->start() == preorder[i]->start());
+                    REQUIRE(loaded_preorder[i]->end() == preorder[i]->end());
+                    REQUIRE(loaded_preorder[i]->type() == preorder[i]->type());
+                    REQUIRE(loaded_preorder[i]->start_end_reachable() == preorder[i]->start_end_reachable());
+                    REQUIRE(original_of(loaded->parent_of(loaded_preorder[i])) == snarl_manager.parent_of(preorder[i]));
+                    REQUIRE(loaded->in_nontrivial_chain(loaded_preorder[i]) == snarl_manager.in_nontrivial_chain(preorder[i]));
+                    REQUIRE(loaded->chain_rank_of(loaded_preorder[i]) == snarl_manager.chain_rank_of(preorder[i]));
+                    REQUIRE(loaded->chain_orientation_of(loaded_preorder[i]) == snarl_manager.chain_orientation_of(preorder[i]));
+                }
+                for (id_t id = 1; id <= 12; id++) {
+                    for (bool reverse : {false, true}) {
+                        REQUIRE(original_of(loaded->into_which_snarl(id, reverse)) == snarl_manager.into_which_snarl(id, reverse));
+                    }
+                }
+                
+                // And a DistanceIndex built from it must measure the same distances
+                DistanceIndex original_distances(&graph, &snarl_manager, 20);
+                DistanceIndex loaded_distances(&graph, loaded.get(), 20);
+                for (id_t from = 1; from <= 12; from++) {
+                    for (id_t to = 1; to <= 12; to++) {
+                        for (bool to_reverse : {false, true}) {
+                            pos_t pos1 = make_pos_t(from, false, 0);
+                            pos_t pos2 = make_pos_t(to, to_reverse, 0);
+                            REQUIRE(loaded_distances.minDistance(pos1, pos2) == original_distances.minDistance(pos1, pos2));
+                        }
+                    }
+                }
+            }
+            
+            SECTION("Snarls and indexes load from streams that can't seek") {
+                // Like a pipe, this can only be read through once
+                class UnseekableBuffer : public std::streambuf {
+                public:
+                    UnseekableBuffer(const string& contents) : contents(contents) {
+                        char* begin = const_cast<char*>(this->contents.data());
+                        setg(begin, begin, begin + this->contents.size());
+                    }
+                private:
+                    string contents;
+                };
+                
+                SnarlTreeIndex index(snarl_manager);
+                stringstream index_buff;
+                vg::io::VPKG::save(index, index_buff);
+                stringstream snarls_buff;
+                vg::io::VPKG::save(snarl_manager, snarls_buff);
+                
+                for (auto saved : {index_buff.str(), snarls_buff.str()}) {
+                    UnseekableBuffer buffer(saved);
+                    istream in(&buffer);
+                    REQUIRE(in.tellg() == streampos(-1));
+                    
+                    unique_ptr<SnarlManager> loaded = load_snarl_manager(in);
+                    REQUIRE(loaded.get() != nullptr);
+                    size_t loaded_count = 0;
+                    loaded->for_each_snarl_preorder([&](const Snarl* snarl) {
+                        loaded_count++;
+                    });
+                    REQUIRE(loaded_count == preorder.size());
+                }
+            }
+        }
     }
 }
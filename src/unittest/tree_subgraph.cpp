@@ -0,0 +1,104 @@
+/// \file tree_subgraph.cpp
+///
+/// Unit tests for the TreeSubgraph class.
+///
+
+#include <iostream>
+#include <string>
+#include "../json2pb.h"
+#include <vg/vg.pb.h>
+#include "../vg.hpp"
+#include "../tree_subgraph.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+    TEST_CASE("TreeSubgraph presents a forest of walks in another graph", "[handle][minimizer]") {
+
+        string graph_json = R"(
+        {"node":[{"id":1,"sequence":"GATT"},
+                 {"id":2,"sequence":"ACA"},
+                 {"id":3,"sequence":"CG"}],
+         "edge":[{"from":1,"to":2},
+                 {"from":1,"to":3,"to_end":true}]}
+        )";
+
+        Graph proto_graph;
+        json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+        VG base(proto_graph);
+
+        // Take the end of node 1, then all of node 2 or the first base of node 3 backward
+        vector<TreeSubgraph::TreeNode> nodes {
+            {-1, base.get_handle(1, false), 1, 3},
+            {0, base.get_handle(2, false), 0, 3},
+            {0, base.get_handle(3, true), 0, 1}
+        };
+        TreeSubgraph tree(&base, std::move(nodes));
+
+        SECTION("Nodes have the sequences of their ranges") {
+            REQUIRE(tree.node_size() == 3);
+            REQUIRE(tree.get_sequence(tree.get_handle(1)) == "ATT");
+            REQUIRE(tree.get_sequence(tree.get_handle(2)) == "ACA");
+            REQUIRE(tree.get_sequence(tree.get_handle(3)) == "C");
+            REQUIRE(tree.get_sequence(tree.get_handle(1, true)) == "AAT");
+            REQUIRE(tree.total_length() == 7);
+            REQUIRE(tree.leaf_count() == 2);
+        }
+
+        SECTION("Edges go from parents to children") {
+            vector<handle_t> next;
+            tree.follow_edges(tree.get_handle(1), false, [&](const handle_t& h) {
+                next.push_back(h);
+            });
+            REQUIRE(next == vector<handle_t>{tree.get_handle(2), tree.get_handle(3)});
+
+            next.clear();
+            tree.follow_edges(tree.get_handle(3, true), false, [&](const handle_t& h) {
+                next.push_back(h);
+            });
+            REQUIRE(next == vector<handle_t>{tree.get_handle(1, true)});
+
+            next.clear();
+            tree.follow_edges(tree.get_handle(1), true, [&](const handle_t& h) {
+                next.push_back(h);
+            });
+            REQUIRE(next.empty());
+        }
+
+        SECTION("Paths translate down to the backing graph") {
+            string path_json = R"(
+            {"mapping":[{"position":{"node_id":1,"offset":1},"edit":[{"from_length":2,"to_length":2}]},
+                        {"position":{"node_id":3},"edit":[{"from_length":1,"to_length":1}]}]}
+            )";
+            Path path;
+            json2pb(path, path_json.c_str(), path_json.size());
+
+            Path translated = tree.translate_down(path);
+            REQUIRE(translated.mapping_size() == 2);
+            REQUIRE(translated.mapping(0).position().node_id() == 1);
+            REQUIRE(translated.mapping(0).position().offset() == 2);
+            REQUIRE(!translated.mapping(0).position().is_reverse());
+            REQUIRE(translated.mapping(1).position().node_id() == 3);
+            REQUIRE(translated.mapping(1).position().offset() == 0);
+            REQUIRE(translated.mapping(1).position().is_reverse());
+
+            string reverse_json = R"(
+            {"mapping":[{"position":{"node_id":3,"is_reverse":true},"edit":[{"from_length":1,"to_length":1}]},
+                        {"position":{"node_id":1,"is_reverse":true},"edit":[{"from_length":3,"to_length":3}]}]}
+            )";
+            Path reverse_path;
+            json2pb(reverse_path, reverse_json.c_str(), reverse_json.size());
+
+            Path reverse_translated = tree.translate_down(reverse_path);
+            REQUIRE(reverse_translated.mapping(0).position().node_id() == 3);
+            REQUIRE(reverse_translated.mapping(0).position().offset() == 1);
+            REQUIRE(!reverse_translated.mapping(0).position().is_reverse());
+            REQUIRE(reverse_translated.mapping(1).position().node_id() == 1);
+            REQUIRE(reverse_translated.mapping(1).position().offset() == 0);
+            REQUIRE(reverse_translated.mapping(1).position().is_reverse());
+        }
+    }
+}
+}
@@ -2535,6 +2535,44 @@ namespace vg {
                 REQUIRE(found_edge_0);
                 REQUIRE(found_edge_1);
             }
+            
+            SECTION( "Containing graph extraction into a subgraph view finds the same nodes" ) {
+                
+                vector<size_t> forward_max_lens{3, 3};
+                vector<size_t> backward_max_lens{2, 3};
+                vector<pos_t> positions{make_pos_t(n0->id(), true, 2), make_pos_t(n5->id(), false, 1)};
+                
+                VG extractor;
+                algorithms::extract_containing_graph(&vg, &extractor, positions, forward_max_lens, backward_max_lens);
+                
+                SubHandleGraph subgraph(&vg);
+                algorithms::extract_containing_graph(&vg, &subgraph, positions, forward_max_lens, backward_max_lens);
+                
+                REQUIRE(subgraph.node_size() == extractor.node_size());
+                extractor.for_each_handle([&](const handle_t& handle) {
+                    REQUIRE(subgraph.has_node(extractor.get_id(handle)));
+                });
+                
+                // the view gets its edges from the super graph
+                REQUIRE(subgraph.has_edge(subgraph.get_handle(n4->id(), false), subgraph.get_handle(n5->id(), true)));
+                REQUIRE(subgraph.has_edge(subgraph.get_handle(n7->id(), false), subgraph.get_handle(n0->id(), false)));
+                
+                SECTION( "The subgraph view can be reset and reused" ) {
+                    
+                    subgraph.reset(&vg);
+                    REQUIRE(subgraph.node_size() == 0);
+                    
+                    vector<pos_t> other_positions{make_pos_t(n2->id(), false, 0)};
+                    vector<size_t> max_lens{0};
+                    algorithms::extract_containing_graph(&vg, &subgraph, other_positions, max_lens, max_lens);
+                    
+                    REQUIRE(subgraph.node_size() == 1);
+                    REQUIRE(subgraph.has_node(n2->id()));
+                    REQUIRE(!subgraph.has_node(n0->id()));
+                    REQUIRE(subgraph.min_node_id() == n2->id());
+                    REQUIRE(subgraph.max_node_id() == n2->id());
+                }
+            }
         }
         
         TEST_CASE( "Extending graph extraction algorithm produces expected results", "[algorithms]" ) {
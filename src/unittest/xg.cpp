@@ -8,6 +8,7 @@
 #include "vg.hpp"
 #include "xg.hpp"
 #include "graph.hpp"
+#include "xg_position.hpp"
 #include <stdio.h>
 
 namespace vg {
@@ -704,5 +705,58 @@ TEST_CASE("Looping over XG handles in parallel works", "[xg]") {
 
 }
 
+TEST_CASE("Position helpers walk an xg index through handles", "[xg]") {
+
+    string graph_json = R"(
+    {"node":[{"id":1,"sequence":"GATT"},
+    {"id":2,"sequence":"ACA"},
+    {"id":3,"sequence":"CCG"}],
+    "edge":[{"from":1,"to":2},
+    {"from":1,"to":3,"to_end":true}]}
+    )";
+    
+    // Load the JSON
+    Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    
+    // Build the xg index and a VG to compare against
+    xg::XG xg_index(proto_graph);
+    VG vg;
+    vg.extend(proto_graph);
+    
+    SECTION("next characters inside a node") {
+        map<pos_t, char> expected { {make_pos_t(1, false, 1), 'A'} };
+        REQUIRE(xg_next_pos_chars(make_pos_t(1, false, 0), &xg_index) == expected);
+        REQUIRE(graph_next_pos_chars(make_pos_t(1, false, 0), &vg) == expected);
+        
+        expected = { {make_pos_t(1, true, 1), 'A'} };
+        REQUIRE(xg_next_pos_chars(make_pos_t(1, true, 0), &xg_index) == expected);
+        REQUIRE(graph_next_pos_chars(make_pos_t(1, true, 0), &vg) == expected);
+    }
+    
+    SECTION("next characters across edges") {
+        map<pos_t, char> expected { {make_pos_t(2, false, 0), 'A'}, {make_pos_t(3, true, 0), 'C'} };
+        REQUIRE(xg_next_pos_chars(make_pos_t(1, false, 3), &xg_index) == expected);
+        REQUIRE(graph_next_pos_chars(make_pos_t(1, false, 3), &vg) == expected);
+        
+        expected = { {make_pos_t(1, true, 0), 'A'} };
+        REQUIRE(xg_next_pos_chars(make_pos_t(3, false, 2), &xg_index) == expected);
+        REQUIRE(graph_next_pos_chars(make_pos_t(3, false, 2), &vg) == expected);
+        REQUIRE(xg_next_pos_chars(make_pos_t(2, true, 2), &xg_index) == expected);
+    }
+    
+    SECTION("characters and distances") {
+        REQUIRE(xg_pos_char(make_pos_t(3, true, 0), &xg_index) == 'C');
+        REQUIRE(graph_pos_char(make_pos_t(3, true, 2), &vg) == 'G');
+        REQUIRE(xg_distance(make_pos_t(1, false, 0), make_pos_t(2, false, 1), 10, &xg_index) == 5);
+        REQUIRE(graph_distance(make_pos_t(1, false, 0), make_pos_t(2, false, 1), 10, &vg) == 5);
+        
+        set<pos_t> expected { make_pos_t(2, false, 1), make_pos_t(3, true, 1) };
+        REQUIRE(xg_positions_bp_from(make_pos_t(1, false, 2), 3, false, &xg_index) == expected);
+        REQUIRE(graph_positions_bp_from(make_pos_t(1, false, 2), 3, false, &vg) == expected);
+    }
+
+}
+
 }
 }
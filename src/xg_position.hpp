@@ -4,6 +4,7 @@
 #include <vg/vg.pb.h>
 #include "types.hpp"
 #include "xg.hpp"
+#include "cached_position.hpp"
 #include "lru_cache.h"
 #include "utility.hpp"
 #include "json2pb.h"
@@ -11,23 +12,23 @@
 #include <iostream>
 
 /** \file 
- * Functions for working with cached Positions and `pos_t`s.
+ * Functions for working with Positions and `pos_t`s in an xg::XG.
  */
 
 namespace vg {
 
 using namespace std;
 
-// xg/position traversal helpers with caching
+// xg/position traversal helpers
 // used by the Sampler and by the Mapper
 string xg_node_sequence(id_t id, const xg::XG* xgidx);
-/// Get the length of a Node from an xg::XG index, with cacheing of deserialized nodes.
+/// Get the length of a Node from an xg::XG index.
 size_t xg_node_length(id_t id, const xg::XG* xgidx);
 /// Get the node start position in the sequence vector
 int64_t xg_node_start(id_t id, const xg::XG* xgidx);
-/// Get the character at a position in an xg::XG index, with cacheing of deserialized nodes.
+/// Get the character at a position in an xg::XG index.
 char xg_pos_char(pos_t pos, const xg::XG* xgidx);
-/// Get the characters at positions after the given position from an xg::XG index, with cacheing of deserialized nodes.
+/// Get the characters at positions after the given position from an xg::XG index.
 map<pos_t, char> xg_next_pos_chars(pos_t pos, const xg::XG* xgidx);
 set<pos_t> xg_next_pos(pos_t pos, bool whole_node, const xg::XG* xgidx);
 int64_t xg_distance(pos_t pos1, pos_t pos2, int64_t maximum, const xg::XG* xgidx);
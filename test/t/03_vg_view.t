@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 20
+plan tests 23
 
 is $(vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz | vg view -d - | wc -l) 505 "view produces the expected number of lines of dot output"
 is $(vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz | vg view -g - | wc -l) 503 "view produces the expected number of lines of GFA output"
@@ -60,3 +60,11 @@ rm -f errors.txt
 vg view -Fv overlaps/corrected_overlap.gfa >/dev/null
 is "$?" "0" "GFA import accepts that file when the offending overlap length is fixed"
 
+
+printf 'H\tVN:Z:1.0\nS\t1\tGATT\nS\t2\tACA\nS\t3\tCA\nL\t1\t+\t2\t+\t0M\nP\tpath1\t1+,2+,3+\t*\n' >missing_link.gfa
+vg view -Fv missing_link.gfa >/dev/null 2>/dev/null
+is "$?" "1" "GFA import rejects a path that crosses a link that is not present"
+rm -f missing_link.gfa
+
+is "$(cat graphs/normalize_me.gfa | vg view -Fv - | vg stats -zl -)" "$(vg view -Fv graphs/normalize_me.gfa | vg stats -zl -)" "a blunt GFA can be imported from a pipe"
+is "$(cat overlaps/two_snvs_assembly1.gfa | vg view -Fv - | vg stats -l - | cut -f2)" "315" "a GFA with overlaps can be imported from a pipe"
@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="en_US.utf8" # force ekg's favorite sort order 
 
-plan tests 55
+plan tests 56
 
 # Single graph without haplotypes
 vg construct -r small/x.fa -v small/x.vcf.gz > x.vg
@@ -274,9 +274,12 @@ rm -f r.gcsa.lcp c.gcsa.lcp t.gcsa.lcp
 
 # Test distance index 
 vg construct -r small/x.fa -v small/x.vcf.gz > x.vg
-vg snarls -t x.vg > snarls.pb
+vg snarls -t -I snarls.sti x.vg > snarls.pb
 
 vg index -s snarls.pb -j distIndex -w 100 x.vg
 is $? 0 "building a distance index of a graph"
 
-rm -f x.vg distIndex snarls.pb
+vg index -s snarls.sti -j distIndex2 -w 100 x.vg
+is $? 0 "building a distance index from a snarl tree index"
+
+rm -f x.vg distIndex distIndex2 snarls.pb snarls.sti
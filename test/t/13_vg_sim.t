@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 12
+plan tests 15
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg x.vg
@@ -44,4 +44,10 @@ is $(vg sim -N -n 1000 -l 20 -x n.xg | grep -o N | uniq | wc -l) 1 "sim can emit
 
 is $(vg sim -n 1000 -l 2 -p 5 -e 0.1 -x n.xg | grep N | wc -l) 0 "sim doesn't emit Ns even with pair and errors"
 
+is "$(vg sim -l 100 -n 100 -s 27 -t 2 -x x.xg | md5sum)" "$(vg sim -l 100 -n 100 -s 27 -t 2 -x x.xg | md5sum)" "vg sim output is reproducible for a fixed seed and thread count"
+
+is "$(vg sim -l 100 -n 99 -s 27 -t 1 -x x.xg | wc -l) $(vg sim -l 100 -n 99 -s 27 -t 4 -x x.xg | wc -l)" "99 99" "vg sim makes the same number of reads with different thread counts"
+
+isnt "$(vg sim -l 100 -n 100 -t 2 -x x.xg | md5sum)" "$(vg sim -l 100 -n 100 -t 2 -x x.xg | md5sum)" "vg sim with multiple threads and no seed is not reproducible"
+
 rm -f x.vg x.xg n.vg n.fa n.xg
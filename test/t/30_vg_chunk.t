@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 16
+plan tests 20
 
 # Construct a graph with alt paths so we can make a gPBWT and later a GBWT
 vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz -a >x.vg
@@ -36,6 +36,17 @@ is $(grep x _chunk_test_out.bed | wc -l) 2 "gam chunker produces bed with correc
 is "$(vg view -aj _chunk_test_0_x_0_199.gam | wc -l)" "$(vg view -aj _chunk_test_0_x_0_199.gam | sort | uniq | wc -l)" "gam chunker emits each matching read at most once"
 is "$(vg view -aj _chunk_test_1_x_500_627.gam | wc -l)" "225" "chunk contains the expected number of alignments"
 
+#check that batch chunking gives the same chunks as chunking each region on its own
+printf "x\t2\t200\nx\t150\t400\nx\t500\t600\n" > _chunk_batch_bed.bed
+vg chunk -x x.xg -a x.sorted.gam -g -b _chunk_single -e _chunk_batch_bed.bed -E _chunk_single_out.bed -c 2
+vg chunk -x x.xg -a x.sorted.gam -g -b _chunk_batch -e _chunk_batch_bed.bed -E _chunk_batch_out.bed -c 2 -B 10
+is "$(cut -f 1-3 _chunk_batch_out.bed | md5sum)" "$(cut -f 1-3 _chunk_single_out.bed | md5sum)" "batch chunking produces the same regions as per-region chunking"
+is "$(for f in _chunk_batch_*.vg; do vg view $f | sort; done | md5sum)" "$(for f in _chunk_single_*.vg; do vg view $f | sort; done | md5sum)" "batch chunking produces the same graphs as per-region chunking"
+is "$(for f in _chunk_batch_*.gam; do vg view -aj $f | sort; done | md5sum)" "$(for f in _chunk_single_*.gam; do vg view -aj $f | sort; done | md5sum)" "batch chunking produces the same reads as per-region chunking"
+vg chunk -x x.xg -a x.sorted.gam -g -b _chunk_batch -e _chunk_batch_bed.bed -c 2 -B -1 2>/dev/null
+is "$?" "1" "batch chunking rejects a batch size that is not positive"
+rm -f _chunk_batch* _chunk_single*
+
 #check that id ranges work
 is $(vg chunk -x x.xg -r 1:3 -c 0 | vg view - -j | jq .node | grep id |  wc -l) 3 "id chunker produces correct chunk size"
 is $(vg chunk -x x.xg -r 1 -c 0 | vg view - -j | jq .node | grep id | wc -l) 1 "id chunker produces correct single chunk"
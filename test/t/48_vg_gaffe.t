@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+
+BASH_TAP_ROOT=../deps/bash-tap
+. ../deps/bash-tap/bash-tap-bootstrap
+
+PATH=../bin:$PATH # for vg
+
+plan tests 5
+
+
+# Build all the indexes gaffe needs
+vg construct -r small/x.fa -v small/x.vcf.gz -a > x.vg 2> /dev/null
+vg index -x x.xg -G x.gbwt -v small/x.vcf.gz x.vg
+vg snarls x.vg > x.snarls
+vg index -s x.snarls -j x.dist -w 100 x.vg
+vg minimizer -t 1 -i x.mi x.xg
+
+# Unpaired reads
+vg sim -x x.xg -n 100 -l 100 -a -s 1 > reads.gam
+vg gaffe -x x.xg -H x.gbwt -m x.mi -s x.snarls -d x.dist -G reads.gam -t 1 > mapped.gam
+is $? 0 "gaffe maps unpaired reads"
+is $(vg view -aj mapped.gam | jq -c 'select(.path.mapping != null)' | wc -l) 100 "gaffe aligns all unpaired reads"
+
+# Interleaved pairs, with mate 2 read from the other strand
+vg sim -x x.xg -n 50 -l 50 -p 200 -v 10 -a -s 1 > pairs.gam
+vg gaffe -x x.xg -H x.gbwt -m x.mi -s x.snarls -d x.dist -G pairs.gam -i --fragment-mean 200 --fragment-stdev 10 -t 1 > mapped_pairs.gam
+is $? 0 "gaffe maps interleaved pairs"
+is $(vg view -aj mapped_pairs.gam | jq -c 'select(.path.mapping != null)' | wc -l) 100 "gaffe aligns both mates of every pair"
+is $(vg view -aj mapped_pairs.gam | jq -r '.path.mapping[0].position.is_reverse // false' | paste - - | awk '$1 != $2' | wc -l) 50 "gaffe pairs mates on opposite strands"
+
+rm -f x.vg x.xg x.gbwt x.snarls x.dist x.mi reads.gam mapped.gam pairs.gam mapped_pairs.gam